@@ -0,0 +1,115 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaAutoExposure.h
+// Closed loop exposure control from the frame histograms
+
+#ifndef DHYANAAUTOEXPOSURE_H_
+#define DHYANAAUTOEXPOSURE_H_
+
+#include "DhyanaCompatibility.h"
+#include "DhyanaFrameHistogram.h"
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct AutoExposureStatus
+ * \brief state of the auto exposure loop
+ *******************************************************************/
+struct LIBDHYANA_API AutoExposureStatus
+{
+    bool        converged;
+    int         nb_iterations;      // exposure changes since the loop was (re)started
+    int         frame_nb;           // last frame used
+    double      exp_time;           // last exposure requested (s)
+    double      measured;           // percentile value of the last frame
+    double      target;             // target value of the percentile
+    double      saturated_fraction; // fraction of the pixels in the last histogram bin
+};
+
+/*******************************************************************
+ * \class AutoExposure
+ * \brief drive the exposure so that a percentile of the frame reaches a target level
+ *
+ * The correction is done in the log domain : exp *= (target / measured) ^ damping,
+ * bounded by the max step and the exposure bounds. Above the allowed
+ * saturated fraction, the exposure is halved. After a change, the
+ * frames already in the camera buffers (settle frames) are ignored.
+ *******************************************************************/
+class LIBDHYANA_API AutoExposure
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "AutoExposure", "Dhyana");
+
+public:
+    AutoExposure();
+    ~AutoExposure();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    //! percentile in ]0, 1], level as a fraction of the full scale in ]0, 1]
+    void setTarget(double percentile, double level);
+    void getTarget(double& percentile, double& level) const;
+    void setMaxSaturated(double fraction);
+    double getMaxSaturated() const;
+    void setExposureBounds(double min_exp_time, double max_exp_time);
+    void getExposureBounds(double& min_exp_time, double& max_exp_time) const;
+    //! ]0, 1], 1 : full correction at each step
+    void setDamping(double damping);
+    double getDamping() const;
+    //! relative error on the target below which the loop is converged
+    void setTolerance(double tolerance);
+    double getTolerance() const;
+    void setSettleFrames(int nb_frames);
+    int getSettleFrames() const;
+
+    void getStatus(AutoExposureStatus& status) const;
+    //! restart the loop (convergence and iterations)
+    void reset();
+
+    //! true if the exposure must be changed to new_exp_time
+    bool update(const FrameHistogramData& histogram, double exp_time, double& new_exp_time);
+
+private:
+    mutable Mutex       m_mutex;
+    bool                m_enable;
+    double              m_percentile;
+    double              m_level;
+    double              m_max_saturated;
+    double              m_min_exp_time;
+    double              m_max_exp_time;
+    double              m_damping;
+    double              m_tolerance;
+    double              m_max_step;
+    int                 m_settle_frames;
+    int                 m_settle_remaining;
+    AutoExposureStatus  m_status;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAAUTOEXPOSURE_H_ */
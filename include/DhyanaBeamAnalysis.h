@@ -0,0 +1,136 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaBeamAnalysis.h
+// Beam centroid, width and projections of each frame
+
+#ifndef DHYANABEAMANALYSIS_H_
+#define DHYANABEAMANALYSIS_H_
+
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct BeamResult
+ * \brief beam parameters of a frame, in frame pixels
+ *
+ * valid is false if no pixel is above the threshold.
+ * The projections are only filled if they are enabled.
+ *******************************************************************/
+struct LIBDHYANA_API BeamResult
+{
+    int                 frame_nb;       // Lima acq frame nb
+    double              timestamp;      // readout time (s)
+    bool                valid;
+    double              total;          // sum of the pixels after background and threshold
+    double              centroid_x;
+    double              centroid_y;
+    double              sigma_x;        // second moment
+    double              sigma_y;
+    double              fwhm_x;         // from the projections, linear interpolation at half max
+    double              fwhm_y;
+    int                 peak_x;         // max of the projections
+    int                 peak_y;
+    std::vector<float>  projection_x;   // sum of each column
+    std::vector<float>  projection_y;   // sum of each row
+};
+
+/*******************************************************************
+ * \class BeamResultCallback
+ * \brief called from the acquisition thread after each frame
+ *******************************************************************/
+class LIBDHYANA_API BeamResultCallback
+{
+public:
+    virtual ~BeamResultCallback() {}
+    virtual void beamResultReady(const BeamResult& result) = 0;
+};
+
+/*******************************************************************
+ * \class BeamAnalysis
+ * \brief row/column projections, moments and FWHM of each frame
+ *
+ * Each pixel is taken as max(pixel - background, 0) and ignored below
+ * the threshold (applied after the background subtraction). 16 bits
+ * frames are projected with SSE2 in a single pass.
+ *******************************************************************/
+class LIBDHYANA_API BeamAnalysis
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "BeamAnalysis", "Dhyana");
+
+public:
+    BeamAnalysis();
+    ~BeamAnalysis();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    void setBackground(double background);
+    double getBackground() const;
+    void setThreshold(double threshold);
+    double getThreshold() const;
+    //! publish the projections with the results
+    void setProjections(bool enable);
+    bool getProjections() const;
+    void setHistorySize(int size);
+    int getHistorySize() const;
+
+    void registerCallback(BeamResultCallback& cb);
+    void unregisterCallback(BeamResultCallback& cb);
+
+    //! false if no frame was processed since the last reset
+    bool getLast(BeamResult& result) const;
+    //! oldest first, without the projections
+    void getHistory(std::vector<BeamResult>& history) const;
+    void reset();
+
+    void process(const void* frame, ImageType type, int width, int height, int frame_nb);
+
+private:
+    void computeResult();
+    void publish(bool with_projections);
+
+    mutable Mutex               m_mutex;
+    bool                        m_enable;
+    double                      m_background;
+    double                      m_threshold;
+    bool                        m_projections;
+    std::vector<BeamResult>     m_history;
+    int                         m_history_next;
+    int                         m_history_count;
+    BeamResult                  m_current;      // acquisition thread scratch
+
+    Mutex                       m_callback_mutex;
+    BeamResultCallback*         m_callback;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANABEAMANALYSIS_H_ */
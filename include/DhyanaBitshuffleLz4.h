@@ -0,0 +1,76 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaBitshuffleLz4.h
+// Bitshuffle + LZ4 chunk codec, compatible with the HDF5 bitshuffle filter
+
+#ifndef DHYANABITSHUFFLELZ4_H_
+#define DHYANABITSHUFFLELZ4_H_
+
+#include <cstddef>
+#include <vector>
+#include "DhyanaCompatibility.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class BitshuffleLz4
+ * \brief compress a chunk as the HDF5 bitshuffle filter (id 32008) with LZ4
+ *
+ * Chunk layout (all sizes big endian) :
+ *   uint64 uncompressed size (bytes), uint32 block size (bytes)
+ *   for each block : uint32 compressed size, LZ4 block of the bitshuffled block
+ *   the last nb_elements % 8 elements, copied as is
+ * The chunks can be written with H5Dwrite_chunk in a dataset created with
+ * the filter 32008, cd_values = {0, 2, elem_size, block_size, 2}.
+ *
+ * The context (LZ4 hash table, shuffle buffer) is not shared : use one
+ * BitshuffleLz4 per thread.
+ *******************************************************************/
+class LIBDHYANA_API BitshuffleLz4
+{
+public:
+    BitshuffleLz4();
+    ~BitshuffleLz4();
+
+    //! 8192 bytes per block (as the filter), in elements, multiple of 8
+    static size_t defaultBlockSize(size_t elem_size);
+    //! worst case size of a chunk, block_size in elements (0 : default)
+    static size_t maxCompressedSize(size_t nb_elements, size_t elem_size, size_t block_size);
+
+    //! compress nb_elements into dst (at least maxCompressedSize bytes), return the chunk size
+    size_t compress(const void* src, size_t nb_elements, size_t elem_size, size_t block_size, void* dst);
+    //! decompress a chunk into dst, return false if the chunk is corrupted or bigger than dst_size
+    bool decompress(const void* src, size_t src_size, size_t elem_size, void* dst, size_t dst_size);
+
+private:
+    std::vector<unsigned char>  m_shuffled;
+    std::vector<unsigned int>   m_hash_table;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANABITSHUFFLELZ4_H_ */
@@ -30,14 +30,34 @@
 
 #include <ostream>
 #include <map>
+#include <vector>
 #include <process.h>
 #include "DhyanaCompatibility.h"
 #include "lima/HwBufferMgr.h"
 #include "lima/HwInterface.h"
+#include "lima/HwMaxImageSizeCallback.h"
 #include "lima/Debug.h"
 #include "lima/Timer.h"
 #include "TUCamApi.h"
 #include "TUDefine.h"
+#include "DhyanaHdrMerger.h"
+#include "DhyanaFrameCorrection.h"
+#include "DhyanaDefectMap.h"
+#include "DhyanaFrameStatistics.h"
+#include "DhyanaFrameHistogram.h"
+#include "DhyanaAutoExposure.h"
+#include "DhyanaBeamAnalysis.h"
+#include "DhyanaFrameAccumulator.h"
+#include "DhyanaLivePreview.h"
+#include "DhyanaFrameCompressor.h"
+#include "DhyanaStreamRecorder.h"
+#include "DhyanaReplaySource.h"
+#include "DhyanaFramePublisher.h"
+#include "DhyanaFrameStreamServer.h"
+#include "DhyanaTucamSdk.h"
+#include "DhyanaProfileStore.h"
+#include "DhyanaParameterCache.h"
+#include "DhyanaTelemetryRing.h"
 
 
 using namespace std;
@@ -62,11 +82,81 @@ const int PIXEL_NB_HEIGHT_MODEL_4040 = 4096;
 class BufferCtrlObj;
 class CSoftTriggerTimer;
 
+/*******************************************************************
+ * \class CameraFrameCallback
+ * \brief called by the acquisition thread for each frame given to Lima
+ *******************************************************************/
+class LIBDHYANA_API CameraFrameCallback
+{
+public:
+    virtual ~CameraFrameCallback() {}
+    //! timestamp : host time (s) when the frame was received from the camera
+    virtual void frameReady(int frame_nb, double timestamp) = 0;
+};
+
+/*******************************************************************
+ * \struct CameraInitTimings
+ * \brief duration (s) of the phases of the camera initialization
+ *******************************************************************/
+struct LIBDHYANA_API CameraInitTimings
+{
+    double  sdk_init;           // TUCAM_Api_Init, shared by the cameras of the process
+    double  device_open;        // TUCAM_Dev_Open
+    double  capability_probe;   // model, image size, versions
+    double  parameter_cache;    // parameters map, roi
+    double  total;
+};
+
+/*******************************************************************
+ * \struct LinkStatus
+ * \brief state of the link to the camera and reconnection counters
+ *******************************************************************/
+struct LIBDHYANA_API LinkStatus
+{
+    bool        connected;
+    bool        reconnecting;
+    int         nb_losses;              // link lost
+    int         nb_recoveries;          // camera reopened and settings restored
+    double      last_recovery_time;     // duration of the last reconnection (s)
+    std::string fault_reason;           // empty if the camera is not in Fault
+};
+
+/*******************************************************************
+ * \struct ProfileStats
+ * \brief result of the last applied profile
+ *******************************************************************/
+struct LIBDHYANA_API ProfileStats
+{
+    std::string name;
+    bool        camera_side;    // TUCAM_File_LoadProfiles done first
+    int         nb_values;      // settings of the profile
+    int         nb_written;     // settings different from the current ones
+    double      duration;       // (s)
+    std::string error;          // the profile is partly applied, empty if it was fully applied
+};
+
+/*******************************************************************
+ * \struct UsbBufferStats
+ * \brief occupancy of the SDK USB transfer buffer since the last prepareAcq
+ *******************************************************************/
+struct LIBDHYANA_API UsbBufferStats
+{
+    int         total_frames;       // TUIDI_TOTALBUFFRAMES, 0 if the camera does not report it
+    int         current_frames;     // TUIDI_CURRENTBUFFRAMES after the last frame
+    double      occupancy;          // current_frames / total_frames
+    int         peak_frames;
+    double      peak_occupancy;
+    int         nb_overruns;        // times the buffer was found full, frames may be lost
+    bool        shedding;           // the optional stages are skipped
+    int         nb_shed_frames;     // frames without the optional stages
+    int         nb_shed_periods;    // times the high water mark was crossed
+};
+
 /*******************************************************************
  * \class Camera
  * \brief object controlling the Dhyana camera
  *******************************************************************/
-class LIBDHYANA_API Camera
+class LIBDHYANA_API Camera : public HwMaxImageSizeCallbackGen
 {
     DEB_CLASS_NAMESPC(DebModCamera, "Camera", "Dhyana");
 
@@ -74,7 +164,7 @@ public:
 
     enum Status
     {
-        Ready, Exposure, Readout, Latency, Fault
+        Ready, Exposure, Readout, Latency, Fault, Initializing
     } ;
 
     enum TucamTriggerMode
@@ -111,7 +201,9 @@ public:
       kGainLow  = TUGAIN_LOW
     };
 
-    Camera(unsigned short timer_period_ms);
+    //! the camera is selected by its serial number, or by its TUCAM index if serial_number is empty
+    //! with async_init, the camera is initialized by a thread and the status is Initializing until it is done
+    Camera(unsigned short timer_period_ms, int camera_index = 0, const std::string& serial_number = "", bool async_init = false);
     virtual ~Camera();
 
     void init();
@@ -122,12 +214,72 @@ public:
     void getStatus(Camera::Status& status);
     int  getNbHwAcquiredFrames();
 
+    // -- asynchronous init
+    bool isInitialized();
+    //! throws if the init failed or is not done within timeout (s), -1 : no timeout
+    //! the HwInterface getters and setters (image size and type, pixel size, model, roi, exposure, trigger) wait for it
+    void waitInit(double timeout = -1.);
+    void getInitError(std::string& error);
+    void getInitTimings(CameraInitTimings& timings);
+
+    // -- link monitoring and automatic reconnection
+    void setAutoReconnect(bool enable);
+    void getAutoReconnect(bool& enable);
+    void setReconnectTimeout(double timeout);
+    void getReconnectTimeout(double& timeout);
+    void setLinkPollPeriod(double period);
+    void getLinkPollPeriod(double& period);
+    bool isConnected();
+    void reconnect();
+    void getFaultReason(std::string& reason);
+    void getLinkStatus(LinkStatus& status);
+
+    // -- named configuration profiles (see ProfileStore)
+    void setProfileDirectory(const std::string& directory);
+    void getProfileDirectory(std::string& directory);
+    //! camera_side : also stored in the camera by TUCAM_File_SaveProfiles
+    void saveProfile(const std::string& name, bool camera_side = true);
+    //! only the settings different from the current ones are written
+    void applyProfile(const std::string& name);
+    void deleteProfile(const std::string& name);
+    void listProfiles(std::vector<std::string>& names);
+    void getProfile(const std::string& name, ProfileValues& values);
+    void getProfileStats(ProfileStats& stats);
+
+    // -- background sampling of the temperatures, fan and USB buffer
+    void setTelemetry(bool enable);
+    void getTelemetry(bool& enable);
+    void setTelemetryPeriod(double period);
+    void getTelemetryPeriod(double& period);
+    bool getLastTelemetry(TelemetrySample& sample);
+    //! samples with a timestamp after since (s), the oldest first
+    void getTelemetryHistory(std::vector<TelemetrySample>& history, double since = 0.);
+
+    // -- USB transfer buffer occupancy, the optional stages are shed when it fills up
+    //! statistics, histogram, auto exposure, beam analysis and preview are skipped above the high water mark
+    void setUsbBufferShedding(bool enable);
+    void getUsbBufferShedding(bool& enable);
+    //! fractions of the buffer, the shedding stops below the low water mark
+    void setUsbBufferWaterMarks(double low, double high);
+    void getUsbBufferWaterMarks(double& low, double& high);
+    void getUsbBufferStats(UsbBufferStats& stats);
+    //! frames in the USB buffer now (TUIDI_CURRENTBUFFRAMES), -1 if unknown
+    int getNbBufferedFrames();
+
+    // -- host side cache of the parameters written to and read from the camera
+    void setParameterCache(bool enable);
+    void getParameterCache(bool& enable);
+    void invalidateParameterCache();
+    void getParameterCacheStats(ParameterCacheStats& stats);
+
     // -- detector info object
     void getImageType(ImageType& type);
     void setImageType(ImageType type);
 
     void getDetectorType(std::string& type);
     void getDetectorModel(std::string& model);
+    void getSerialNumber(std::string& serial_number);
+    void getCameraIndex(int& index);
     void getDetectorImageSize(Size& size);
     void getPixelSize(double& sizex, double& sizey);
 
@@ -183,12 +335,206 @@ public:
     void setTriggerMode(TucamTriggerMode mode);
     void getTriggerEdge(TucamTriggerEdge& edge);
     void setTriggerEdge(TucamTriggerEdge edge);
+    void getTriggerDelay(int& delay);
+    void setTriggerDelay(int delay);
+    void getTriggerBufFrames(int& nb_frames);
+    void setTriggerBufFrames(int nb_frames);
+    void getBurstFrames(int& nb_frames);
+    void setBurstFrames(int nb_frames);
     void getOutputSignal(int port, TucamSignal& signal, TucamSignalEdge& edge, int& delay, int& width);
     void setOutputSignal(int port, TucamSignal signal, TucamSignalEdge edge=kSignalEdgeRising, int delay=-1, int width=-1);
     bool is_trigOutput_available();
 
+    // -- host side HDR merge of the high gain and low gain readouts
+    void setHdrMerge(bool enable);
+    void getHdrMerge(bool& enable);
+    void setHdrKFactor(double k);
+    void getHdrKFactor(double& k);
+    void setHdrThreshold(unsigned threshold);
+    void getHdrThreshold(unsigned& threshold);
+    void setHdrBlendWidth(unsigned width);
+    void getHdrBlendWidth(unsigned& width);
+    void setHdrOffsets(unsigned high_offset, unsigned low_offset);
+    void getHdrOffsets(unsigned& high_offset, unsigned& low_offset);
+    void setHdrOutputType(ImageType type);
+    void getHdrOutputType(ImageType& type);
+    void calibrateHdrKFactor();
+
+    // -- dark and flat field correction in the frame copy
+    void setCorrection(bool enable);
+    void getCorrection(bool& enable);
+    void setCorrectionOutputType(ImageType type);
+    void getCorrectionOutputType(ImageType& type);
+    void setCorrectionClamp(bool clamp);
+    void getCorrectionClamp(bool& clamp);
+    void loadCorrectionOffsetMap(const std::string& file_name);
+    void loadCorrectionGainMap(const std::string& file_name);
+    void saveCorrectionOffsetMap(const std::string& file_name);
+    void clearCorrectionMaps();
+    void startDarkAccumulation(int nb_frames);
+    void abortDarkAccumulation();
+    void getDarkAccumulationRemaining(int& nb_frames);
+
+    // -- defective pixels replacement in the frame copy
+    void setDefectCorrection(bool enable);
+    void getDefectCorrection(bool& enable);
+    void setDefectReplacement(DefectMap::Replacement replacement);
+    void getDefectReplacement(DefectMap::Replacement& replacement);
+    void buildDefectMap(double hot_sigma, double gain_tolerance);
+    void loadDefectMap(const std::string& file_name);
+    void saveDefectMap(const std::string& file_name);
+    void clearDefectMap();
+    void getNbDefects(int& nb_defects);
+
+    // -- per frame statistics
+    void setStatistics(bool enable);
+    void getStatistics(bool& enable);
+    void setStatisticsSaturationLevel(double level);
+    void getStatisticsSaturationLevel(double& level);
+    void setStatisticsRois(const std::vector<Roi>& rois);
+    void getStatisticsRois(std::vector<Roi>& rois);
+    void setStatisticsHistorySize(int size);
+    void getStatisticsHistorySize(int& size);
+    void registerStatisticsCallback(FrameStatsCallback& cb);
+    void unregisterStatisticsCallback(FrameStatsCallback& cb);
+    bool getLastStatistics(FrameStats& stats, std::vector<FrameStats>& roi_stats);
+    void getStatisticsHistory(std::vector<FrameStats>& history);
+
+    // -- per frame histogram
+    void setHistogram(bool enable);
+    void getHistogram(bool& enable);
+    void setHistogramSource(FrameHistogram::Source source);
+    void getHistogramSource(FrameHistogram::Source& source);
+    void setHistogramNbBins(int nb_bins);
+    void getHistogramNbBins(int& nb_bins);
+    void setHistogramHistorySize(int size);
+    void getHistogramHistorySize(int& size);
+    void registerHistogramCallback(FrameHistogramCallback& cb);
+    void unregisterHistogramCallback(FrameHistogramCallback& cb);
+    bool getLastHistogram(FrameHistogramData& histogram);
+
+    // -- auto exposure
+    void setAutoExposure(bool enable);
+    void getAutoExposure(bool& enable);
+    void setAutoExposureTarget(double percentile, double level);
+    void getAutoExposureTarget(double& percentile, double& level);
+    void setAutoExposureMaxSaturated(double fraction);
+    void getAutoExposureMaxSaturated(double& fraction);
+    void setAutoExposureBounds(double min_exp_time, double max_exp_time);
+    void getAutoExposureBounds(double& min_exp_time, double& max_exp_time);
+    void setAutoExposureDamping(double damping);
+    void getAutoExposureDamping(double& damping);
+    void setAutoExposureTolerance(double tolerance);
+    void getAutoExposureTolerance(double& tolerance);
+    void setAutoExposureSettleFrames(int nb_frames);
+    void getAutoExposureSettleFrames(int& nb_frames);
+    void getAutoExposureStatus(AutoExposureStatus& status);
+
+    // -- beam centroid and projections
+    void setBeamAnalysis(bool enable);
+    void getBeamAnalysis(bool& enable);
+    void setBeamBackground(double background);
+    void getBeamBackground(double& background);
+    void setBeamThreshold(double threshold);
+    void getBeamThreshold(double& threshold);
+    void setBeamProjections(bool enable);
+    void getBeamProjections(bool& enable);
+    void setBeamHistorySize(int size);
+    void getBeamHistorySize(int& size);
+    void registerBeamCallback(BeamResultCallback& cb);
+    void unregisterBeamCallback(BeamResultCallback& cb);
+    bool getLastBeamResult(BeamResult& result);
+    void getBeamHistory(std::vector<BeamResult>& history);
+
+    // -- accumulation of N camera frames into a Bpp32 frame
+    void setAccumulation(bool enable);
+    void getAccumulation(bool& enable);
+    void setAccumulationNbFrames(int nb_frames);
+    void getAccumulationNbFrames(int& nb_frames);
+    void setAccumulationDarkSubtraction(bool enable);
+    void getAccumulationDarkSubtraction(bool& enable);
+
+    // -- live preview
+    void setPreview(bool enable);
+    void getPreview(bool& enable);
+    void setPreviewMode(LivePreview::Mode mode);
+    void getPreviewMode(LivePreview::Mode& mode);
+    void setPreviewAlpha(double alpha);
+    void getPreviewAlpha(double& alpha);
+    void setPreviewBinning(int bin);
+    void getPreviewBinning(int& bin);
+    void setPreviewRefreshPeriod(double period);
+    void getPreviewRefreshPeriod(double& period);
+    void resetPreview();
+    bool getPreviewImage(std::vector<float>& image, Size& size, int& frame_nb, int& nb_averaged);
+
+    // -- bitshuffle/LZ4 compression of a copy of the frames
+    void setCompression(bool enable);
+    void getCompression(bool& enable);
+    void setCompressionNbThreads(int nb_threads);
+    void getCompressionNbThreads(int& nb_threads);
+    void setCompressionQueueDepth(int depth);
+    void getCompressionQueueDepth(int& depth);
+    void setCompressionBlockSize(int block_size);
+    void getCompressionBlockSize(int& block_size);
+    void registerCompressedFrameCallback(CompressedFrameCallback& cb);
+    void unregisterCompressedFrameCallback(CompressedFrameCallback& cb);
+    void getCompressionStats(CompressionStats& stats);
+
+    // -- unbuffered streaming of the frames to disk
+    void setRecording(bool enable);
+    void getRecording(bool& enable);
+    void setRecordingFilePrefix(const std::string& prefix);
+    void getRecordingFilePrefix(std::string& prefix);
+    void setRecordingNbBuffers(int nb_buffers);
+    void getRecordingNbBuffers(int& nb_buffers);
+    void setRecordingPreallocationStep(int nb_frames);
+    void getRecordingPreallocationStep(int& nb_frames);
+    void getRecordingStats(RecordingStats& stats);
+
+    // -- replay of a recording in place of the camera frames
+    void setReplayFile(const std::string& name);
+    void getReplayFile(std::string& name);
+    void setReplay(bool enable);
+    void getReplay(bool& enable);
+    void setReplayTiming(ReplaySource::Timing timing);
+    void getReplayTiming(ReplaySource::Timing& timing);
+    void setReplayLoop(bool loop);
+    void getReplayLoop(bool& loop);
+    void getReplayNbFrames(int& nb_frames);
+
+    // -- publication of the frames in shared memory for the local processes
+    void setSharedMemory(bool enable);
+    void getSharedMemory(bool& enable);
+    void setSharedMemoryName(const std::string& name);
+    void getSharedMemoryName(std::string& name);
+    void setSharedMemoryNbSlots(int nb_slots);
+    void getSharedMemoryNbSlots(int& nb_slots);
+    void getSharedMemoryStats(SharedMemoryStats& stats);
+
+    // -- TCP streaming of the frames to the remote subscribers
+    void setStreaming(bool enable);
+    void getStreaming(bool& enable);
+    void setStreamingPort(int port);
+    void getStreamingPort(int& port);
+    void setStreamingAddress(const std::string& address);
+    void getStreamingAddress(std::string& address);
+    void setStreamingEncoding(FrameStreamServer::Encoding encoding);
+    void getStreamingEncoding(FrameStreamServer::Encoding& encoding);
+    void setStreamingDropPolicy(FrameStreamServer::DropPolicy policy);
+    void getStreamingDropPolicy(FrameStreamServer::DropPolicy& policy);
+    void setStreamingQueueDepth(int depth);
+    void getStreamingQueueDepth(int& depth);
+    void getStreamingStats(StreamingStats& stats);
+
+    // -- synchronized acquisition of a group of cameras (see CameraGroup)
+    void setGroupTrigger(bool enable);
+    void getGroupTrigger(bool& enable);
+    void softwareTrigger();
+    void registerFrameCallback(CameraFrameCallback& cb);
+    void unregisterFrameCallback(CameraFrameCallback& cb);
+
 	//TUCAM stuff, use TUCAM notations !
-	TUCAM_INIT          m_itApi; // TUCAM handle Api
 	TUCAM_OPEN          m_opCam; // TUCAM handle camera
 	TUCAM_FRAME         m_frame; // TUCAM frame structure
 	HANDLE              m_hThdEvent; // TUCAM handle event   
@@ -201,6 +547,25 @@ private:
     //read/copy frame
     bool readFrame(void *bptr, int& frame_nb);
     void setStatus(Camera::Status status, bool force);    
+    void _init();
+    void checkInit();
+    void waitInitDone();
+    bool isExposureCached();
+    bool useHandle();
+    void releaseHandle();
+    bool recoverLink(bool capture);
+    bool reopen(bool refresh);
+    void restoreSettings();
+    void captureProfile(ProfileValues& values);
+    void sampleTelemetry(TelemetrySample& sample);
+    void updateUsbBuffer();
+    static bool profileChanged(const ProfileValues& target, const ProfileValues& current,
+                               const char* key, double* numbers, int nb_numbers);
+    void imageTypeChanged();
+    int frameRangeBits();
+    ImageType cameraImageType();
+    void setCameraHistogram(bool enable);
+    void updateAutoExposure();
 	void _startAcq();
     inline bool IS_POWER_OF_2(long x)
     {
@@ -222,6 +587,10 @@ private:
     //////////////////////////////
 
     class AcqThread;
+    class InitThread;
+    class LinkThread;
+    class TelemetryThread;
+    class HandleUse;
 
     AcqThread *         m_acq_thread;
     TrigMode            m_trigger_mode;
@@ -237,21 +606,127 @@ private:
     long                m_depth;
     Camera::Status      m_status;
     Bin                 m_bin;
+    Roi                 m_hw_roi; // roi in detector coordinates
     double              m_temperature_target;
     // Buffer control object
     SoftBufferCtrlObj   m_bufferCtrlObj;
 	CSoftTriggerTimer*	m_internal_trigger_timer;
     double              m_fps;
 	unsigned short 		m_timer_period_ms;
+    int                 m_camera_index;
+    std::string         m_serial_number;
+    std::string         m_model;
+
+    //asynchronous init
+    InitThread*         m_init_thread;
+    bool                m_sdk_init; // TucamSdk::init done
+    bool                m_initializing;
+    bool                m_initialized;
+    bool                m_init_running; // init() is running in m_init_caller
+    pthread_t           m_init_caller;
+    std::string         m_init_error;
+    CameraInitTimings   m_init_timings;
+    std::string         m_fault_reason;
+
+    //link monitoring
+    LinkThread*         m_link_thread;
+    bool                m_link_quit;
+    bool                m_auto_reconnect;
+    double              m_reconnect_timeout; // (s)
+    double              m_link_poll_period; // (s)
+    bool                m_reconnecting;
+    pthread_t           m_reconnect_caller;
+    int                 m_nb_handle_users; // SDK calls outside of the lock, the handle is not closed meanwhile
+    bool                m_link_lost;
+    LinkStatus          m_link_status;
+    unsigned            m_global_gain; // restored after a reconnection
+    unsigned            m_fan_speed;
+    unsigned            m_tec_mode;
+
+    //background sampling of the sensors
+    TelemetryThread*    m_telemetry_thread;
+    bool                m_telemetry;
+    bool                m_telemetry_quit;
+    double              m_telemetry_period; // (s)
+    TelemetryRing       m_telemetry_ring;
+
+    //USB transfer buffer
+    Mutex               m_usb_buffer_mutex;
+    bool                m_usb_shedding; // adaptive policy enabled
+    double              m_usb_low_water_mark;
+    double              m_usb_high_water_mark;
+    UsbBufferStats      m_usb_buffer_stats;
+
+    //last values written to and read from the camera
+    ParameterCache      m_parameter_cache;
+
+    //configuration profiles
+    ProfileStore        m_profile_store;
+    ProfileStats        m_profile_stats;
     
     //TUCAM stuff, use TUCAM notations !
     TucamTriggerMode    m_tucam_trigger_mode;
     TucamTriggerEdge    m_tucam_trigger_edge_mode;
+    int                 m_tucam_trigger_delay; // (us)
+    int                 m_tucam_trigger_buf_frames;
+    int                 m_burst_frames; // nos of frames per IntTrigMult trigger
+    int                 m_burst_pending; // nos of frames of the current burst(s) not yet received
     TUCAM_TRGOUT_ATTR m_tgroutAttr1;
     TUCAM_TRGOUT_ATTR m_tgroutAttr2;
     TUCAM_TRGOUT_ATTR m_tgroutAttr3;
     TUCAM_TRIGGER_ATTR*	m_tgrAttr;
    
+    //host side HDR merge
+    HdrMerger           m_hdr_merger;
+    bool                m_hdr_single_readout_warned;
+
+    //dark and flat field correction
+    FrameCorrection     m_frame_correction;
+    std::vector<unsigned short> m_unpack_buffer;
+
+    //defective pixels
+    DefectMap           m_defect_map;
+
+    //per frame statistics
+    FrameStatistics     m_frame_statistics;
+
+    //per frame histogram
+    FrameHistogram      m_frame_histogram;
+    FrameHistogramData  m_histogram_data; // acquisition thread scratch, also read by the auto exposure
+
+    //auto exposure
+    AutoExposure        m_auto_exposure;
+
+    //beam centroid and projections
+    BeamAnalysis        m_beam_analysis;
+
+    //frame accumulation
+    FrameAccumulator    m_frame_accumulator;
+
+    //live preview
+    LivePreview         m_live_preview;
+
+    //compression
+    FrameCompressor     m_frame_compressor;
+
+    //streaming to disk
+    StreamRecorder      m_stream_recorder;
+
+    //replay of a recording
+    ReplaySource        m_replay_source;
+    bool                m_replay;
+
+    //shared memory ring
+    FramePublisher      m_frame_publisher;
+
+    //TCP streaming
+    FrameStreamServer   m_frame_stream_server;
+
+    //camera group
+    bool                m_group_trigger; // IntTrig triggers sent by the group
+    Mutex               m_frame_callback_mutex;
+    CameraFrameCallback* m_frame_callback;
+
     //All camera available properties/parameters map
     std::map<std::string, int> m_parameters_map;
 
@@ -275,6 +750,77 @@ private:
     Camera& m_cam;
 } ;
 
+/*******************************************************************
+ * \class LinkThread
+ * \brief watch the link to the camera outside of the acquisitions
+ *******************************************************************/
+class Camera::LinkThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "LinkThread");
+public:
+    LinkThread(Camera &aCam);
+    virtual ~LinkThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    Camera& m_cam;
+} ;
+
+/*******************************************************************
+ * \class TelemetryThread
+ * \brief low priority sampling of the sensors of the camera
+ *******************************************************************/
+class Camera::TelemetryThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "TelemetryThread");
+public:
+    TelemetryThread(Camera &aCam);
+    virtual ~TelemetryThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    Camera& m_cam;
+} ;
+
+/*******************************************************************
+ * \class HandleUse
+ * \brief the SDK handle is not closed by a reconnection while in use
+ *
+ * Throws if the camera is reconnecting, except in the reconnecting thread.
+ *******************************************************************/
+class Camera::HandleUse
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "HandleUse");
+public:
+    HandleUse(Camera& cam);
+    ~HandleUse();
+
+private:
+    Camera&     m_cam;
+};
+
+/*******************************************************************
+ * \class InitThread
+ * \brief asynchronous init of the camera
+ *******************************************************************/
+class Camera::InitThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "Camera", "InitThread");
+public:
+    InitThread(Camera &aCam);
+    virtual ~InitThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    Camera& m_cam;
+} ;
+
 } // namespace Dhyana
 } // namespace lima
 
@@ -0,0 +1,247 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaCameraGroup.h
+// synchronized acquisition of several cameras
+
+#ifndef DHYANACAMERAGROUP_H_
+#define DHYANACAMERAGROUP_H_
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include "DhyanaCompatibility.h"
+#include "DhyanaCamera.h"
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct GroupFrame
+ * \brief a frame received from all the cameras of the group
+ *******************************************************************/
+struct LIBDHYANA_API GroupFrame
+{
+    int                 frame_nb;       // Lima acq frame nb, the same on all the cameras
+    std::vector<double> timestamps;     // host time (s) when each camera delivered the frame
+    std::vector<double> skews;          // timestamp - timestamp of the first camera (s)
+    double              max_skew;       // latest - earliest timestamp (s)
+    bool                in_sync;        // max_skew within the max skew
+};
+
+/*******************************************************************
+ * \class GroupFrameCallback
+ * \brief called when a frame has been received from all the cameras
+ *******************************************************************/
+class LIBDHYANA_API GroupFrameCallback
+{
+public:
+    virtual ~GroupFrameCallback() {}
+    virtual void groupFrameReady(const GroupFrame& frame) = 0;
+};
+
+/*******************************************************************
+ * \struct GroupMemberStats
+ * \brief counters of a camera of the group
+ *******************************************************************/
+struct LIBDHYANA_API GroupMemberStats
+{
+    std::string         serial_number;
+    double              arm_time;       // prepareAcq duration (s)
+    double              trigger_offset; // last software trigger sent after the first one (s)
+    double              last_skew;      // (s)
+    double              mean_skew;      // (s)
+    double              max_skew;       // max absolute skew (s)
+    int                 nb_frames;      // frames received
+    int                 nb_missing;     // frames of the other cameras not received from this one in time
+    int                 nb_retriggers;  // software triggers sent again after a lost trigger
+};
+
+/*******************************************************************
+ * \struct CameraGroupStats
+ * \brief counters since the last prepareAcq
+ *******************************************************************/
+struct LIBDHYANA_API CameraGroupStats
+{
+    double                          arm_time;       // parallel prepareAcq of the cameras (s)
+    int                             nb_triggers;
+    int                             nb_matched;     // frames received from all the cameras
+    int                             nb_incomplete;  // frames given up after the match window
+    int                             nb_out_of_sync; // matched frames above the max skew
+    std::vector<GroupMemberStats>   members;
+};
+
+/*******************************************************************
+ * \class CameraGroup
+ * \brief acquisition in lockstep of several cameras of the process
+ *
+ * The cameras are armed (prepareAcq, startAcq, stopAcq) in parallel,
+ * one thread per camera. In kSoftwareTrigger mode all the cameras are
+ * in IntTrig and a trigger thread sends the software trigger to all of
+ * them together; in kHardwareTrigger mode only the first camera (the
+ * master) is triggered, its trigger output drives the trigger input of
+ * the other cameras which are in ExtTrigMult. The next trigger is sent
+ * when all the cameras have delivered the frame (lockstep).
+ * The frames are matched by frame number, and the skew of the host
+ * timestamps relative to the first camera is reported per camera.
+ *******************************************************************/
+class LIBDHYANA_API CameraGroup
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "CameraGroup", "Dhyana");
+
+public:
+    enum SyncMode
+    {
+      kSoftwareTrigger,     // software trigger fan-out to all the cameras
+      kHardwareTrigger      // trigger output of the first camera wired to the others
+    };
+
+    CameraGroup();
+    ~CameraGroup();
+
+    //! the first camera is the reference of the skews and the master
+    void addCamera(Camera& camera);
+    void removeCameras();
+    int getNbCameras() const;
+
+    void setSyncMode(SyncMode mode);
+    SyncMode getSyncMode() const;
+    //! trigger output port (0 to 2) of the master in kHardwareTrigger
+    void setMasterOutputPort(int port);
+    int getMasterOutputPort() const;
+    //! min time between the triggers (s), 0 : exposure + latency of the first camera
+    void setTriggerPeriod(double period);
+    double getTriggerPeriod() const;
+    //! matched frames with a larger skew (s) are out of sync, 0 : no check
+    void setMaxSkew(double max_skew);
+    double getMaxSkew() const;
+    //! nb of frames waiting for the late cameras
+    void setMatchWindow(int nb_frames);
+    int getMatchWindow() const;
+    void setHistorySize(int size);
+    int getHistorySize() const;
+
+    void prepareAcq();
+    void startAcq();
+    void stopAcq();
+    bool isAcqRunning() const;
+
+    void registerCallback(GroupFrameCallback& cb);
+    void unregisterCallback(GroupFrameCallback& cb);
+    bool getLastGroupFrame(GroupFrame& frame) const;
+    void getHistory(std::vector<GroupFrame>& history) const;
+    void getStats(CameraGroupStats& stats) const;
+
+private:
+    class GroupThread;
+
+    class Member : public CameraFrameCallback
+    {
+    public:
+        Member(CameraGroup& group, Camera& camera, int index);
+        virtual void frameReady(int frame_nb, double timestamp);
+
+        CameraGroup&        group;
+        Camera&             camera;
+        int                 index;
+        GroupMemberStats    stats;
+        double              skew_sum;
+        int                 nb_frames_at_timeout;
+        bool                retriggered;    // the current trigger was sent again
+        bool                given_up;       // the current frame is counted as missing
+        std::string         error;  // of the last parallel call
+    };
+
+    struct PendingFrame
+    {
+        GroupFrame          frame;
+        int                 nb_received;
+        std::vector<bool>   missing;    // counted as missing by the trigger thread
+    };
+
+    void runOnMembers(int role);
+    void triggerLoop();
+    bool allReceived(int nb_frames) const;
+    std::map<int, PendingFrame>::iterator pendingFrame(int frame_nb);
+    void frameReady(Member& member, int frame_nb, double timestamp);
+    void matchFrame(GroupFrame& frame);
+
+    mutable Cond                    m_cond;
+    std::vector<Member*>            m_members;
+    SyncMode                        m_sync_mode;
+    int                             m_master_output_port;
+    double                          m_trigger_period;
+    double                          m_max_skew;
+    int                             m_match_window;
+    int                             m_history_size;
+
+    //acquisition
+    bool                            m_running;
+    bool                            m_quit;
+    GroupThread*                    m_trigger_thread;
+    int                             m_nb_frames;
+    double                          m_period;
+    std::map<int, PendingFrame>     m_pending;
+    std::deque<GroupFrame>          m_history;
+    CameraGroupStats                m_stats;
+
+    Mutex                           m_callback_mutex;
+    GroupFrameCallback*             m_callback;
+};
+
+/*******************************************************************
+ * \class GroupThread
+ * \brief prepareAcq/startAcq/stopAcq of a camera, or trigger thread
+ *******************************************************************/
+class CameraGroup::GroupThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "CameraGroup", "GroupThread");
+public:
+    enum Role
+    {
+      kPrepare,
+      kStart,
+      kStop,
+      kTrigger
+    };
+
+    GroupThread(CameraGroup& group, Role role, Member* member = NULL);
+    virtual ~GroupThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    CameraGroup&    m_group;
+    Role            m_role;
+    Member*         m_member;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANACAMERAGROUP_H_ */
@@ -0,0 +1,101 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaDefectMap.h
+// Host side list of the defective pixels and their replacement in the frame copy
+
+#ifndef DHYANADEFECTMAP_H_
+#define DHYANADEFECTMAP_H_
+
+#include <string>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/SizeUtils.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class DefectMap
+ * \brief defective pixels of the detector, replaced by their neighbours
+ *
+ * The defects are stored as sorted linear indices (y * width + x) in
+ * full detector coordinates, with the first index of each row, so the
+ * replacement only visits the defects of the frame (roi).
+ * A defect is replaced by the median or the mean of its valid 8 neighbours.
+ * Defect files are text, one "x y" pair per line, '#' starts a comment.
+ *******************************************************************/
+class LIBDHYANA_API DefectMap
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "DefectMap", "Dhyana");
+
+public:
+    enum Replacement
+    {
+      kReplaceMedian,
+      kReplaceMean
+    };
+
+    DefectMap();
+    ~DefectMap();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    void setReplacement(Replacement replacement);
+    Replacement getReplacement() const;
+
+    //! hot pixels : dark > median + hot_sigma * robust sigma of the dark map
+    //! bad response : |gain / median gain - 1| > gain_tolerance (gain map optional)
+    void build(const std::vector<float>& dark, const std::vector<float>& gain, const Size& size,
+               double hot_sigma, double gain_tolerance);
+    void load(const std::string& file_name, const Size& size);
+    void save(const std::string& file_name) const;
+    void clear();
+    int getNbDefects() const;
+
+    //! replace the defects of the width x height frame at (x0, y0) in the detector
+    void replace(void* frame, ImageType type, int width, int height, int x0, int y0);
+
+private:
+    void setIndices(std::vector<unsigned int>& indices, const Size& size);
+    bool isDefect(int x, int y) const;
+    template<class T> void replacePixels(T* frame, int width, int height, int x0, int y0);
+
+    mutable Mutex               m_mutex;
+    bool                        m_enable;
+    Replacement                 m_replacement;
+    int                         m_width;
+    int                         m_height;
+    std::vector<unsigned int>   m_indices;      // sorted linear indices
+    std::vector<unsigned int>   m_row_start;    // first defect of each row, height + 1 entries
+    bool                        m_geometry_warned;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANADEFECTMAP_H_ */
@@ -0,0 +1,85 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameAccumulator.h
+// Sum of N consecutive camera frames into one 32 bits Lima frame
+
+#ifndef DHYANAFRAMEACCUMULATOR_H_
+#define DHYANAFRAMEACCUMULATOR_H_
+
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/SizeUtils.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class FrameAccumulator
+ * \brief sum N camera frames into a Bpp32 frame
+ *
+ * The dark (rounded to 16 bits, in full detector coordinates) can be
+ * subtracted from each frame, with saturation at 0, before the sum.
+ *******************************************************************/
+class LIBDHYANA_API FrameAccumulator
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameAccumulator", "Dhyana");
+
+public:
+    FrameAccumulator();
+    ~FrameAccumulator();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    //! [1, 65536] : the 32 bits sums can not overflow
+    void setNbFrames(int nb_frames);
+    int getNbFrames() const;
+    void setDarkSubtraction(bool enable);
+    bool getDarkSubtraction() const;
+    void setDark(const std::vector<float>& dark, const Size& size);
+    bool hasDark() const;
+
+    //! restart the current sum (acquisition start)
+    void reset();
+    //! add the width x height frame at (x0, y0) in the detector to dst, true if N frames are summed
+    bool add(const unsigned short* src, unsigned int* dst, int width, int height, int x0, int y0);
+
+private:
+    mutable Mutex                   m_mutex;
+    bool                            m_enable;
+    int                             m_nb_frames;
+    int                             m_count;
+    bool                            m_dark_subtraction;
+    std::vector<unsigned short>     m_dark;
+    int                             m_dark_width;
+    int                             m_dark_height;
+    bool                            m_geometry_warned;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMEACCUMULATOR_H_ */
@@ -0,0 +1,200 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameCompressor.h
+// Pool of threads compressing a copy of the frames (bitshuffle + LZ4)
+
+#ifndef DHYANAFRAMECOMPRESSOR_H_
+#define DHYANAFRAMECOMPRESSOR_H_
+
+#include <cstddef>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "DhyanaBitshuffleLz4.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct CompressedFrame
+ * \brief a compressed frame, data is a bitshuffle/LZ4 HDF5 chunk
+ *******************************************************************/
+struct LIBDHYANA_API CompressedFrame
+{
+    int                     frame_nb;           // Lima acq frame nb
+    double                  timestamp;          // readout time (s)
+    int                     width;
+    int                     height;
+    ImageType               type;
+    size_t                  uncompressed_size;  // bytes
+    const unsigned char*    data;               // only valid during the callback
+    size_t                  size;               // bytes
+};
+
+/*******************************************************************
+ * \class CompressedFrameCallback
+ * \brief called from a compression thread, in the frame order
+ *******************************************************************/
+class LIBDHYANA_API CompressedFrameCallback
+{
+public:
+    virtual ~CompressedFrameCallback() {}
+    virtual void compressedFrameReady(const CompressedFrame& frame) = 0;
+};
+
+/*******************************************************************
+ * \struct CompressionStats
+ * \brief counters since the last reset
+ *******************************************************************/
+struct LIBDHYANA_API CompressionStats
+{
+    int         nb_frames;          // compressed and delivered
+    int         nb_dropped;         // queue full
+    double      ratio;              // uncompressed / compressed bytes
+    double      throughput;         // MB/s of uncompressed data, per thread
+    int         queue_peak;         // max nb of frames waiting or in progress
+};
+
+/*******************************************************************
+ * \class FrameCompressor
+ * \brief compress a copy of the frames on a pool of threads
+ *
+ * The acquisition thread only copies the frame into a free slot of
+ * the queue, the frame is dropped (and counted) if the queue is full :
+ * the acquisition never waits for the compression. The slots are
+ * compressed in parallel and delivered to the callback in order.
+ *******************************************************************/
+class LIBDHYANA_API FrameCompressor
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameCompressor", "Dhyana");
+
+public:
+    FrameCompressor();
+    ~FrameCompressor();
+
+    //! start or stop (after the queued frames are delivered) the threads
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    //! 1 to 16 threads
+    void setNbThreads(int nb_threads);
+    int getNbThreads() const;
+    //! 1 to 256 frames, the queued frames are delivered and the threads restarted
+    void setQueueDepth(int depth);
+    int getQueueDepth() const;
+    //! bitshuffle block in elements, multiple of 8, 0 : 8192 bytes (default of the filter)
+    void setBlockSize(int block_size);
+    int getBlockSize() const;
+
+    void registerCallback(CompressedFrameCallback& cb);
+    void unregisterCallback(CompressedFrameCallback& cb);
+
+    void getStats(CompressionStats& stats) const;
+    void resetStats();
+    //! wait until the queued frames are delivered
+    void flush();
+
+    //! queue a copy of the frame, false if it is dropped
+    bool push(const void* frame, ImageType type, int width, int height, int frame_nb);
+
+private:
+    class WorkerThread;
+
+    enum SlotState
+    {
+      kFree,
+      kFilling,
+      kPending,
+      kBusy,
+      kDone
+    };
+
+    struct Slot
+    {
+        SlotState                   state;
+        int                         frame_nb;
+        double                      timestamp;
+        int                         width;
+        int                         height;
+        ImageType                   type;
+        std::vector<unsigned char>  raw;
+        std::vector<unsigned char>  compressed;
+        size_t                      size;
+        double                      elapsed;    // compression time (s)
+    };
+
+    void startThreads();
+    void stopThreads();
+    void compressLoop();
+    void deliver(AutoMutex& lock);
+
+    mutable Cond                m_cond;     // parameters, slots and stats
+    bool                        m_enable;
+    int                         m_nb_threads;
+    int                         m_block_size;
+    bool                        m_quit;
+    std::vector<WorkerThread*>  m_threads;
+
+    std::vector<Slot>           m_slots;
+    int                         m_next_push;
+    int                         m_next_compress;
+    int                         m_next_deliver;
+    int                         m_nb_queued;
+    bool                        m_delivering;
+
+    int                         m_nb_frames;
+    int                         m_nb_dropped;
+    double                      m_uncompressed_bytes;
+    double                      m_compressed_bytes;
+    double                      m_elapsed;
+    int                         m_queue_peak;
+
+    Mutex                       m_callback_mutex;
+    CompressedFrameCallback*    m_callback;
+};
+
+/*******************************************************************
+ * \class WorkerThread
+ * \brief compression thread, each one has its own codec context
+ *******************************************************************/
+class FrameCompressor::WorkerThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameCompressor", "WorkerThread");
+public:
+    WorkerThread(FrameCompressor& compressor);
+    virtual ~WorkerThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    FrameCompressor& m_compressor;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMECOMPRESSOR_H_ */
@@ -0,0 +1,116 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameCorrection.h
+// Dark (offset) and flat field (gain) correction applied in the frame copy
+
+#ifndef DHYANAFRAMECORRECTION_H_
+#define DHYANAFRAMECORRECTION_H_
+
+#include <string>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/SizeUtils.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class FrameCorrection
+ * \brief per pixel offset/gain correction : out = (in - offset) * gain
+ *
+ * Maps are float, in full detector coordinates, the frame (roi) is
+ * corrected at its offset (x0, y0) in the detector.
+ * Map files are raw float32 (little endian), width x height of the detector.
+ *******************************************************************/
+class LIBDHYANA_API FrameCorrection
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameCorrection", "Dhyana");
+
+public:
+    FrameCorrection();
+    ~FrameCorrection();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+
+    //! Bpp16 (rounded, saturated to [0, 65535]) or Bpp32F
+    void setOutputType(ImageType type);
+    ImageType getOutputType() const;
+    //! clamp the negative values to 0 in Bpp32F output
+    void setClamp(bool clamp);
+    bool getClamp() const;
+
+    void setOffsetMap(const float* map, const Size& size);
+    void setGainMap(const float* map, const Size& size);
+    void loadOffsetMap(const std::string& file_name, const Size& size);
+    void loadGainMap(const std::string& file_name, const Size& size);
+    void saveOffsetMap(const std::string& file_name);
+    void clearMaps();
+    bool hasOffsetMap() const;
+    bool hasGainMap() const;
+    //! copy of the maps (empty if not set), size of the maps
+    void getMaps(std::vector<float>& offset, std::vector<float>& gain, Size& size) const;
+
+    //! average the next nb_frames frames into the offset map
+    void startDarkAccumulation(int nb_frames, const Size& size);
+    void abortDarkAccumulation();
+    //! nb of frames still to accumulate (0 : done or not started)
+    int getDarkAccumulationRemaining() const;
+    void accumulateDark(const unsigned short* src, int width, int height, int x0, int y0);
+
+    //! correct the width x height frame at (x0, y0) in the detector, src and dst may be the same for Bpp16 output
+    //! return false if the frame is outside of the maps, it is then only converted to the output type
+    bool apply(const unsigned short* src, void* dst, int width, int height, int x0, int y0);
+
+private:
+    void loadMap(const std::string& file_name, const Size& size, std::vector<float>& map);
+    void setMap(const float* map, const Size& size, std::vector<float>& dst);
+    bool checkGeometry(int width, int height, int x0, int y0);
+
+    mutable Mutex               m_mutex;
+    bool                        m_enable;
+    ImageType                   m_output_type;
+    bool                        m_clamp;
+    int                         m_map_width;
+    int                         m_map_height;
+    std::vector<float>          m_offset;
+    std::vector<float>          m_gain;
+    std::vector<float>          m_zero_row;
+    std::vector<float>          m_unit_row;
+    bool                        m_geometry_warned;
+
+    //dark accumulation
+    std::vector<unsigned int>   m_dark_sum;
+    int                         m_dark_nb_frames;
+    int                         m_dark_remaining;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMECORRECTION_H_ */
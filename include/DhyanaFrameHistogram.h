@@ -0,0 +1,140 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameHistogram.h
+// Per frame intensity histogram, from the camera or computed on the host
+
+#ifndef DHYANAFRAMEHISTOGRAM_H_
+#define DHYANAFRAMEHISTOGRAM_H_
+
+#include <cstddef>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct FrameHistogramData
+ * \brief histogram of a frame, bin i counts the values in [i * bin_width, (i + 1) * bin_width)
+ *
+ * Values above the full scale are counted in the last bin.
+ *******************************************************************/
+struct LIBDHYANA_API FrameHistogramData
+{
+    int                         frame_nb;       // Lima acq frame nb
+    double                      timestamp;      // readout time (s)
+    unsigned int                bin_width;
+    bool                        from_camera;    // TUIDC_HISTC block of the frame
+    std::vector<unsigned int>   bins;
+};
+
+/*******************************************************************
+ * \class FrameHistogramCallback
+ * \brief called from the acquisition thread after each frame
+ *******************************************************************/
+class LIBDHYANA_API FrameHistogramCallback
+{
+public:
+    virtual ~FrameHistogramCallback() {}
+    virtual void frameHistogramReady(const FrameHistogramData& histogram) = 0;
+};
+
+/*******************************************************************
+ * \class FrameHistogram
+ * \brief intensity histogram of each frame
+ *
+ * The histogram is read from the histogram block delivered by the camera
+ * (TUIDC_HISTC) or computed on the host. The host histogram uses 4 private
+ * sub histograms, merged at the end of the frame, so consecutive equal
+ * pixels do not serialize on the same counter.
+ *******************************************************************/
+class LIBDHYANA_API FrameHistogram
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameHistogram", "Dhyana");
+
+public:
+    enum Source
+    {
+      kSourceHost,
+      kSourceCamera
+    };
+
+    FrameHistogram();
+    ~FrameHistogram();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    void setSource(Source source);
+    Source getSource() const;
+    //! power of 2 in [16, 65536]
+    void setNbBins(int nb_bins);
+    int getNbBins() const;
+    void setHistorySize(int size);
+    int getHistorySize() const;
+
+    void registerCallback(FrameHistogramCallback& cb);
+    void unregisterCallback(FrameHistogramCallback& cb);
+
+    //! false if no frame was processed since the last reset
+    bool getLast(FrameHistogramData& histogram) const;
+    //! oldest first
+    void getHistory(std::vector<FrameHistogramData>& history) const;
+    void reset();
+
+    //! host histogram of a frame in the Lima buffer over [0, 2^range_bits[, the full scale of the stage which produced it
+    bool compute(const void* frame, ImageType type, size_t nb_pixels, int range_bits, int frame_nb,
+                 FrameHistogramData& histogram);
+    //! rebin the camera histogram block (nb_camera_bins uint32 over the full scale of bit_depth)
+    void fromCamera(const unsigned int* camera_bins, size_t nb_camera_bins, int bit_depth, int frame_nb,
+                    FrameHistogramData& histogram);
+    //! store a computed histogram in the ring buffer and give it to the callback
+    void publish(const FrameHistogramData& histogram);
+
+    //! smallest value with at least fraction of the pixels below or at it (upper edge of the bin)
+    static double percentile(const FrameHistogramData& histogram, double fraction);
+
+private:
+    static unsigned int binWidth(int range_bits, int nb_bins);
+
+    mutable Mutex                   m_mutex;
+    bool                            m_enable;
+    Source                          m_source;
+    int                             m_nb_bins;
+    std::vector<FrameHistogramData> m_history;
+    int                             m_history_next;
+    int                             m_history_count;
+    std::vector<unsigned int>       m_private_bins;     // 4 sub histograms, acquisition thread scratch
+
+    Mutex                           m_callback_mutex;
+    FrameHistogramCallback*         m_callback;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMEHISTOGRAM_H_ */
@@ -0,0 +1,127 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFramePublisher.h
+// Publication of the frames in a shared memory ring
+
+#ifndef DHYANAFRAMEPUBLISHER_H_
+#define DHYANAFRAMEPUBLISHER_H_
+
+#include <windows.h>
+#include <string>
+#include "DhyanaCompatibility.h"
+#include "DhyanaSharedFrameRing.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/SizeUtils.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct SharedMemoryStats
+ * \brief state of the shared memory ring
+ *******************************************************************/
+struct LIBDHYANA_API SharedMemoryStats
+{
+    std::string     name;           // of the file mapping of the ring, empty if the ring is not created
+    int             generation;     // of the ring, incremented each time it is recreated
+    int             nb_slots;
+    int             slot_size;      // bytes
+    long long       nb_published;   // since the creation of the ring
+    int             nb_frames;      // published during the current (or last) acquisition
+};
+
+/*******************************************************************
+ * \class FramePublisher
+ * \brief copy of the frames in a ring shared with the local processes
+ *
+ * The ring is a named file mapping (see DhyanaSharedFrameRing.h), the
+ * readers map it read only with a SharedFrameReader. The acquisition
+ * thread copies each frame in the next slot and never waits for the
+ * readers : a slow reader loses the overwritten frames.
+ * The ring is kept between the acquisitions, it is recreated with the
+ * next generation when the frames no longer fit in the slots or the
+ * nb of slots changes, the directory tells the readers to follow.
+ *******************************************************************/
+class LIBDHYANA_API FramePublisher
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FramePublisher", "Dhyana");
+
+public:
+    FramePublisher();
+    ~FramePublisher();
+
+    //! disable removes the ring
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    //! name of the file mapping, "Local\\DhyanaFrames" by default
+    void setName(const std::string& name);
+    std::string getName() const;
+    //! 2 to 256 slots
+    void setNbSlots(int nb_slots);
+    int getNbSlots() const;
+
+    void getStats(SharedMemoryStats& stats) const;
+
+    //! create the ring if needed, throw if it can not be created
+    void start(const FrameDim& frame_dim);
+    //! copy the frame in the next slot
+    void push(const void* frame, int frame_nb);
+
+private:
+    void openDirectory();
+    void removeDirectory();
+    void createRing(size_t max_frame_size);
+    void removeRing();
+
+    mutable Mutex               m_mutex;
+    bool                        m_enable;
+    std::string                 m_name;
+    int                         m_nb_slots;
+
+    //directory, named m_name
+    HANDLE                      m_directory_mapping;
+    SharedRingDirectory*        m_directory;
+
+    //ring, named m_ring_name
+    std::string                 m_ring_name;
+    HANDLE                      m_mapping;
+    unsigned char*              m_data;
+    SharedRingHeader*           m_header;
+
+    //current acquisition
+    int                         m_width;
+    int                         m_height;
+    ImageType                   m_image_type;
+    size_t                      m_frame_size;
+    double                      m_start_time;
+    int                         m_nb_frames;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMEPUBLISHER_H_ */
@@ -0,0 +1,141 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameStatistics.h
+// Per frame statistics computed in the frame copy
+
+#ifndef DHYANAFRAMESTATISTICS_H_
+#define DHYANAFRAMESTATISTICS_H_
+
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/SizeUtils.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct FrameStats
+ * \brief statistics of a frame or of a roi of the frame
+ *******************************************************************/
+struct LIBDHYANA_API FrameStats
+{
+    int         frame_nb;       // Lima acq frame nb
+    double      timestamp;      // readout time (s)
+    long long   nb_pixels;
+    double      min;
+    double      max;
+    double      sum;
+    double      mean;
+    double      std;
+    long long   nb_saturated;   // pixels >= saturation level
+};
+
+/*******************************************************************
+ * \class FrameStatsCallback
+ * \brief called from the acquisition thread after each frame
+ *
+ * roi_stats has one entry per statistics roi, in the same order.
+ * Keep it short : the next frame is not read until it returns.
+ *******************************************************************/
+class LIBDHYANA_API FrameStatsCallback
+{
+public:
+    virtual ~FrameStatsCallback() {}
+    virtual void frameStatsReady(const FrameStats& stats, const std::vector<FrameStats>& roi_stats) = 0;
+};
+
+/*******************************************************************
+ * \class FrameStatistics
+ * \brief min/max/sum/mean/std/saturation of each frame, optionally per roi
+ *
+ * The whole frame statistics of 16 bits frames are computed with SSE2
+ * in the same pass as the copy into the Lima buffer. The results are
+ * kept in a ring buffer and published through a callback.
+ *******************************************************************/
+class LIBDHYANA_API FrameStatistics
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameStatistics", "Dhyana");
+
+public:
+    FrameStatistics();
+    ~FrameStatistics();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    //! 0 : saturation at the full scale of the pixel depth
+    void setSaturationLevel(double level);
+    double getSaturationLevel() const;
+    //! rois in frame coordinates, clipped to the frame
+    void setRois(const std::vector<Roi>& rois);
+    void getRois(std::vector<Roi>& rois) const;
+    void setHistorySize(int size);
+    int getHistorySize() const;
+
+    void registerCallback(FrameStatsCallback& cb);
+    void unregisterCallback(FrameStatsCallback& cb);
+
+    //! false if no frame was processed since the last reset
+    bool getLast(FrameStats& stats, std::vector<FrameStats>& roi_stats) const;
+    //! whole frame statistics, oldest first
+    void getHistory(std::vector<FrameStats>& history) const;
+    void reset();
+
+    //! copy src into dst (if not NULL) and compute the statistics in the same pass
+    void process(const unsigned short* src, unsigned short* dst, int width, int height, int frame_nb, int bit_depth);
+    //! statistics of a frame already in the Lima buffer
+    void process(const void* frame, ImageType type, int width, int height, int frame_nb, int bit_depth);
+
+private:
+    struct Entry
+    {
+        FrameStats              stats;
+        std::vector<FrameStats> roi_stats;
+    };
+
+    double saturationLevel(int bit_depth) const;
+    void computeRois(const void* frame, ImageType type, int width, int height, double saturation,
+                     FrameStats& model, std::vector<FrameStats>& roi_stats) const;
+    void publish(const FrameStats& stats);
+
+    mutable Mutex               m_mutex;
+    bool                        m_enable;
+    double                      m_saturation_level;
+    std::vector<Roi>            m_rois;
+    std::vector<Entry>          m_history;
+    int                         m_history_next;
+    int                         m_history_count;
+    std::vector<FrameStats>     m_roi_stats;        // acquisition thread scratch
+
+    Mutex                       m_callback_mutex;
+    FrameStatsCallback*         m_callback;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMESTATISTICS_H_ */
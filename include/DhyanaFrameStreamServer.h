@@ -0,0 +1,243 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaFrameStreamServer.h
+// TCP streaming of the frames to the remote subscribers
+
+#ifndef DHYANAFRAMESTREAMSERVER_H_
+#define DHYANAFRAMESTREAMSERVER_H_
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include "DhyanaCompatibility.h"
+#include "DhyanaBitshuffleLz4.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+#define STREAM_FRAME_MAGIC          "DHYF"
+#define STREAM_SUBSCRIPTION_MAGIC   "DHYS"
+
+/*******************************************************************
+ * \struct StreamFrameHeader
+ * \brief sent before each frame, little endian, followed by data_size bytes
+ *******************************************************************/
+struct LIBDHYANA_API StreamFrameHeader
+{
+    char            magic[4];           // STREAM_FRAME_MAGIC
+    unsigned int    header_size;        // sizeof(StreamFrameHeader)
+    unsigned int    frame_nb;           // Lima acq frame nb
+    unsigned int    width;
+    unsigned int    height;
+    unsigned int    image_type;         // lima::ImageType
+    unsigned int    encoding;           // FrameStreamServer::Encoding
+    unsigned int    data_size;          // bytes following the header
+    unsigned int    uncompressed_size;  // bytes of the frame
+    unsigned int    reserved;
+    double          timestamp;          // s since the start of the acquisition
+};
+
+/*******************************************************************
+ * \struct StreamSubscription
+ * \brief optionally sent by a subscriber just after its connection
+ *******************************************************************/
+struct LIBDHYANA_API StreamSubscription
+{
+    char            magic[4];           // STREAM_SUBSCRIPTION_MAGIC
+    unsigned int    drop_policy;        // FrameStreamServer::DropPolicy
+    unsigned int    queue_depth;        // 1 to 64 frames
+};
+
+/*******************************************************************
+ * \struct StreamSubscriberStats
+ * \brief counters of a connected subscriber
+ *******************************************************************/
+struct LIBDHYANA_API StreamSubscriberStats
+{
+    std::string     address;            // ip:port
+    int             drop_policy;
+    int             queue_depth;
+    int             nb_sent;
+    int             nb_dropped;
+};
+
+/*******************************************************************
+ * \struct StreamingStats
+ * \brief counters since the start of the server
+ *******************************************************************/
+struct LIBDHYANA_API StreamingStats
+{
+    int                                 nb_frames;      // frames given to the subscribers
+    int                                 nb_dropped;     // frames not encoded (encoder late)
+    std::vector<StreamSubscriberStats>  subscribers;
+};
+
+/*******************************************************************
+ * \class FrameStreamServer
+ * \brief push the frames over TCP to the connected subscribers
+ *
+ * Each message is a StreamFrameHeader followed by the frame, raw or as
+ * a bitshuffle/LZ4 chunk (HDF5 filter format, see BitshuffleLz4).
+ * The acquisition thread copies the frame only if there are subscribers,
+ * the compression is done by an encoder thread, and each subscriber has
+ * its own sender thread and queue : when the queue of a slow subscriber
+ * is full, its oldest (kDropOldest) or its newest (kDropNewest) frame is
+ * dropped, the other subscribers and the acquisition are not slowed down.
+ *******************************************************************/
+class LIBDHYANA_API FrameStreamServer
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameStreamServer", "Dhyana");
+
+public:
+    enum Encoding
+    {
+      kRaw,
+      kBitshuffleLz4
+    };
+
+    enum DropPolicy
+    {
+      kDropOldest,      // the subscriber always gets the latest frames
+      kDropNewest       // the subscriber gets consecutive frames until its queue is full
+    };
+
+    FrameStreamServer();
+    ~FrameStreamServer();
+
+    //! listen or disconnect all the subscribers
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    //! the server restarts if it is enabled
+    void setPort(int port);
+    int getPort() const;
+    //! local address to listen on, "0.0.0.0" for all the interfaces
+    void setAddress(const std::string& address);
+    std::string getAddress() const;
+    void setEncoding(Encoding encoding);
+    Encoding getEncoding() const;
+    //! default of the subscribers that do not send a StreamSubscription
+    void setDropPolicy(DropPolicy policy);
+    DropPolicy getDropPolicy() const;
+    //! 1 to 64 frames
+    void setQueueDepth(int depth);
+    int getQueueDepth() const;
+
+    void getStats(StreamingStats& stats) const;
+
+    //! origin of the timestamps
+    void start();
+    //! queue the frame for the subscribers, never waits
+    void push(const void* frame, ImageType type, int width, int height, int frame_nb);
+
+private:
+    class ServerThread;
+
+    struct Message
+    {
+        std::vector<unsigned char>  data;   // header + frame
+        int                         refs;   // queued or being sent to the subscribers
+    };
+
+    struct Subscriber
+    {
+        UINT_PTR                    socket; // SOCKET
+        std::string                 address;
+        DropPolicy                  drop_policy;
+        int                         queue_depth;
+        std::deque<Message*>        queue;
+        bool                        closed;
+        int                         nb_sent;
+        int                         nb_dropped;
+        ServerThread*               thread;
+    };
+
+    void startServer();
+    void stopServer();
+    void acceptLoop();
+    void encodeLoop();
+    void sendLoop(Subscriber* subscriber);
+    void dispatch(Message* message);
+    Message* getMessage();
+    void releaseMessage(Message* message);
+    void reapSubscribers(AutoMutex& lock);
+
+    mutable Cond                m_cond;
+    bool                        m_enable;
+    int                         m_port;
+    std::string                 m_address;
+    Encoding                    m_encoding;
+    DropPolicy                  m_drop_policy;
+    int                         m_queue_depth;
+
+    //server
+    bool                        m_quit;
+    UINT_PTR                    m_listen_socket; // SOCKET
+    ServerThread*               m_accept_thread;
+    ServerThread*               m_encode_thread;
+    std::vector<Subscriber*>    m_subscribers;
+    int                         m_nb_open; // subscribers not closed
+    std::deque<Message*>        m_encode_queue;
+    std::vector<Message*>       m_free_messages;
+    double                      m_start_time;
+
+    int                         m_nb_frames;
+    int                         m_nb_dropped;
+};
+
+/*******************************************************************
+ * \class ServerThread
+ * \brief accept, encoder or subscriber sender thread
+ *******************************************************************/
+class FrameStreamServer::ServerThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "FrameStreamServer", "ServerThread");
+public:
+    enum Role
+    {
+      kAccept,
+      kEncode,
+      kSend
+    };
+
+    ServerThread(FrameStreamServer& server, Role role, Subscriber* subscriber = NULL);
+    virtual ~ServerThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    FrameStreamServer&  m_server;
+    Role                m_role;
+    Subscriber*         m_subscriber;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAFRAMESTREAMSERVER_H_ */
@@ -0,0 +1,102 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaHdrMerger.h
+// Host side fusion of the high gain and low gain readouts
+
+#ifndef DHYANAHDRMERGER_H_
+#define DHYANAHDRMERGER_H_
+
+#include <cstddef>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class HdrMerger
+ * \brief merge the high gain and the low gain readouts of a frame
+ *
+ * out = w * (high - high_offset) + (1 - w) * K * (low - low_offset)
+ * w = clamp((threshold - high) / blend_width, 0, 1)
+ *
+ * The high gain readout is used below threshold - blend_width, the
+ * scaled low gain readout above threshold, both are blended in between.
+ *******************************************************************/
+class LIBDHYANA_API HdrMerger
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "HdrMerger", "Dhyana");
+
+public:
+    HdrMerger();
+    ~HdrMerger();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+
+    void setKFactor(double k);
+    double getKFactor() const;
+    void setThreshold(unsigned threshold);
+    unsigned getThreshold() const;
+    void setBlendWidth(unsigned width);
+    unsigned getBlendWidth() const;
+    void setOffsets(unsigned high_offset, unsigned low_offset);
+    void getOffsets(unsigned& high_offset, unsigned& low_offset) const;
+    //! Bpp32 (rounded) or Bpp32F
+    void setOutputType(ImageType type);
+    ImageType getOutputType() const;
+
+    //! estimate K on the next merged frame (least squares on the linear range of the high gain)
+    void requestCalibration();
+    bool isCalibrationPending() const;
+
+    //! merge nb_pixels pixels into dst (uint32 or float, see output type)
+    void merge(const unsigned short* high, const unsigned short* low, void* dst, size_t nb_pixels);
+
+private:
+    struct Params
+    {
+        bool        enable;
+        double      k_factor;
+        unsigned    threshold;
+        unsigned    blend_width;
+        unsigned    high_offset;
+        unsigned    low_offset;
+        ImageType   output_type;
+    };
+
+    void calibrate(const Params& params, const unsigned short* high, const unsigned short* low, size_t nb_pixels);
+
+    mutable Mutex   m_mutex;
+    Params          m_params;
+    bool            m_calibration_requested;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAHDRMERGER_H_ */
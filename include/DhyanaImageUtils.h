@@ -0,0 +1,71 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaImageUtils.h
+// Pixel kernels used in the frame copy path
+
+#ifndef DHYANAIMAGEUTILS_H_
+#define DHYANAIMAGEUTILS_H_
+
+#include <cstddef>
+#include "DhyanaCompatibility.h"
+
+// SSE2 is always available on x64, other instruction sets are checked at runtime
+#if defined(__GNUC__)
+#define DHYANA_TARGET_SSSE3 __attribute__((target("ssse3")))
+#else
+#define DHYANA_TARGET_SSSE3
+#endif
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class ImageUtils
+ * \brief helpers to convert the frames delivered by the TUCAM SDK
+ *******************************************************************/
+class LIBDHYANA_API ImageUtils
+{
+public:
+    //! true if the cpu supports SSSE3 (pshufb)
+    static bool hasSSSE3();
+
+    //! size in bytes of nb_pixels 12 bits pixels packed 2 pixels in 3 bytes
+    static size_t packed12Size(size_t nb_pixels)
+    {
+        return (nb_pixels * 3 + 1) / 2;
+    }
+
+    //! unpack 12 bits pixels (2 pixels in 3 bytes, LSB first) into 16 bits pixels
+    //! byte0 = p0[7:0], byte1 = p1[3:0] << 4 | p0[11:8], byte2 = p1[11:4]
+    static void unpack12(const unsigned char* src, unsigned short* dst, size_t nb_pixels);
+
+private:
+    static size_t unpack12_ssse3(const unsigned char* src, unsigned short* dst, size_t nb_pixels);
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAIMAGEUTILS_H_ */
@@ -0,0 +1,116 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaLivePreview.h
+// Binned and averaged preview image, published at a reduced rate
+
+#ifndef DHYANALIVEPREVIEW_H_
+#define DHYANALIVEPREVIEW_H_
+
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/SizeUtils.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class LivePreview
+ * \brief secondary float preview of the frames
+ *
+ * Each frame is binned (mean of bin x bin pixels) and averaged into a
+ * float image : running average since the last reset, or exponential
+ * decay avg += alpha * (frame - avg). The average is copied into the
+ * published image at most every refresh period, readers only lock the
+ * published image, never the Lima buffers nor the average.
+ *******************************************************************/
+class LIBDHYANA_API LivePreview
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "LivePreview", "Dhyana");
+
+public:
+    enum Mode
+    {
+      kRunningAverage,
+      kExponential
+    };
+
+    LivePreview();
+    ~LivePreview();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    void setMode(Mode mode);
+    Mode getMode() const;
+    //! ]0, 1], weight of the new frame in kExponential mode
+    void setAlpha(double alpha);
+    double getAlpha() const;
+    //! 1, 2, 4, 8 or 16
+    void setBinning(int bin);
+    int getBinning() const;
+    //! min time between 2 published images (s), 0 : each frame
+    void setRefreshPeriod(double period);
+    double getRefreshPeriod() const;
+    //! restart the average
+    void reset();
+
+    //! copy of the last published image, false if none
+    bool getImage(std::vector<float>& image, Size& size, int& frame_nb, int& nb_averaged) const;
+
+    void process(const void* frame, ImageType type, int width, int height, int frame_nb);
+
+private:
+    template<class T> void binFrame(const T* frame, int width, int height, int bin);
+
+    mutable Mutex           m_mutex;            // parameters
+    bool                    m_enable;
+    Mode                    m_mode;
+    double                  m_alpha;
+    int                     m_bin;
+    double                  m_refresh_period;
+    bool                    m_reset_requested;
+
+    //acquisition thread only
+    std::vector<float>      m_binned;
+    std::vector<float>      m_average;
+    int                     m_average_width;
+    int                     m_average_height;
+    int                     m_nb_averaged;
+    double                  m_last_publish;
+
+    //published image
+    mutable Mutex           m_image_mutex;
+    std::vector<float>      m_image;
+    Size                    m_image_size;
+    int                     m_image_frame_nb;
+    int                     m_image_nb_averaged;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANALIVEPREVIEW_H_ */
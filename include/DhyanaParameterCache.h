@@ -0,0 +1,105 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaParameterCache.h
+// Host side shadow of the parameters written to and read from the camera
+
+#ifndef DHYANAPARAMETERCACHE_H_
+#define DHYANAPARAMETERCACHE_H_
+
+#include <string>
+#include <map>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct ParameterCacheStats
+ * \brief counters since the last resetStats
+ *******************************************************************/
+struct LIBDHYANA_API ParameterCacheStats
+{
+    int     nb_entries;         // parameters currently known
+    int     nb_writes;          // write requests
+    int     nb_skipped_writes;  // write requests with the value already in the camera
+    int     nb_reads;           // read requests
+    int     nb_read_hits;       // read requests served from the cache
+    int     nb_invalidations;   // whole cache dropped (reset, reconnection, profile load)
+};
+
+/*******************************************************************
+ * \class ParameterCache
+ * \brief last value written to or read from the camera, per parameter
+ *
+ * The values are kept as text so that a parameter made of several
+ * numbers (a trigger output) is one entry. A write of the cached value
+ * is skipped and a read of a cached parameter does not go to the camera.
+ * The caller must not cache the parameters changed by the camera itself
+ * (temperatures, status) and must invalidate the entries of the
+ * parameters it writes without the cache.
+ *******************************************************************/
+class LIBDHYANA_API ParameterCache
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "ParameterCache", "Dhyana");
+
+public:
+    ParameterCache();
+    ~ParameterCache();
+
+    //! disabled : nothing is cached, all the writes and reads go to the camera
+    void setEnable(bool enable);
+    bool isEnabled() const;
+
+    //! true if the value is the cached one : the write can be skipped
+    bool isUnchanged(const std::string& name, const std::string& value);
+    bool isUnchanged(const std::string& name, double value);
+    //! after a successful write or read
+    void set(const std::string& name, const std::string& value);
+    void set(const std::string& name, double value);
+    //! false if the parameter must be read from the camera
+    bool get(const std::string& name, std::string& value);
+    bool get(const std::string& name, double& value);
+
+    void invalidate(const std::string& name);
+    void invalidate();
+
+    void getStats(ParameterCacheStats& stats) const;
+    void resetStats();
+
+    static std::string toString(double value);
+
+private:
+    mutable Mutex                       m_mutex;
+    bool                                m_enable;
+    std::map<std::string, std::string>  m_values;
+    ParameterCacheStats                 m_stats;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAPARAMETERCACHE_H_ */
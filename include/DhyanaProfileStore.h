@@ -0,0 +1,85 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaProfileStore.h
+// Host side storage of the named configuration profiles
+
+#ifndef DHYANAPROFILESTORE_H_
+#define DHYANAPROFILESTORE_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+//! key -> value of a profile, the values are written as text
+typedef std::map<std::string, std::string> ProfileValues;
+
+/*******************************************************************
+ * \class ProfileStore
+ * \brief named sets of settings kept in memory and in text files
+ *
+ * A profile is saved in <directory>/<name>.profile, one "key = value"
+ * per line, '#' starts a comment. The profiles already read are kept in
+ * memory so that switching between them does not read the files again.
+ * The names are made of letters, digits, '_' and '-' only, they are
+ * also used as the name of the profile stored in the camera.
+ *******************************************************************/
+class LIBDHYANA_API ProfileStore
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "ProfileStore", "Dhyana");
+
+public:
+    ProfileStore();
+    ~ProfileStore();
+
+    void setDirectory(const std::string& directory);
+    std::string getDirectory() const;
+
+    void save(const std::string& name, const ProfileValues& values);
+    //! false if there is no profile with this name
+    bool load(const std::string& name, ProfileValues& values);
+    void remove(const std::string& name);
+    //! profiles in memory and in the directory, sorted by name
+    void list(std::vector<std::string>& names);
+
+    static void checkName(const std::string& name);
+
+private:
+    std::string fileName(const std::string& name) const;
+
+    mutable Mutex                           m_mutex;
+    std::string                             m_directory;
+    std::map<std::string, ProfileValues>    m_profiles;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAPROFILESTORE_H_ */
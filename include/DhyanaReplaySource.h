@@ -0,0 +1,112 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaReplaySource.h
+// Frames of a recorded sequence served in place of the camera frames
+
+#ifndef DHYANAREPLAYSOURCE_H_
+#define DHYANAREPLAYSOURCE_H_
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "DhyanaStreamRecorder.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/ThreadUtils.h"
+#include "TUCamApi.h"
+#include "TUDefine.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class ReplaySource
+ * \brief read only mapping of a recording of the StreamRecorder
+ *
+ * The data file is mapped once, the frames are given in place (no
+ * copy) as a TUCAM_FRAME, like TUCAM_Buf_WaitForFrame, at the recorded
+ * timing (relative to start()) or as fast as possible. The frames keep
+ * their recorded size : uiImgSize tells a packed 12 bits frame or the
+ * 2 readouts of an HDR frame.
+ *******************************************************************/
+class LIBDHYANA_API ReplaySource
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "ReplaySource", "Dhyana");
+
+public:
+    enum Timing
+    {
+      kRecordedTiming,
+      kAsFastAsPossible
+    };
+
+    ReplaySource();
+    ~ReplaySource();
+
+    //! map <name>.raw and read <name>.idx, name is the recording without extension
+    void open(const std::string& name);
+    void close();
+    bool isOpen() const;
+    std::string getName() const;
+    int getNbFrames() const;
+    //! geometry and camera pixel type of the recorded frames
+    void getFrameFormat(int& width, int& height, ImageType& type) const;
+
+    void setTiming(Timing timing);
+    Timing getTiming() const;
+    //! restart from the first frame at the end of the recording
+    void setLoop(bool loop);
+    bool getLoop() const;
+
+    //! rewind, the recorded timing is relative to this call
+    void start();
+    //! wake up nextFrame, it then returns false
+    void interrupt();
+    //! the next frame, false at the end of the recording or if interrupted
+    bool nextFrame(TUCAM_FRAME& frame);
+
+private:
+    mutable Cond                    m_cond;
+    std::string                     m_name;
+    HANDLE                          m_file;
+    HANDLE                          m_mapping;
+    const unsigned char*            m_data;
+    RecordIndexHeader               m_header;
+    std::vector<RecordIndexEntry>   m_entries;
+    Timing                          m_timing;
+    bool                            m_loop;
+
+    //current replay
+    bool                            m_interrupted;
+    size_t                          m_next;
+    double                          m_start_time;
+    double                          m_loop_offset;  // recorded time of the previous loops
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANAREPLAYSOURCE_H_ */
@@ -0,0 +1,112 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaSharedFrameReader.h
+// Client of the shared memory ring, for the consumers in other processes
+
+#ifndef DHYANASHAREDFRAMEREADER_H_
+#define DHYANASHAREDFRAMEREADER_H_
+
+#include <windows.h>
+#include <string>
+#include "DhyanaCompatibility.h"
+#include "DhyanaSharedFrameRing.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct SharedFrame
+ * \brief a frame of the ring, data points into the mapping
+ *******************************************************************/
+struct LIBDHYANA_API SharedFrame
+{
+    const void*     data;
+    unsigned int    frame_nb;
+    unsigned int    width;
+    unsigned int    height;
+    unsigned int    image_type;     // lima::ImageType
+    unsigned int    size;           // bytes
+    double          timestamp;      // s since the start of the acquisition
+    long long       index;          // publication index
+    LONG            sequence;       // of the slot when the frame was read
+};
+
+/*******************************************************************
+ * \class SharedFrameReader
+ * \brief read only mapping of the ring of the FramePublisher
+ *
+ * The reader never blocks the publisher : a frame is read in place,
+ * then isValid() tells if the slot was rewritten meanwhile. A reader
+ * slower than the camera loses the overwritten frames (getNbLost).
+ * Only windows.h is needed, the class can be compiled in the client.
+ *******************************************************************/
+class LIBDHYANA_API SharedFrameReader
+{
+public:
+    SharedFrameReader();
+    ~SharedFrameReader();
+
+    //! false if the ring does not exist (yet)
+    bool open(const std::string& name);
+    void close();
+    bool isOpen() const;
+
+    //! the next frame after the last one read, false if there is none yet
+    bool next(SharedFrame& frame);
+    //! the last published frame, false if there is none
+    bool latest(SharedFrame& frame);
+    //! true if the data of the frame were not overwritten since next/latest
+    bool isValid(const SharedFrame& frame) const;
+    //! copy the data of the frame to dst (frame.size bytes), false if overwritten during the copy
+    bool copy(const SharedFrame& frame, void* dst) const;
+
+    //! frames overwritten before they could be read
+    long long getNbLost() const;
+
+private:
+    SharedFrameReader(const SharedFrameReader&);
+    SharedFrameReader& operator=(const SharedFrameReader&);
+
+    bool checkRing();
+    bool mapDirectory();
+    void unmap();
+    bool read(long long index, SharedFrame& frame) const;
+    const SharedSlotHeader* slot(long long index) const;
+
+    std::string                 m_name;
+    HANDLE                      m_directory_mapping;
+    const SharedRingDirectory*  m_directory;
+    LONG                        m_generation;   // of the ring mapped
+    HANDLE                      m_mapping;
+    const unsigned char*        m_data;
+    const SharedRingHeader*     m_header;
+    long long                   m_next_index;
+    long long                   m_nb_lost;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANASHAREDFRAMEREADER_H_ */
@@ -0,0 +1,100 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaSharedFrameRing.h
+// Layout of the shared memory ring of the published frames
+
+#ifndef DHYANASHAREDFRAMERING_H_
+#define DHYANASHAREDFRAMERING_H_
+
+#include <windows.h>
+
+namespace lima
+{
+namespace Dhyana
+{
+
+// The name given by the user is a small directory mapping (SharedRingDirectory),
+// kept while the publisher is enabled. It holds the generation of the current
+// ring, a named file mapping (paging file) called <name>_<generation> :
+//  - a SharedRingHeader at offset 0
+//  - nb_slots slots of slot_size bytes from header_size, frame k in slot k % nb_slots
+//  - in each slot a SharedSlotHeader then the frame data at SHARED_SLOT_DATA_OFFSET
+// The publisher is the only writer. A slot is protected by a seqlock : its
+// sequence is odd while it is written, a reader keeps the data only if the
+// sequence is even and unchanged after the read.
+// A ring is never resized : a new generation is created and the old ring is
+// closed, the readers still mapping it do not prevent the creation.
+
+#define SHARED_DIRECTORY_MAGIC      "DHYSHD1"
+#define SHARED_DIRECTORY_SIZE       4096
+#define SHARED_RING_MAGIC           "DHYSHM1"
+#define SHARED_RING_HEADER_SIZE     4096
+#define SHARED_SLOT_DATA_OFFSET     64
+
+/*******************************************************************
+ * \struct SharedRingDirectory
+ * \brief the mapping of the user name, it tells which ring is current
+ *******************************************************************/
+struct SharedRingDirectory
+{
+    char                magic[8];       // SHARED_DIRECTORY_MAGIC
+    volatile LONG       generation;     // of the current ring, 0 if there is none yet
+    unsigned int        reserved;
+};
+
+/*******************************************************************
+ * \struct SharedRingHeader
+ * \brief description of the ring, written once by the publisher
+ *******************************************************************/
+struct SharedRingHeader
+{
+    char                magic[8];       // SHARED_RING_MAGIC
+    unsigned int        header_size;    // offset of the first slot
+    unsigned int        nb_slots;
+    unsigned int        slot_size;      // bytes between 2 slots
+    unsigned int        max_frame_size; // bytes of frame data a slot can hold
+    volatile LONG       closed;         // the publisher has replaced or removed the ring
+    unsigned int        reserved;
+    volatile LONGLONG   nb_published;   // frames published in the ring, the last one is nb_published - 1
+};
+
+/*******************************************************************
+ * \struct SharedSlotHeader
+ * \brief description of the frame held by a slot
+ *******************************************************************/
+struct SharedSlotHeader
+{
+    volatile LONG       sequence;       // odd while the slot is written
+    unsigned int        frame_nb;       // Lima acq frame nb
+    unsigned int        width;
+    unsigned int        height;
+    unsigned int        image_type;     // lima::ImageType
+    unsigned int        size;           // bytes of the frame
+    double              timestamp;      // publication time (s) since the start of the acquisition
+    LONGLONG            index;          // publication index of the frame in the ring
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANASHAREDFRAMERING_H_ */
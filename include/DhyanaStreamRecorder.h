@@ -0,0 +1,213 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaStreamRecorder.h
+// Unbuffered streaming of the raw frames to a preallocated file
+
+#ifndef DHYANASTREAMRECORDER_H_
+#define DHYANASTREAMRECORDER_H_
+
+#include <windows.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/Constants.h"
+#include "lima/SizeUtils.h"
+#include "lima/ThreadUtils.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct RecordIndexHeader
+ * \brief first bytes of the index file (.idx) of a recording
+ *******************************************************************/
+struct LIBDHYANA_API RecordIndexHeader
+{
+    char            magic[8];       // "DHYREC1"
+    unsigned int    width;
+    unsigned int    height;
+    unsigned int    image_type;     // lima::ImageType of the camera pixels (Bpp8, Bpp12 or Bpp16)
+    unsigned int    slot_size;      // bytes between 2 frames in the data file (.raw)
+    unsigned int    reserved[2];
+};
+
+/*******************************************************************
+ * \struct RecordIndexEntry
+ * \brief one record per frame written, in the order of the data file
+ *******************************************************************/
+struct LIBDHYANA_API RecordIndexEntry
+{
+    unsigned long long  offset;     // in the data file
+    double              timestamp;  // readout time (s) since the start of the recording
+    unsigned int        frame_nb;   // camera frame index (uiIndex of the TUCAM frame)
+    unsigned int        size;       // bytes of the frame as transferred (12 bits packed, 2 HDR readouts)
+};
+
+/*******************************************************************
+ * \struct RecordingStats
+ * \brief counters of the current (or last) recording
+ *******************************************************************/
+struct LIBDHYANA_API RecordingStats
+{
+    std::string     file_name;      // data file
+    int             nb_frames;      // written
+    int             nb_dropped;     // no free buffer or write error
+    double          throughput;     // MB/s since the first frame
+    int             in_flight_peak; // max nb of writes in progress
+    bool            error;
+    std::string     error_reason;   // the recording stopped on this error
+};
+
+/*******************************************************************
+ * \class StreamRecorder
+ * \brief write the frames to disk beside the Lima frame delivery
+ *
+ * The frames are recorded as delivered by the camera, before the
+ * processing stages (correction, HDR merge, accumulation...).
+ * The data file is opened without cache (FILE_FLAG_NO_BUFFERING) and
+ * written with overlapped I/O from page aligned buffers : each frame
+ * takes a slot rounded up to a multiple of 4096 bytes. The file is
+ * preallocated for the nb of frames of the acquisition (or grown by
+ * the preallocation step in continuous mode) and truncated at the end.
+ * The acquisition thread only copies the frame into a free buffer,
+ * the frame is dropped if all the buffers are in use.
+ *
+ * Files : <prefix>_<nnnn>.raw and <prefix>_<nnnn>.idx, nnnn is
+ * incremented at each acquisition.
+ *******************************************************************/
+class LIBDHYANA_API StreamRecorder
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "StreamRecorder", "Dhyana");
+
+public:
+    StreamRecorder();
+    ~StreamRecorder();
+
+    void setEnable(bool enable);
+    bool isEnabled() const;
+    //! path and prefix of the files, the file number restarts at 0
+    void setFilePrefix(const std::string& prefix);
+    std::string getFilePrefix() const;
+    //! 2 to 64 buffers, the max nb of writes in flight
+    void setNbBuffers(int nb_buffers);
+    int getNbBuffers() const;
+    //! nb of frames preallocated at once when the nb of frames is unknown (continuous acquisition)
+    void setPreallocationStep(int nb_frames);
+    int getPreallocationStep() const;
+
+    void getStats(RecordingStats& stats) const;
+
+    //! open and preallocate the files, type is the camera pixel type, nb_frames = 0 for a continuous acquisition
+    void start(const Size& size, ImageType type, size_t max_frame_size, int nb_frames);
+    //! wait for the pending writes, truncate and close the files
+    void stop();
+    bool isRecording() const;
+
+    //! queue a copy of the frame (size bytes, at most max_frame_size), false if it is dropped
+    bool push(const void* frame, size_t size, int frame_nb);
+
+private:
+    class WriterThread;
+
+    enum SlotState
+    {
+      kFree,
+      kFilling,
+      kFilled,
+      kWriting
+    };
+
+    struct Slot
+    {
+        SlotState           state;
+        unsigned char*      buffer;
+        OVERLAPPED          overlapped;
+        bool                failed;     // the write could not be issued
+        RecordIndexEntry    entry;
+    };
+
+    void writeLoop();
+    bool extendFile(unsigned long long size);
+    void closeFiles();
+
+    mutable Cond                m_cond;
+    bool                        m_enable;
+    std::string                 m_prefix;
+    int                         m_file_number;
+    int                         m_nb_buffers;
+    int                         m_preallocation_step;
+
+    //current recording
+    bool                        m_recording;
+    bool                        m_stop;
+    WriterThread*               m_thread;
+    HANDLE                      m_file;
+    FILE*                       m_index;
+    std::string                 m_file_name;
+    size_t                      m_frame_size;
+    size_t                      m_slot_size;
+    unsigned char*              m_buffers;
+    std::vector<Slot>           m_slots;
+    int                         m_next_fill;
+    int                         m_next_write;
+    int                         m_next_complete;
+    int                         m_in_flight;
+    unsigned long long          m_next_offset;
+    unsigned long long          m_allocated;
+    double                      m_start_time;
+
+    int                         m_nb_frames;
+    int                         m_nb_dropped;
+    double                      m_nb_bytes;
+    int                         m_in_flight_peak;
+    double                      m_last_time;
+    bool                        m_error;
+    std::string                 m_error_reason;
+};
+
+/*******************************************************************
+ * \class WriterThread
+ * \brief issues the writes and collects their completion
+ *******************************************************************/
+class StreamRecorder::WriterThread : public Thread
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "StreamRecorder", "WriterThread");
+public:
+    WriterThread(StreamRecorder& recorder);
+    virtual ~WriterThread();
+
+protected:
+    virtual void threadFunction();
+
+private:
+    StreamRecorder& m_recorder;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANASTREAMRECORDER_H_ */
@@ -0,0 +1,109 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaTelemetryRing.h
+// Time series of the camera sensors sampled in the background
+
+#ifndef DHYANATELEMETRYRING_H_
+#define DHYANATELEMETRYRING_H_
+
+#include <windows.h>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \struct TelemetrySample
+ * \brief values of the sensors read together
+ *******************************************************************/
+struct LIBDHYANA_API TelemetrySample
+{
+    enum Field
+    {
+      kTemperature      = 1 << 0,
+      kFanSpeed         = 1 << 1,
+      kFpgaTemperature  = 1 << 2,
+      kPcbaTemperature  = 1 << 3,
+      kEnvTemperature   = 1 << 4,
+      kBufferedFrames   = 1 << 5
+    };
+
+    double      timestamp;          // host time (s)
+    unsigned    fields;             // Field bits of the values read, the models do not have all the sensors
+    double      temperature;        // sensor (TUIDP_TEMPERATURE)
+    int         fan_speed;          // TUIDI_FAN_SPEED
+    double      fpga_temperature;   // TUIDI_FPGA_TEMPERATURE
+    double      pcba_temperature;   // TUIDI_PCBA_TEMPERATURE
+    double      env_temperature;    // TUIDI_ENV_TEMPERATURE
+    int         buffered_frames;    // TUIDI_CURRENTBUFFRAMES
+};
+
+/*******************************************************************
+ * \class TelemetryRing
+ * \brief fixed size ring of the last samples, without lock
+ *
+ * There is a single writer (the sampling thread), the readers never
+ * block it : each slot is a seqlock, its sequence is odd while the
+ * sample is written, and a reader copies the sample again if the
+ * sequence changed meanwhile. A slot already overwritten by a newer
+ * sample is skipped by getHistory.
+ *******************************************************************/
+class LIBDHYANA_API TelemetryRing
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "TelemetryRing", "Dhyana");
+
+public:
+    explicit TelemetryRing(int nb_samples);
+    ~TelemetryRing();
+
+    int getNbSlots() const;
+    long long getNbSamples() const;
+
+    //! single writer
+    void push(const TelemetrySample& sample);
+    bool getLast(TelemetrySample& sample) const;
+    //! samples with a timestamp after since (s), the oldest first
+    void getHistory(std::vector<TelemetrySample>& history, double since = 0.) const;
+
+private:
+    struct Slot
+    {
+        volatile LONG       sequence;   // odd while the sample is written
+        long long           index;      // sample index, to detect an overwritten slot
+        TelemetrySample     sample;
+    };
+
+    bool read(long long index, TelemetrySample& sample) const;
+
+    std::vector<Slot>       m_slots;
+    volatile LONGLONG       m_nb_samples;
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANATELEMETRYRING_H_ */
@@ -0,0 +1,88 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2011
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+//
+// DhyanaTucamSdk.h
+// TUCAM SDK environment shared by the cameras of the process
+
+#ifndef DHYANATUCAMSDK_H_
+#define DHYANATUCAMSDK_H_
+
+#include <string>
+#include <vector>
+#include "DhyanaCompatibility.h"
+#include "lima/Debug.h"
+#include "lima/ThreadUtils.h"
+#include "TUCamApi.h"
+#include "TUDefine.h"
+
+namespace lima
+{
+namespace Dhyana
+{
+
+/*******************************************************************
+ * \class TucamSdk
+ * \brief reference counted TUCAM_Api_Init/TUCAM_Api_Uninit
+ *
+ * The SDK environment is global to the process : it is initialized
+ * by the first camera and uninitialized by the last one, so that
+ * several Camera objects can live in one process.
+ * A camera (device index) can only be opened once, the cameras are
+ * opened concurrently, by index or by serial number.
+ *******************************************************************/
+class LIBDHYANA_API TucamSdk
+{
+    DEB_CLASS_NAMESPC(DebModCamera, "TucamSdk", "Dhyana");
+
+public:
+    //! TUCAM_Api_Init by the first user
+    static void init();
+    //! TUCAM_Api_Uninit by the last user
+    static void uninit();
+
+    //! open the camera with this serial number, or at this index if serial_number is empty
+    static void open(int index, const std::string& serial_number, TUCAM_OPEN& cam);
+    static void close(TUCAM_OPEN& cam);
+    //! enumerate the cameras again (TUCAM_Api_Uninit/Init), only if no camera is opened
+    static bool refresh();
+
+    //! nb of cameras found by TUCAM_Api_Init, 0 if the SDK is not initialized
+    static int getNbCameras();
+    //! nb of cameras opened in the process
+    static int getNbOpen();
+    static std::string getSerialNumber(HDTUCAM handle);
+
+private:
+    static bool isOpen(int index);
+    static bool isProbed(int index);
+
+    static Cond                 s_cond;
+    static int                  s_nb_users;
+    static TUCAM_INIT           s_init;
+    static std::vector<int>     s_open_indexes;
+    static std::vector<int>     s_probed_indexes;   // opened to read their serial number
+};
+
+} // namespace Dhyana
+} // namespace lima
+
+#endif /* DHYANATUCAMSDK_H_ */
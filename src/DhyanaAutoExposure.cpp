@@ -0,0 +1,302 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cmath>
+#include "lima/Exceptions.h"
+#include "DhyanaAutoExposure.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+AutoExposure::AutoExposure() :
+m_enable(false),
+m_percentile(0.99),
+m_level(0.7),
+m_max_saturated(0.001),
+m_min_exp_time(0.0001),
+m_max_exp_time(1.),
+m_damping(0.7),
+m_tolerance(0.05),
+m_max_step(4.),
+m_settle_frames(2),
+m_settle_remaining(0)
+{
+	DEB_CONSTRUCTOR();
+	m_status.converged = false;
+	m_status.nb_iterations = 0;
+	m_status.frame_nb = -1;
+	m_status.exp_time = 0.;
+	m_status.measured = 0.;
+	m_status.target = 0.;
+	m_status.saturated_fraction = 0.;
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+AutoExposure::~AutoExposure()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void AutoExposure::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+}
+
+bool AutoExposure::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void AutoExposure::setTarget(double percentile, double level)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(percentile, level);
+	if(percentile <= 0. || percentile > 1. || level <= 0. || level > 1.)
+	{
+		THROW_HW_ERROR(Error) << "Auto exposure percentile and level must be in ]0, 1] !";
+	}
+	AutoMutex lock(m_mutex);
+	m_percentile = percentile;
+	m_level = level;
+	m_status.converged = false;
+}
+
+void AutoExposure::getTarget(double& percentile, double& level) const
+{
+	AutoMutex lock(m_mutex);
+	percentile = m_percentile;
+	level = m_level;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void AutoExposure::setMaxSaturated(double fraction)
+{
+	DEB_MEMBER_FUNCT();
+	if(fraction < 0. || fraction > 1.)
+	{
+		THROW_HW_ERROR(Error) << "Auto exposure saturated fraction must be in [0, 1] !";
+	}
+	AutoMutex lock(m_mutex);
+	m_max_saturated = fraction;
+}
+
+double AutoExposure::getMaxSaturated() const
+{
+	AutoMutex lock(m_mutex);
+	return m_max_saturated;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void AutoExposure::setExposureBounds(double min_exp_time, double max_exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(min_exp_time, max_exp_time);
+	if(min_exp_time <= 0. || max_exp_time < min_exp_time)
+	{
+		THROW_HW_ERROR(Error) << "Auto exposure bounds must verify 0 < min <= max !";
+	}
+	AutoMutex lock(m_mutex);
+	m_min_exp_time = min_exp_time;
+	m_max_exp_time = max_exp_time;
+}
+
+void AutoExposure::getExposureBounds(double& min_exp_time, double& max_exp_time) const
+{
+	AutoMutex lock(m_mutex);
+	min_exp_time = m_min_exp_time;
+	max_exp_time = m_max_exp_time;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void AutoExposure::setDamping(double damping)
+{
+	DEB_MEMBER_FUNCT();
+	if(damping <= 0. || damping > 1.)
+	{
+		THROW_HW_ERROR(Error) << "Auto exposure damping must be in ]0, 1] !";
+	}
+	AutoMutex lock(m_mutex);
+	m_damping = damping;
+}
+
+double AutoExposure::getDamping() const
+{
+	AutoMutex lock(m_mutex);
+	return m_damping;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void AutoExposure::setTolerance(double tolerance)
+{
+	DEB_MEMBER_FUNCT();
+	if(tolerance <= 0. || tolerance >= 1.)
+	{
+		THROW_HW_ERROR(Error) << "Auto exposure tolerance must be in ]0, 1[ !";
+	}
+	AutoMutex lock(m_mutex);
+	m_tolerance = tolerance;
+}
+
+double AutoExposure::getTolerance() const
+{
+	AutoMutex lock(m_mutex);
+	return m_tolerance;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void AutoExposure::setSettleFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	if(nb_frames < 0)
+	{
+		THROW_HW_ERROR(Error) << "Auto exposure settle frames must be positive !";
+	}
+	AutoMutex lock(m_mutex);
+	m_settle_frames = nb_frames;
+}
+
+int AutoExposure::getSettleFrames() const
+{
+	AutoMutex lock(m_mutex);
+	return m_settle_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void AutoExposure::getStatus(AutoExposureStatus& status) const
+{
+	AutoMutex lock(m_mutex);
+	status = m_status;
+}
+
+void AutoExposure::reset()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_status.converged = false;
+	m_status.nb_iterations = 0;
+	m_status.frame_nb = -1;
+	m_settle_remaining = 0;
+}
+
+//-----------------------------------------------------
+// @brief one step of the loop
+//-----------------------------------------------------
+bool AutoExposure::update(const FrameHistogramData& histogram, double exp_time, double& new_exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	if(!m_enable || histogram.bins.empty())
+		return false;
+	if(m_settle_remaining > 0)
+	{
+		//frames exposed before the last change
+		m_settle_remaining--;
+		return false;
+	}
+
+	unsigned long long total = 0;
+	for(size_t b = 0; b < histogram.bins.size(); b++)
+		total += histogram.bins[b];
+	if(total == 0)
+		return false;
+
+	double full_scale = (double) histogram.bins.size() * histogram.bin_width;
+	double measured = FrameHistogram::percentile(histogram, m_percentile);
+	double target = m_level * full_scale;
+	double saturated_fraction = (double) histogram.bins.back() / (double) total;
+	bool saturated = (saturated_fraction > m_max_saturated);
+
+	m_status.frame_nb = histogram.frame_nb;
+	m_status.measured = measured;
+	m_status.target = target;
+	m_status.saturated_fraction = saturated_fraction;
+	m_status.exp_time = exp_time;
+
+	double error = (measured > 0.) ? std::fabs(measured / target - 1.) : 1.;
+	if(!saturated && error <= m_tolerance)
+	{
+		if(!m_status.converged)
+		{
+			DEB_TRACE() << "Auto exposure converged : " << DEB_VAR3(exp_time, measured, m_status.nb_iterations);
+		}
+		m_status.converged = true;
+		return false;
+	}
+	m_status.converged = false;
+
+	double ratio;
+	if(saturated)
+	{
+		//the percentile is blind above the full scale
+		ratio = 0.5;
+	}
+	else
+	{
+		ratio = std::pow(target / ((measured > 1.) ? measured : 1.), m_damping);
+	}
+	if(ratio > m_max_step)
+		ratio = m_max_step;
+	if(ratio < 1. / m_max_step)
+		ratio = 1. / m_max_step;
+
+	new_exp_time = exp_time * ratio;
+	if(new_exp_time < m_min_exp_time)
+		new_exp_time = m_min_exp_time;
+	if(new_exp_time > m_max_exp_time)
+		new_exp_time = m_max_exp_time;
+	// at a bound, nothing more can be done
+	if(std::fabs(new_exp_time - exp_time) <= 1e-9 * exp_time)
+		return false;
+
+	m_status.exp_time = new_exp_time;
+	m_status.nb_iterations++;
+	m_settle_remaining = m_settle_frames;
+	return true;
+}
+
+//-----------------------------------------------------
@@ -0,0 +1,427 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cmath>
+#include <emmintrin.h>
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "DhyanaBeamAnalysis.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief background subtraction and threshold of a pixel
+//-----------------------------------------------------
+static inline float beam_pixel(float v, float background, float threshold)
+{
+	v -= background;
+	if(v < 0.f)
+		v = 0.f;
+	return (v >= threshold) ? v : 0.f;
+}
+
+//-----------------------------------------------------
+// @brief SSE2 projections of a 16 bits frame
+//-----------------------------------------------------
+static void project_u16(const unsigned short* src, int width, int height, float background, float threshold,
+						float* projection_x, float* projection_y)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 fzero = _mm_setzero_ps();
+	const __m128 bg = _mm_set1_ps(background);
+	const __m128 thr = _mm_set1_ps(threshold);
+
+	for(int y = 0; y < height; y++)
+	{
+		const unsigned short* row = src + (size_t) y * width;
+		__m128 row_sum = fzero;
+		int x = 0;
+		for(; x + 8 <= width; x += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*) (row + x));
+			__m128 lo = _mm_max_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), bg), fzero);
+			__m128 hi = _mm_max_ps(_mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), bg), fzero);
+			lo = _mm_and_ps(lo, _mm_cmpge_ps(lo, thr));
+			hi = _mm_and_ps(hi, _mm_cmpge_ps(hi, thr));
+			_mm_storeu_ps(projection_x + x, _mm_add_ps(_mm_loadu_ps(projection_x + x), lo));
+			_mm_storeu_ps(projection_x + x + 4, _mm_add_ps(_mm_loadu_ps(projection_x + x + 4), hi));
+			row_sum = _mm_add_ps(row_sum, _mm_add_ps(lo, hi));
+		}
+
+		float sums[4];
+		_mm_storeu_ps(sums, row_sum);
+		float sum = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+		for(; x < width; x++)
+		{
+			float v = beam_pixel((float) row[x], background, threshold);
+			projection_x[x] += v;
+			sum += v;
+		}
+		projection_y[y] = sum;
+	}
+}
+
+//-----------------------------------------------------
+// @brief projections of the other pixel types
+//-----------------------------------------------------
+template<class T>
+static void project_generic(const T* src, int width, int height, float background, float threshold,
+							float* projection_x, float* projection_y)
+{
+	for(int y = 0; y < height; y++)
+	{
+		const T* row = src + (size_t) y * width;
+		float sum = 0.f;
+		for(int x = 0; x < width; x++)
+		{
+			float v = beam_pixel((float) row[x], background, threshold);
+			projection_x[x] += v;
+			sum += v;
+		}
+		projection_y[y] = sum;
+	}
+}
+
+//-----------------------------------------------------
+// @brief centroid and second moment of a projection, false if empty
+//-----------------------------------------------------
+static bool projection_moments(const std::vector<float>& p, double& total, double& centroid, double& sigma)
+{
+	double sum = 0.;
+	double sum_x = 0.;
+	for(size_t i = 0; i < p.size(); i++)
+	{
+		sum += p[i];
+		sum_x += (double) i * p[i];
+	}
+	total = sum;
+	centroid = 0.;
+	sigma = 0.;
+	if(sum <= 0.)
+		return false;
+	centroid = sum_x / sum;
+	double sum_xx = 0.;
+	for(size_t i = 0; i < p.size(); i++)
+	{
+		double d = (double) i - centroid;
+		sum_xx += d * d * p[i];
+	}
+	sigma = std::sqrt(sum_xx / sum);
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief full width at half max around the peak of a projection
+//-----------------------------------------------------
+static double projection_fwhm(const std::vector<float>& p, int& peak)
+{
+	peak = 0;
+	for(size_t i = 1; i < p.size(); i++)
+	{
+		if(p[i] > p[peak])
+			peak = (int) i;
+	}
+	if(p.empty() || p[peak] <= 0.f)
+		return 0.;
+
+	double half = 0.5 * p[peak];
+	double left = 0.;
+	for(int i = peak; i > 0; i--)
+	{
+		if(p[i - 1] < half)
+		{
+			left = (i - 1) + (half - p[i - 1]) / (p[i] - p[i - 1]);
+			break;
+		}
+	}
+	double right = (double) p.size() - 1;
+	for(int i = peak; i + 1 < (int) p.size(); i++)
+	{
+		if(p[i + 1] < half)
+		{
+			right = i + (p[i] - half) / (p[i] - p[i + 1]);
+			break;
+		}
+	}
+	return right - left;
+}
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+BeamAnalysis::BeamAnalysis() :
+m_enable(false),
+m_background(0.),
+m_threshold(0.),
+m_projections(false),
+m_history(256),
+m_history_next(0),
+m_history_count(0),
+m_callback(NULL)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+BeamAnalysis::~BeamAnalysis()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void BeamAnalysis::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+}
+
+bool BeamAnalysis::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void BeamAnalysis::setBackground(double background)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_background = background;
+}
+
+double BeamAnalysis::getBackground() const
+{
+	AutoMutex lock(m_mutex);
+	return m_background;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void BeamAnalysis::setThreshold(double threshold)
+{
+	DEB_MEMBER_FUNCT();
+	if(threshold < 0.)
+	{
+		THROW_HW_ERROR(Error) << "Beam threshold must be positive !";
+	}
+	AutoMutex lock(m_mutex);
+	m_threshold = threshold;
+}
+
+double BeamAnalysis::getThreshold() const
+{
+	AutoMutex lock(m_mutex);
+	return m_threshold;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void BeamAnalysis::setProjections(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_projections = enable;
+}
+
+bool BeamAnalysis::getProjections() const
+{
+	AutoMutex lock(m_mutex);
+	return m_projections;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void BeamAnalysis::setHistorySize(int size)
+{
+	DEB_MEMBER_FUNCT();
+	if(size < 1)
+	{
+		THROW_HW_ERROR(Error) << "Beam history size must be at least 1 !";
+	}
+	AutoMutex lock(m_mutex);
+	m_history.assign(size, BeamResult());
+	m_history_next = 0;
+	m_history_count = 0;
+}
+
+int BeamAnalysis::getHistorySize() const
+{
+	AutoMutex lock(m_mutex);
+	return (int) m_history.size();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void BeamAnalysis::registerCallback(BeamResultCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback)
+	{
+		THROW_HW_ERROR(Error) << "A beam callback is already registered !";
+	}
+	m_callback = &cb;
+}
+
+void BeamAnalysis::unregisterCallback(BeamResultCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback != &cb)
+	{
+		THROW_HW_ERROR(Error) << "This beam callback is not registered !";
+	}
+	m_callback = NULL;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool BeamAnalysis::getLast(BeamResult& result) const
+{
+	AutoMutex lock(m_mutex);
+	if(m_history_count == 0)
+		return false;
+	int last = (m_history_next + (int) m_history.size() - 1) % (int) m_history.size();
+	result = m_history[last];
+	return true;
+}
+
+void BeamAnalysis::getHistory(std::vector<BeamResult>& history) const
+{
+	AutoMutex lock(m_mutex);
+	history.clear();
+	history.reserve(m_history_count);
+	int size = (int) m_history.size();
+	int first = (m_history_next + size - m_history_count) % size;
+	for(int k = 0; k < m_history_count; k++)
+	{
+		history.push_back(m_history[(first + k) % size]);
+		history.back().projection_x.clear();
+		history.back().projection_y.clear();
+	}
+}
+
+void BeamAnalysis::reset()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_history_next = 0;
+	m_history_count = 0;
+}
+
+//-----------------------------------------------------
+// @brief moments and widths from the projections
+//-----------------------------------------------------
+void BeamAnalysis::computeResult()
+{
+	double total_y;
+	bool valid_x = projection_moments(m_current.projection_x, m_current.total, m_current.centroid_x, m_current.sigma_x);
+	bool valid_y = projection_moments(m_current.projection_y, total_y, m_current.centroid_y, m_current.sigma_y);
+	m_current.valid = valid_x && valid_y;
+	m_current.fwhm_x = projection_fwhm(m_current.projection_x, m_current.peak_x);
+	m_current.fwhm_y = projection_fwhm(m_current.projection_y, m_current.peak_y);
+}
+
+//-----------------------------------------------------
+// @brief store in the ring buffer and call the callback
+//-----------------------------------------------------
+void BeamAnalysis::publish(bool with_projections)
+{
+	if(!with_projections)
+	{
+		m_current.projection_x.clear();
+		m_current.projection_y.clear();
+	}
+	{
+		AutoMutex lock(m_mutex);
+		m_history[m_history_next] = m_current;
+		m_history_next = (m_history_next + 1) % (int) m_history.size();
+		if(m_history_count < (int) m_history.size())
+			m_history_count++;
+	}
+
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback)
+	{
+		m_callback->beamResultReady(m_current);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void BeamAnalysis::process(const void* frame, ImageType type, int width, int height, int frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	float background;
+	float threshold;
+	bool with_projections;
+	{
+		AutoMutex lock(m_mutex);
+		background = (float) m_background;
+		threshold = (float) m_threshold;
+		with_projections = m_projections;
+	}
+
+	m_current.frame_nb = frame_nb;
+	m_current.timestamp = Timestamp::now();
+	m_current.projection_x.assign(width, 0.f);
+	m_current.projection_y.assign(height, 0.f);
+	float* projection_x = width ? &m_current.projection_x[0] : NULL;
+	float* projection_y = height ? &m_current.projection_y[0] : NULL;
+	switch(type)
+	{
+		case Bpp8:
+			project_generic((const unsigned char*) frame, width, height, background, threshold, projection_x, projection_y);
+			break;
+		case Bpp16:
+			project_u16((const unsigned short*) frame, width, height, background, threshold, projection_x, projection_y);
+			break;
+		case Bpp32:
+			project_generic((const unsigned int*) frame, width, height, background, threshold, projection_x, projection_y);
+			break;
+		case Bpp32F:
+			project_generic((const float*) frame, width, height, background, threshold, projection_x, projection_y);
+			break;
+		default:
+			DEB_ERROR() << "Beam analysis : unsupported image type " << type;
+			return;
+	}
+
+	computeResult();
+	publish(with_projections);
+}
+
+//-----------------------------------------------------
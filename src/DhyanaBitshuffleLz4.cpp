@@ -0,0 +1,531 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cstring>
+#include <emmintrin.h>
+#include "DhyanaBitshuffleLz4.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// bitshuffle filter constants
+//-----------------------------------------------------
+static const size_t BSHUF_TARGET_BLOCK_SIZE_B = 8192;
+static const size_t BSHUF_MIN_BLOCK_SIZE = 128;
+static const size_t BSHUF_BLOCKED_MULT = 8;
+static const size_t BSHUF_HEADER_SIZE = 12;
+
+//-----------------------------------------------------
+// LZ4 block format constants
+//-----------------------------------------------------
+static const int LZ4_HASH_LOG = 12;
+static const size_t LZ4_MIN_MATCH = 4;
+static const size_t LZ4_LAST_LITERALS = 5;     // the last 5 bytes are always literals
+static const size_t LZ4_MF_LIMIT = 12;         // a match starts at least 12 bytes before the end
+static const size_t LZ4_MAX_DISTANCE = 65535;
+static const unsigned LZ4_SKIP_TRIGGER = 6;    // speed up the search after 64 misses (incompressible data)
+
+//-----------------------------------------------------
+// @brief big endian helpers
+//-----------------------------------------------------
+static inline void write_uint32_be(unsigned char* p, size_t v)
+{
+	p[0] = (unsigned char) (v >> 24);
+	p[1] = (unsigned char) (v >> 16);
+	p[2] = (unsigned char) (v >> 8);
+	p[3] = (unsigned char) v;
+}
+
+static inline size_t read_uint32_be(const unsigned char* p)
+{
+	return ((size_t) p[0] << 24) | ((size_t) p[1] << 16) | ((size_t) p[2] << 8) | (size_t) p[3];
+}
+
+static inline void write_uint64_be(unsigned char* p, unsigned long long v)
+{
+	for(int i = 7; i >= 0; i--)
+	{
+		p[i] = (unsigned char) v;
+		v >>= 8;
+	}
+}
+
+static inline unsigned long long read_uint64_be(const unsigned char* p)
+{
+	unsigned long long v = 0;
+	for(int i = 0; i < 8; i++)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+//-----------------------------------------------------
+// @brief LZ4 worst case of a block
+//-----------------------------------------------------
+static inline size_t lz4_bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+//-----------------------------------------------------
+// @brief store the 8 bit planes of 16 bytes : plane k, bit e of byte b <- bit k of byte e of the group b
+//-----------------------------------------------------
+static inline void bitshuffle_store_planes(__m128i v, unsigned char* out, size_t row, size_t byte_index, size_t b)
+{
+	// movemask takes the msb of each byte : bit 7 first, then shift the bytes left
+	for(int k = 7; k >= 0; k--)
+	{
+		int bits = _mm_movemask_epi8(v);
+		unsigned char* p = out + (byte_index * 8 + k) * row + b;
+		p[0] = (unsigned char) bits;
+		p[1] = (unsigned char) (bits >> 8);
+		v = _mm_add_epi8(v, v);
+	}
+}
+
+//-----------------------------------------------------
+// @brief bit transpose of a block of n elements (n multiple of 8)
+// out row (j * 8 + k) holds bit k of byte j of the n elements, 1 bit per element
+//-----------------------------------------------------
+static void bitshuffle_block(const unsigned char* in, unsigned char* out, size_t n, size_t elem_size)
+{
+	const size_t row = n / 8;
+	size_t i = 0;
+
+	if(elem_size == 1)
+	{
+		for(; i + 16 <= n; i += 16)
+			bitshuffle_store_planes(_mm_loadu_si128((const __m128i*) (in + i)), out, row, 0, i / 8);
+	}
+	else if(elem_size == 2)
+	{
+		const __m128i low_mask = _mm_set1_epi16(0x00FF);
+		for(; i + 16 <= n; i += 16)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*) (in + i * 2));
+			__m128i c = _mm_loadu_si128((const __m128i*) (in + i * 2 + 16));
+			__m128i lo = _mm_packus_epi16(_mm_and_si128(a, low_mask), _mm_and_si128(c, low_mask));
+			__m128i hi = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(c, 8));
+			bitshuffle_store_planes(lo, out, row, 0, i / 8);
+			bitshuffle_store_planes(hi, out, row, 1, i / 8);
+		}
+	}
+	else if(elem_size == 4)
+	{
+		const __m128i byte_mask = _mm_set1_epi32(0xFF);
+		for(; i + 16 <= n; i += 16)
+		{
+			__m128i q[4];
+			for(int l = 0; l < 4; l++)
+				q[l] = _mm_loadu_si128((const __m128i*) (in + i * 4 + l * 16));
+			for(size_t j = 0; j < 4; j++)
+			{
+				__m128i shift = _mm_cvtsi32_si128((int) (j * 8));
+				__m128i w01 = _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(q[0], shift), byte_mask),
+											  _mm_and_si128(_mm_srl_epi32(q[1], shift), byte_mask));
+				__m128i w23 = _mm_packs_epi32(_mm_and_si128(_mm_srl_epi32(q[2], shift), byte_mask),
+											  _mm_and_si128(_mm_srl_epi32(q[3], shift), byte_mask));
+				bitshuffle_store_planes(_mm_packus_epi16(w01, w23), out, row, j, i / 8);
+			}
+		}
+	}
+
+	// remaining groups of 8 elements, and the other element sizes
+	for(; i < n; i += 8)
+	{
+		for(size_t j = 0; j < elem_size; j++)
+		{
+			for(int k = 0; k < 8; k++)
+			{
+				unsigned int byte = 0;
+				for(int e = 0; e < 8; e++)
+					byte |= ((in[(i + e) * elem_size + j] >> k) & 1) << e;
+				out[(j * 8 + k) * row + i / 8] = (unsigned char) byte;
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------
+// @brief inverse of bitshuffle_block
+//-----------------------------------------------------
+static void bitunshuffle_block(const unsigned char* in, unsigned char* out, size_t n, size_t elem_size)
+{
+	const size_t row = n / 8;
+	memset(out, 0, n * elem_size);
+	for(size_t j = 0; j < elem_size; j++)
+	{
+		for(int k = 0; k < 8; k++)
+		{
+			const unsigned char* plane = in + (j * 8 + k) * row;
+			for(size_t b = 0; b < row; b++)
+			{
+				unsigned int bits = plane[b];
+				if(!bits)
+					continue;
+				unsigned char* o = out + b * 8 * elem_size + j;
+				for(int e = 0; e < 8; e++)
+					o[e * elem_size] |= (unsigned char) (((bits >> e) & 1) << k);
+			}
+		}
+	}
+}
+
+//-----------------------------------------------------
+// @brief LZ4 helpers
+//-----------------------------------------------------
+static inline unsigned int lz4_read32(const unsigned char* p)
+{
+	unsigned int v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline unsigned int lz4_hash(unsigned int v)
+{
+	return (v * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static inline unsigned char* lz4_write_length(unsigned char* op, size_t length)
+{
+	while(length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = (unsigned char) length;
+	return op;
+}
+
+//-----------------------------------------------------
+// @brief one sequence : literals then a match (match_length 0 for the last sequence)
+//-----------------------------------------------------
+static unsigned char* lz4_write_sequence(unsigned char* op, const unsigned char* literals, size_t nb_literals,
+										 size_t offset, size_t match_length)
+{
+	unsigned char* token = op++;
+	unsigned int t;
+	if(nb_literals >= 15)
+	{
+		t = 15 << 4;
+		op = lz4_write_length(op, nb_literals - 15);
+	}
+	else
+	{
+		t = (unsigned int) nb_literals << 4;
+	}
+	memcpy(op, literals, nb_literals);
+	op += nb_literals;
+
+	if(match_length)
+	{
+		*op++ = (unsigned char) offset;
+		*op++ = (unsigned char) (offset >> 8);
+		size_t length = match_length - LZ4_MIN_MATCH;
+		if(length >= 15)
+		{
+			t |= 15;
+			op = lz4_write_length(op, length - 15);
+		}
+		else
+		{
+			t |= (unsigned int) length;
+		}
+	}
+	*token = (unsigned char) t;
+	return op;
+}
+
+//-----------------------------------------------------
+// @brief greedy LZ4 block compression
+// table holds positions relative to the chunk, base is the position of src :
+// the entries of the previous blocks are ignored, the table is cleared once per chunk
+//-----------------------------------------------------
+static size_t lz4_compress_block(const unsigned char* src, size_t size, unsigned char* dst,
+								 unsigned int* table, unsigned int base)
+{
+	const unsigned char* ip = src;
+	const unsigned char* anchor = src;
+	const unsigned char* const iend = src + size;
+	unsigned char* op = dst;
+
+	if(size > LZ4_MF_LIMIT)
+	{
+		const unsigned char* const mflimit = iend - LZ4_MF_LIMIT;
+		const unsigned char* const matchlimit = iend - LZ4_LAST_LITERALS;
+		unsigned int search = 1 << LZ4_SKIP_TRIGGER;
+
+		// the first position can only be a match source
+		table[lz4_hash(lz4_read32(ip))] = base;
+		ip++;
+		while(ip <= mflimit)
+		{
+			unsigned int h = lz4_hash(lz4_read32(ip));
+			unsigned int pos = base + (unsigned int) (ip - src);
+			unsigned int candidate = table[h];
+			table[h] = pos;
+			if(candidate < base || pos - candidate > LZ4_MAX_DISTANCE ||
+			   lz4_read32(src + (candidate - base)) != lz4_read32(ip))
+			{
+				ip += search++ >> LZ4_SKIP_TRIGGER;
+				continue;
+			}
+
+			const unsigned char* match = src + (candidate - base);
+			while(ip > anchor && match > src && ip[-1] == match[-1])
+			{
+				ip--;
+				match--;
+			}
+			const unsigned char* mp = ip + LZ4_MIN_MATCH;
+			const unsigned char* mm = match + LZ4_MIN_MATCH;
+			while(mp + 8 <= matchlimit)
+			{
+				unsigned long long a, b;
+				memcpy(&a, mp, 8);
+				memcpy(&b, mm, 8);
+				if(a != b)
+					break;
+				mp += 8;
+				mm += 8;
+			}
+			while(mp < matchlimit && *mp == *mm)
+			{
+				mp++;
+				mm++;
+			}
+
+			op = lz4_write_sequence(op, anchor, ip - anchor, ip - match, mp - ip);
+			ip = mp;
+			anchor = ip;
+			search = 1 << LZ4_SKIP_TRIGGER;
+			if(ip <= mflimit)
+				table[lz4_hash(lz4_read32(ip - 2))] = base + (unsigned int) (ip - 2 - src);
+		}
+	}
+
+	op = lz4_write_sequence(op, anchor, iend - anchor, 0, 0);
+	return op - dst;
+}
+
+//-----------------------------------------------------
+// @brief LZ4 block decompression, the block must fill dst exactly
+//-----------------------------------------------------
+static bool lz4_decompress_block(const unsigned char* src, size_t size, unsigned char* dst, size_t dst_size)
+{
+	const unsigned char* ip = src;
+	const unsigned char* const iend = src + size;
+	unsigned char* op = dst;
+	unsigned char* const oend = dst + dst_size;
+
+	while(ip < iend)
+	{
+		unsigned int token = *ip++;
+		size_t nb_literals = token >> 4;
+		if(nb_literals == 15)
+		{
+			unsigned int b;
+			do
+			{
+				if(ip >= iend)
+					return false;
+				b = *ip++;
+				nb_literals += b;
+			} while(b == 255);
+		}
+		if((size_t) (iend - ip) < nb_literals || (size_t) (oend - op) < nb_literals)
+			return false;
+		memcpy(op, ip, nb_literals);
+		op += nb_literals;
+		ip += nb_literals;
+		if(ip == iend)
+			break;
+
+		if(iend - ip < 2)
+			return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > (size_t) (op - dst))
+			return false;
+		size_t match_length = token & 15;
+		if(match_length == 15)
+		{
+			unsigned int b;
+			do
+			{
+				if(ip >= iend)
+					return false;
+				b = *ip++;
+				match_length += b;
+			} while(b == 255);
+		}
+		match_length += LZ4_MIN_MATCH;
+		if((size_t) (oend - op) < match_length)
+			return false;
+		// the match may overlap the output (runs)
+		const unsigned char* match = op - offset;
+		for(size_t i = 0; i < match_length; i++)
+			op[i] = match[i];
+		op += match_length;
+	}
+	return op == oend;
+}
+
+//-----------------------------------------------------
+// @brief block size in elements : 0 is the default, else a multiple of 8
+//-----------------------------------------------------
+static size_t checked_block_size(size_t block_size, size_t elem_size)
+{
+	block_size -= block_size % BSHUF_BLOCKED_MULT;
+	return block_size ? block_size : BitshuffleLz4::defaultBlockSize(elem_size);
+}
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+BitshuffleLz4::BitshuffleLz4() :
+m_hash_table(1 << LZ4_HASH_LOG, 0)
+{
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+BitshuffleLz4::~BitshuffleLz4()
+{
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+size_t BitshuffleLz4::defaultBlockSize(size_t elem_size)
+{
+	size_t block_size = BSHUF_TARGET_BLOCK_SIZE_B / elem_size;
+	block_size = (block_size / BSHUF_BLOCKED_MULT) * BSHUF_BLOCKED_MULT;
+	return (block_size < BSHUF_MIN_BLOCK_SIZE) ? BSHUF_MIN_BLOCK_SIZE : block_size;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+size_t BitshuffleLz4::maxCompressedSize(size_t nb_elements, size_t elem_size, size_t block_size)
+{
+	block_size = checked_block_size(block_size, elem_size);
+	size_t nb_blocks = nb_elements / block_size;
+	size_t last_block_size = nb_elements % block_size;
+	last_block_size -= last_block_size % BSHUF_BLOCKED_MULT;
+	size_t leftover = nb_elements % BSHUF_BLOCKED_MULT;
+
+	size_t size = BSHUF_HEADER_SIZE + nb_blocks * (4 + lz4_bound(block_size * elem_size));
+	if(last_block_size)
+		size += 4 + lz4_bound(last_block_size * elem_size);
+	return size + leftover * elem_size;
+}
+
+//-----------------------------------------------------
+// @brief blocks of block_size elements, then the last block rounded down to a multiple of 8
+//-----------------------------------------------------
+size_t BitshuffleLz4::compress(const void* src, size_t nb_elements, size_t elem_size, size_t block_size, void* dst)
+{
+	block_size = checked_block_size(block_size, elem_size);
+	const size_t block_bytes = block_size * elem_size;
+	const unsigned char* in = (const unsigned char*) src;
+	unsigned char* out = (unsigned char*) dst;
+
+	write_uint64_be(out, (unsigned long long) nb_elements * elem_size);
+	write_uint32_be(out + 8, block_bytes);
+	size_t out_size = BSHUF_HEADER_SIZE;
+
+	if(m_shuffled.size() < block_bytes)
+		m_shuffled.resize(block_bytes);
+	memset(&m_hash_table[0], 0, m_hash_table.size() * sizeof(unsigned int));
+
+	size_t done = 0;
+	while(done + BSHUF_BLOCKED_MULT <= nb_elements)
+	{
+		size_t n = nb_elements - done;
+		if(n > block_size)
+			n = block_size;
+		n -= n % BSHUF_BLOCKED_MULT;
+
+		bitshuffle_block(in + done * elem_size, &m_shuffled[0], n, elem_size);
+		size_t size = lz4_compress_block(&m_shuffled[0], n * elem_size, out + out_size + 4,
+										 &m_hash_table[0], (unsigned int) (done * elem_size));
+		write_uint32_be(out + out_size, size);
+		out_size += 4 + size;
+		done += n;
+	}
+
+	size_t leftover = (nb_elements - done) * elem_size;
+	memcpy(out + out_size, in + done * elem_size, leftover);
+	return out_size + leftover;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool BitshuffleLz4::decompress(const void* src, size_t src_size, size_t elem_size, void* dst, size_t dst_size)
+{
+	const unsigned char* in = (const unsigned char*) src;
+	unsigned char* out = (unsigned char*) dst;
+	if(src_size < BSHUF_HEADER_SIZE || elem_size == 0)
+		return false;
+
+	unsigned long long total = read_uint64_be(in);
+	size_t block_bytes = read_uint32_be(in + 8);
+	if(total > dst_size || total % elem_size || block_bytes == 0 || block_bytes % (elem_size * BSHUF_BLOCKED_MULT))
+		return false;
+
+	const size_t nb_elements = (size_t) total / elem_size;
+	const size_t block_size = block_bytes / elem_size;
+	if(m_shuffled.size() < block_bytes)
+		m_shuffled.resize(block_bytes);
+
+	size_t in_pos = BSHUF_HEADER_SIZE;
+	size_t done = 0;
+	while(done + BSHUF_BLOCKED_MULT <= nb_elements)
+	{
+		size_t n = nb_elements - done;
+		if(n > block_size)
+			n = block_size;
+		n -= n % BSHUF_BLOCKED_MULT;
+
+		if(src_size - in_pos < 4)
+			return false;
+		size_t size = read_uint32_be(in + in_pos);
+		in_pos += 4;
+		if(src_size - in_pos < size ||
+		   !lz4_decompress_block(in + in_pos, size, &m_shuffled[0], n * elem_size))
+			return false;
+		bitunshuffle_block(&m_shuffled[0], out + done * elem_size, n, elem_size);
+		in_pos += size;
+		done += n;
+	}
+
+	size_t leftover = (nb_elements - done) * elem_size;
+	if(src_size - in_pos != leftover)
+		return false;
+	memcpy(out + done * elem_size, in + in_pos, leftover);
+	return true;
+}
+
+//-----------------------------------------------------
@@ -35,36 +35,135 @@
 #include "lima/MiscUtils.h"
 #include "DhyanaTimer.h"
 #include "DhyanaCamera.h"
+#include "DhyanaImageUtils.h"
 
 using namespace lima;
 using namespace lima::Dhyana;
 using namespace std;
 
+//-----------------------------------------------------
+// telemetry samples kept, one hour at the default period
+//-----------------------------------------------------
+static const int TELEMETRY_HISTORY_SIZE = 3600;
+
+//-----------------------------------------------------
+// @brief TUCAM_Dev_GetInfo of an integer value
+//-----------------------------------------------------
+static bool readInfo(HDTUCAM handle, int id, int& value)
+{
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = id;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(handle, &valInfo))
+		return false;
+	value = valInfo.nValue;
+	return true;
+}
+
 //---------------------------
 // @brief  Ctor
 //---------------------------
-Camera::Camera(unsigned short timer_period_ms):
+Camera::Camera(unsigned short timer_period_ms, int camera_index, const std::string& serial_number, bool async_init):
 m_depth(16),
 m_trigger_mode(IntTrig),
 m_status(Ready),
 m_acq_frame_nb(0),
 m_temperature_target(0),
 m_timer_period_ms(timer_period_ms),
+m_camera_index(camera_index),
+m_serial_number(serial_number),
+m_init_thread(NULL),
+m_sdk_init(false),
+m_initializing(false),
+m_initialized(false),
+m_init_running(false),
+m_link_thread(NULL),
+m_link_quit(false),
+m_auto_reconnect(true),
+m_reconnect_timeout(10.),
+m_link_poll_period(1.),
+m_reconnecting(false),
+m_nb_handle_users(0),
+m_link_lost(false),
+m_global_gain(0),
+m_fan_speed(0),
+m_tec_mode(0),
+m_telemetry_thread(NULL),
+m_telemetry(true),
+m_telemetry_quit(false),
+m_telemetry_period(1.),
+m_telemetry_ring(TELEMETRY_HISTORY_SIZE),
+m_usb_shedding(false),
+m_usb_low_water_mark(0.25),
+m_usb_high_water_mark(0.75),
 m_fps(0.0),
 m_tucam_trigger_mode(kTriggerStandard),
-m_tucam_trigger_edge_mode(kEdgeRising)
+m_tucam_trigger_edge_mode(kEdgeRising),
+m_tucam_trigger_delay(0),
+m_tucam_trigger_buf_frames(1),
+m_burst_frames(1),
+m_burst_pending(0),
+m_hdr_single_readout_warned(false),
+m_replay(false),
+m_group_trigger(false),
+m_frame_callback(NULL)
 {
 
 	DEB_CONSTRUCTOR();	
+	m_opCam.hIdxTUCam = NULL;
+	//initialize TUCAM Event used when Waiting for Frame
+	m_hThdEvent = NULL;
+	m_init_timings.sdk_init = 0.;
+	m_init_timings.device_open = 0.;
+	m_init_timings.capability_probe = 0.;
+	m_init_timings.parameter_cache = 0.;
+	m_init_timings.total = 0.;
+	m_link_status.connected = false;
+	m_link_status.reconnecting = false;
+	m_link_status.nb_losses = 0;
+	m_link_status.nb_recoveries = 0;
+	m_link_status.last_recovery_time = 0.;
+	m_usb_buffer_stats = UsbBufferStats();
+	m_profile_stats.camera_side = false;
+	m_profile_stats.nb_values = 0;
+	m_profile_stats.nb_written = 0;
+	m_profile_stats.duration = 0.;
+	//written by the init (setTrigMode)
+	m_tgrAttr = new TUCAM_TRIGGER_ATTR();
 	//Init TUCAM	
-	init();		
+	if(!async_init)
+	{
+		try
+		{
+			init();
+		}
+		catch(Exception&)
+		{
+			delete m_tgrAttr;
+			throw;
+		}
+		m_initialized = true;
+	}
 	//create the acquisition thread
 	DEB_TRACE() << "Create the acquisition thread";
 	m_acq_thread = new AcqThread(*this);
 	DEB_TRACE() <<"Create the Internal Trigger Timer";
 	m_internal_trigger_timer = new CSoftTriggerTimer(m_timer_period_ms, *this);
 	m_acq_thread->start();
-	m_tgrAttr = new TUCAM_TRIGGER_ATTR();
+	if(async_init)
+	{
+		//the constructor returns, the camera is Initializing until the init thread is done
+		DEB_TRACE() << "Start the init thread";
+		m_initializing = true;
+		setStatus(Camera::Initializing, true);
+		m_init_thread = new InitThread(*this);
+		m_init_thread->start();
+	}
+	DEB_TRACE() << "Start the link thread";
+	m_link_thread = new LinkThread(*this);
+	m_link_thread->start();
+	DEB_TRACE() << "Start the telemetry thread";
+	m_telemetry_thread = new TelemetryThread(*this);
+	m_telemetry_thread->start();
 }
 
 //-----------------------------------------------------
@@ -73,13 +172,19 @@ m_tucam_trigger_edge_mode(kEdgeRising)
 Camera::~Camera()
 {
 	DEB_DESTRUCTOR();
-	// Close camera
-	DEB_TRACE() << "Close TUCAM API ...";
-	TUCAM_Dev_Close(m_opCam.hIdxTUCam);
-	m_opCam.hIdxTUCam = NULL;
-	// Uninitialize SDK API environment
-	DEB_TRACE() << "Uninitialize TUCAM API ...";
-	TUCAM_Api_Uninit();
+	//wait for the end of an asynchronous init
+	delete m_init_thread;
+	//stop watching the link and sampling the sensors
+	{
+		AutoMutex lock(m_cond.mutex());
+		m_link_quit = true;
+		m_telemetry_quit = true;
+		m_cond.broadcast();
+	}
+	delete m_link_thread;
+	delete m_telemetry_thread;
+	//abort a running acquisition, the other cameras of the process keep the SDK
+	stopAcq();
 	//delete the acquisition thread
 	DEB_TRACE() << "Delete the acquisition thread";
 	delete m_acq_thread;
@@ -87,6 +192,11 @@ Camera::~Camera()
 	DEB_TRACE() << "Delete the Internal Trigger Timer";
 	delete m_internal_trigger_timer;
 	delete m_tgrAttr;
+	// Close camera, the SDK API environment is uninitialized with the last camera
+	DEB_TRACE() << "Close TUCAM camera ...";
+	TucamSdk::close(m_opCam);
+	if(m_sdk_init)
+		TucamSdk::uninit();
 }
 
 //-----------------------------------------------------
@@ -95,39 +205,78 @@ Camera::~Camera()
 void Camera::init()
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "Initialize TUCAM API ...";
-	m_itApi.pstrConfigPath = "./";//Camera parameters input saving path is not defined
-	m_itApi.uiCamCount = 0;
-
-	if(TUCAMRET_SUCCESS != TUCAM_Api_Init(&m_itApi))
 	{
-		// Initializing SDK API environment failed
-		THROW_HW_ERROR(Error) << "Unable to initialize TUCAM_Api !";
+		AutoMutex lock(m_cond.mutex());
+		m_init_running = true;
+		m_init_caller = pthread_self();
 	}
-
-	if(0 == m_itApi.uiCamCount)
+	try
 	{
-		// No camera
-		THROW_HW_ERROR(Error) << "Unable to locate the camera !";
+		_init();
 	}
-
-	DEB_TRACE() << "Open TUCAM API ...(nb. camera : "<<m_itApi.uiCamCount<<")";
-	m_opCam.hIdxTUCam = NULL;
-	m_opCam.uiIdxOpen = 0;	
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_Open(&m_opCam))
+	catch(Exception&)
 	{
-		// Failed to open camera
-		THROW_HW_ERROR(Error) << "Unable to Open the camera !";
+		//the camera and the SDK are released, the init may be done again
+		TucamSdk::close(m_opCam);
+		if(m_sdk_init)
+		{
+			TucamSdk::uninit();
+			m_sdk_init = false;
+		}
+		AutoMutex lock(m_cond.mutex());
+		m_init_running = false;
+		throw;
 	}
+	AutoMutex lock(m_cond.mutex());
+	m_init_running = false;
+}
 
-	if(NULL == m_opCam.hIdxTUCam)
+//-----------------------------------------------------
+// @brief the phases are timed, see getInitTimings
+//-----------------------------------------------------
+void Camera::_init()
+{
+	DEB_MEMBER_FUNCT();
+	Timestamp t0 = Timestamp::now();
+	DEB_TRACE() << "Initialize TUCAM API ...";
+	//the SDK API environment is shared by the cameras of the process
+	TucamSdk::init();
+	m_sdk_init = true;
+	Timestamp t1 = Timestamp::now();
+
+	DEB_TRACE() << "Open TUCAM camera ...";
+	TucamSdk::open(m_camera_index, m_serial_number, m_opCam);
+	m_camera_index = m_opCam.uiIdxOpen;
+	m_serial_number = TucamSdk::getSerialNumber(m_opCam.hIdxTUCam);
+	DEB_TRACE() << "Camera " << m_serial_number << " at index " << m_camera_index
+				<< " (nb. camera : " << TucamSdk::getNbCameras() << ")";
+	Timestamp t2 = Timestamp::now();
 	{
-		THROW_HW_ERROR(Error) << "Unable to open the camera !";
+		AutoMutex lock(m_cond.mutex());
+		m_init_timings.sdk_init = t1 - t0;
+		m_init_timings.device_open = t2 - t1;
 	}
-	
-	//initialize TUCAM Event used when Waiting for Frame
-	m_hThdEvent = NULL;
 
+	//capability probing : the model is read once, an unsupported model fails here
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_CAMERA_MODEL;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_CAMERA_MODEL from the camera !";
+	}
+	{
+		AutoMutex lock(m_cond.mutex());
+		m_model = valInfo.pText;
+	}
+	Size size;
+	getDetectorImageSize(size);
+	std::string tucam_version, firmware_version;
+	getTucamVersion(tucam_version);
+	getFirmwareVersion(firmware_version);
+	DEB_TRACE() << DEB_VAR4(m_model, size, tucam_version, firmware_version);
+	Timestamp t3 = Timestamp::now();
+
+	//parameter caching
 	m_tgroutAttr1.nTgrOutPort = 0;
 	m_tgroutAttr1.nTgrOutMode = TucamSignal::kSignalReadEnd;
 	m_tgroutAttr1.nEdgeMode = TucamSignalEdge::kSignalEdgeRising;
@@ -147,1309 +296,4630 @@ void Camera::init()
 	m_tgroutAttr3.nWidth = 5000;
 
 	createParametersMap();
+
+	//roi in detector coordinates, used by the frame correction
+	getRoi(m_hw_roi);
+	//restored after a reconnection
+	getExpTime(m_exp_time);
+	getGlobalGain(m_global_gain);
+	//saved in the profiles, not all the models have a fan or a TEC
+	int nVal;
+	if(TUCAMRET_SUCCESS == TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, &nVal))
+		m_fan_speed = (unsigned) nVal;
+	if(TUCAMRET_SUCCESS == TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_ENABLETEC, &nVal))
+		m_tec_mode = (unsigned) nVal;
+	//TUCAM_Cap_Start uses the trigger mode of m_tgrAttr, it must be the one of m_trigger_mode
+	setTrigMode(m_trigger_mode);
+	Timestamp t4 = Timestamp::now();
+
+	AutoMutex lock(m_cond.mutex());
+	m_init_timings.capability_probe = t3 - t2;
+	m_init_timings.parameter_cache = t4 - t3;
+	m_init_timings.total = t4 - t0;
+	DEB_TRACE() << "Camera initialized in " << (int) (m_init_timings.total * 1000) << " (ms) : "
+				<< "sdk " << (int) (m_init_timings.sdk_init * 1000) << ", "
+				<< "open " << (int) (m_init_timings.device_open * 1000) << ", "
+				<< "probe " << (int) (m_init_timings.capability_probe * 1000) << ", "
+				<< "cache " << (int) (m_init_timings.parameter_cache * 1000) << " (ms)";
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::reset()
+bool Camera::isInitialized()
 {
-	DEB_MEMBER_FUNCT();
-	stopAcq();	
-	//@BEGIN : other stuff on Driver/API
-	//...
-	//@END
+	AutoMutex lock(m_cond.mutex());
+	return m_initialized;
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::prepareAcq()
+void Camera::waitInit(double timeout)
 {
 	DEB_MEMBER_FUNCT();
 	AutoMutex lock(m_cond.mutex());
 	Timestamp t0 = Timestamp::now();
-
-	//@BEGIN : Ensure that Acquisition is Started before return ...
-	DEB_TRACE() << "prepareAcq ...";
-	DEB_TRACE() << "Ensure that Acquisition is Started";
-	setStatus(Camera::Exposure, false);
-	if(NULL == m_hThdEvent)
+	while(m_initializing)
 	{
-		m_frame.pBuffer = NULL;
-		m_frame.ucFormatGet = TUFRM_FMT_USUAl;
-		m_frame.uiRsdSize = 1;// how many frames do you want
-
-		// Alloc buffer after set resolution or set ROI attribute
-		DEB_TRACE() << "TUCAM_Buf_Alloc";
-		TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame);
-
-		DEB_TRACE() << "TUCAM_Cap_Start";
-		if(m_trigger_mode == IntTrig)
-		{
-			// Start capture in software trigger
-			TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_SOFTWARE);
-		}
-		if(m_trigger_mode == IntTrigMult)
-		{
-			// Start capture in software trigger
-			TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_SOFTWARE);
-		}		
-		else if(m_trigger_mode == ExtTrigMult)
+		if(timeout < 0.)
 		{
-			// Start capture in external trigger STANDARD (EXPOSURE SOFT)
-			TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_STANDARD);
+			m_cond.wait();
+			continue;
 		}
-		else if(m_trigger_mode == ExtGate)
+		double remaining = timeout - (double) (Timestamp::now() - t0);
+		if(remaining <= 0.)
 		{
-			// Start capture in external trigger STANDARD (EXPOSURE WIDTH)
-			TUCAM_Cap_Start(m_opCam.hIdxTUCam, TUCCM_TRIGGER_STANDARD);
+			THROW_HW_ERROR(Error) << "Camera initialization not done after " << timeout << " s !";
 		}
-		
-		////DEB_TRACE() << "TUCAM CreateEvent";
-		m_hThdEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
-	}
-	
-	//@BEGIN : trigger the acquisition
-	if(m_trigger_mode == IntTrig)	
-	{
-		DEB_TRACE() <<"Start Internal Trigger Timer (Single)";
-		m_internal_trigger_timer->disable_oneshot_mode();
-		m_internal_trigger_timer->start();
+		m_cond.wait(remaining);
 	}
-
-	
-	//@END
-	if(m_trigger_mode == IntTrigMult)
-	{
-	  _startAcq();
-    }
-	
-	Timestamp t1 = Timestamp::now();
-	double delta_time = t1 - t0;
-	DEB_TRACE() << "prepareAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
-	//@END
+	checkInit();
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::startAcq()
+void Camera::getInitError(std::string& error)
 {
 	DEB_MEMBER_FUNCT();
 	AutoMutex lock(m_cond.mutex());
-	
-	Timestamp t0 = Timestamp::now();
+	error = m_init_error;
+}
 
-	DEB_TRACE() << "startAcq ...";
+void Camera::getInitTimings(CameraInitTimings& timings)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	timings = m_init_timings;
+}
 
-	StdBufferCbMgr& buffer_mgr = m_bufferCtrlObj.getBuffer();
-	buffer_mgr.setStartTimestamp(Timestamp::now());
-	
-	//@BEGIN : trigger the acquisition
-	if(m_trigger_mode == IntTrigMult)	
-	{
-		DEB_TRACE() <<"Start Internal Trigger Timer (Multi)";
-		m_internal_trigger_timer->enable_oneshot_mode();
-		m_internal_trigger_timer->start();
+//-----------------------------------------------------
+// @brief called with m_cond locked, the HwInterface calls wait for the end of an asynchronous init
+// (Lima reads the capabilities when the Interface and CtControl are built) instead of failing
+//-----------------------------------------------------
+void Camera::waitInitDone()
+{
+	DEB_MEMBER_FUNCT();
+	//init() uses the getters itself
+	if(m_init_running && pthread_equal(m_init_caller, pthread_self()))
 		return;
-	}
-	//@END
-	m_acq_frame_nb = 0;
-	m_fps = 0.0;	
-	DEB_TRACE() << "Ensure that Acquisition is Started  & wait thread to be started";
-	setStatus(Camera::Exposure, false);		
-	////setStatus(Camera::Ready, false);		
-	//Start acquisition thread & wait 
-	{
-		m_wait_flag = false;
-		m_quit = false;
-		m_cond.broadcast();
+	while(m_initializing)
 		m_cond.wait();
+	if(!m_initialized)
+	{
+		THROW_HW_ERROR(Error) << "Camera initialization failed : " << m_init_error << " !";
 	}
-	
-	
-	Timestamp t1 = Timestamp::now();
-	double delta_time = t1 - t0;
-	DEB_TRACE() << "startAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
 }
 
-
 //-----------------------------------------------------
-//
+// @brief for the SDK calls outside of m_cond, false while reconnecting (but in the reconnecting thread)
 //-----------------------------------------------------
-void Camera::_startAcq()
+bool Camera::useHandle()
 {
-  DEB_MEMBER_FUNCT();
-  m_acq_frame_nb = 0;
-  m_fps = 0.0;	
-  //Start acqusition thread
-  AutoMutex aLock(m_cond.mutex());
-  m_wait_flag = false;
-  m_cond.broadcast();
+	AutoMutex lock(m_cond.mutex());
+	if(m_reconnecting)
+		return pthread_equal(m_reconnect_caller, pthread_self()) != 0;
+	m_nb_handle_users++;
+	return true;
+}
+
+void Camera::releaseHandle()
+{
+	AutoMutex lock(m_cond.mutex());
+	if(m_reconnecting && pthread_equal(m_reconnect_caller, pthread_self()))
+		return;
+	if(--m_nb_handle_users == 0)
+		m_cond.broadcast();
+}
+
+Camera::HandleUse::HandleUse(Camera& cam) :
+m_cam(cam)
+{
+	DEB_CONSTRUCTOR();
+	if(!m_cam.useHandle())
+	{
+		THROW_HW_ERROR(Error) << "Camera is reconnecting !";
+	}
+}
+
+Camera::HandleUse::~HandleUse()
+{
+	m_cam.releaseHandle();
 }
+
 //-----------------------------------------------------
-//
+// @brief called with m_cond locked
 //-----------------------------------------------------
-void Camera::stopAcq()
+void Camera::checkInit()
 {
 	DEB_MEMBER_FUNCT();
-	AutoMutex aLock(m_cond.mutex());
-	DEB_TRACE() << "stopAcq ...";
-	// Don't do anything if acquisition is idle.
-	if(m_thread_running == true)
+	if(m_initializing)
 	{
-		m_wait_flag = true;
-		m_cond.broadcast();		
+		THROW_HW_ERROR(Error) << "Camera is initializing !";
 	}
-
-	//@BEGIN : Ensure that Acquisition is Stopped before return ...			
-	Timestamp t0 = Timestamp::now();
-	if(NULL != m_hThdEvent)
+	if(!m_initialized)
 	{
-		DEB_TRACE() << "TUCAM_Buf_AbortWait";
-		TUCAM_Buf_AbortWait(m_opCam.hIdxTUCam);
-		WaitForSingleObject(m_hThdEvent, INFINITE);
-		CloseHandle(m_hThdEvent);
-		m_hThdEvent = NULL;
-		// Stop capture   
-		DEB_TRACE() << "TUCAM_Cap_Stop";
-		TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
-		// Release alloc buffer after stop capture
-		DEB_TRACE() << "TUCAM_Buf_Release";
-		TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+		THROW_HW_ERROR(Error) << "Camera initialization failed : " << m_init_error << " !";
 	}
-	//@END	
-	
-	//@BEGIN : trigger the acquisition
-	if(m_trigger_mode == IntTrig)	
+	if(m_reconnecting)
 	{
-		DEB_TRACE() <<"Stop Internal Trigger Timer (Single)";
-		m_internal_trigger_timer->stop();
+		THROW_HW_ERROR(Error) << "Camera is reconnecting !";
 	}
-	//@END
-	
-	//@BEGIN : trigger the acquisition
-	if(m_trigger_mode == IntTrigMult)	
+	if(m_link_lost)
 	{
-		DEB_TRACE() <<"Stop Internal Trigger Timer (Multi)";
-		m_internal_trigger_timer->stop();
+		THROW_HW_ERROR(Error) << m_fault_reason << " !";
 	}
-	//@END
-	
-	//@BEGIN
-	//now detector is ready
-	DEB_TRACE() << "Ensure that Acquisition is Stopped";
-	setStatus(Camera::Ready, false);
-	//@END	
-	
-	Timestamp t1 = Timestamp::now();
-	double delta_time = t1 - t0;
-	DEB_TRACE() << "stopAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";		
 }
 
 //-----------------------------------------------------
-// @brief set the new camera status
+//
 //-----------------------------------------------------
-void Camera::setStatus(Camera::Status status, bool force)
+void Camera::setAutoReconnect(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	//AutoMutex aLock(m_cond.mutex());
-	if(force || m_status != Camera::Fault)
-		m_status = status;
-	//m_cond.broadcast();
+	DEB_PARAM() << DEB_VAR1(enable);
+	AutoMutex lock(m_cond.mutex());
+	m_auto_reconnect = enable;
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::getStatus(Camera::Status& status)
+void Camera::getAutoReconnect(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-	AutoMutex aLock(m_cond.mutex());
-	if(m_trigger_mode == IntTrigMult)
-		m_status = Camera::Ready;
-		
-	status = m_status;
-
-	DEB_RETURN() << DEB_VAR1(status);
+	AutoMutex lock(m_cond.mutex());
+	enable = m_auto_reconnect;
 }
 
 //-----------------------------------------------------
-//
+// @brief max duration of a reconnection (s)
 //-----------------------------------------------------
-bool Camera::readFrame(void *bptr, int& frame_nb)
+void Camera::setReconnectTimeout(double timeout)
 {
 	DEB_MEMBER_FUNCT();
-	Timestamp t0 = Timestamp::now();
-
-	//@BEGIN : Get frame from Driver/API & copy it into bptr already allocated 
-	////DEB_TRACE() << "Copy Buffer image into Lima Frame Ptr";
-	memcpy((unsigned short *) bptr, (unsigned short *) (m_frame.pBuffer + m_frame.usOffset), m_frame.uiImgSize);//we need a nb of BYTES .		
-	frame_nb = m_frame.uiIndex;
-	//@END	
+	DEB_PARAM() << DEB_VAR1(timeout);
+	if(timeout <= 0.)
+	{
+		THROW_HW_ERROR(Error) << "Reconnect timeout must be positive !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_reconnect_timeout = timeout;
+}
 
-	////Timestamp t1 = Timestamp::now();
-	////double delta_time = t1 - t0;
-	////DEB_TRACE() << "readFrame : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
-	return false;
+void Camera::getReconnectTimeout(double& timeout)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	timeout = m_reconnect_timeout;
 }
 
 //-----------------------------------------------------
-//
+// @brief period of the link check outside of the acquisitions (s)
 //-----------------------------------------------------
-void Camera::AcqThread::threadFunction()
+void Camera::setLinkPollPeriod(double period)
 {
 	DEB_MEMBER_FUNCT();
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	StdBufferCbMgr& buffer_mgr = m_cam.m_bufferCtrlObj.getBuffer();
-
-	while(!m_cam.m_quit)
+	DEB_PARAM() << DEB_VAR1(period);
+	if(period <= 0.)
 	{
-		while(m_cam.m_wait_flag && !m_cam.m_quit)
-		{
-			DEB_TRACE() << "Wait for start acquisition ...";
-			m_cam.m_thread_running = false;
-			m_cam.m_cond.broadcast();
-			m_cam.m_cond.wait();
-		}
-
-		//if quit is requested (requested only by destructor)
-		if(m_cam.m_quit)
-			return;
+		THROW_HW_ERROR(Error) << "Link poll period must be positive !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_link_poll_period = period;
+	m_cond.broadcast();
+}
 
-		DEB_TRACE() << "Running ...";
-		m_cam.m_thread_running = true;
-		m_cam.m_cond.broadcast();
-		aLock.unlock();		
+void Camera::getLinkPollPeriod(double& period)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	period = m_link_poll_period;
+}
 
-		Timestamp t0_capture = Timestamp::now();
-		Timestamp t0_fps, t1_fps, delta_fps;
+//-----------------------------------------------------
+// @brief TUIDI_CONNECTSTATUS, the model is read if the camera does not give it
+//-----------------------------------------------------
+bool Camera::isConnected()
+{
+	DEB_MEMBER_FUNCT();
+	if(NULL == m_opCam.hIdxTUCam)
+		return false;
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_CONNECTSTATUS;
+	if(TUCAMRET_SUCCESS == TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+		return valInfo.nValue != 0;
+	valInfo.nID = TUIDI_CAMERA_MODEL;
+	return TUCAMRET_SUCCESS == TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo);
+}
 
-		//@BEGIN 
-		DEB_TRACE() << "Capture all frames ...";
-		bool continueFlag = true;
-		t0_fps = Timestamp::now();
-		while(continueFlag && (!m_cam.m_nb_frames || m_cam.m_acq_frame_nb < m_cam.m_nb_frames))
+//-----------------------------------------------------
+// @brief reopen the camera after a Fault of the link
+//-----------------------------------------------------
+void Camera::reconnect()
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(!m_initialized || m_reconnecting)
 		{
-			// Check first if acq. has been stopped
-			if(m_cam.m_wait_flag)
-			{
-				DEB_TRACE() << "AcqThread has been stopped from user";
-				continueFlag = false;
-				continue;
-			}
-
-			//set status to exposure
-			////m_cam.setStatus(Camera::Exposure, false);
-			
-			//wait frame from TUCAM API ...
-			if(m_cam.m_acq_frame_nb == 0)//display TRACE only once ...
-			{				
-				DEB_TRACE() << "TUCAM_Buf_WaitForFrame ...";
-			}
-			
-			if(TUCAMRET_SUCCESS == TUCAM_Buf_WaitForFrame(m_cam.m_opCam.hIdxTUCam, &m_cam.m_frame))
-			{
-				/*
-				//The based information
-				DEB_TRACE() << "m_cam.m_frame.szSignature = "	<< m_cam.m_frame.szSignature	;		// [out]Copyright+Version: TU+1.0 ['T', 'U', '1', '\0']		
-				DEB_TRACE() << "m_cam.m_frame.usHeader = "		<< m_cam.m_frame.usHeader		;		// [out] The frame header size
-				DEB_TRACE() << "m_cam.m_frame.usOffset = "		<< m_cam.m_frame.usOffset		;		// [out] The frame data offset
-				DEB_TRACE() << "m_cam.m_frame.usWidth = "		<< m_cam.m_frame.usWidth		;		// [out] The frame width
-				DEB_TRACE() << "m_cam.m_frame.usHeight = "		<< m_cam.m_frame.usHeight		;		// [out] The frame height
-				DEB_TRACE() << "m_cam.m_frame.uiWidthStep = "	<< m_cam.m_frame.uiWidthStep	;		// [out] The frame width step
-				DEB_TRACE() << "m_cam.m_frame.ucDepth = "		<< m_cam.m_frame.ucDepth		;		// [out] The frame data depth 
-				DEB_TRACE() << "m_cam.m_frame.ucFormat = "		<< m_cam.m_frame.ucFormat		;		// [out] The frame data format                  
-				DEB_TRACE() << "m_cam.m_frame.ucChannels = "	<< m_cam.m_frame.ucChannels		;		// [out] The frame data channels
-				DEB_TRACE() << "m_cam.m_frame.ucElemBytes = "	<< m_cam.m_frame.ucElemBytes	;		// [out] The frame data bytes per element
-				DEB_TRACE() << "m_cam.m_frame.ucFormatGet = "	<< m_cam.m_frame.ucFormatGet	;		// [in]  Which frame data format do you want    see TUFRM_FORMATS
-				DEB_TRACE() << "m_cam.m_frame.uiIndex = "		<< m_cam.m_frame.uiIndex		;		// [in/out] The frame index number
-				DEB_TRACE() << "m_cam.m_frame.uiImgSize = "		<< m_cam.m_frame.uiImgSize		;		// [out] The frame size
-				DEB_TRACE() << "m_cam.m_frame.uiRsdSize = "		<< m_cam.m_frame.uiRsdSize		;		// [in]  The frame reserved size    (how many frames do you want)
-				DEB_TRACE() << "m_cam.m_frame.uiHstSize = "		<< m_cam.m_frame.uiHstSize		;		// [out] The frame histogram size	
-				*/
-
-				// Grabbing was successful, process image
-				m_cam.setStatus(Camera::Readout, false);
-
-				//Prepare Lima Frame Ptr 
-				void* bptr = buffer_mgr.getFrameBufferPtr(m_cam.m_acq_frame_nb);
-
-				//Copy Frame into Lima Frame Ptr
-				int frame_nb = 0;
-				m_cam.readFrame(bptr, frame_nb);
-		
-				//Push the image buffer through Lima 
-				Timestamp t0 = Timestamp::now();
-				DEB_TRACE() << "Declare a Lima new Frame Ready (" << m_cam.m_acq_frame_nb << ")";
-				HwFrameInfoType frame_info;
-				frame_info.acq_frame_nb = m_cam.m_acq_frame_nb;
-				continueFlag = buffer_mgr.newFrameReady(frame_info);
-				m_cam.m_acq_frame_nb++;
-				
-				////Timestamp t1 = Timestamp::now();
-				////double delta_time = t1 - t0;			
+			THROW_HW_ERROR(Error) << "Camera is not initialized or is reconnecting !";
+		}
+		if(m_thread_running || NULL != m_hThdEvent)
+		{
+			THROW_HW_ERROR(Error) << "Unable to reconnect the camera during the acquisition !";
+		}
+		m_link_lost = true;
+	}
+	if(!recoverLink(false))
+	{
+		std::string reason;
+		getFaultReason(reason);
+		THROW_HW_ERROR(Error) << reason << " !";
+	}
+}
 
-				//wait latency after each frame , except for the last image 
-				if((!m_cam.m_nb_frames) || (m_cam.m_acq_frame_nb < m_cam.m_nb_frames) && (m_cam.m_lat_time))
-				{
-					DEB_TRACE() << "Wait latency time : " << m_cam.m_lat_time * 1000 << " (ms) ...";
-					usleep((DWORD) (m_cam.m_lat_time * 1000000));
-				}		
-				////DEB_TRACE() << "newFrameReady+latency : elapsed time = " << (int) (delta_time * 1000) << " (ms)";						
-			}
-			else
-			{
-				if(m_cam.m_trigger_mode == IntTrigMult)
-					continue;
-				DEB_TRACE() << "Unable to get the frame from the camera !";
-			}
+void Camera::getFaultReason(std::string& reason)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	reason = m_fault_reason;
+}
 
+void Camera::getLinkStatus(LinkStatus& status)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	status = m_link_status;
+	status.connected = m_initialized && !m_link_lost && !m_reconnecting;
+	status.reconnecting = m_reconnecting;
+	status.fault_reason = m_fault_reason;
+}
 
-			t1_fps = Timestamp::now();
-			delta_fps = t1_fps - t0_fps;
-			if (delta_fps > 0)
-			{
-				m_cam.m_fps = m_cam.m_acq_frame_nb / delta_fps;
-			}
+//-----------------------------------------------------
+// @brief close, reopen and restore the camera within the reconnect timeout
+//
+// During an acquisition (capture) the capture is restarted with the same
+// trigger mode. Returns false if the camera is not back in time, it is then
+// left in Fault with the reason.
+//-----------------------------------------------------
+bool Camera::recoverLink(bool capture)
+{
+	DEB_MEMBER_FUNCT();
+	double timeout;
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(m_reconnecting || (!capture && (m_thread_running || NULL != m_hThdEvent)))
+			return false;
+		m_reconnecting = true;
+		m_reconnect_caller = pthread_self();
+		if(!m_link_lost)
+		{
+			m_link_lost = true;
+			m_link_status.nb_losses++;
 		}
+		m_fault_reason = "Link to the camera lost, reconnecting";
+		setStatus(Camera::Fault, true);
+		timeout = m_reconnect_timeout;
+		//the getters and the telemetry thread end their SDK calls before the handle is closed
+		while(m_nb_handle_users > 0)
+			m_cond.wait();
+	}
+	DEB_WARNING() << "Link to the camera " << m_serial_number << " lost, reconnecting ...";
+	Timestamp t0 = Timestamp::now();
 
-		//
-		////DEB_TRACE() << "TUCAM SetEvent";
-		SetEvent(m_cam.m_hThdEvent);
-		//@END
-		
-		//stopAcq only if this is not already done		
-		DEB_TRACE() << "stopAcq only if this is not already done";
-		if(!m_cam.m_wait_flag)
+	//the handle of the lost camera is released
+	if(capture)
+	{
+		TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
+		TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+	}
+	TucamSdk::close(m_opCam);
+
+	bool recovered = false;
+	for(int attempt = 0; !recovered; attempt++)
+	{
+		//a camera plugged again is only seen by a new enumeration
+		recovered = reopen(attempt > 0);
+		if(recovered)
+			break;
+		AutoMutex lock(m_cond.mutex());
+		double remaining = timeout - (double) (Timestamp::now() - t0);
+		if(remaining <= 0. || m_quit || m_link_quit || (capture && m_wait_flag))
+			break;
+		m_cond.wait((remaining < 0.5) ? remaining : 0.5);
+	}
+	if(recovered && capture)
+	{
+		m_frame.pBuffer = NULL;
+		m_frame.ucFormatGet = TUFRM_FMT_USUAl;
+		m_frame.uiRsdSize = 1;
+		TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame);
+		if(TUCAMRET_SUCCESS != TUCAM_Cap_Start(m_opCam.hIdxTUCam, m_tgrAttr->nTgrMode))
 		{
-			////DEB_TRACE() << "stopAcq";
-			m_cam.stopAcq();
+			DEB_ERROR() << "Unable to restart the capture !";
+			TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+			TucamSdk::close(m_opCam);
+			recovered = false;
 		}
+	}
+	double elapsed = Timestamp::now() - t0;
 
-		//now detector is ready
-		m_cam.setStatus(Camera::Ready, false);
-		DEB_TRACE() << "AcqThread is no more running";		
-		
-		Timestamp t1_capture = Timestamp::now();
-		double delta_time_capture = t1_capture - t0_capture;
+	AutoMutex lock(m_cond.mutex());
+	m_reconnecting = false;
+	m_link_status.last_recovery_time = elapsed;
+	if(recovered)
+	{
+		DEB_TRACE() << "Camera reconnected in " << (int) (elapsed * 1000) << " (ms)";
+		m_link_lost = false;
+		m_link_status.nb_recoveries++;
+		m_fault_reason.clear();
+		//the frames of the bursts triggered before the loss will not come
+		if(capture)
+			m_burst_pending = 0;
+		setStatus(capture ? Camera::Exposure : Camera::Ready, true);
+	}
+	else
+	{
+		std::stringstream reason;
+		reason << "Link to the camera lost, not reconnected after " << elapsed << " s";
+		if(TucamSdk::getNbOpen() > 0)
+			reason << " (the cameras are not enumerated again while other cameras of the process are open,"
+				   << " a camera plugged again is seen after they are closed)";
+		m_fault_reason = reason.str();
+		DEB_ERROR() << m_fault_reason;
+	}
+	m_cond.broadcast();
+	return recovered;
+}
 
-		DEB_TRACE() << "Capture all frames elapsed time = " << (int) (delta_time_capture * 1000) << " (ms)";				
+//-----------------------------------------------------
+// @brief the camera is searched by its serial number, its index may have changed
+//-----------------------------------------------------
+bool Camera::reopen(bool refresh)
+{
+	DEB_MEMBER_FUNCT();
+	if(refresh)
+		TucamSdk::refresh();
+	try
+	{
+		TucamSdk::open(m_camera_index, m_serial_number, m_opCam);
+		m_camera_index = m_opCam.uiIdxOpen;
+		restoreSettings();
+	}
+	catch(Exception& e)
+	{
+		DEB_TRACE() << "Camera not reopened : " << e.getErrMsg();
+		TucamSdk::close(m_opCam);
+		return false;
+	}
+	return true;
+}
 
-		aLock.lock();
-		m_cam.m_thread_running = false;
-		m_cam.m_wait_flag = true;
+//-----------------------------------------------------
+// @brief the settings of the camera before the link loss are written again
+//-----------------------------------------------------
+void Camera::restoreSettings()
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "Restore the camera settings";
+	//the camera has been restarted, the cached values are not in it anymore
+	m_parameter_cache.invalidate();
+	setImageType(cameraImageType());
+	setRoi(m_hw_roi);
+	double exp_time;
+	{
+		AutoMutex lock(m_cond.mutex());
+		exp_time = m_exp_time;
+	}
+	setExpTime(exp_time);
+	setGlobalGain(m_global_gain);
+	setTrigMode(m_trigger_mode);
+	TUCAM_TRGOUT_ATTR* outputs[3] = {&m_tgroutAttr1, &m_tgroutAttr2, &m_tgroutAttr3};
+	for(int port = 0; port < 3; port++)
+	{
+		//not all the models have the trigger outputs
+		if(TUCAMRET_SUCCESS != TUCAM_Cap_SetTriggerOut(m_opCam.hIdxTUCam, *outputs[port]))
+			DEB_TRACE() << "Unable to restore the output signal of the port " << port;
 	}
+	if(m_frame_histogram.isEnabled() && m_frame_histogram.getSource() == FrameHistogram::kSourceCamera)
+		setCameraHistogram(true);
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-Camera::AcqThread::AcqThread(Camera& cam):
-m_cam(cam)
+void Camera::reset()
 {
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	m_cam.m_wait_flag = true;
-	m_cam.m_quit = false;
-	aLock.unlock();
-	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+	DEB_MEMBER_FUNCT();
+	stopAcq();	
+	m_parameter_cache.invalidate();
+	//@BEGIN : other stuff on Driver/API
+	//...
+	//@END
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-Camera::AcqThread::~AcqThread()
+void Camera::prepareAcq()
 {
-	AutoMutex aLock(m_cam.m_cond.mutex());
-	m_cam.m_wait_flag = true;
-	m_cam.m_quit = true;
-	m_cam.m_cond.broadcast();
-	aLock.unlock();
-	join();
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	Timestamp t0 = Timestamp::now();
+	checkInit();
+
+	//@BEGIN : Ensure that Acquisition is Started before return ...
+	DEB_TRACE() << "prepareAcq ...";
+	DEB_TRACE() << "Ensure that Acquisition is Started";
+	if(m_trigger_mode == IntTrigMult && m_nb_frames % m_burst_frames != 0)
+	{
+		THROW_HW_ERROR(Error) << "Number of frames (" << m_nb_frames << ") "
+							  << "must be a multiple of the burst size (" << m_burst_frames << ") !";
+	}
+	if(m_trigger_mode == IntTrigMult && m_frame_accumulator.isEnabled())
+	{
+		THROW_HW_ERROR(Error) << "Frame accumulation can not be used with IntTrigMult !";
+	}
+	{
+		//a roi written behind Lima (applyProfile) must not overflow the Lima frames
+		FrameDim frame_dim;
+		m_bufferCtrlObj.getBuffer().getFrameDim(frame_dim);
+		if(frame_dim.getSize().getWidth() != m_hw_roi.getSize().getWidth() ||
+		   frame_dim.getSize().getHeight() != m_hw_roi.getSize().getHeight())
+		{
+			THROW_HW_ERROR(Error) << "Camera roi (" << m_hw_roi.getSize() << ") "
+								  << "does not match the Lima frames (" << frame_dim.getSize() << "), set the Lima roi again !";
+		}
+	}
+	if(m_replay)
+	{
+		//the replayed frames take the place of the camera frames, they must have the same format
+		int width, height;
+		ImageType type;
+		m_replay_source.getFrameFormat(width, height, type);
+		ImageType camera_type = cameraImageType();
+		if(m_trigger_mode != IntTrig)
+		{
+			THROW_HW_ERROR(Error) << "Replay can only be used with IntTrig !";
+		}
+		if(width != m_hw_roi.getSize().getWidth() || height != m_hw_roi.getSize().getHeight() || type != camera_type)
+		{
+			THROW_HW_ERROR(Error) << "Replay frames (" << width << "x" << height << ", " << type << ") "
+								  << "do not match the camera frames (" << m_hw_roi.getSize() << ", " << camera_type << ") !";
+		}
+	}
+	m_frame_accumulator.reset();
+	m_live_preview.reset();
+	m_frame_compressor.resetStats();
+	{
+		//the size of the USB buffer is read once, the occupancy at each frame
+		AutoMutex usb_lock(m_usb_buffer_mutex);
+		m_usb_buffer_stats = UsbBufferStats();
+		int total_frames;
+		if(!m_replay && readInfo(m_opCam.hIdxTUCam, TUIDI_TOTALBUFFRAMES, total_frames) && total_frames > 0)
+			m_usb_buffer_stats.total_frames = total_frames;
+	}
+	if(m_stream_recorder.isEnabled())
+	{
+		//the camera frames are recorded before the processing stages, an HDR frame holds 2 readouts
+		Size size = m_hw_roi.getSize();
+		size_t max_frame_size = (size_t) size.getWidth() * size.getHeight() * ((m_depth == 8) ? 1 : 2);
+		if(m_hdr_merger.isEnabled())
+			max_frame_size *= 2;
+		int nb_camera_frames = m_nb_frames;
+		if(m_frame_accumulator.isEnabled())
+			nb_camera_frames *= m_frame_accumulator.getNbFrames();
+		//a recording left open by a failed prepareAcq is closed first
+		m_stream_recorder.stop();
+		m_stream_recorder.start(size, cameraImageType(), max_frame_size, nb_camera_frames);
+	}
+	if(m_frame_publisher.isEnabled())
+	{
+		FrameDim frame_dim;
+		m_bufferCtrlObj.getBuffer().getFrameDim(frame_dim);
+		m_frame_publisher.start(frame_dim);
+	}
+	m_frame_stream_server.start();
+	setStatus(Camera::Exposure, false);
+	if(m_replay)
+	{
+		//no capture on the camera, the acquisition thread reads the mapped recording
+		DEB_TRACE() << "Replay of " << m_replay_source.getName();
+		m_replay_source.start();
+	}
+	else if(NULL == m_hThdEvent)
+	{
+		m_frame.pBuffer = NULL;
+		m_frame.ucFormatGet = TUFRM_FMT_USUAl;
+		m_frame.uiRsdSize = 1;// how many frames do you want
+
+		// Alloc buffer after set resolution or set ROI attribute
+		DEB_TRACE() << "TUCAM_Buf_Alloc";
+		TUCAM_Buf_Alloc(m_opCam.hIdxTUCam, &m_frame);
+
+		DEB_TRACE() << "TUCAM_Cap_Start";
+		// Start capture in the mode applied by setTrigMode() :
+		// - software trigger for IntTrig/IntTrigMult
+		// - standard/synchronous/global external trigger for ExtTrigMult/ExtGate
+		if(TUCAMRET_SUCCESS != TUCAM_Cap_Start(m_opCam.hIdxTUCam, m_tgrAttr->nTgrMode))
+		{
+			THROW_HW_ERROR(Error) << "Unable to start the capture !";
+		}
+		
+		////DEB_TRACE() << "TUCAM CreateEvent";
+		m_hThdEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+	}
+	
+	//@BEGIN : trigger the acquisition
+	if(m_trigger_mode == IntTrig && !m_replay && !m_group_trigger)	
+	{
+		DEB_TRACE() <<"Start Internal Trigger Timer (Single)";
+		m_internal_trigger_timer->disable_oneshot_mode();
+		m_internal_trigger_timer->start();
+	}
+
+	
+	//@END
+	if(m_trigger_mode == IntTrigMult)
+	{
+	  m_burst_pending = 0;
+	  _startAcq();
+    }
+	
+	Timestamp t1 = Timestamp::now();
+	double delta_time = t1 - t0;
+	DEB_TRACE() << "prepareAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
+	//@END
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::startAcq()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	
+	Timestamp t0 = Timestamp::now();
+	checkInit();
+
+	DEB_TRACE() << "startAcq ...";
+
+	StdBufferCbMgr& buffer_mgr = m_bufferCtrlObj.getBuffer();
+	buffer_mgr.setStartTimestamp(Timestamp::now());
+	
+	//@BEGIN : trigger the acquisition
+	if(m_trigger_mode == IntTrigMult)	
+	{
+		DEB_TRACE() <<"Start Internal Trigger Timer (Multi)";
+		//each software trigger produces m_burst_frames frames on the camera
+		m_burst_pending += m_burst_frames;
+		m_internal_trigger_timer->enable_oneshot_mode();
+		m_internal_trigger_timer->start();
+		return;
+	}
+	//@END
+	m_acq_frame_nb = 0;
+	m_fps = 0.0;	
+	DEB_TRACE() << "Ensure that Acquisition is Started  & wait thread to be started";
+	setStatus(Camera::Exposure, false);		
+	////setStatus(Camera::Ready, false);		
+	//Start acquisition thread & wait 
+	{
+		m_wait_flag = false;
+		m_quit = false;
+		m_cond.broadcast();
+		m_cond.wait();
+	}
+	
+	
+	Timestamp t1 = Timestamp::now();
+	double delta_time = t1 - t0;
+	DEB_TRACE() << "startAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
+}
+
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::_startAcq()
+{
+  DEB_MEMBER_FUNCT();
+  m_acq_frame_nb = 0;
+  m_fps = 0.0;	
+  //Start acqusition thread
+  AutoMutex aLock(m_cond.mutex());
+  m_wait_flag = false;
+  m_cond.broadcast();
+}
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::stopAcq()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cond.mutex());
+	DEB_TRACE() << "stopAcq ...";
+	// Don't do anything if acquisition is idle.
+	if(m_thread_running == true)
+	{
+		m_wait_flag = true;
+		m_cond.broadcast();		
+	}
+
+	//@BEGIN : Ensure that Acquisition is Stopped before return ...			
+	Timestamp t0 = Timestamp::now();
+	if(m_replay)
+	{
+		m_replay_source.interrupt();
+	}
+	if(NULL != m_hThdEvent)
+	{
+		HANDLE thd_event = m_hThdEvent;
+		DEB_TRACE() << "TUCAM_Buf_AbortWait";
+		//a reconnection of the acquisition thread ends on m_wait_flag, its handle may be closed
+		if(!m_reconnecting)
+			TUCAM_Buf_AbortWait(m_opCam.hIdxTUCam);
+		//the acquisition thread may need the lock to end (burst count, reconnection)
+		aLock.unlock();
+		WaitForSingleObject(thd_event, INFINITE);
+		aLock.lock();
+		//the capture may have been stopped by a concurrent stopAcq meanwhile
+		if(m_hThdEvent == thd_event)
+		{
+			CloseHandle(m_hThdEvent);
+			m_hThdEvent = NULL;
+			// Stop capture   
+			DEB_TRACE() << "TUCAM_Cap_Stop";
+			TUCAM_Cap_Stop(m_opCam.hIdxTUCam);
+			// Release alloc buffer after stop capture
+			DEB_TRACE() << "TUCAM_Buf_Release";
+			TUCAM_Buf_Release(m_opCam.hIdxTUCam);
+		}
+	}
+	//@END	
+	
+	//@BEGIN : trigger the acquisition
+	if(m_trigger_mode == IntTrig)	
+	{
+		DEB_TRACE() <<"Stop Internal Trigger Timer (Single)";
+		m_internal_trigger_timer->stop();
+	}
+	//@END
+	
+	//@BEGIN : trigger the acquisition
+	if(m_trigger_mode == IntTrigMult)	
+	{
+		DEB_TRACE() <<"Stop Internal Trigger Timer (Multi)";
+		m_internal_trigger_timer->stop();
+	}
+	//@END
+	
+	//@BEGIN
+	//now detector is ready
+	DEB_TRACE() << "Ensure that Acquisition is Stopped";
+	setStatus(Camera::Ready, false);
+	//@END	
+	
+	Timestamp t1 = Timestamp::now();
+	double delta_time = t1 - t0;
+	DEB_TRACE() << "stopAcq : elapsed time = " << (int) (delta_time * 1000) << " (ms)";		
+}
+
+//-----------------------------------------------------
+// @brief set the new camera status
+//-----------------------------------------------------
+void Camera::setStatus(Camera::Status status, bool force)
+{
+	DEB_MEMBER_FUNCT();
+	//AutoMutex aLock(m_cond.mutex());
+	if(force || (m_status != Camera::Fault && m_status != Camera::Initializing))
+		m_status = status;
+	//m_cond.broadcast();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getStatus(Camera::Status& status)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cond.mutex());
+	//the Fault of a link loss is kept
+	if(m_trigger_mode == IntTrigMult && m_initialized && !m_link_lost && !m_reconnecting)
+	{
+		//in burst mode, the camera is busy until all frames of the burst are received
+		if(m_burst_frames == 1 || m_burst_pending <= 0)
+			m_status = Camera::Ready;
+		else
+			m_status = Camera::Exposure;
+	}
+		
+	status = m_status;
+
+	DEB_RETURN() << DEB_VAR1(status);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool Camera::readFrame(void *bptr, int& frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	Timestamp t0 = Timestamp::now();
+
+	//@BEGIN : Get frame from Driver/API & copy it into bptr already allocated 
+	////DEB_TRACE() << "Copy Buffer image into Lima Frame Ptr";
+	unsigned char* src = m_frame.pBuffer + m_frame.usOffset;
+	int width = m_frame.usWidth;
+	int height = m_frame.usHeight;
+	size_t nb_pixels = (size_t) width * height;
+	//the processing stages use the detector coordinates of the roi
+	int x0 = m_hw_roi.getTopLeft().x;
+	int y0 = m_hw_roi.getTopLeft().y;
+	ImageType frame_type = Bpp16;
+	//the USB buffer fills up : the optional stages are skipped, the frame is still given to Lima
+	bool shed;
+	{
+		AutoMutex usb_lock(m_usb_buffer_mutex);
+		shed = m_usb_buffer_stats.shedding;
+		if(shed)
+			m_usb_buffer_stats.nb_shed_frames++;
+	}
+	if(m_stream_recorder.isRecording())
+	{
+		//the frame as delivered by the camera, before the processing stages, with the camera frame index
+		//(the accumulated frames share the same Lima frame nb)
+		m_stream_recorder.push(src, m_frame.uiImgSize, (int) m_frame.uiIndex);
+	}
+	bool statistics = m_frame_statistics.isEnabled() && !shed;
+	bool defects = m_defect_map.isEnabled();
+	if(m_depth == 8)
+	{
+		//8 bits pixels : same layout as the Lima frame
+		memcpy(bptr, src, m_frame.uiImgSize);//we need a nb of BYTES .		
+		frame_type = Bpp8;
+	}
+	else if(m_hdr_merger.isEnabled())
+	{
+		//the high gain readout is followed by the low gain readout
+		const unsigned short* high = (const unsigned short *) src;
+		const unsigned short* low = high;
+		if(m_frame.uiImgSize == 2 * nb_pixels * sizeof(unsigned short))
+		{
+			low = high + nb_pixels;
+		}
+		else if(!m_hdr_single_readout_warned)
+		{
+			DEB_WARNING() << "HDR merge : the camera delivers a single readout, it is only converted !";
+			m_hdr_single_readout_warned = true;
+		}
+		m_hdr_merger.merge(high, low, bptr, nb_pixels);
+		frame_type = m_hdr_merger.getOutputType();
+	}
+	else
+	{
+		const unsigned short* pixels = (const unsigned short *) src;
+		bool correction = m_frame_correction.isEnabled();
+		bool accumulation = m_frame_accumulator.isEnabled();
+		if(m_depth == 12 && m_frame.uiImgSize == ImageUtils::packed12Size(nb_pixels))
+		{
+			//12 bits packed transfer : unpack into the 16 bits Lima container,
+			//or in a scratch buffer if the Lima frame is 32 bits. The size tells the layout,
+			//some cameras do not pack and a replayed frame keeps the layout it was recorded with
+			unsigned short* unpacked = (unsigned short *) bptr;
+			if(accumulation || (correction && m_frame_correction.getOutputType() == Bpp32F))
+			{
+				m_unpack_buffer.resize(nb_pixels);
+				unpacked = &m_unpack_buffer[0];
+			}
+			ImageUtils::unpack12(src, unpacked, nb_pixels);
+			pixels = unpacked;
+		}
+
+		if(m_frame_correction.getDarkAccumulationRemaining() > 0)
+		{
+			m_frame_correction.accumulateDark(pixels, width, height, x0, y0);
+		}
+
+		if(correction)
+		{
+			//the correction is done during the copy into the Lima frame
+			m_frame_correction.apply(pixels, bptr, width, height, x0, y0);
+			frame_type = m_frame_correction.getOutputType();
+		}
+		else if(accumulation)
+		{
+			//the Lima frame holds the running sum, it is released after N camera frames
+			frame_type = Bpp32;
+			if(!m_frame_accumulator.add(pixels, (unsigned int *) bptr, width, height, x0, y0))
+			{
+				frame_nb = m_frame.uiIndex;
+				return false;
+			}
+		}
+		else if(statistics && !defects)
+		{
+			//the statistics are computed in the same pass as the copy
+			unsigned short* dst = (pixels != bptr) ? (unsigned short *) bptr : NULL;
+			m_frame_statistics.process(pixels, dst, width, height, m_acq_frame_nb, m_depth);
+			statistics = false;
+		}
+		else if(pixels != bptr)
+		{
+			//16 bits pixels : same layout as the Lima frame
+			memcpy(bptr, pixels, nb_pixels * sizeof(unsigned short));//we need a nb of BYTES .
+		}
+	}
+
+	if(defects)
+	{
+		//only the defects inside the roi are visited
+		m_defect_map.replace(bptr, frame_type, width, height, x0, y0);
+	}
+	//HDR and accumulated frames go above the camera full scale
+	int range_bits = frameRangeBits();
+	if(statistics)
+	{
+		//statistics of the processed frame
+		m_frame_statistics.process(bptr, frame_type, width, height, m_acq_frame_nb, range_bits);
+	}
+	bool histogram = m_frame_histogram.isEnabled() && !shed;
+	bool auto_exposure = m_auto_exposure.isEnabled() && !shed;
+	if(histogram || auto_exposure)
+	{
+		//the camera histogram block follows the image data, it is computed on the raw frame
+		bool computed = true;
+		if(m_frame_histogram.getSource() == FrameHistogram::kSourceCamera && m_frame.uiHstSize >= sizeof(unsigned int))
+		{
+			const unsigned int* camera_bins = (const unsigned int *) (src + m_frame.uiImgSize);
+			m_frame_histogram.fromCamera(camera_bins, m_frame.uiHstSize / sizeof(unsigned int), m_depth, m_acq_frame_nb, m_histogram_data);
+		}
+		else
+		{
+			computed = m_frame_histogram.compute(bptr, frame_type, nb_pixels, range_bits, m_acq_frame_nb, m_histogram_data);
+		}
+		//the auto exposure alone does not fill the histogram history
+		if(computed && histogram)
+		{
+			m_frame_histogram.publish(m_histogram_data);
+		}
+		if(computed && auto_exposure)
+		{
+			updateAutoExposure();
+		}
+	}
+	if(m_beam_analysis.isEnabled() && !shed)
+	{
+		m_beam_analysis.process(bptr, frame_type, width, height, m_acq_frame_nb);
+	}
+	if(m_live_preview.isEnabled() && !shed)
+	{
+		m_live_preview.process(bptr, frame_type, width, height, m_acq_frame_nb);
+	}
+	if(m_frame_compressor.isEnabled())
+	{
+		//a copy is queued, the Lima buffer is released without waiting for the compression
+		m_frame_compressor.push(bptr, frame_type, width, height, m_acq_frame_nb);
+	}
+	if(m_frame_publisher.isEnabled())
+	{
+		//never waits for the readers
+		m_frame_publisher.push(bptr, m_acq_frame_nb);
+	}
+	if(m_frame_stream_server.isEnabled())
+	{
+		//copied only if there are subscribers
+		m_frame_stream_server.push(bptr, frame_type, width, height, m_acq_frame_nb);
+	}
+	frame_nb = m_frame.uiIndex;
+	//@END	
+
+	////Timestamp t1 = Timestamp::now();
+	////double delta_time = t1 - t0;
+	////DEB_TRACE() << "readFrame : elapsed time = " << (int) (delta_time * 1000) << " (ms)";
+	return true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::AcqThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	StdBufferCbMgr& buffer_mgr = m_cam.m_bufferCtrlObj.getBuffer();
+
+	while(!m_cam.m_quit)
+	{
+		while(m_cam.m_wait_flag && !m_cam.m_quit)
+		{
+			DEB_TRACE() << "Wait for start acquisition ...";
+			m_cam.m_thread_running = false;
+			m_cam.m_cond.broadcast();
+			m_cam.m_cond.wait();
+		}
+
+		//if quit is requested (requested only by destructor)
+		if(m_cam.m_quit)
+			return;
+
+		DEB_TRACE() << "Running ...";
+		m_cam.m_thread_running = true;
+		m_cam.m_cond.broadcast();
+		aLock.unlock();		
+
+		Timestamp t0_capture = Timestamp::now();
+		Timestamp t0_fps, t1_fps, delta_fps;
+
+		//@BEGIN 
+		DEB_TRACE() << "Capture all frames ...";
+		bool continueFlag = true;
+		bool replay = m_cam.m_replay;
+		t0_fps = Timestamp::now();
+		while(continueFlag && (!m_cam.m_nb_frames || m_cam.m_acq_frame_nb < m_cam.m_nb_frames))
+		{
+			// Check first if acq. has been stopped
+			if(m_cam.m_wait_flag)
+			{
+				DEB_TRACE() << "AcqThread has been stopped from user";
+				continueFlag = false;
+				continue;
+			}
+
+			//set status to exposure
+			////m_cam.setStatus(Camera::Exposure, false);
+			
+			//wait frame from TUCAM API ...
+			if(m_cam.m_acq_frame_nb == 0)//display TRACE only once ...
+			{				
+				DEB_TRACE() << "TUCAM_Buf_WaitForFrame ...";
+			}
+			
+			bool frame_ok;
+			if(replay)
+			{
+				frame_ok = m_cam.m_replay_source.nextFrame(m_cam.m_frame);
+				if(!frame_ok)
+				{
+					DEB_TRACE() << "End of the replay";
+					continueFlag = false;
+					continue;
+				}
+			}
+			else
+			{
+				frame_ok = (TUCAMRET_SUCCESS == TUCAM_Buf_WaitForFrame(m_cam.m_opCam.hIdxTUCam, &m_cam.m_frame));
+				if(!frame_ok && !m_cam.m_wait_flag && m_cam.m_auto_reconnect && !m_cam.isConnected())
+				{
+					//the camera is reopened and the capture restarted, the frames meanwhile are lost
+					if(!m_cam.recoverLink(true))
+					{
+						DEB_ERROR() << "Link to the camera lost, acquisition aborted";
+						continueFlag = false;
+					}
+					continue;
+				}
+			}
+			if(frame_ok)
+			{
+				Timestamp frame_time = Timestamp::now();
+				/*
+				//The based information
+				DEB_TRACE() << "m_cam.m_frame.szSignature = "	<< m_cam.m_frame.szSignature	;		// [out]Copyright+Version: TU+1.0 ['T', 'U', '1', '\0']		
+				DEB_TRACE() << "m_cam.m_frame.usHeader = "		<< m_cam.m_frame.usHeader		;		// [out] The frame header size
+				DEB_TRACE() << "m_cam.m_frame.usOffset = "		<< m_cam.m_frame.usOffset		;		// [out] The frame data offset
+				DEB_TRACE() << "m_cam.m_frame.usWidth = "		<< m_cam.m_frame.usWidth		;		// [out] The frame width
+				DEB_TRACE() << "m_cam.m_frame.usHeight = "		<< m_cam.m_frame.usHeight		;		// [out] The frame height
+				DEB_TRACE() << "m_cam.m_frame.uiWidthStep = "	<< m_cam.m_frame.uiWidthStep	;		// [out] The frame width step
+				DEB_TRACE() << "m_cam.m_frame.ucDepth = "		<< m_cam.m_frame.ucDepth		;		// [out] The frame data depth 
+				DEB_TRACE() << "m_cam.m_frame.ucFormat = "		<< m_cam.m_frame.ucFormat		;		// [out] The frame data format                  
+				DEB_TRACE() << "m_cam.m_frame.ucChannels = "	<< m_cam.m_frame.ucChannels		;		// [out] The frame data channels
+				DEB_TRACE() << "m_cam.m_frame.ucElemBytes = "	<< m_cam.m_frame.ucElemBytes	;		// [out] The frame data bytes per element
+				DEB_TRACE() << "m_cam.m_frame.ucFormatGet = "	<< m_cam.m_frame.ucFormatGet	;		// [in]  Which frame data format do you want    see TUFRM_FORMATS
+				DEB_TRACE() << "m_cam.m_frame.uiIndex = "		<< m_cam.m_frame.uiIndex		;		// [in/out] The frame index number
+				DEB_TRACE() << "m_cam.m_frame.uiImgSize = "		<< m_cam.m_frame.uiImgSize		;		// [out] The frame size
+				DEB_TRACE() << "m_cam.m_frame.uiRsdSize = "		<< m_cam.m_frame.uiRsdSize		;		// [in]  The frame reserved size    (how many frames do you want)
+				DEB_TRACE() << "m_cam.m_frame.uiHstSize = "		<< m_cam.m_frame.uiHstSize		;		// [out] The frame histogram size	
+				*/
+
+				// Grabbing was successful, process image
+				m_cam.setStatus(Camera::Readout, false);
+				if(!replay)
+					m_cam.updateUsbBuffer();
+
+				//Prepare Lima Frame Ptr 
+				void* bptr = buffer_mgr.getFrameBufferPtr(m_cam.m_acq_frame_nb);
+
+				//Copy Frame into Lima Frame Ptr
+				int frame_nb = 0;
+				if(!m_cam.readFrame(bptr, frame_nb))
+				{
+					//accumulation : the Lima frame is not complete
+					continue;
+				}
+		
+				//Push the image buffer through Lima 
+				Timestamp t0 = Timestamp::now();
+				DEB_TRACE() << "Declare a Lima new Frame Ready (" << m_cam.m_acq_frame_nb << ")";
+				HwFrameInfoType frame_info;
+				frame_info.acq_frame_nb = m_cam.m_acq_frame_nb;
+				continueFlag = buffer_mgr.newFrameReady(frame_info);
+				{
+					AutoMutex lock(m_cam.m_frame_callback_mutex);
+					if(m_cam.m_frame_callback)
+						m_cam.m_frame_callback->frameReady(frame_info.acq_frame_nb, (double) frame_time);
+				}
+				m_cam.m_acq_frame_nb++;
+				if(m_cam.m_trigger_mode == IntTrigMult)
+				{
+					AutoMutex lock(m_cam.m_cond.mutex());
+					m_cam.m_burst_pending--;
+				}
+				
+				////Timestamp t1 = Timestamp::now();
+				////double delta_time = t1 - t0;			
+
+				//wait latency after each frame , except for the last image 
+				if((!m_cam.m_nb_frames) || (m_cam.m_acq_frame_nb < m_cam.m_nb_frames) && (m_cam.m_lat_time))
+				{
+					DEB_TRACE() << "Wait latency time : " << m_cam.m_lat_time * 1000 << " (ms) ...";
+					usleep((DWORD) (m_cam.m_lat_time * 1000000));
+				}		
+				////DEB_TRACE() << "newFrameReady+latency : elapsed time = " << (int) (delta_time * 1000) << " (ms)";						
+			}
+			else
+			{
+				if(m_cam.m_trigger_mode == IntTrigMult)
+					continue;
+				DEB_TRACE() << "Unable to get the frame from the camera !";
+			}
+
+
+			t1_fps = Timestamp::now();
+			delta_fps = t1_fps - t0_fps;
+			if (delta_fps > 0)
+			{
+				m_cam.m_fps = m_cam.m_acq_frame_nb / delta_fps;
+			}
+		}
+
+		//
+		////DEB_TRACE() << "TUCAM SetEvent";
+		if(!replay)
+			SetEvent(m_cam.m_hThdEvent);
+		//@END
+		
+		//stopAcq only if this is not already done		
+		DEB_TRACE() << "stopAcq only if this is not already done";
+		if(!m_cam.m_wait_flag)
+		{
+			////DEB_TRACE() << "stopAcq";
+			m_cam.stopAcq();
+		}
+
+		//the compressed and recorded frames are all written before the detector is ready
+		m_cam.m_frame_compressor.flush();
+		m_cam.m_stream_recorder.stop();
+
+		//now detector is ready
+		m_cam.setStatus(Camera::Ready, false);
+		DEB_TRACE() << "AcqThread is no more running";		
+		
+		Timestamp t1_capture = Timestamp::now();
+		double delta_time_capture = t1_capture - t0_capture;
+
+		DEB_TRACE() << "Capture all frames elapsed time = " << (int) (delta_time_capture * 1000) << " (ms)";				
+
+		aLock.lock();
+		m_cam.m_thread_running = false;
+		m_cam.m_wait_flag = true;
+	}
+}
+
+//-----------------------------------------------------
+// @brief the init error is kept, the thread must not throw
+//-----------------------------------------------------
+void Camera::InitThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	std::string error;
+	try
+	{
+		m_cam.init();
+	}
+	catch(Exception& e)
+	{
+		error = e.getErrMsg();
+	}
+
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	m_cam.m_initializing = false;
+	m_cam.m_initialized = error.empty();
+	m_cam.m_init_error = error;
+	m_cam.m_fault_reason = error;
+	if(!error.empty())
+	{
+		DEB_ERROR() << "Camera initialization failed : " << error;
+	}
+	m_cam.setStatus(error.empty() ? Camera::Ready : Camera::Fault, true);
+	m_cam.m_cond.broadcast();
+}
+
+//-----------------------------------------------------
+// @brief the acquisition thread watches the link during the acquisitions
+//-----------------------------------------------------
+void Camera::LinkThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	Timestamp next_poll = Timestamp::now();
+	while(!m_cam.m_link_quit)
+	{
+		double remaining = m_cam.m_link_poll_period - (double) (Timestamp::now() - next_poll);
+		if(remaining > 0.)
+		{
+			m_cam.m_cond.wait(remaining);
+			continue;
+		}
+		next_poll = Timestamp::now();
+		if(!m_cam.m_auto_reconnect || !m_cam.m_initialized || m_cam.m_reconnecting
+		   || m_cam.m_thread_running || NULL != m_cam.m_hThdEvent)
+			continue;
+
+		//a link not recovered in time is tried again at each poll
+		bool link_lost = m_cam.m_link_lost;
+		if(!link_lost)
+		{
+			m_cam.m_nb_handle_users++;
+			aLock.unlock();
+			link_lost = !m_cam.isConnected();
+			aLock.lock();
+			if(--m_cam.m_nb_handle_users == 0)
+				m_cam.m_cond.broadcast();
+		}
+		aLock.unlock();
+		if(link_lost)
+			m_cam.recoverLink(false);
+		aLock.lock();
+	}
+}
+
+//-----------------------------------------------------
+// @brief the sensors are read outside of the lock, the acquisition is not delayed
+//-----------------------------------------------------
+void Camera::TelemetryThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	//the sensors are not urgent, the acquisition thread goes first
+	SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	Timestamp next_sample = Timestamp::now();
+	while(!m_cam.m_telemetry_quit)
+	{
+		double remaining = m_cam.m_telemetry_period - (double) (Timestamp::now() - next_sample);
+		if(remaining > 0.)
+		{
+			m_cam.m_cond.wait(remaining);
+			continue;
+		}
+		next_sample = Timestamp::now();
+		if(!m_cam.m_telemetry || !m_cam.m_initialized || m_cam.m_reconnecting || m_cam.m_link_lost)
+			continue;
+
+		//the handle is not closed by a reconnection meanwhile
+		m_cam.m_nb_handle_users++;
+		aLock.unlock();
+		TelemetrySample sample;
+		m_cam.sampleTelemetry(sample);
+		m_cam.m_telemetry_ring.push(sample);
+		aLock.lock();
+		if(--m_cam.m_nb_handle_users == 0)
+			m_cam.m_cond.broadcast();
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::TelemetryThread::TelemetryThread(Camera& cam):
+m_cam(cam)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+Camera::TelemetryThread::~TelemetryThread()
+{
+	join();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::LinkThread::LinkThread(Camera& cam):
+m_cam(cam)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::LinkThread::~LinkThread()
+{
+	join();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::InitThread::InitThread(Camera& cam):
+m_cam(cam)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::InitThread::~InitThread()
+{
+	join();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::AcqThread::AcqThread(Camera& cam):
+m_cam(cam)
+{
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	m_cam.m_wait_flag = true;
+	m_cam.m_quit = false;
+	aLock.unlock();
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+Camera::AcqThread::~AcqThread()
+{
+	AutoMutex aLock(m_cam.m_cond.mutex());
+	m_cam.m_wait_flag = true;
+	m_cam.m_quit = true;
+	m_cam.m_cond.broadcast();
+	aLock.unlock();
+	join();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getImageType(ImageType& type)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		waitInitDone();
+	}
+	//@BEGIN : Fix the image type (pixel depth) into Driver/API		
+	if(m_hdr_merger.isEnabled())
+	{
+		//the merged frames are 32 bits
+		type = m_hdr_merger.getOutputType();
+		return;
+	}
+	if(m_frame_correction.isEnabled() && m_frame_correction.getOutputType() == Bpp32F)
+	{
+		type = Bpp32F;
+		return;
+	}
+	if(m_frame_accumulator.isEnabled())
+	{
+		type = Bpp32;
+		return;
+	}
+	switch(m_depth)
+	{
+		case 8: type = Bpp8;
+			break;
+		case 12: type = Bpp12;
+			break;
+		case 16: type = Bpp16;
+			break;
+		default:
+			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 8/12/16 bits are managed!";
+			break;
+	}
+	//@END	
+	return;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setImageType(ImageType type)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		waitInitDone();
+	}
+	HandleUse handle(*this);
+	DEB_TRACE() << "setImageType - " << DEB_VAR1(type);
+	//@BEGIN : Fix the image type (pixel depth) into Driver/API	
+	if(type == Bpp8 && (m_hdr_merger.isEnabled() || m_frame_correction.isEnabled() || m_frame_accumulator.isEnabled()))
+	{
+		THROW_HW_ERROR(Error) << "Bpp8 can not be used with the HDR merge, the frame correction or the accumulation !";
+	}
+	if(type != Bpp16 && m_hdr_merger.isEnabled())
+	{
+		THROW_HW_ERROR(Error) << "HDR merge needs 16 bits readouts, image type must be Bpp16 !";
+	}
+	//12 bits may fall back to 16 bits, and the camera may change other settings with the depth (exposure range,
+	//readout), all the cached values are read again, also if a write below fails
+	m_parameter_cache.invalidate();
+	switch(type)
+	{
+		case Bpp8:
+			if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_BITOFDEPTH, 8))
+			{
+				THROW_HW_ERROR(Error) << "Unable to Write TUIDC_BITOFDEPTH (8) to the camera !";
+			}
+			m_depth = 8;
+			break;
+		case Bpp12:
+			//ask for a 12 bits (packed) transfer, cameras without this mode deliver 16 bits containers
+			if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_BITOFDEPTH, 12))
+			{
+				DEB_TRACE() << "TUIDC_BITOFDEPTH (12) is not supported, use 16 bits transfer";
+				if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_BITOFDEPTH, 16))
+				{
+					THROW_HW_ERROR(Error) << "Unable to Write TUIDC_BITOFDEPTH (16) to the camera !";
+				}
+			}
+			m_depth = 12;
+			break;
+		case Bpp16:
+			if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_BITOFDEPTH, 16))
+			{
+				THROW_HW_ERROR(Error) << "Unable to Write TUIDC_BITOFDEPTH (16) to the camera !";
+			}
+			m_depth = 16;
+			break;
+		default:
+			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 8/12/16 bits are managed!";
+			break;
+	}
+	//@END	
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorType(std::string& type)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Get Detector type from Driver/API
+	type = "Tucsen - Dhyana";
+	//@END	
+
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorModel(std::string& model)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Get Detector model/type read from Driver/API at init
+	AutoMutex lock(m_cond.mutex());
+	waitInitDone();
+	model = m_model;
+	//@END		
+}
+
+//-----------------------------------------------------
+// @brief serial number read from the camera at init
+//-----------------------------------------------------
+void Camera::getSerialNumber(std::string& serial_number)
+{
+	DEB_MEMBER_FUNCT();
+	serial_number = m_serial_number;
+}
+
+//-----------------------------------------------------
+// @brief TUCAM device index of the camera
+//-----------------------------------------------------
+void Camera::getCameraIndex(int& index)
+{
+	DEB_MEMBER_FUNCT();
+	index = m_camera_index;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getDetectorImageSize(Size& size)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : Get Detector size in pixels from Driver/API
+	std::string model="UNKNOWN";
+	getDetectorModel(model);
+	if (model == "Dhyana 95"  || model.find("Dhyana 95 V2") != std::string::npos)
+	{
+		size = Size(PIXEL_NB_WIDTH_MODEL_95, PIXEL_NB_HEIGHT_MODEL_95);
+	}
+	else if (model.find("4040") != std::string::npos)
+	{
+		size = Size(PIXEL_NB_WIDTH_MODEL_4040, PIXEL_NB_HEIGHT_MODEL_4040);
+	}	
+	else
+	{
+		THROW_HW_ERROR(NotSupported) << model;
+	}
+	//@END
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getPixelSize(double& sizex, double& sizey)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN : Get Pixels size in micron from Driver/API	
+	std::string model="UNKNOWN";
+	getDetectorModel(model);	
+	if (model == "Dhyana 95"  || model.find("Dhyana 95 V2") != std::string::npos)
+	{
+		sizex = PIXEL_SIZE_WIDTH_MICRON_MODEL_95;
+		sizey = PIXEL_SIZE_HEIGHT_MICRON_MODEL_95;
+	}
+	else if (model.find("4040") != std::string::npos)
+	{
+		sizex=PIXEL_SIZE_WIDTH_MICRON_MODEL_4040;
+		sizey=PIXEL_SIZE_HEIGHT_MICRON_MODEL_4040;
+	}
+	else
+	{
+		THROW_HW_ERROR(NotSupported) << model;
+	}	
+	//@END
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+HwBufferCtrlObj* Camera::getBufferCtrlObj()
+{
+	return &m_bufferCtrlObj;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool Camera::checkTrigMode(TrigMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	bool valid_mode;
+	//@BEGIN
+	switch(mode)
+	{
+		case IntTrig:
+		case IntTrigMult:
+		case ExtTrigMult:
+		case ExtGate:
+			valid_mode = true;
+			break;
+		case ExtTrigReadout:
+		case ExtTrigSingle:
+		default:
+			valid_mode = false;
+			break;
+	}
+	//@END
+	return valid_mode;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setTrigMode(TrigMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		waitInitDone();
+	}
+	HandleUse handle(*this);
+	DEB_TRACE() << "setTrigMode() " << DEB_VAR1(mode);
+	DEB_PARAM() << DEB_VAR1(mode);
+	//@BEGIN
+	m_tgrAttr->nTgrMode = -1;//NOT DEFINED (see below)
+	m_tgrAttr->nFrames = 1;
+	m_tgrAttr->nDelayTm = 0;
+	m_tgrAttr->nExpMode = -1;//NOT DEFINED (see below)
+	m_tgrAttr->nEdgeMode = TUCTD_RISING;
+	m_tgrAttr->nBufFrames = m_tucam_trigger_buf_frames;
+
+	switch(mode)
+	{
+		case IntTrig:
+			m_tgrAttr->nTgrMode = TUCCM_TRIGGER_SOFTWARE;
+			m_tgrAttr->nExpMode = TUCTE_EXPTM;
+			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_SOFTWARE (EXPOSURE SOFTWARE)";
+			break;
+		case IntTrigMult:
+			m_tgrAttr->nTgrMode = TUCCM_TRIGGER_SOFTWARE;
+			m_tgrAttr->nExpMode = TUCTE_EXPTM;
+			//burst mode : one software trigger produces m_burst_frames frames
+			m_tgrAttr->nFrames = m_burst_frames;
+			m_tgrAttr->nBufFrames = max(m_tucam_trigger_buf_frames, m_burst_frames);
+			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_SOFTWARE (EXPOSURE SOFTWARE) (MULTI)";
+			break;			
+		case ExtTrigMult:
+			m_tgrAttr->nTgrMode = m_tucam_trigger_mode;
+			m_tgrAttr->nExpMode = TUCTE_EXPTM;
+			m_tgrAttr->nEdgeMode = m_tucam_trigger_edge_mode;
+			m_tgrAttr->nDelayTm = m_tucam_trigger_delay;
+			DEB_TRACE() << "TUCAM_Cap_SetTrigger : " << m_tgrAttr->nTgrMode << " (EXPOSURE SOFTWARE: "<<m_tgrAttr->nExpMode<<")";
+			break;
+		case ExtGate:		
+			m_tgrAttr->nTgrMode = m_tucam_trigger_mode;
+			m_tgrAttr->nExpMode = TUCTE_WIDTH;
+			m_tgrAttr->nEdgeMode = m_tucam_trigger_edge_mode;
+			m_tgrAttr->nDelayTm = m_tucam_trigger_delay;
+			DEB_TRACE() << "TUCAM_Cap_SetTrigger : " << m_tgrAttr->nTgrMode << " (EXPOSURE TRIGGER WIDTH: "<<m_tgrAttr->nExpMode<<")";
+			break;			
+		case ExtTrigSingle:		
+		case ExtTrigReadout:
+		default:
+			THROW_HW_ERROR(NotSupported) << DEB_VAR1(mode);
+	}
+
+	DEB_TRACE() << "TUCAM_Cap_SetTrigger : " << DEB_VAR4(m_tgrAttr->nEdgeMode, m_tgrAttr->nDelayTm, m_tgrAttr->nFrames, m_tgrAttr->nBufFrames);
+	if(TUCAMRET_SUCCESS != TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, *m_tgrAttr))
+	{
+		THROW_HW_ERROR(Error) << "Unable to set the trigger attributes to the camera !";
+	}
+	m_trigger_mode = mode;
+	//@END
+
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getTrigMode(TrigMode& mode)
+{
+	DEB_MEMBER_FUNCT();
+	mode = m_trigger_mode;
+}
+
+void Camera::getTriggerMode(TucamTriggerMode &mode)
+{
+	DEB_MEMBER_FUNCT();
+	mode = m_tucam_trigger_mode;
+}
+
+//-----------------------------------------------------
+// @brief set the TUCAM external trigger mode (standard/synchronous/global)
+// it is applied to the camera when an external Lima trigger mode is in use
+//-----------------------------------------------------
+void Camera::setTriggerMode(TucamTriggerMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(mode);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the trigger settings during the acquisition !";
+	}
+	m_tucam_trigger_mode = mode;
+	if(m_trigger_mode == ExtTrigMult || m_trigger_mode == ExtGate)
+	{
+		setTrigMode(m_trigger_mode);
+	}
+}
+
+void Camera::getTriggerEdge(TucamTriggerEdge &edge)
+{
+	DEB_MEMBER_FUNCT();
+	edge = m_tucam_trigger_edge_mode;
+}
+
+//-----------------------------------------------------
+// @brief set the active edge of the external trigger input
+//-----------------------------------------------------
+void Camera::setTriggerEdge(TucamTriggerEdge edge)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(edge);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the trigger settings during the acquisition !";
+	}
+	m_tucam_trigger_edge_mode = edge;
+	if(m_trigger_mode == ExtTrigMult || m_trigger_mode == ExtGate)
+	{
+		setTrigMode(m_trigger_mode);
+	}
+}
+
+void Camera::getTriggerDelay(int& delay)
+{
+	DEB_MEMBER_FUNCT();
+	delay = m_tucam_trigger_delay;
+}
+
+//-----------------------------------------------------
+// @brief set the delay (us) between the external trigger and the exposure start
+//-----------------------------------------------------
+void Camera::setTriggerDelay(int delay)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(delay);
+	if(delay < 0)
+	{
+		THROW_HW_ERROR(Error) << "Trigger delay must be positive !";
+	}
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the trigger settings during the acquisition !";
+	}
+	m_tucam_trigger_delay = delay;
+	if(m_trigger_mode == ExtTrigMult || m_trigger_mode == ExtGate)
+	{
+		setTrigMode(m_trigger_mode);
+	}
+}
+
+void Camera::getTriggerBufFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_tucam_trigger_buf_frames;
+}
+
+//-----------------------------------------------------
+// @brief set how many frames the camera can buffer between two triggers
+//-----------------------------------------------------
+void Camera::setTriggerBufFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+	if(nb_frames < 1)
+	{
+		THROW_HW_ERROR(Error) << "Number of buffered frames must be at least 1 !";
+	}
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the number of buffered frames during the acquisition !";
+	}
+	m_tucam_trigger_buf_frames = nb_frames;
+	setTrigMode(m_trigger_mode);
+}
+
+//-----------------------------------------------------
+// @brief set the number of frames acquired by the camera for each IntTrigMult trigger
+//-----------------------------------------------------
+void Camera::setBurstFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+	if(nb_frames < 1)
+	{
+		THROW_HW_ERROR(Error) << "Burst size must be at least 1 !";
+	}
+	//the bursts of the running sequence and its nb of frames use the current size
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the burst size during the acquisition !";
+	}
+	m_burst_frames = nb_frames;
+	if(m_trigger_mode == IntTrigMult)
+	{
+		setTrigMode(m_trigger_mode);
+	}
+}
+
+void Camera::getBurstFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_burst_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getExpTime(double& exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		waitInitDone();
+	}
+	HandleUse handle(*this);
+	//@BEGIN
+	double dbVal;
+	bool cached = isExposureCached();
+	if(!cached || !m_parameter_cache.get("TUIDP_EXPOSURETM", dbVal))
+	{
+		if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, &dbVal))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Read TUIDP_EXPOSURETM from the camera !";
+		}
+		if(cached)
+			m_parameter_cache.set("TUIDP_EXPOSURETM", dbVal);
+	}
+	//@END
+	//also changed by the auto exposure of the acquisition thread
+	AutoMutex lock(m_cond.mutex());
+	m_exp_time = dbVal / 1000;//TUCAM use (ms), but lima use (second) as unit 
+	exp_time = m_exp_time;
+	DEB_RETURN() << DEB_VAR1(exp_time);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setExpTime(double exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		waitInitDone();
+	}
+	HandleUse handle(*this);
+	DEB_TRACE() << "setExpTime() " << DEB_VAR1(exp_time);
+	//@BEGIN
+	double dbVal = exp_time * 1000;//TUCAM use (ms), but lima use (second) as unit 
+	bool cached = isExposureCached();
+	if(!cached || !m_parameter_cache.isUnchanged("TUIDP_EXPOSURETM", dbVal))
+	{
+		m_parameter_cache.invalidate("TUIDP_EXPOSURETM");
+		if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, dbVal))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Write TUIDP_EXPOSURETM to the camera !";
+		}
+		if(cached)
+			m_parameter_cache.set("TUIDP_EXPOSURETM", dbVal);
+	}
+	//@END
+	AutoMutex lock(m_cond.mutex());
+	m_exp_time = exp_time;
+}
+
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setLatTime(double lat_time)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setLatTime() " << DEB_VAR1(lat_time);
+	m_lat_time = lat_time;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLatTime(double& lat_time)
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	//@END
+	lat_time = m_lat_time;
+	DEB_RETURN() << DEB_VAR1(lat_time);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getExposureTimeRange(double& min_expo, double& max_expo) const
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	min_expo = 0.;
+	max_expo = 10;//10s
+	//@END
+	DEB_RETURN() << DEB_VAR2(min_expo, max_expo);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getLatTimeRange(double& min_lat, double& max_lat) const
+{
+	DEB_MEMBER_FUNCT();
+	//@BEGIN
+	// --- no info on min latency
+	min_lat = 0.;
+	// --- do not know how to get the max_lat, fix it as the max exposure time
+	max_lat = 10;//10s
+	//@END
+	DEB_RETURN() << DEB_VAR2(min_lat, max_lat);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::setNbFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "setNbFrames() " << DEB_VAR1(nb_frames);
+	//@BEGIN
+	if(nb_frames < 0)
+	{
+		THROW_HW_ERROR(Error) << "Number of frames to acquire has not been set";
+	}
+	if(nb_frames > 1)
+	{
+		//THROW_HW_ERROR(Error) << "Unable to acquire more than 1 frame ! ";	//T@D@ allowed only for test 
+	}
+	//@END
+	m_nb_frames = nb_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getNbFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_RETURN() << DEB_VAR1(m_nb_frames);
+	//@BEGIN
+	//@END
+	nb_frames = m_nb_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+int Camera::getNbHwAcquiredFrames()
+{
+	DEB_MEMBER_FUNCT();
+	return m_acq_frame_nb;
+}
+
+//-----------------------------------------------------
+// @brief range the binning to the maximum allowed
+//-----------------------------------------------------
+void Camera::checkBin(Bin &hw_bin)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : check available values of binning H/V
+	int x = hw_bin.getX();
+	int y = hw_bin.getY();
+	if(x != 1 || y != 1)
+	{
+		DEB_ERROR() << "Binning values not supported";
+		THROW_HW_ERROR(Error) << "Binning values not supported = " << DEB_VAR1(hw_bin);
+	}
+	//@END
+
+	hw_bin = Bin(x, y);
+	DEB_RETURN() << DEB_VAR1(hw_bin);
+}
+//-----------------------------------------------------
+// @brief set the new binning mode
+//-----------------------------------------------------
+void Camera::setBin(const Bin &set_bin)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : set binning H/V to the Driver/API
+	//...
+	//@END
+	m_bin = set_bin;
+
+	DEB_RETURN() << DEB_VAR1(set_bin);
+}
+
+//-----------------------------------------------------
+// @brief return the current binning mode
+//-----------------------------------------------------
+void Camera::getBin(Bin &hw_bin)
+{
+	DEB_MEMBER_FUNCT();
+
+	//@BEGIN : get binning from Driver/API
+	int bin_x = 1;
+	int bin_y = 1;
+	//@END
+	Bin tmp_bin(bin_x, bin_y);
+
+	hw_bin = tmp_bin;
+	m_bin = tmp_bin;
+
+	DEB_RETURN() << DEB_VAR1(hw_bin);
+}
+
+//-----------------------------------------------------
+//! Camera::checkRoi()
+//-----------------------------------------------------
+void Camera::checkRoi(const Roi& set_roi, Roi& hw_roi)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_TRACE() << "checkRoi";
+	DEB_PARAM() << DEB_VAR1(set_roi);
+	//@BEGIN : check available values of Roi
+	if(set_roi.isActive())
+	{	
+		if ((set_roi.getSize().getWidth() % 4 != 0)     ||
+			(set_roi.getSize().getHeight() % 4 != 0)    ||
+			(set_roi.getTopLeft().x % 4 != 0)           ||
+			(set_roi.getTopLeft().y % 4 != 0))           
+		{
+			THROW_HW_ERROR(Error) << "Roi coordinates (x, y, width, height) must respect some constraints:\n"
+								  << " - x must be a multiple of 4 \n"
+								  << " - y must be a multiple of 4 \n"
+								  << " - width must be a multiple of 4 \n"
+								  << " - height must be a multiple of 4 \n";
+		}     
+		hw_roi = set_roi;
+	}
+	else
+	{
+		hw_roi = set_roi;
+	}
+	//@END
+
+
+	DEB_RETURN() << DEB_VAR1(hw_roi);
+}
+
+//---------------------------------------------------------------------------------------
+//! Camera::getRoi()
+//---------------------------------------------------------------------------------------
+void Camera::getRoi(Roi& hw_roi)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		waitInitDone();
+	}
+	HandleUse handle(*this);
+	//@BEGIN : get Roi from the Driver/API
+	TUCAM_ROI_ATTR roiAttr;
+	if(TUCAMRET_SUCCESS != TUCAM_Cap_GetROI(m_opCam.hIdxTUCam, &roiAttr))
+	{
+		THROW_HW_ERROR(Error) << "Unable to GetRoi from  the camera !";
+	}
+	hw_roi = Roi(roiAttr.nHOffset,
+				roiAttr.nVOffset,
+				roiAttr.nWidth,
+				roiAttr.nHeight);
+	//@END
+
+	DEB_RETURN() << DEB_VAR1(hw_roi);
+}
+
+//---------------------------------------------------------------------------------------
+//! Camera::setRoi()
+//---------------------------------------------------------------------------------------
+void Camera::setRoi(const Roi& set_roi)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		waitInitDone();
+	}
+	HandleUse handle(*this);
+	DEB_TRACE() << "setRoi";
+	DEB_PARAM() << DEB_VAR1(set_roi);
+	//@BEGIN : set Roi from the Driver/API	
+	if(!set_roi.isActive())
+	{
+		DEB_TRACE() << "Roi is not Enabled : so set full frame";
+
+		//set Roi to Driver/API
+		Size size;
+		getDetectorImageSize(size);
+		TUCAM_ROI_ATTR roiAttr;
+		roiAttr.bEnable = TRUE;
+		roiAttr.nHOffset = 0;
+		roiAttr.nVOffset = 0;
+		roiAttr.nWidth = size.getWidth();
+		roiAttr.nHeight = size.getHeight();
+
+		bool roi_set = (TUCAMRET_SUCCESS == TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr));
+		//the camera may adapt other settings to the roi (exposure, frame rate), they are read again
+		m_parameter_cache.invalidate();
+		if(!roi_set)
+		{
+			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
+		}
+		m_hw_roi = Roi(0, 0, size.getWidth(), size.getHeight());
+	}
+	else
+	{
+		DEB_TRACE() << "Roi is Enabled";
+		//set Roi to Driver/API
+		TUCAM_ROI_ATTR roiAttr;
+		roiAttr.bEnable = TRUE;
+		roiAttr.nHOffset = set_roi.getTopLeft().x;
+		roiAttr.nVOffset = set_roi.getTopLeft().y;
+		roiAttr.nWidth = set_roi.getSize().getWidth();
+		roiAttr.nHeight = set_roi.getSize().getHeight();
+
+		bool roi_set = (TUCAMRET_SUCCESS == TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr));
+		m_parameter_cache.invalidate();
+		if(!roi_set)
+		{
+			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
+		}
+		m_hw_roi = set_roi;
+	}
+	//@END	
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool Camera::isAcqRunning() const
+{
+	DEB_MEMBER_FUNCT();
+	//	AutoMutex aLock(m_cond.mutex());
+	DEB_TRACE() << "isAcqRunning - " << DEB_VAR1(m_thread_running) << "---------------------------";
+	return m_thread_running;
+}
+
+///////////////////////////////////////////////////////
+// Dhyana specific stuff now
+///////////////////////////////////////////////////////
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setTemperatureTarget(double temp)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+	TUCAM_PROP_ATTR attrProp;
+	attrProp.nIdxChn = 0;// Current channel (camera monochrome = 0) . VERY IMPORTANT, doesn't work otherwise !!!!!
+	attrProp.idProp = TUIDP_TEMPERATURE;
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetAttr(m_opCam.hIdxTUCam, &attrProp))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE range from the camera !";
+	}
+	DEB_TRACE() << "Temperature range [" << (int) attrProp.dbValMin << " , " << (int) attrProp.dbValMax << "]";
+
+	int temp_middle = (int) attrProp.dbValMax / 2;
+	if(((int) temp + temp_middle)<((int) attrProp.dbValMin) || ((int) temp + temp_middle)>((int) attrProp.dbValMax))
+	{
+		THROW_HW_ERROR(Error) << "Unable to set the Temperature Target !\n"
+		 << "It is out of range : "
+		 << "["
+		 << (int) attrProp.dbValMin - temp_middle
+		 << ","
+		 << (int) attrProp.dbValMax - temp_middle
+		 << "]";
+	}
+
+	int nVal = (int) temp + temp_middle;//temperatureTarget is a delta according to the middle temperature !!
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, nVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_TEMPERATURE to the camera !";
+	}
+	m_temperature_target = (double) temp;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getTemperatureTarget(double& temp)
+{
+	DEB_MEMBER_FUNCT();
+
+	temp = m_temperature_target;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getTemperature(double& temp)
+{
+	DEB_MEMBER_FUNCT();
+	//the last sample of the telemetry thread if it is recent, the camera is not used
+	TelemetrySample sample;
+	if(m_telemetry && m_telemetry_ring.getLast(sample) && (sample.fields & TelemetrySample::kTemperature)
+	   && (double) Timestamp::now() - sample.timestamp <= 2 * m_telemetry_period)
+	{
+		temp = sample.temperature;
+		return;
+	}
+
+	HandleUse handle(*this);
+	double dbVal = 0.0f;
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, &dbVal))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE from the camera !";
+	}
+	temp = dbVal;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setFanSpeed(unsigned speed)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+
+	int nVal = (int) speed;
+	if(!m_parameter_cache.isUnchanged("TUIDC_FAN_GEAR", nVal))
+	{
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, nVal))
+		{
+			m_parameter_cache.invalidate("TUIDC_FAN_GEAR");
+			THROW_HW_ERROR(Error) << "Unable to Write TUIDC_FAN_GEAR to the camera !";
+		}
+		m_parameter_cache.set("TUIDC_FAN_GEAR", nVal);
+	}
+	m_fan_speed = speed;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getFanSpeed(unsigned& speed)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+
+	double dbVal;
+	if(!m_parameter_cache.get("TUIDC_FAN_GEAR", dbVal))
+	{
+		int nVal;
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, &nVal))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Read TUIDC_FAN_GEAR from the camera !";
+		}
+		dbVal = nVal;
+		m_parameter_cache.set("TUIDC_FAN_GEAR", dbVal);
+	}
+	speed = (unsigned) dbVal;
+	m_fan_speed = speed;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setGlobalGain(unsigned gain)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+
+	if(gain != 0 && gain != 1 && gain != 2)
+	{
+		THROW_HW_ERROR(Error) << "Available gain values are : 0:HDR\n1:HIGH\n2: LOW !";
+	}
+
+	double dbVal = (double) gain;
+	if(!m_parameter_cache.isUnchanged("TUIDP_GLOBALGAIN", dbVal))
+	{
+		if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, dbVal))
+		{
+			m_parameter_cache.invalidate("TUIDP_GLOBALGAIN");
+			THROW_HW_ERROR(Error) << "Unable to Write TUIDP_GLOBALGAIN to the camera !";
+		}
+		m_parameter_cache.set("TUIDP_GLOBALGAIN", dbVal);
+	}
+	m_global_gain = gain;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getGlobalGain(unsigned& gain)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+
+	double dbVal;
+	if(!m_parameter_cache.get("TUIDP_GLOBALGAIN", dbVal))
+	{
+		if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, &dbVal))
+		{
+			THROW_HW_ERROR(Error) << "Unable to Read TUIDP_GLOBALGAIN from the camera !";
+		}
+		m_parameter_cache.set("TUIDP_GLOBALGAIN", dbVal);
+	}
+	gain = (unsigned) dbVal;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void Camera::getTucamVersion(std::string& version)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_VERSION_API;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_API from the camera !";
+	}
+	version = valInfo.pText;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getFirmwareVersion(std::string& version)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+	TUCAM_VALUE_INFO valInfo;
+	valInfo.nID = TUIDI_VERSION_FRMW;
+	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	{
+		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_FRMW from the camera !";
+	}
+	version = valInfo.nValue;
+}
+
+//-----------------------------------------------------------------------------
+/// Get the frame rate
+//-----------------------------------------------------------------------------
+void Camera::getFPS(double& fps) ///< [out] last computed fps
+{
+    DEB_MEMBER_FUNCT();
+
+    fps = m_fps;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::setTecMode(unsigned mode)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+
+	if(mode != 0 && mode != 1)
+	{
+		THROW_HW_ERROR(Error) << "Available mode values are :\n0:OFF\n1:ON";
+	}
+
+	int nVal = (int) mode;
+	if(!m_parameter_cache.isUnchanged("TUIDC_ENABLETEC", nVal))
+	{
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_ENABLETEC, nVal))
+		{
+			m_parameter_cache.invalidate("TUIDC_ENABLETEC");
+			DEB_TRACE() << "Unable to Write TUIDC_ENABLETEC from the camera!";
+			THROW_HW_ERROR(Error) << "Unable to Write TUIDC_ENABLETEC to the camera !";
+		}
+		m_parameter_cache.set("TUIDC_ENABLETEC", nVal);
+	}
+	m_tec_mode = mode;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------  
+void Camera::getTecMode(unsigned& mode)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+
+	double dbVal;
+	if(!m_parameter_cache.get("TUIDC_ENABLETEC", dbVal))
+	{
+		int nVal;
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_ENABLETEC, &nVal))
+		{
+			DEB_TRACE() << "Unable to Read TUIDC_ENABLETEC from the camera!";
+			THROW_HW_ERROR(Error) << "Unable to Read TUIDC_ENABLETEC from the camera !";
+		}
+		dbVal = nVal;
+		m_parameter_cache.set("TUIDC_ENABLETEC", dbVal);
+	}
+	mode = (unsigned) dbVal;
+	m_tec_mode = mode;
+}
+
+//-----------------------------------------------------
+// Set trigger outpout on selected port
+//-----------------------------------------------------  
+void Camera::setOutputSignal(int port, TucamSignal signal, TucamSignalEdge edge, int delay, int width)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+
+	TUCAM_TRGOUT_ATTR* tgroutAttr;
+	switch (port)
+	{
+	case 0:
+		tgroutAttr = &m_tgroutAttr1;
+		break;
+
+	case 1:
+		tgroutAttr = &m_tgroutAttr2;
+		break;
+
+	case 2:
+		tgroutAttr = &m_tgroutAttr3;
+		break;
+
+	default:
+		THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
+		break;
+	}
+
+	//the written attributes are kept, they are not read back from the camera
+	std::stringstream key, value;
+	key << "TRGOUT_" << port;
+	value << signal << " " << edge << " " << delay * 1000 << " " << width * 1000;
+	if (m_parameter_cache.isUnchanged(key.str(), value.str()))
+		return;
+
+	tgroutAttr->nTgrOutMode = signal;
+	tgroutAttr->nEdgeMode = edge;
+	tgroutAttr->nDelayTm = delay * 1000;
+	tgroutAttr->nWidth = width * 1000;
+
+	if (TUCAMRET_SUCCESS != TUCAM_Cap_SetTriggerOut(m_opCam.hIdxTUCam, *tgroutAttr))
+	{
+		m_parameter_cache.invalidate(key.str());
+		THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
+	}
+	m_parameter_cache.set(key.str(), value.str());
+}
+
+//-----------------------------------------------------
+// Get trigger outpout on selected port
+//----------------------------------------------------- 
+void Camera::getOutputSignal(int port, TucamSignal& signal, TucamSignalEdge& edge, int& delay, int& width)
+{
+  DEB_MEMBER_FUNCT();
+
+  switch (port)
+  {
+  case 0:
+	  signal = (TucamSignal)m_tgroutAttr1.nTgrOutMode;
+	  edge = (TucamSignalEdge)m_tgroutAttr1.nEdgeMode;
+	  delay = m_tgroutAttr1.nDelayTm;
+	  width = m_tgroutAttr1.nWidth;
+	  break;
+
+  case 1:
+	  signal = (TucamSignal)m_tgroutAttr2.nTgrOutMode;
+	  edge = (TucamSignalEdge)m_tgroutAttr2.nEdgeMode;
+	  delay = m_tgroutAttr2.nDelayTm;
+	  width = m_tgroutAttr2.nWidth;
+	  break;
+
+  case 2:
+	  signal = (TucamSignal)m_tgroutAttr3.nTgrOutMode;
+	  edge = (TucamSignalEdge)m_tgroutAttr3.nEdgeMode;
+	  delay = m_tgroutAttr3.nDelayTm;
+	  width = m_tgroutAttr3.nWidth;
+	  break;
+
+  default:
+	  THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
+	  break;
+  }
+}
+
+//-----------------------------------------------------
+// is trigger out attribute is available
+//----------------------------------------------------- 
+bool Camera::is_trigOutput_available()
+{
+	HandleUse handle(*this);
+	DEB_MEMBER_FUNCT();	
+	bool is_trigOutput_available = true;
+
+	TUCAM_TRGOUT_ATTR tgroutAttr;
+	if (TUCAMRET_SUCCESS != TUCAM_Cap_GetTriggerOut(m_opCam.hIdxTUCam, &tgroutAttr))
+	{
+		is_trigOutput_available = false;
+		DEB_TRACE() << "Unable to get trigger out attribute from the camera!";
+	}
+	
+	return is_trigOutput_available;
+}
+
+
+//-----------------------------------------------------
+// @brief notify Lima that the output image type has changed
+//-----------------------------------------------------
+void Camera::imageTypeChanged()
+{
+	DEB_MEMBER_FUNCT();
+	Size size;
+	getDetectorImageSize(size);
+	ImageType type;
+	getImageType(type);
+	DEB_TRACE() << "imageTypeChanged - " << DEB_VAR2(size, type);
+	maxImageSizeChanged(size, type);
+}
+
+//-----------------------------------------------------
+// @brief pixel type of the frames delivered by the camera, before the processing stages
+//-----------------------------------------------------
+ImageType Camera::cameraImageType()
+{
+	return (m_depth == 8) ? Bpp8 : (m_depth == 12) ? Bpp12 : Bpp16;
+}
+
+//-----------------------------------------------------
+// @brief full scale (bits) of the Lima frames, given by the stage which produced them
+//-----------------------------------------------------
+int Camera::frameRangeBits()
+{
+	int range_bits = m_depth;
+	if(m_hdr_merger.isEnabled())
+	{
+		//the low gain readout is scaled by K
+		double full_scale = m_hdr_merger.getKFactor() * 65536.;
+		range_bits = 16;
+		while(range_bits < 32 && (double) (1ULL << range_bits) < full_scale)
+			range_bits++;
+	}
+	else if(m_frame_accumulator.isEnabled())
+	{
+		//sum of N camera frames
+		int nb_frames = m_frame_accumulator.getNbFrames();
+		while(range_bits < 32 && (1LL << (range_bits - m_depth)) < nb_frames)
+			range_bits++;
+	}
+	return range_bits;
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the host side HDR merge (32 bits output)
+//-----------------------------------------------------
+void Camera::setHdrMerge(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the HDR merge during the acquisition !";
+	}
+	//the merge reads 16 bits readouts, a packed 12 bits transfer is not unpacked before it
+	if(enable && m_depth != 16)
+	{
+		THROW_HW_ERROR(Error) << "HDR merge needs 16 bits readouts, image type must be Bpp16 !";
+	}
+	if(enable && m_frame_correction.isEnabled())
+	{
+		THROW_HW_ERROR(Error) << "HDR merge can not be used with the frame correction !";
+	}
+	if(enable && m_frame_accumulator.isEnabled())
+	{
+		THROW_HW_ERROR(Error) << "HDR merge can not be used with the frame accumulation !";
+	}
+	if(enable == m_hdr_merger.isEnabled())
+		return;
+	m_hdr_merger.setEnable(enable);
+	m_hdr_single_readout_warned = false;
+	imageTypeChanged();
+}
+
+void Camera::getHdrMerge(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_hdr_merger.isEnabled();
+}
+
+//-----------------------------------------------------
+// @brief ratio between the high gain and the low gain responses
+//-----------------------------------------------------
+void Camera::setHdrKFactor(double k)
+{
+	DEB_MEMBER_FUNCT();
+	m_hdr_merger.setKFactor(k);
+}
+
+void Camera::getHdrKFactor(double& k)
+{
+	DEB_MEMBER_FUNCT();
+	k = m_hdr_merger.getKFactor();
+}
+
+//-----------------------------------------------------
+// @brief high gain level (ADU) above which the low gain readout is used
+//-----------------------------------------------------
+void Camera::setHdrThreshold(unsigned threshold)
+{
+	DEB_MEMBER_FUNCT();
+	m_hdr_merger.setThreshold(threshold);
+}
+
+void Camera::getHdrThreshold(unsigned& threshold)
+{
+	DEB_MEMBER_FUNCT();
+	threshold = m_hdr_merger.getThreshold();
+}
+
+//-----------------------------------------------------
+// @brief width (ADU) of the blending below the threshold
+//-----------------------------------------------------
+void Camera::setHdrBlendWidth(unsigned width)
+{
+	DEB_MEMBER_FUNCT();
+	m_hdr_merger.setBlendWidth(width);
+}
+
+void Camera::getHdrBlendWidth(unsigned& width)
+{
+	DEB_MEMBER_FUNCT();
+	width = m_hdr_merger.getBlendWidth();
+}
+
+//-----------------------------------------------------
+// @brief black levels of the high gain and low gain readouts
+//-----------------------------------------------------
+void Camera::setHdrOffsets(unsigned high_offset, unsigned low_offset)
+{
+	DEB_MEMBER_FUNCT();
+	m_hdr_merger.setOffsets(high_offset, low_offset);
+}
+
+void Camera::getHdrOffsets(unsigned& high_offset, unsigned& low_offset)
+{
+	DEB_MEMBER_FUNCT();
+	m_hdr_merger.getOffsets(high_offset, low_offset);
+}
+
+//-----------------------------------------------------
+// @brief merged frames type : Bpp32 or Bpp32F
+//-----------------------------------------------------
+void Camera::setHdrOutputType(ImageType type)
+{
+	DEB_MEMBER_FUNCT();
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the HDR output type during the acquisition !";
+	}
+	m_hdr_merger.setOutputType(type);
+	if(m_hdr_merger.isEnabled())
+	{
+		imageTypeChanged();
+	}
+}
+
+void Camera::getHdrOutputType(ImageType& type)
+{
+	DEB_MEMBER_FUNCT();
+	type = m_hdr_merger.getOutputType();
+}
+
+//-----------------------------------------------------
+// @brief compute the K factor from the next merged frame
+//-----------------------------------------------------
+void Camera::calibrateHdrKFactor()
+{
+	DEB_MEMBER_FUNCT();
+	m_hdr_merger.requestCalibration();
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the dark and flat field correction in the frame copy
+//-----------------------------------------------------
+void Camera::setCorrection(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the frame correction during the acquisition !";
+	}
+	if(enable && m_depth == 8)
+	{
+		THROW_HW_ERROR(Error) << "Frame correction needs 16 bits pixels, image type is Bpp8 !";
+	}
+	if(enable && m_hdr_merger.isEnabled())
+	{
+		THROW_HW_ERROR(Error) << "Frame correction can not be used with the HDR merge !";
+	}
+	if(enable && m_frame_accumulator.isEnabled())
+	{
+		THROW_HW_ERROR(Error) << "Frame correction can not be used with the frame accumulation !";
+	}
+	if(enable == m_frame_correction.isEnabled())
+		return;
+	m_frame_correction.setEnable(enable);
+	if(m_frame_correction.getOutputType() == Bpp32F)
+	{
+		imageTypeChanged();
+	}
+}
+
+void Camera::getCorrection(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_frame_correction.isEnabled();
+}
+
+//-----------------------------------------------------
+// @brief corrected frames type : Bpp16 or Bpp32F
+//-----------------------------------------------------
+void Camera::setCorrectionOutputType(ImageType type)
+{
+	DEB_MEMBER_FUNCT();
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the correction output type during the acquisition !";
+	}
+	m_frame_correction.setOutputType(type);
+	if(m_frame_correction.isEnabled())
+	{
+		imageTypeChanged();
+	}
+}
+
+void Camera::getCorrectionOutputType(ImageType& type)
+{
+	DEB_MEMBER_FUNCT();
+	type = m_frame_correction.getOutputType();
+}
+
+//-----------------------------------------------------
+// @brief clamp negative corrected values to 0 (Bpp32F output)
+//-----------------------------------------------------
+void Camera::setCorrectionClamp(bool clamp)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_correction.setClamp(clamp);
+}
+
+void Camera::getCorrectionClamp(bool& clamp)
+{
+	DEB_MEMBER_FUNCT();
+	clamp = m_frame_correction.getClamp();
+}
+
+//-----------------------------------------------------
+// @brief load raw float32 maps of the detector size
+//-----------------------------------------------------
+void Camera::loadCorrectionOffsetMap(const std::string& file_name)
+{
+	DEB_MEMBER_FUNCT();
+	Size size;
+	getDetectorImageSize(size);
+	m_frame_correction.loadOffsetMap(file_name, size);
+}
+
+void Camera::loadCorrectionGainMap(const std::string& file_name)
+{
+	DEB_MEMBER_FUNCT();
+	Size size;
+	getDetectorImageSize(size);
+	m_frame_correction.loadGainMap(file_name, size);
+}
+
+void Camera::saveCorrectionOffsetMap(const std::string& file_name)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_correction.saveOffsetMap(file_name);
+}
+
+void Camera::clearCorrectionMaps()
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_correction.clearMaps();
+}
+
+//-----------------------------------------------------
+// @brief average the next nb_frames acquired frames into the offset map
+//-----------------------------------------------------
+void Camera::startDarkAccumulation(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	if(m_depth == 8)
+	{
+		THROW_HW_ERROR(Error) << "Dark accumulation needs 16 bits pixels, image type is Bpp8 !";
+	}
+	Size size;
+	getDetectorImageSize(size);
+	m_frame_correction.startDarkAccumulation(nb_frames, size);
+}
+
+void Camera::abortDarkAccumulation()
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_correction.abortDarkAccumulation();
+}
+
+void Camera::getDarkAccumulationRemaining(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_frame_correction.getDarkAccumulationRemaining();
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the replacement of the defective pixels
+//-----------------------------------------------------
+void Camera::setDefectCorrection(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_defect_map.setEnable(enable);
+}
+
+void Camera::getDefectCorrection(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_defect_map.isEnabled();
+}
+
+//-----------------------------------------------------
+// @brief median or mean of the valid neighbours
+//-----------------------------------------------------
+void Camera::setDefectReplacement(DefectMap::Replacement replacement)
+{
+	DEB_MEMBER_FUNCT();
+	m_defect_map.setReplacement(replacement);
+}
+
+void Camera::getDefectReplacement(DefectMap::Replacement& replacement)
+{
+	DEB_MEMBER_FUNCT();
+	replacement = m_defect_map.getReplacement();
+}
+
+//-----------------------------------------------------
+// @brief build the defect list from the correction offset (dark) and gain (flat) maps
+//-----------------------------------------------------
+void Camera::buildDefectMap(double hot_sigma, double gain_tolerance)
+{
+	DEB_MEMBER_FUNCT();
+	std::vector<float> dark;
+	std::vector<float> gain;
+	Size size;
+	m_frame_correction.getMaps(dark, gain, size);
+	if(dark.empty())
+	{
+		THROW_HW_ERROR(Error) << "Defect map needs an offset map (load it or use startDarkAccumulation) !";
+	}
+	m_defect_map.build(dark, gain, size, hot_sigma, gain_tolerance);
+}
+
+void Camera::loadDefectMap(const std::string& file_name)
+{
+	DEB_MEMBER_FUNCT();
+	Size size;
+	getDetectorImageSize(size);
+	m_defect_map.load(file_name, size);
+}
+
+void Camera::saveDefectMap(const std::string& file_name)
+{
+	DEB_MEMBER_FUNCT();
+	m_defect_map.save(file_name);
+}
+
+void Camera::clearDefectMap()
+{
+	DEB_MEMBER_FUNCT();
+	m_defect_map.clear();
+}
+
+void Camera::getNbDefects(int& nb_defects)
+{
+	DEB_MEMBER_FUNCT();
+	nb_defects = m_defect_map.getNbDefects();
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the per frame statistics
+//-----------------------------------------------------
+void Camera::setStatistics(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_frame_statistics.setEnable(enable);
+}
+
+void Camera::getStatistics(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_frame_statistics.isEnabled();
+}
+
+//-----------------------------------------------------
+// @brief pixels >= level are counted as saturated, 0 : full scale of the pixel depth
+//-----------------------------------------------------
+void Camera::setStatisticsSaturationLevel(double level)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_statistics.setSaturationLevel(level);
+}
+
+void Camera::getStatisticsSaturationLevel(double& level)
+{
+	DEB_MEMBER_FUNCT();
+	level = m_frame_statistics.getSaturationLevel();
+}
+
+//-----------------------------------------------------
+// @brief additional statistics rois, in frame coordinates
+//-----------------------------------------------------
+void Camera::setStatisticsRois(const std::vector<Roi>& rois)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_statistics.setRois(rois);
+}
+
+void Camera::getStatisticsRois(std::vector<Roi>& rois)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_statistics.getRois(rois);
+}
+
+void Camera::setStatisticsHistorySize(int size)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_statistics.setHistorySize(size);
+}
+
+void Camera::getStatisticsHistorySize(int& size)
+{
+	DEB_MEMBER_FUNCT();
+	size = m_frame_statistics.getHistorySize();
+}
+
+void Camera::registerStatisticsCallback(FrameStatsCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_statistics.registerCallback(cb);
+}
+
+void Camera::unregisterStatisticsCallback(FrameStatsCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_statistics.unregisterCallback(cb);
+}
+
+//-----------------------------------------------------
+// @brief statistics of the last frame, false if none
+//-----------------------------------------------------
+bool Camera::getLastStatistics(FrameStats& stats, std::vector<FrameStats>& roi_stats)
+{
+	DEB_MEMBER_FUNCT();
+	return m_frame_statistics.getLast(stats, roi_stats);
+}
+
+void Camera::getStatisticsHistory(std::vector<FrameStats>& history)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_statistics.getHistory(history);
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the per frame histogram
+//-----------------------------------------------------
+void Camera::setHistogram(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	setCameraHistogram(enable && m_frame_histogram.getSource() == FrameHistogram::kSourceCamera);
+	m_frame_histogram.setEnable(enable);
+}
+
+void Camera::getHistogram(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_frame_histogram.isEnabled();
+}
+
+//-----------------------------------------------------
+// @brief histogram computed by the camera (TUIDC_HISTC) or by the host
+//-----------------------------------------------------
+void Camera::setHistogramSource(FrameHistogram::Source source)
+{
+	DEB_MEMBER_FUNCT();
+	if(m_frame_histogram.isEnabled())
+	{
+		setCameraHistogram(source == FrameHistogram::kSourceCamera);
+	}
+	m_frame_histogram.setSource(source);
+}
+
+void Camera::getHistogramSource(FrameHistogram::Source& source)
+{
+	DEB_MEMBER_FUNCT();
+	source = m_frame_histogram.getSource();
+}
+
+void Camera::setHistogramNbBins(int nb_bins)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_histogram.setNbBins(nb_bins);
+}
+
+void Camera::getHistogramNbBins(int& nb_bins)
+{
+	DEB_MEMBER_FUNCT();
+	nb_bins = m_frame_histogram.getNbBins();
+}
+
+void Camera::setHistogramHistorySize(int size)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_histogram.setHistorySize(size);
+}
+
+void Camera::getHistogramHistorySize(int& size)
+{
+	DEB_MEMBER_FUNCT();
+	size = m_frame_histogram.getHistorySize();
+}
+
+void Camera::registerHistogramCallback(FrameHistogramCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_histogram.registerCallback(cb);
+}
+
+void Camera::unregisterHistogramCallback(FrameHistogramCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_histogram.unregisterCallback(cb);
+}
+
+//-----------------------------------------------------
+// @brief histogram of the last frame, false if none
+//-----------------------------------------------------
+bool Camera::getLastHistogram(FrameHistogramData& histogram)
+{
+	DEB_MEMBER_FUNCT();
+	return m_frame_histogram.getLast(histogram);
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the histogram block delivered with the frames
+//-----------------------------------------------------
+void Camera::setCameraHistogram(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
+	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_HISTC, enable ? 1 : 0))
+	{
+		m_parameter_cache.invalidate("TUIDC_HISTC");
+		THROW_HW_ERROR(Error) << "Unable to set the camera histogram (TUIDC_HISTC) !";
+	}
+	m_parameter_cache.set("TUIDC_HISTC", enable ? 1 : 0);
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the auto exposure loop, it uses the frame histogram
+//-----------------------------------------------------
+void Camera::setAutoExposure(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_auto_exposure.reset();
+	m_auto_exposure.setEnable(enable);
+}
+
+void Camera::getAutoExposure(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_auto_exposure.isEnabled();
+}
+
+//-----------------------------------------------------
+// @brief the percentile of the frame is driven to level x full scale
+//-----------------------------------------------------
+void Camera::setAutoExposureTarget(double percentile, double level)
+{
+	DEB_MEMBER_FUNCT();
+	m_auto_exposure.setTarget(percentile, level);
+}
+
+void Camera::getAutoExposureTarget(double& percentile, double& level)
+{
+	DEB_MEMBER_FUNCT();
+	m_auto_exposure.getTarget(percentile, level);
+}
+
+void Camera::setAutoExposureMaxSaturated(double fraction)
+{
+	DEB_MEMBER_FUNCT();
+	m_auto_exposure.setMaxSaturated(fraction);
+}
+
+void Camera::getAutoExposureMaxSaturated(double& fraction)
+{
+	DEB_MEMBER_FUNCT();
+	fraction = m_auto_exposure.getMaxSaturated();
+}
+
+void Camera::setAutoExposureBounds(double min_exp_time, double max_exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	double min_expo, max_expo;
+	getExposureTimeRange(min_expo, max_expo);
+	if(min_exp_time < min_expo || max_exp_time > max_expo)
+	{
+		THROW_HW_ERROR(Error) << "Auto exposure bounds are out of the exposure range [" << min_expo << ", " << max_expo << "] !";
+	}
+	m_auto_exposure.setExposureBounds(min_exp_time, max_exp_time);
+}
+
+void Camera::getAutoExposureBounds(double& min_exp_time, double& max_exp_time)
+{
+	DEB_MEMBER_FUNCT();
+	m_auto_exposure.getExposureBounds(min_exp_time, max_exp_time);
+}
+
+void Camera::setAutoExposureDamping(double damping)
+{
+	DEB_MEMBER_FUNCT();
+	m_auto_exposure.setDamping(damping);
+}
+
+void Camera::getAutoExposureDamping(double& damping)
+{
+	DEB_MEMBER_FUNCT();
+	damping = m_auto_exposure.getDamping();
+}
+
+void Camera::setAutoExposureTolerance(double tolerance)
+{
+	DEB_MEMBER_FUNCT();
+	m_auto_exposure.setTolerance(tolerance);
+}
+
+void Camera::getAutoExposureTolerance(double& tolerance)
+{
+	DEB_MEMBER_FUNCT();
+	tolerance = m_auto_exposure.getTolerance();
+}
+
+//-----------------------------------------------------
+// @brief frames ignored after an exposure change (frames already in the camera buffers)
+//-----------------------------------------------------
+void Camera::setAutoExposureSettleFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	m_auto_exposure.setSettleFrames(nb_frames);
+}
+
+void Camera::getAutoExposureSettleFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_auto_exposure.getSettleFrames();
+}
+
+void Camera::getAutoExposureStatus(AutoExposureStatus& status)
+{
+	DEB_MEMBER_FUNCT();
+	m_auto_exposure.getStatus(status);
+}
+
+//-----------------------------------------------------
+// @brief one step of the auto exposure, called from the acquisition thread
+//-----------------------------------------------------
+void Camera::updateAutoExposure()
+{
+	DEB_MEMBER_FUNCT();
+	double current_exp_time, exp_time;
+	{
+		AutoMutex lock(m_cond.mutex());
+		current_exp_time = m_exp_time;
+	}
+	if(!m_auto_exposure.update(m_histogram_data, current_exp_time, exp_time))
+		return;
+
+	//the exposure is changed on the fly, the capture is not restarted
+	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, exp_time * 1000))//TUCAM use (ms), but lima use (second) as unit 
+	{
+		m_parameter_cache.invalidate("TUIDP_EXPOSURETM");
+		DEB_ERROR() << "Auto exposure : unable to Write TUIDP_EXPOSURETM to the camera !";
+		return;
+	}
+	m_parameter_cache.set("TUIDP_EXPOSURETM", exp_time * 1000);
+	DEB_TRACE() << "Auto exposure : " << DEB_VAR2(current_exp_time, exp_time);
+	AutoMutex lock(m_cond.mutex());
+	m_exp_time = exp_time;
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the beam centroid and projections
+//-----------------------------------------------------
+void Camera::setBeamAnalysis(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_beam_analysis.setEnable(enable);
+}
+
+void Camera::getBeamAnalysis(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_beam_analysis.isEnabled();
+}
+
+//-----------------------------------------------------
+// @brief constant background subtracted from each pixel
+//-----------------------------------------------------
+void Camera::setBeamBackground(double background)
+{
+	DEB_MEMBER_FUNCT();
+	m_beam_analysis.setBackground(background);
+}
+
+void Camera::getBeamBackground(double& background)
+{
+	DEB_MEMBER_FUNCT();
+	background = m_beam_analysis.getBackground();
+}
+
+//-----------------------------------------------------
+// @brief pixels below the threshold (after background) are ignored
+//-----------------------------------------------------
+void Camera::setBeamThreshold(double threshold)
+{
+	DEB_MEMBER_FUNCT();
+	m_beam_analysis.setThreshold(threshold);
+}
+
+void Camera::getBeamThreshold(double& threshold)
+{
+	DEB_MEMBER_FUNCT();
+	threshold = m_beam_analysis.getThreshold();
+}
+
+void Camera::setBeamProjections(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	m_beam_analysis.setProjections(enable);
+}
+
+void Camera::getBeamProjections(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_beam_analysis.getProjections();
+}
+
+void Camera::setBeamHistorySize(int size)
+{
+	DEB_MEMBER_FUNCT();
+	m_beam_analysis.setHistorySize(size);
+}
+
+void Camera::getBeamHistorySize(int& size)
+{
+	DEB_MEMBER_FUNCT();
+	size = m_beam_analysis.getHistorySize();
+}
+
+void Camera::registerBeamCallback(BeamResultCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	m_beam_analysis.registerCallback(cb);
+}
+
+void Camera::unregisterBeamCallback(BeamResultCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	m_beam_analysis.unregisterCallback(cb);
+}
+
+//-----------------------------------------------------
+// @brief beam parameters of the last frame, false if none
+//-----------------------------------------------------
+bool Camera::getLastBeamResult(BeamResult& result)
+{
+	DEB_MEMBER_FUNCT();
+	return m_beam_analysis.getLast(result);
+}
+
+void Camera::getBeamHistory(std::vector<BeamResult>& history)
+{
+	DEB_MEMBER_FUNCT();
+	m_beam_analysis.getHistory(history);
+}
+
+//-----------------------------------------------------
+// @brief sum N camera frames into each Bpp32 Lima frame
+//-----------------------------------------------------
+void Camera::setAccumulation(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the frame accumulation during the acquisition !";
+	}
+	if(enable && m_depth == 8)
+	{
+		THROW_HW_ERROR(Error) << "Frame accumulation needs 16 bits pixels, image type is Bpp8 !";
+	}
+	if(enable && (m_hdr_merger.isEnabled() || m_frame_correction.isEnabled()))
+	{
+		THROW_HW_ERROR(Error) << "Frame accumulation can not be used with the HDR merge or the frame correction !";
+	}
+	if(enable == m_frame_accumulator.isEnabled())
+		return;
+	m_frame_accumulator.setEnable(enable);
+	imageTypeChanged();
+}
+
+void Camera::getAccumulation(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_frame_accumulator.isEnabled();
+}
+
+void Camera::setAccumulationNbFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the nb of accumulated frames during the acquisition !";
+	}
+	m_frame_accumulator.setNbFrames(nb_frames);
+}
+
+void Camera::getAccumulationNbFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_frame_accumulator.getNbFrames();
+}
+
+//-----------------------------------------------------
+// @brief subtract the correction offset map from each accumulated frame
+//-----------------------------------------------------
+void Camera::setAccumulationDarkSubtraction(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	if(enable)
+	{
+		std::vector<float> dark;
+		std::vector<float> gain;
+		Size size;
+		m_frame_correction.getMaps(dark, gain, size);
+		if(dark.empty())
+		{
+			THROW_HW_ERROR(Error) << "Dark subtraction needs an offset map (load it or use startDarkAccumulation) !";
+		}
+		m_frame_accumulator.setDark(dark, size);
+	}
+	m_frame_accumulator.setDarkSubtraction(enable);
+}
+
+void Camera::getAccumulationDarkSubtraction(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_frame_accumulator.getDarkSubtraction();
+}
+
+//-----------------------------------------------------
+// @brief enable/disable the binned and averaged live preview
+//-----------------------------------------------------
+void Camera::setPreview(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_live_preview.setEnable(enable);
+}
+
+void Camera::getPreview(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_live_preview.isEnabled();
+}
+
+void Camera::setPreviewMode(LivePreview::Mode mode)
+{
+	DEB_MEMBER_FUNCT();
+	m_live_preview.setMode(mode);
+}
+
+void Camera::getPreviewMode(LivePreview::Mode& mode)
+{
+	DEB_MEMBER_FUNCT();
+	mode = m_live_preview.getMode();
+}
+
+//-----------------------------------------------------
+// @brief weight of the new frame in the exponential mode
+//-----------------------------------------------------
+void Camera::setPreviewAlpha(double alpha)
+{
+	DEB_MEMBER_FUNCT();
+	m_live_preview.setAlpha(alpha);
+}
+
+void Camera::getPreviewAlpha(double& alpha)
+{
+	DEB_MEMBER_FUNCT();
+	alpha = m_live_preview.getAlpha();
+}
+
+void Camera::setPreviewBinning(int bin)
+{
+	DEB_MEMBER_FUNCT();
+	m_live_preview.setBinning(bin);
+}
+
+void Camera::getPreviewBinning(int& bin)
+{
+	DEB_MEMBER_FUNCT();
+	bin = m_live_preview.getBinning();
+}
+
+//-----------------------------------------------------
+// @brief min time between 2 preview images (s)
+//-----------------------------------------------------
+void Camera::setPreviewRefreshPeriod(double period)
+{
+	DEB_MEMBER_FUNCT();
+	m_live_preview.setRefreshPeriod(period);
+}
+
+void Camera::getPreviewRefreshPeriod(double& period)
+{
+	DEB_MEMBER_FUNCT();
+	period = m_live_preview.getRefreshPeriod();
+}
+
+void Camera::resetPreview()
+{
+	DEB_MEMBER_FUNCT();
+	m_live_preview.reset();
+}
+
+//-----------------------------------------------------
+// @brief last preview image (float), false if none
+//-----------------------------------------------------
+bool Camera::getPreviewImage(std::vector<float>& image, Size& size, int& frame_nb, int& nb_averaged)
+{
+	DEB_MEMBER_FUNCT();
+	return m_live_preview.getImage(image, size, frame_nb, nb_averaged);
+}
+
+//-----------------------------------------------------
+// @brief compress a copy of each frame on a pool of threads
+//-----------------------------------------------------
+void Camera::setCompression(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the compression during the acquisition !";
+	}
+	m_frame_compressor.setEnable(enable);
+}
+
+void Camera::getCompression(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_frame_compressor.isEnabled();
+}
+
+void Camera::setCompressionNbThreads(int nb_threads)
+{
+	DEB_MEMBER_FUNCT();
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the nb of compression threads during the acquisition !";
+	}
+	m_frame_compressor.setNbThreads(nb_threads);
+}
+
+void Camera::getCompressionNbThreads(int& nb_threads)
+{
+	DEB_MEMBER_FUNCT();
+	nb_threads = m_frame_compressor.getNbThreads();
+}
+
+//-----------------------------------------------------
+// @brief nb of frames waiting for the compression, the next ones are dropped
+//-----------------------------------------------------
+void Camera::setCompressionQueueDepth(int depth)
+{
+	DEB_MEMBER_FUNCT();
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the compression queue depth during the acquisition !";
+	}
+	m_frame_compressor.setQueueDepth(depth);
+}
+
+void Camera::getCompressionQueueDepth(int& depth)
+{
+	DEB_MEMBER_FUNCT();
+	depth = m_frame_compressor.getQueueDepth();
+}
+
+//-----------------------------------------------------
+// @brief bitshuffle block in pixels, 0 : default of the HDF5 filter
+//-----------------------------------------------------
+void Camera::setCompressionBlockSize(int block_size)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_compressor.setBlockSize(block_size);
+}
+
+void Camera::getCompressionBlockSize(int& block_size)
+{
+	DEB_MEMBER_FUNCT();
+	block_size = m_frame_compressor.getBlockSize();
+}
+
+void Camera::registerCompressedFrameCallback(CompressedFrameCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_compressor.registerCallback(cb);
+}
+
+void Camera::unregisterCompressedFrameCallback(CompressedFrameCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_compressor.unregisterCallback(cb);
+}
+
+void Camera::getCompressionStats(CompressionStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_compressor.getStats(stats);
+}
+
+//-----------------------------------------------------
+// @brief write the frames to <prefix>_<nnnn>.raw/.idx during the acquisitions
+//-----------------------------------------------------
+void Camera::setRecording(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the recording during the acquisition !";
+	}
+	m_stream_recorder.setEnable(enable);
+}
+
+void Camera::getRecording(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_stream_recorder.isEnabled();
+}
+
+void Camera::setRecordingFilePrefix(const std::string& prefix)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(prefix);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the recording file during the acquisition !";
+	}
+	m_stream_recorder.setFilePrefix(prefix);
+}
+
+void Camera::getRecordingFilePrefix(std::string& prefix)
+{
+	DEB_MEMBER_FUNCT();
+	prefix = m_stream_recorder.getFilePrefix();
+}
+
+//-----------------------------------------------------
+// @brief nb of frame buffers, i.e. max nb of writes in flight
+//-----------------------------------------------------
+void Camera::setRecordingNbBuffers(int nb_buffers)
+{
+	DEB_MEMBER_FUNCT();
+	m_stream_recorder.setNbBuffers(nb_buffers);
+}
+
+void Camera::getRecordingNbBuffers(int& nb_buffers)
+{
+	DEB_MEMBER_FUNCT();
+	nb_buffers = m_stream_recorder.getNbBuffers();
+}
+
+//-----------------------------------------------------
+// @brief file growth (frames) in continuous acquisition
+//-----------------------------------------------------
+void Camera::setRecordingPreallocationStep(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	m_stream_recorder.setPreallocationStep(nb_frames);
+}
+
+void Camera::getRecordingPreallocationStep(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_stream_recorder.getPreallocationStep();
+}
+
+void Camera::getRecordingStats(RecordingStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+	m_stream_recorder.getStats(stats);
 }
 
 //-----------------------------------------------------
-//
+// @brief name of a recording without extension, <name>.raw is mapped
 //-----------------------------------------------------
-void Camera::getImageType(ImageType& type)
+void Camera::setReplayFile(const std::string& name)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Fix the image type (pixel depth) into Driver/API		
-	switch(m_depth)
+	DEB_PARAM() << DEB_VAR1(name);
+	if(isAcqRunning())
 	{
-		case 16: type = Bpp16;
-			break;
-		default:
-			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 16 bits cameras are already managed!";
-			break;
+		THROW_HW_ERROR(Error) << "Unable to change the replay file during the acquisition !";
 	}
-	//@END	
-	return;
+	if(name.empty())
+	{
+		m_replay = false;
+		m_replay_source.close();
+		return;
+	}
+	m_replay_source.open(name);
+}
+
+void Camera::getReplayFile(std::string& name)
+{
+	DEB_MEMBER_FUNCT();
+	name = m_replay_source.getName();
 }
 
 //-----------------------------------------------------
-//
+// @brief the acquisitions read the replay file instead of the camera
 //-----------------------------------------------------
-void Camera::setImageType(ImageType type)
+void Camera::setReplay(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setImageType - " << DEB_VAR1(type);
-	//@BEGIN : Fix the image type (pixel depth) into Driver/API	
-	switch(type)
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
 	{
-		case Bpp16:
-			m_depth = 16;
-			break;
-		default:
-			THROW_HW_ERROR(Error) << "This pixel format of the camera is not managed, only 16 bits cameras are already managed!";
-			break;
+		THROW_HW_ERROR(Error) << "Unable to change the replay during the acquisition !";
 	}
-	//@END	
+	if(enable && !m_replay_source.isOpen())
+	{
+		THROW_HW_ERROR(Error) << "No replay file is opened !";
+	}
+	m_replay = enable;
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::getDetectorType(std::string& type)
+void Camera::getReplay(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Detector type from Driver/API
-	type = "Tucsen - Dhyana";
-	//@END	
+	enable = m_replay;
+}
 
+void Camera::setReplayTiming(ReplaySource::Timing timing)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(timing);
+	m_replay_source.setTiming(timing);
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::getDetectorModel(std::string& model)
+void Camera::getReplayTiming(ReplaySource::Timing& timing)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Detector model/type from Driver/API
-	stringstream ss;
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_CAMERA_MODEL;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_CAMERA_MODEL from the camera !";
-	}
-	ss << valInfo.pText;
-	model = ss.str();
-	//@END		
+	timing = m_replay_source.getTiming();
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::getDetectorImageSize(Size& size)
+void Camera::setReplayLoop(bool loop)
 {
 	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(loop);
+	m_replay_source.setLoop(loop);
+}
 
-	//@BEGIN : Get Detector size in pixels from Driver/API
-	std::string model="UNKNOWN";
-	getDetectorModel(model);
-	if (model == "Dhyana 95"  || model.find("Dhyana 95 V2") != std::string::npos)
-	{
-		size = Size(PIXEL_NB_WIDTH_MODEL_95, PIXEL_NB_HEIGHT_MODEL_95);
-	}
-	else if (model.find("4040") != std::string::npos)
-	{
-		size = Size(PIXEL_NB_WIDTH_MODEL_4040, PIXEL_NB_HEIGHT_MODEL_4040);
-	}	
-	else
-	{
-		THROW_HW_ERROR(NotSupported) << model;
-	}
-	//@END
+void Camera::getReplayLoop(bool& loop)
+{
+	DEB_MEMBER_FUNCT();
+	loop = m_replay_source.getLoop();
+}
+
+void Camera::getReplayNbFrames(int& nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	nb_frames = m_replay_source.getNbFrames();
 }
 
 //-----------------------------------------------------
-//
+// @brief the frames are copied in a ring mapped by the SharedFrameReader clients
 //-----------------------------------------------------
-void Camera::getPixelSize(double& sizex, double& sizey)
+void Camera::setSharedMemory(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : Get Pixels size in micron from Driver/API	
-	std::string model="UNKNOWN";
-	getDetectorModel(model);	
-	if (model == "Dhyana 95"  || model.find("Dhyana 95 V2") != std::string::npos)
-	{
-		sizex = PIXEL_SIZE_WIDTH_MICRON_MODEL_95;
-		sizey = PIXEL_SIZE_HEIGHT_MICRON_MODEL_95;
-	}
-	else if (model.find("4040") != std::string::npos)
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
 	{
-		sizex=PIXEL_SIZE_WIDTH_MICRON_MODEL_4040;
-		sizey=PIXEL_SIZE_HEIGHT_MICRON_MODEL_4040;
+		THROW_HW_ERROR(Error) << "Unable to change the shared memory during the acquisition !";
 	}
-	else
-	{
-		THROW_HW_ERROR(NotSupported) << model;
-	}	
-	//@END
+	m_frame_publisher.setEnable(enable);
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-HwBufferCtrlObj* Camera::getBufferCtrlObj()
+void Camera::getSharedMemory(bool& enable)
 {
-	return &m_bufferCtrlObj;
+	DEB_MEMBER_FUNCT();
+	enable = m_frame_publisher.isEnabled();
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-bool Camera::checkTrigMode(TrigMode mode)
+void Camera::setSharedMemoryName(const std::string& name)
 {
 	DEB_MEMBER_FUNCT();
-	bool valid_mode;
-	//@BEGIN
-	switch(mode)
+	DEB_PARAM() << DEB_VAR1(name);
+	if(isAcqRunning())
 	{
-		case IntTrig:
-		case IntTrigMult:
-		case ExtTrigMult:
-		case ExtGate:
-			valid_mode = true;
-			break;
-		case ExtTrigReadout:
-		case ExtTrigSingle:
-		default:
-			valid_mode = false;
-			break;
+		THROW_HW_ERROR(Error) << "Unable to change the shared memory name during the acquisition !";
 	}
-	//@END
-	return valid_mode;
+	m_frame_publisher.setName(name);
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::setTrigMode(TrigMode mode)
+void Camera::getSharedMemoryName(std::string& name)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setTrigMode() " << DEB_VAR1(mode);
-	DEB_PARAM() << DEB_VAR1(mode);
-	//@BEGIN
-	m_tgrAttr->nTgrMode = -1;//NOT DEFINED (see below)
-	m_tgrAttr->nFrames = 1;
-	m_tgrAttr->nDelayTm = 0;
-	m_tgrAttr->nExpMode = -1;//NOT DEFINED (see below)
-	m_tgrAttr->nEdgeMode = TUCTD_RISING;
+	name = m_frame_publisher.getName();
+}
 
-	switch(mode)
+void Camera::setSharedMemoryNbSlots(int nb_slots)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_slots);
+	if(isAcqRunning())
 	{
-		case IntTrig:
-			m_tgrAttr->nTgrMode = TUCCM_TRIGGER_SOFTWARE;
-			m_tgrAttr->nExpMode = TUCTE_EXPTM;
-			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, *m_tgrAttr);
-			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_SOFTWARE (EXPOSURE SOFTWARE)";
-			break;
-		case IntTrigMult:
-			m_tgrAttr->nTgrMode = TUCCM_TRIGGER_SOFTWARE;
-			m_tgrAttr->nExpMode = TUCTE_EXPTM;
-			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, *m_tgrAttr);
-			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_SOFTWARE (EXPOSURE SOFTWARE) (MULTI)";
-			break;			
-		case ExtTrigMult:
-			m_tgrAttr->nTgrMode = TUCCM_TRIGGER_STANDARD;
-			m_tgrAttr->nExpMode = TUCTE_EXPTM;
-			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, *m_tgrAttr);
-			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_STANDARD (EXPOSURE SOFTWARE: "<<m_tgrAttr->nExpMode<<")";
-			break;
-		case ExtGate:		
-			m_tgrAttr->nTgrMode = TUCCM_TRIGGER_STANDARD;
-			m_tgrAttr->nExpMode = TUCTE_WIDTH;
-			TUCAM_Cap_SetTrigger(m_opCam.hIdxTUCam, *m_tgrAttr);
-			DEB_TRACE() << "TUCAM_Cap_SetTrigger : TUCCM_TRIGGER_STANDARD (EXPOSURE TRIGGER WIDTH: "<<m_tgrAttr->nExpMode<<")";
-			break;			
-		case ExtTrigSingle:		
-		case ExtTrigReadout:
-		default:
-			THROW_HW_ERROR(NotSupported) << DEB_VAR1(mode);
+		THROW_HW_ERROR(Error) << "Unable to change the shared memory nb of slots during the acquisition !";
 	}
-	m_trigger_mode = mode;
-	//@END
+	m_frame_publisher.setNbSlots(nb_slots);
+}
+
+void Camera::getSharedMemoryNbSlots(int& nb_slots)
+{
+	DEB_MEMBER_FUNCT();
+	nb_slots = m_frame_publisher.getNbSlots();
+}
 
+void Camera::getSharedMemoryStats(SharedMemoryStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_publisher.getStats(stats);
 }
 
 //-----------------------------------------------------
-//
+// @brief the server runs between the acquisitions, the subscribers stay connected
 //-----------------------------------------------------
-void Camera::getTrigMode(TrigMode& mode)
+void Camera::setStreaming(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	mode = m_trigger_mode;
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the streaming during the acquisition !";
+	}
+	m_frame_stream_server.setEnable(enable);
 }
 
-void Camera::getTriggerMode(TucamTriggerMode &mode)
+void Camera::getStreaming(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-	mode = m_tucam_trigger_mode;
+	enable = m_frame_stream_server.isEnabled();
 }
 
-void Camera::setTriggerMode(TucamTriggerMode mode)
+void Camera::setStreamingPort(int port)
 {
 	DEB_MEMBER_FUNCT();
-	m_tucam_trigger_mode = mode;
+	DEB_PARAM() << DEB_VAR1(port);
+	m_frame_stream_server.setPort(port);
 }
 
-void Camera::getTriggerEdge(TucamTriggerEdge &edge)
+void Camera::getStreamingPort(int& port)
 {
 	DEB_MEMBER_FUNCT();
-	edge = m_tucam_trigger_edge_mode;
+	port = m_frame_stream_server.getPort();
 }
 
-void Camera::setTriggerEdge(TucamTriggerEdge edge)
+void Camera::setStreamingAddress(const std::string& address)
 {
 	DEB_MEMBER_FUNCT();
-	m_tucam_trigger_edge_mode = edge;
+	DEB_PARAM() << DEB_VAR1(address);
+	m_frame_stream_server.setAddress(address);
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::getExpTime(double& exp_time)
+void Camera::getStreamingAddress(std::string& address)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	double dbVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, &dbVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_EXPOSURETM from the camera !";
-	}
-	m_exp_time = dbVal / 1000;//TUCAM use (ms), but lima use (second) as unit 
-	//@END
-	exp_time = m_exp_time;
-	DEB_RETURN() << DEB_VAR1(exp_time);
+	address = m_frame_stream_server.getAddress();
 }
 
 //-----------------------------------------------------
-//
+// @brief raw frames or bitshuffle/LZ4 chunks
 //-----------------------------------------------------
-void Camera::setExpTime(double exp_time)
+void Camera::setStreamingEncoding(FrameStreamServer::Encoding encoding)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setExpTime() " << DEB_VAR1(exp_time);
-	//@BEGIN
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_EXPOSURETM, exp_time * 1000))//TUCAM use (ms), but lima use (second) as unit 
-	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_EXPOSURETM to the camera !";
-	}
-	//@END
-	m_exp_time = exp_time;
+	DEB_PARAM() << DEB_VAR1(encoding);
+	m_frame_stream_server.setEncoding(encoding);
 }
 
+void Camera::getStreamingEncoding(FrameStreamServer::Encoding& encoding)
+{
+	DEB_MEMBER_FUNCT();
+	encoding = m_frame_stream_server.getEncoding();
+}
 
 //-----------------------------------------------------
-//
+// @brief defaults of the subscribers that do not send a StreamSubscription
 //-----------------------------------------------------
-void Camera::setLatTime(double lat_time)
+void Camera::setStreamingDropPolicy(FrameStreamServer::DropPolicy policy)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setLatTime() " << DEB_VAR1(lat_time);
-	m_lat_time = lat_time;
+	DEB_PARAM() << DEB_VAR1(policy);
+	m_frame_stream_server.setDropPolicy(policy);
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::getLatTime(double& lat_time)
+void Camera::getStreamingDropPolicy(FrameStreamServer::DropPolicy& policy)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	//@END
-	m_lat_time = lat_time;
-	DEB_RETURN() << DEB_VAR1(lat_time);
+	policy = m_frame_stream_server.getDropPolicy();
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::getExposureTimeRange(double& min_expo, double& max_expo) const
+void Camera::setStreamingQueueDepth(int depth)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	min_expo = 0.;
-	max_expo = 10;//10s
-	//@END
-	DEB_RETURN() << DEB_VAR2(min_expo, max_expo);
+	DEB_PARAM() << DEB_VAR1(depth);
+	m_frame_stream_server.setQueueDepth(depth);
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------
-void Camera::getLatTimeRange(double& min_lat, double& max_lat) const
+void Camera::getStreamingQueueDepth(int& depth)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN
-	// --- no info on min latency
-	min_lat = 0.;
-	// --- do not know how to get the max_lat, fix it as the max exposure time
-	max_lat = 10;//10s
-	//@END
-	DEB_RETURN() << DEB_VAR2(min_lat, max_lat);
+	depth = m_frame_stream_server.getQueueDepth();
+}
+
+void Camera::getStreamingStats(StreamingStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+	m_frame_stream_server.getStats(stats);
 }
 
 //-----------------------------------------------------
-//
+// @brief the IntTrig triggers are sent by softwareTrigger() instead of the internal timer
 //-----------------------------------------------------
-void Camera::setNbFrames(int nb_frames)
+void Camera::setGroupTrigger(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setNbFrames() " << DEB_VAR1(nb_frames);
-	//@BEGIN
-	if(nb_frames < 0)
-	{
-		THROW_HW_ERROR(Error) << "Number of frames to acquire has not been set";
-	}
-	if(nb_frames > 1)
+	DEB_PARAM() << DEB_VAR1(enable);
+	if(isAcqRunning())
 	{
-		//THROW_HW_ERROR(Error) << "Unable to acquire more than 1 frame ! ";	//T@D@ allowed only for test 
+		THROW_HW_ERROR(Error) << "Unable to change the group trigger during the acquisition !";
 	}
-	//@END
-	m_nb_frames = nb_frames;
+	m_group_trigger = enable;
+}
+
+void Camera::getGroupTrigger(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_group_trigger;
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getNbFrames(int& nb_frames)
+void Camera::softwareTrigger()
 {
-	DEB_MEMBER_FUNCT();
-	DEB_RETURN() << DEB_VAR1(m_nb_frames);
-	//@BEGIN
-	//@END
-	nb_frames = m_nb_frames;
+	//the trigger is lost while reconnecting
+	if(!useHandle())
+		return;
+	TUCAM_Cap_DoSoftwareTrigger(m_opCam.hIdxTUCam);
+	releaseHandle();
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-int Camera::getNbHwAcquiredFrames()
+void Camera::registerFrameCallback(CameraFrameCallback& cb)
 {
 	DEB_MEMBER_FUNCT();
-	return m_acq_frame_nb;
+	AutoMutex lock(m_frame_callback_mutex);
+	if(m_frame_callback)
+	{
+		THROW_HW_ERROR(Error) << "A frame callback is already registered !";
+	}
+	m_frame_callback = &cb;
 }
 
-//-----------------------------------------------------
-// @brief range the binning to the maximum allowed
-//-----------------------------------------------------
-void Camera::checkBin(Bin &hw_bin)
+void Camera::unregisterFrameCallback(CameraFrameCallback& cb)
 {
 	DEB_MEMBER_FUNCT();
-
-	//@BEGIN : check available values of binning H/V
-	int x = hw_bin.getX();
-	int y = hw_bin.getY();
-	if(x != 1 || y != 1)
+	AutoMutex lock(m_frame_callback_mutex);
+	if(m_frame_callback != &cb)
 	{
-		DEB_ERROR() << "Binning values not supported";
-		THROW_HW_ERROR(Error) << "Binning values not supported = " << DEB_VAR1(hw_bin);
+		THROW_HW_ERROR(Error) << "This frame callback is not registered !";
 	}
-	//@END
-
-	hw_bin = Bin(x, y);
-	DEB_RETURN() << DEB_VAR1(hw_bin);
+	m_frame_callback = NULL;
 }
+
 //-----------------------------------------------------
-// @brief set the new binning mode
+// plugin stages saved in the profiles
 //-----------------------------------------------------
-void Camera::setBin(const Bin &set_bin)
+struct ProfileStage
 {
-	DEB_MEMBER_FUNCT();
+	const char* key;
+	void (Camera::*get)(bool&);
+	void (Camera::*set)(bool);
+};
 
-	//@BEGIN : set binning H/V to the Driver/API
-	//...
-	//@END
-	m_bin = set_bin;
+static const ProfileStage PROFILE_STAGES[] =
+{
+	{"hdr_merge",			&Camera::getHdrMerge,			&Camera::setHdrMerge},
+	{"correction",			&Camera::getCorrection,			&Camera::setCorrection},
+	{"defect_correction",	&Camera::getDefectCorrection,	&Camera::setDefectCorrection},
+	{"statistics",			&Camera::getStatistics,			&Camera::setStatistics},
+	{"histogram",			&Camera::getHistogram,			&Camera::setHistogram},
+	{"auto_exposure",		&Camera::getAutoExposure,		&Camera::setAutoExposure},
+	{"beam_analysis",		&Camera::getBeamAnalysis,		&Camera::setBeamAnalysis},
+	{"accumulation",		&Camera::getAccumulation,		&Camera::setAccumulation},
+	{"preview",				&Camera::getPreview,			&Camera::setPreview},
+	{"compression",			&Camera::getCompression,		&Camera::setCompression},
+	{"recording",			&Camera::getRecording,			&Camera::setRecording},
+	{"shared_memory",		&Camera::getSharedMemory,		&Camera::setSharedMemory},
+	{"streaming",			&Camera::getStreaming,			&Camera::setStreaming}
+};
+static const int NB_PROFILE_STAGES = sizeof(PROFILE_STAGES) / sizeof(PROFILE_STAGES[0]);
 
-	DEB_RETURN() << DEB_VAR1(set_bin);
+//-----------------------------------------------------
+// @brief the values are compared as written in the profiles
+//-----------------------------------------------------
+static std::string profileValue(double value)
+{
+	std::ostringstream os;
+	os << std::setprecision(12) << value;
+	return os.str();
 }
 
 //-----------------------------------------------------
-// @brief return the current binning mode
+//
 //-----------------------------------------------------
-void Camera::getBin(Bin &hw_bin)
+void Camera::setProfileDirectory(const std::string& directory)
 {
 	DEB_MEMBER_FUNCT();
+	m_profile_store.setDirectory(directory);
+}
 
-	//@BEGIN : get binning from Driver/API
-	int bin_x = 1;
-	int bin_y = 1;
-	//@END
-	Bin tmp_bin(bin_x, bin_y);
-
-	hw_bin = tmp_bin;
-	m_bin = tmp_bin;
-
-	DEB_RETURN() << DEB_VAR1(hw_bin);
+void Camera::getProfileDirectory(std::string& directory)
+{
+	DEB_MEMBER_FUNCT();
+	directory = m_profile_store.getDirectory();
 }
 
 //-----------------------------------------------------
-//! Camera::checkRoi()
+// @brief the settings are taken from the cached values, the camera is not read
 //-----------------------------------------------------
-void Camera::checkRoi(const Roi& set_roi, Roi& hw_roi)
+void Camera::saveProfile(const std::string& name, bool camera_side)
 {
 	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "checkRoi";
-	DEB_PARAM() << DEB_VAR1(set_roi);
-	//@BEGIN : check available values of Roi
-	if(set_roi.isActive())
-	{	
-		if ((set_roi.getSize().getWidth() % 4 != 0)     ||
-			(set_roi.getSize().getHeight() % 4 != 0)    ||
-			(set_roi.getTopLeft().x % 4 != 0)           ||
-			(set_roi.getTopLeft().y % 4 != 0))           
-		{
-			THROW_HW_ERROR(Error) << "Roi coordinates (x, y, width, height) must respect some constraints:\n"
-								  << " - x must be a multiple of 4 \n"
-								  << " - y must be a multiple of 4 \n"
-								  << " - width must be a multiple of 4 \n"
-								  << " - height must be a multiple of 4 \n";
-		}     
-		hw_roi = set_roi;
-	}
-	else
+	DEB_PARAM() << DEB_VAR2(name, camera_side);
+	ProfileStore::checkName(name);
+	ProfileValues values;
 	{
-		hw_roi = set_roi;
+		AutoMutex lock(m_cond.mutex());
+		checkInit();
+		captureProfile(values);
+		if(camera_side)
+		{
+			//the SDK takes a non const name
+			std::vector<char> prf_name(name.begin(), name.end());
+			prf_name.push_back('\0');
+			if(TUCAMRET_SUCCESS != TUCAM_File_SaveProfiles(m_opCam.hIdxTUCam, &prf_name[0]))
+			{
+				THROW_HW_ERROR(Error) << "Unable to save the profile " << name << " in the camera !";
+			}
+		}
 	}
-	//@END
-
-
-	DEB_RETURN() << DEB_VAR1(hw_roi);
+	values["camera_profile"] = camera_side ? "1" : "0";
+	m_profile_store.save(name, values);
 }
 
-//---------------------------------------------------------------------------------------
-//! Camera::getRoi()
-//---------------------------------------------------------------------------------------
-void Camera::getRoi(Roi& hw_roi)
+//-----------------------------------------------------
+// @brief the camera profile is loaded first (bulk), then only the changed settings are written
+//-----------------------------------------------------
+void Camera::applyProfile(const std::string& name)
 {
 	DEB_MEMBER_FUNCT();
-	//@BEGIN : get Roi from the Driver/API
-	TUCAM_ROI_ATTR roiAttr;
-	if(TUCAMRET_SUCCESS != TUCAM_Cap_GetROI(m_opCam.hIdxTUCam, &roiAttr))
+	DEB_PARAM() << DEB_VAR1(name);
+	Timestamp t0 = Timestamp::now();
+	ProfileValues target;
+	if(!m_profile_store.load(name, target))
 	{
-		THROW_HW_ERROR(Error) << "Unable to GetRoi from  the camera !";
+		THROW_HW_ERROR(Error) << "Unknown profile " << name << " !";
 	}
-	hw_roi = Roi(roiAttr.nHOffset,
-				roiAttr.nVOffset,
-				roiAttr.nWidth,
-				roiAttr.nHeight);
-	//@END
 
-	DEB_RETURN() << DEB_VAR1(hw_roi);
-}
+	AutoMutex lock(m_cond.mutex());
+	checkInit();
+	if(m_thread_running || NULL != m_hThdEvent)
+	{
+		THROW_HW_ERROR(Error) << "Unable to apply a profile during the acquisition !";
+	}
 
-//---------------------------------------------------------------------------------------
-//! Camera::setRoi()
-//---------------------------------------------------------------------------------------
-void Camera::setRoi(const Roi& set_roi)
-{
-	DEB_MEMBER_FUNCT();
-	DEB_TRACE() << "setRoi";
-	DEB_PARAM() << DEB_VAR1(set_roi);
-	//@BEGIN : set Roi from the Driver/API	
-	if(!set_roi.isActive())
+	//all the values are checked before anything is written
+	double v[4];
+	ProfileValues current;
+	captureProfile(current);
+	ProfileValues::const_iterator camera_profile = target.find("camera_profile");
+	bool camera_side = (camera_profile != target.end() && camera_profile->second == "1");
+
+	//the roi is set by Lima (CtImage), a profile can not change it underneath
+	if(profileChanged(target, current, "roi", v, 4))
 	{
-		DEB_TRACE() << "Roi is not Enabled : so set full frame";
+		THROW_HW_ERROR(Error) << "Profile " << name << " has an other roi (" << target["roi"]
+							  << "), the roi must be set through Lima before the profile is applied !";
+	}
+	int depth = m_depth;
+	bool depth_changed = profileChanged(target, current, "image_depth", v, 1);
+	if(depth_changed)
+	{
+		depth = (int) v[0];
+		if(depth != 8 && depth != 12 && depth != 16)
+		{
+			THROW_HW_ERROR(Error) << "Invalid image depth " << depth << " in the profile !";
+		}
+	}
 
-		//set Roi to Driver/API
-		Size size;
-		getDetectorImageSize(size);
-		TUCAM_ROI_ATTR roiAttr;
-		roiAttr.bEnable = TRUE;
-		roiAttr.nHOffset = 0;
-		roiAttr.nVOffset = 0;
-		roiAttr.nWidth = size.getWidth();
-		roiAttr.nHeight = size.getHeight();
+	bool stage_changed[NB_PROFILE_STAGES];
+	bool stage_enabled[NB_PROFILE_STAGES];
+	bool hdr = false, correction = false, accumulation = false;
+	for(int i = 0; i < NB_PROFILE_STAGES; i++)
+	{
+		std::string key = PROFILE_STAGES[i].key;
+		stage_changed[i] = profileChanged(target, current, key.c_str(), v, 1);
+		stage_enabled[i] = stage_changed[i] ? (v[0] != 0.) : (current[key] == "1");
+		if(key == "hdr_merge")
+			hdr = stage_enabled[i];
+		else if(key == "correction")
+			correction = stage_enabled[i];
+		else if(key == "accumulation")
+			accumulation = stage_enabled[i];
+	}
+	if(hdr && depth != 16)
+	{
+		THROW_HW_ERROR(Error) << "HDR merge needs 16 bits readouts, the profile image depth is " << depth << " !";
+	}
+	if((correction || accumulation) && depth == 8)
+	{
+		THROW_HW_ERROR(Error) << "Frame correction and accumulation need 16 bits pixels, the profile image depth is 8 !";
+	}
+	if((correction && hdr) || (accumulation && (hdr || correction)))
+	{
+		THROW_HW_ERROR(Error) << "Profile " << name << " enables processing stages which can not be used together !";
+	}
+	int accumulation_nb_frames = 0;
+	bool accumulation_changed = profileChanged(target, current, "accumulation_nb_frames", v, 1);
+	if(accumulation_changed)
+	{
+		accumulation_nb_frames = (int) v[0];
+		if(accumulation_nb_frames < 1 || accumulation_nb_frames > 65536)
+		{
+			THROW_HW_ERROR(Error) << "Number of accumulated frames must be in [1, 65536] !";
+		}
+	}
+
+	bool exp_time_changed = profileChanged(target, current, "exp_time", v, 1);
+	double exp_time = v[0];
+	bool lat_time_changed = profileChanged(target, current, "lat_time", v, 1);
+	double lat_time = v[0];
+	bool gain_changed = profileChanged(target, current, "global_gain", v, 1);
+	unsigned gain = (unsigned) v[0];
+	bool fan_speed_changed = profileChanged(target, current, "fan_speed", v, 1);
+	unsigned fan_speed = (unsigned) v[0];
+	bool tec_mode_changed = profileChanged(target, current, "tec_mode", v, 1);
+	unsigned tec_mode = (unsigned) v[0];
+	bool temperature_changed = profileChanged(target, current, "temperature_target", v, 1);
+	double temperature = v[0];
+	if(exp_time_changed && exp_time < 0.)
+	{
+		THROW_HW_ERROR(Error) << "Invalid exposure time " << exp_time << " in the profile !";
+	}
 
-		if(TUCAMRET_SUCCESS != TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr))
+	//the trigger settings are written together by one TUCAM_Cap_SetTrigger
+	bool trigger_changed = false;
+	TrigMode trig_mode = m_trigger_mode;
+	TucamTriggerMode trigger_mode = m_tucam_trigger_mode;
+	TucamTriggerEdge trigger_edge = m_tucam_trigger_edge_mode;
+	int trigger_delay = m_tucam_trigger_delay;
+	int trigger_buf_frames = m_tucam_trigger_buf_frames;
+	int burst_frames = m_burst_frames;
+	if(profileChanged(target, current, "trig_mode", v, 1))
+	{
+		trig_mode = (TrigMode) (int) v[0];
+		if(!checkTrigMode(trig_mode))
 		{
-			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
+			THROW_HW_ERROR(Error) << "Invalid trig mode " << trig_mode << " in the profile !";
+		}
+		trigger_changed = true;
+	}
+	if(profileChanged(target, current, "trigger_mode", v, 1))
+	{
+		int mode = (int) v[0];
+		if(mode != kTriggerStandard && mode != kTriggerSynchronous && mode != kTriggerGlobal)
+		{
+			THROW_HW_ERROR(Error) << "Invalid trigger mode " << mode << " in the profile !";
+		}
+		trigger_mode = (TucamTriggerMode) mode;
+		trigger_changed = true;
+	}
+	if(profileChanged(target, current, "trigger_edge", v, 1))
+	{
+		int edge = (int) v[0];
+		if(edge != kEdgeRising && edge != kEdgeFalling)
+		{
+			THROW_HW_ERROR(Error) << "Invalid trigger edge " << edge << " in the profile !";
+		}
+		trigger_edge = (TucamTriggerEdge) edge;
+		trigger_changed = true;
+	}
+	if(profileChanged(target, current, "trigger_delay", v, 1))
+	{
+		if(v[0] < 0)
+		{
+			THROW_HW_ERROR(Error) << "Trigger delay must be positive !";
+		}
+		trigger_delay = (int) v[0];
+		trigger_changed = true;
+	}
+	if(profileChanged(target, current, "trigger_buf_frames", v, 1))
+	{
+		if(v[0] < 1)
+		{
+			THROW_HW_ERROR(Error) << "Number of buffered frames must be at least 1 !";
+		}
+		trigger_buf_frames = (int) v[0];
+		trigger_changed = true;
+	}
+	if(profileChanged(target, current, "burst_frames", v, 1))
+	{
+		if(v[0] < 1)
+		{
+			THROW_HW_ERROR(Error) << "Burst size must be at least 1 !";
 		}
+		burst_frames = (int) v[0];
+		trigger_changed = true;
+	}
 
+	bool output_changed[3];
+	double outputs_values[3][4];
+	for(int port = 0; port < 3; port++)
+	{
+		std::ostringstream key;
+		key << "output_signal_" << port;
+		output_changed[port] = profileChanged(target, current, key.str().c_str(), outputs_values[port], 4);
 	}
-	else
+
+	//a failure of the camera leaves the profile partly applied, it is recorded in the stats
+	int nb_written = 0;
+	m_profile_stats.name = name;
+	m_profile_stats.camera_side = camera_side;
+	m_profile_stats.nb_values = (int) target.size();
+	m_profile_stats.error.clear();
+	try
 	{
-		DEB_TRACE() << "Roi is Enabled";
-		//set Roi to Driver/API
-		TUCAM_ROI_ATTR roiAttr;
-		roiAttr.bEnable = TRUE;
-		roiAttr.nHOffset = set_roi.getTopLeft().x;
-		roiAttr.nVOffset = set_roi.getTopLeft().y;
-		roiAttr.nWidth = set_roi.getSize().getWidth();
-		roiAttr.nHeight = set_roi.getSize().getHeight();
+		if(camera_side)
+		{
+			std::vector<char> prf_name(name.begin(), name.end());
+			prf_name.push_back('\0');
+			if(TUCAMRET_SUCCESS != TUCAM_File_LoadProfiles(m_opCam.hIdxTUCam, &prf_name[0]))
+			{
+				THROW_HW_ERROR(Error) << "Unable to load the profile " << name << " from the camera !";
+			}
+			nb_written++;
+			//the settings loaded by the camera are read back, the ones which differ are written below
+			m_parameter_cache.invalidate();
+			getExpTime(m_exp_time);
+			getGlobalGain(m_global_gain);
+			exp_time_changed = exp_time_changed || target.count("exp_time");
+			gain_changed = gain_changed || target.count("global_gain");
+			//the roi of the camera profile is the one of Lima, checked above
+			setRoi(m_hw_roi);
+		}
 
-		if(TUCAMRET_SUCCESS != TUCAM_Cap_SetROI(m_opCam.hIdxTUCam, roiAttr))
+		//the stages are disabled first, some of them can not be used with the image type of the profile
+		for(int i = 0; i < NB_PROFILE_STAGES; i++)
 		{
-			THROW_HW_ERROR(Error) << "Unable to SetRoi to the camera !";
+			if(stage_changed[i] && !stage_enabled[i])
+			{
+				(this->*PROFILE_STAGES[i].set)(false);
+				nb_written++;
+			}
+		}
+		if(depth_changed)
+		{
+			setImageType((depth == 8) ? Bpp8 : (depth == 12) ? Bpp12 : Bpp16);
+			nb_written++;
+		}
+		if(exp_time_changed)
+		{
+			setExpTime(exp_time);
+			nb_written++;
+		}
+		if(lat_time_changed)
+		{
+			setLatTime(lat_time);
+			nb_written++;
+		}
+		if(gain_changed)
+		{
+			setGlobalGain(gain);
+			nb_written++;
+		}
+		if(fan_speed_changed)
+		{
+			setFanSpeed(fan_speed);
+			nb_written++;
+		}
+		if(tec_mode_changed)
+		{
+			setTecMode(tec_mode);
+			nb_written++;
+		}
+		if(temperature_changed)
+		{
+			setTemperatureTarget(temperature);
+			nb_written++;
+		}
+		if(trigger_changed)
+		{
+			m_tucam_trigger_mode = trigger_mode;
+			m_tucam_trigger_edge_mode = trigger_edge;
+			m_tucam_trigger_delay = trigger_delay;
+			m_tucam_trigger_buf_frames = trigger_buf_frames;
+			m_burst_frames = burst_frames;
+			setTrigMode(trig_mode);
+			nb_written++;
+		}
+
+		TUCAM_TRGOUT_ATTR* outputs[3] = {&m_tgroutAttr1, &m_tgroutAttr2, &m_tgroutAttr3};
+		for(int port = 0; port < 3; port++)
+		{
+			if(!output_changed[port])
+				continue;
+			outputs[port]->nTgrOutMode = (int) outputs_values[port][0];
+			outputs[port]->nEdgeMode = (int) outputs_values[port][1];
+			outputs[port]->nDelayTm = (int) outputs_values[port][2];
+			outputs[port]->nWidth = (int) outputs_values[port][3];
+			std::stringstream cache_key, cache_value;
+			cache_key << "TRGOUT_" << port;
+			cache_value << outputs[port]->nTgrOutMode << " " << outputs[port]->nEdgeMode << " "
+						<< outputs[port]->nDelayTm << " " << outputs[port]->nWidth;
+			if(TUCAMRET_SUCCESS != TUCAM_Cap_SetTriggerOut(m_opCam.hIdxTUCam, *outputs[port]))
+			{
+				m_parameter_cache.invalidate(cache_key.str());
+				THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
+			}
+			m_parameter_cache.set(cache_key.str(), cache_value.str());
+			nb_written++;
+		}
+
+		if(accumulation_changed)
+		{
+			setAccumulationNbFrames(accumulation_nb_frames);
+			nb_written++;
+		}
+		for(int i = 0; i < NB_PROFILE_STAGES; i++)
+		{
+			if(stage_changed[i] && stage_enabled[i])
+			{
+				(this->*PROFILE_STAGES[i].set)(true);
+				nb_written++;
+			}
 		}
 	}
-	//@END	
+	catch(Exception& e)
+	{
+		m_profile_stats.nb_written = nb_written;
+		m_profile_stats.duration = Timestamp::now() - t0;
+		m_profile_stats.error = e.getErrMsg();
+		DEB_ERROR() << "Profile " << name << " partly applied (" << nb_written << " settings written) : " << m_profile_stats.error;
+		if(depth_changed && m_depth == depth)
+			imageTypeChanged();
+		throw;
+	}
+	//Lima is told about the new image type (max image size callback)
+	if(depth_changed)
+		imageTypeChanged();
+
+	m_profile_stats.nb_written = nb_written;
+	m_profile_stats.duration = Timestamp::now() - t0;
+	DEB_TRACE() << "Profile " << name << " applied in " << (int) (m_profile_stats.duration * 1000) << " (ms) : "
+				<< nb_written << " settings written";
 }
 
 //-----------------------------------------------------
-//
+// @brief the profile stored in the camera is not removed, it is overwritten by the next save
 //-----------------------------------------------------
-bool Camera::isAcqRunning() const
+void Camera::deleteProfile(const std::string& name)
 {
 	DEB_MEMBER_FUNCT();
-	//	AutoMutex aLock(m_cond.mutex());
-	DEB_TRACE() << "isAcqRunning - " << DEB_VAR1(m_thread_running) << "---------------------------";
-	return m_thread_running;
+	m_profile_store.remove(name);
 }
 
-///////////////////////////////////////////////////////
-// Dhyana specific stuff now
-///////////////////////////////////////////////////////
-
-//-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::setTemperatureTarget(double temp)
+void Camera::listProfiles(std::vector<std::string>& names)
 {
-	DEB_MEMBER_FUNCT();
-	TUCAM_PROP_ATTR attrProp;
-	attrProp.nIdxChn = 0;// Current channel (camera monochrome = 0) . VERY IMPORTANT, doesn't work otherwise !!!!!
-	attrProp.idProp = TUIDP_TEMPERATURE;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetAttr(m_opCam.hIdxTUCam, &attrProp))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE range from the camera !";
-	}
-	DEB_TRACE() << "Temperature range [" << (int) attrProp.dbValMin << " , " << (int) attrProp.dbValMax << "]";
-
-	int temp_middle = (int) attrProp.dbValMax / 2;
-	if(((int) temp + temp_middle)<((int) attrProp.dbValMin) || ((int) temp + temp_middle)>((int) attrProp.dbValMax))
-	{
-		THROW_HW_ERROR(Error) << "Unable to set the Temperature Target !\n"
-		 << "It is out of range : "
-		 << "["
-		 << (int) attrProp.dbValMin - temp_middle
-		 << ","
-		 << (int) attrProp.dbValMax - temp_middle
-		 << "]";
-	}
+	DEB_MEMBER_FUNCT();
+	m_profile_store.list(names);
+}
 
-	int nVal = (int) temp + temp_middle;//temperatureTarget is a delta according to the middle temperature !!
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, nVal))
+void Camera::getProfile(const std::string& name, ProfileValues& values)
+{
+	DEB_MEMBER_FUNCT();
+	if(!m_profile_store.load(name, values))
 	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_TEMPERATURE to the camera !";
+		THROW_HW_ERROR(Error) << "Unknown profile " << name << " !";
 	}
-	m_temperature_target = (double) temp;
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getTemperatureTarget(double& temp)
+void Camera::getProfileStats(ProfileStats& stats)
 {
 	DEB_MEMBER_FUNCT();
-
-	temp = m_temperature_target;
+	AutoMutex lock(m_cond.mutex());
+	stats = m_profile_stats;
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getTemperature(double& temp)
+// @brief called with m_cond locked
+//-----------------------------------------------------
+void Camera::captureProfile(ProfileValues& values)
 {
 	DEB_MEMBER_FUNCT();
+	values.clear();
+	values["image_depth"] = profileValue(m_depth);
+	values["roi"] = profileValue(m_hw_roi.getTopLeft().x) + " " + profileValue(m_hw_roi.getTopLeft().y) + " "
+				  + profileValue(m_hw_roi.getSize().getWidth()) + " " + profileValue(m_hw_roi.getSize().getHeight());
+	values["exp_time"] = profileValue(m_exp_time);
+	values["lat_time"] = profileValue(m_lat_time);
+	values["global_gain"] = profileValue(m_global_gain);
+	values["fan_speed"] = profileValue(m_fan_speed);
+	values["tec_mode"] = profileValue(m_tec_mode);
+	values["temperature_target"] = profileValue(m_temperature_target);
+
+	values["trig_mode"] = profileValue(m_trigger_mode);
+	values["trigger_mode"] = profileValue(m_tucam_trigger_mode);
+	values["trigger_edge"] = profileValue(m_tucam_trigger_edge_mode);
+	values["trigger_delay"] = profileValue(m_tucam_trigger_delay);
+	values["trigger_buf_frames"] = profileValue(m_tucam_trigger_buf_frames);
+	values["burst_frames"] = profileValue(m_burst_frames);
+
+	//mode edge delay width, as TUCAM_Cap_SetTriggerOut takes them
+	TUCAM_TRGOUT_ATTR* outputs[3] = {&m_tgroutAttr1, &m_tgroutAttr2, &m_tgroutAttr3};
+	for(int port = 0; port < 3; port++)
+	{
+		std::ostringstream key;
+		key << "output_signal_" << port;
+		values[key.str()] = profileValue(outputs[port]->nTgrOutMode) + " " + profileValue(outputs[port]->nEdgeMode) + " "
+						  + profileValue(outputs[port]->nDelayTm) + " " + profileValue(outputs[port]->nWidth);
+	}
 
-	double dbVal = 0.0f;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, &dbVal))
+	for(int i = 0; i < NB_PROFILE_STAGES; i++)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_TEMPERATURE from the camera !";
+		bool enable;
+		(this->*PROFILE_STAGES[i].get)(enable);
+		values[PROFILE_STAGES[i].key] = enable ? "1" : "0";
 	}
-	temp = dbVal;
+	int nb_frames;
+	getAccumulationNbFrames(nb_frames);
+	values["accumulation_nb_frames"] = profileValue(nb_frames);
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::setFanSpeed(unsigned speed)
+// @brief true if the key is in the profile with a value different from the current one
+//-----------------------------------------------------
+bool Camera::profileChanged(const ProfileValues& target, const ProfileValues& current,
+							const char* key, double* numbers, int nb_numbers)
 {
-	DEB_MEMBER_FUNCT();
-
-	int nVal = (int) speed;
-
-	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, nVal))
+	DEB_STATIC_FUNCT();
+	ProfileValues::const_iterator found = target.find(key);
+	if(found == target.end())
+		return false;
+	std::istringstream is(found->second);
+	std::string value;
+	for(int i = 0; i < nb_numbers; i++)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDC_FAN_GEAR to the camera !";
+		if(!(is >> numbers[i]))
+		{
+			THROW_HW_ERROR(Error) << "Invalid value \"" << found->second << "\" of " << key << " in the profile !";
+		}
+		value += (i > 0 ? " " : "") + profileValue(numbers[i]);
 	}
+	ProfileValues::const_iterator now = current.find(key);
+	return now == current.end() || now->second != value;
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getFanSpeed(unsigned& speed)
+// @brief sampled by the telemetry thread, the values of the history are not lost
+//-----------------------------------------------------
+void Camera::setTelemetry(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	AutoMutex lock(m_cond.mutex());
+	m_telemetry = enable;
+	m_cond.broadcast();
+}
+
+void Camera::getTelemetry(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	enable = m_telemetry;
+}
 
-	int nVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_FAN_GEAR, &nVal))
+void Camera::setTelemetryPeriod(double period)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(period);
+	if(period < 0.1)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDC_FAN_GEAR from the camera !";
+		THROW_HW_ERROR(Error) << "Telemetry period must be at least 0.1 s !";
 	}
-	speed = (unsigned) nVal;
+	AutoMutex lock(m_cond.mutex());
+	m_telemetry_period = period;
+	m_cond.broadcast();
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::setGlobalGain(unsigned gain)
+void Camera::getTelemetryPeriod(double& period)
 {
 	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	period = m_telemetry_period;
+}
 
-	if(gain != 0 && gain != 1 && gain != 2)
-	{
-		THROW_HW_ERROR(Error) << "Available gain values are : 0:HDR\n1:HIGH\n2: LOW !";
-	}
+//-----------------------------------------------------
+// @brief the samples are read without lock, the telemetry thread is never blocked
+//-----------------------------------------------------
+bool Camera::getLastTelemetry(TelemetrySample& sample)
+{
+	DEB_MEMBER_FUNCT();
+	return m_telemetry_ring.getLast(sample);
+}
 
-	double dbVal = (double) gain;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_SetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, dbVal))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDP_GLOBALGAIN to the camera !";
-	}
+void Camera::getTelemetryHistory(std::vector<TelemetrySample>& history, double since)
+{
+	DEB_MEMBER_FUNCT();
+	m_telemetry_ring.getHistory(history, since);
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getGlobalGain(unsigned& gain)
+// @brief called by the telemetry thread without lock
+//-----------------------------------------------------
+void Camera::sampleTelemetry(TelemetrySample& sample)
 {
 	DEB_MEMBER_FUNCT();
+	sample.timestamp = Timestamp::now();
+	sample.fields = 0;
+	sample.temperature = 0.;
+	sample.fan_speed = 0;
+	sample.fpga_temperature = 0.;
+	sample.pcba_temperature = 0.;
+	sample.env_temperature = 0.;
+	sample.buffered_frames = 0;
 
 	double dbVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_GLOBALGAIN, &dbVal))
+	if(TUCAMRET_SUCCESS == TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, TUIDP_TEMPERATURE, &dbVal))
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDP_GLOBALGAIN from the camera !";
+		sample.temperature = dbVal;
+		sample.fields |= TelemetrySample::kTemperature;
+	}
+	int nVal;
+	if(readInfo(m_opCam.hIdxTUCam, TUIDI_FAN_SPEED, nVal))
+	{
+		sample.fan_speed = nVal;
+		sample.fields |= TelemetrySample::kFanSpeed;
+	}
+	if(readInfo(m_opCam.hIdxTUCam, TUIDI_FPGA_TEMPERATURE, nVal))
+	{
+		sample.fpga_temperature = nVal;
+		sample.fields |= TelemetrySample::kFpgaTemperature;
+	}
+	if(readInfo(m_opCam.hIdxTUCam, TUIDI_PCBA_TEMPERATURE, nVal))
+	{
+		sample.pcba_temperature = nVal;
+		sample.fields |= TelemetrySample::kPcbaTemperature;
+	}
+	if(readInfo(m_opCam.hIdxTUCam, TUIDI_ENV_TEMPERATURE, nVal))
+	{
+		sample.env_temperature = nVal;
+		sample.fields |= TelemetrySample::kEnvTemperature;
+	}
+	if(readInfo(m_opCam.hIdxTUCam, TUIDI_CURRENTBUFFRAMES, nVal))
+	{
+		sample.buffered_frames = nVal;
+		sample.fields |= TelemetrySample::kBufferedFrames;
 	}
-	gain = (unsigned) dbVal;
 }
 
 //-----------------------------------------------------
 //
 //-----------------------------------------------------
-void Camera::getTucamVersion(std::string& version)
+void Camera::setUsbBufferShedding(bool enable)
 {
 	DEB_MEMBER_FUNCT();
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_VERSION_API;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
-	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_API from the camera !";
-	}
-	version = valInfo.pText;
+	DEB_PARAM() << DEB_VAR1(enable);
+	AutoMutex lock(m_usb_buffer_mutex);
+	m_usb_shedding = enable;
+	if(!enable)
+		m_usb_buffer_stats.shedding = false;
 }
 
-//-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getFirmwareVersion(std::string& version)
+void Camera::getUsbBufferShedding(bool& enable)
 {
 	DEB_MEMBER_FUNCT();
-	TUCAM_VALUE_INFO valInfo;
-	valInfo.nID = TUIDI_VERSION_FRMW;
-	if(TUCAMRET_SUCCESS != TUCAM_Dev_GetInfo(m_opCam.hIdxTUCam, &valInfo))
+	AutoMutex lock(m_usb_buffer_mutex);
+	enable = m_usb_shedding;
+}
+
+void Camera::setUsbBufferWaterMarks(double low, double high)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(low, high);
+	if(low < 0. || high > 1. || low >= high)
 	{
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDI_VERSION_FRMW from the camera !";
+		THROW_HW_ERROR(Error) << "USB buffer water marks must verify 0 <= low < high <= 1 !";
 	}
-	version = valInfo.nValue;
+	AutoMutex lock(m_usb_buffer_mutex);
+	m_usb_low_water_mark = low;
+	m_usb_high_water_mark = high;
 }
 
-//-----------------------------------------------------------------------------
-/// Get the frame rate
-//-----------------------------------------------------------------------------
-void Camera::getFPS(double& fps) ///< [out] last computed fps
+void Camera::getUsbBufferWaterMarks(double& low, double& high)
 {
-    DEB_MEMBER_FUNCT();
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_usb_buffer_mutex);
+	low = m_usb_low_water_mark;
+	high = m_usb_high_water_mark;
+}
 
-    fps = m_fps;
+void Camera::getUsbBufferStats(UsbBufferStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_usb_buffer_mutex);
+	stats = m_usb_buffer_stats;
+}
+
+int Camera::getNbBufferedFrames()
+{
+	DEB_MEMBER_FUNCT();
+	int current_frames;
+	if(m_replay || !useHandle())
+		return -1;
+	bool ok = readInfo(m_opCam.hIdxTUCam, TUIDI_CURRENTBUFFRAMES, current_frames);
+	releaseHandle();
+	return ok ? current_frames : -1;
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::setTecMode(unsigned mode)
+// @brief called by the acquisition thread after each frame received from the camera
+//-----------------------------------------------------
+void Camera::updateUsbBuffer()
 {
 	DEB_MEMBER_FUNCT();
+	int current_frames;
+	if(!readInfo(m_opCam.hIdxTUCam, TUIDI_CURRENTBUFFRAMES, current_frames))
+		return;
 
-	if(mode != 0 && mode != 1)
+	AutoMutex lock(m_usb_buffer_mutex);
+	UsbBufferStats& stats = m_usb_buffer_stats;
+	bool was_full = stats.total_frames > 0 && stats.current_frames >= stats.total_frames;
+	stats.current_frames = current_frames;
+	if(current_frames > stats.peak_frames)
+		stats.peak_frames = current_frames;
+	if(stats.total_frames <= 0)
+		return;
+
+	stats.occupancy = (double) current_frames / stats.total_frames;
+	stats.peak_occupancy = (double) stats.peak_frames / stats.total_frames;
+	if(current_frames >= stats.total_frames && !was_full)
 	{
-		THROW_HW_ERROR(Error) << "Available mode values are :\n0:OFF\n1:ON";
+		stats.nb_overruns++;
+		DEB_WARNING() << "USB buffer full (" << current_frames << " frames), frames may be lost !";
 	}
 
-	int nVal = (int) mode;
-	if(TUCAMRET_SUCCESS != TUCAM_Capa_SetValue(m_opCam.hIdxTUCam, TUIDC_ENABLETEC, nVal))
+	//hysteresis between the water marks
+	if(m_usb_shedding && !stats.shedding && stats.occupancy >= m_usb_high_water_mark)
+	{
+		stats.shedding = true;
+		stats.nb_shed_periods++;
+		DEB_TRACE() << "USB buffer at " << (int) (stats.occupancy * 100) << "%, optional stages skipped";
+	}
+	else if(stats.shedding && stats.occupancy <= m_usb_low_water_mark)
 	{
-		DEB_TRACE() << "Unable to Write TUIDC_ENABLETEC from the camera!";
-		THROW_HW_ERROR(Error) << "Unable to Write TUIDC_ENABLETEC to the camera !";
+		stats.shedding = false;
+		DEB_TRACE() << "USB buffer at " << (int) (stats.occupancy * 100) << "%, optional stages restored";
 	}
 }
 
 //-----------------------------------------------------
-//
-//-----------------------------------------------------  
-void Camera::getTecMode(unsigned& mode)
+// @brief the parameters changed by the camera itself or starting an action are not cached
+//-----------------------------------------------------
+static bool isCachedParameter(const std::string& name)
 {
-	DEB_MEMBER_FUNCT();
-
-	int nVal;
-	if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_ENABLETEC, &nVal))
+	static const char* const UNCACHED[] =
 	{
-		DEB_TRACE() << "Unable to Read TUIDC_ENABLETEC from the camera!";
-		THROW_HW_ERROR(Error) << "Unable to Read TUIDC_ENABLETEC from the camera !";
+		"TUIDP_TEMPERATURE", "TUIDP_FOCUS_POSITION", "TUIDP_FRAME_RATE", "TUIDP_START_TIME",
+		"TUIDP_FRAME_NUMBER", "TUIDP_INTERVAL_TIME", "TUIDP_GPS_APPLY", "TUIDP_AMB_TEMPERATURE",
+		"TUIDP_AMB_HUMIDITY", "TUIDP_AVERAGEGRAY",
+		"TUIDC_ATFOCUS_STATUS", "TUIDC_ATEXPOSURE_STATUS", "TUIDC_ATWBALANCE_STATUS", "TUIDC_SENSORRESET",
+		"TUIDC_CAMSTATE", "TUIDC_ROLLINGSCANRESET", "TUIDC_CAMPARASAVE", "TUIDC_CAMPARALOAD"
+	};
+	//the processing and vendor properties are not camera registers
+	if(name.compare(0, 6, "TUIDP_") != 0 && name.compare(0, 6, "TUIDC_") != 0)
+		return false;
+	for(size_t i = 0; i < sizeof(UNCACHED) / sizeof(UNCACHED[0]); i++)
+	{
+		if(name == UNCACHED[i])
+			return false;
 	}
-	mode = (unsigned) nVal;
+	return true;
 }
 
 //-----------------------------------------------------
-// Set trigger outpout on selected port
-//-----------------------------------------------------  
-void Camera::setOutputSignal(int port, TucamSignal signal, TucamSignalEdge edge, int delay, int width)
+// @brief the exposure time is changed by the camera itself while its auto exposure (TUIDC_ATEXPOSURE) is on
+//-----------------------------------------------------
+bool Camera::isExposureCached()
 {
 	DEB_MEMBER_FUNCT();
-
-	TUCAM_TRGOUT_ATTR tgroutAttr;
-
-	switch (port)
+	if(!m_parameter_cache.isEnabled())
+		return false;
+	double value;
+	if(!m_parameter_cache.get("TUIDC_ATEXPOSURE", value))
 	{
-	case 0:
-		m_tgroutAttr1.nTgrOutMode = signal;
-		m_tgroutAttr1.nEdgeMode = edge;
-		m_tgroutAttr1.nDelayTm = delay * 1000;
-		m_tgroutAttr1.nWidth = width * 1000;
-
-		if (TUCAMRET_SUCCESS != TUCAM_Cap_SetTriggerOut(m_opCam.hIdxTUCam, m_tgroutAttr1))
-		{
-			THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
-		}
-
-		tgroutAttr.nTgrOutPort = port;
-
-		if (TUCAMRET_SUCCESS != TUCAM_Cap_GetTriggerOut(m_opCam.hIdxTUCam, &tgroutAttr))
-		{
-			THROW_HW_ERROR(Error) << "Unable to get Output signal port " << port;
-		}
-
-		m_tgroutAttr1.nTgrOutMode = tgroutAttr.nTgrOutMode;
-		m_tgroutAttr1.nEdgeMode = tgroutAttr.nEdgeMode;
-		m_tgroutAttr1.nDelayTm = tgroutAttr.nDelayTm;
-		m_tgroutAttr1.nWidth = tgroutAttr.nWidth;
-		break;
-
-	case 1:
-
-		m_tgroutAttr2.nTgrOutMode = signal;
-		m_tgroutAttr2.nEdgeMode = edge;
-		m_tgroutAttr2.nDelayTm = delay * 1000;
-		m_tgroutAttr2.nWidth = width * 1000;
-
-		if (TUCAMRET_SUCCESS != TUCAM_Cap_SetTriggerOut(m_opCam.hIdxTUCam, m_tgroutAttr2))
-		{
-			THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
-		}
-
-		tgroutAttr.nTgrOutPort = port;
-
-		if (TUCAMRET_SUCCESS != TUCAM_Cap_GetTriggerOut(m_opCam.hIdxTUCam, &tgroutAttr))
-		{
-			THROW_HW_ERROR(Error) << "Unable to get Output signal port " << port;
-		}
-		m_tgroutAttr2.nTgrOutMode = tgroutAttr.nTgrOutMode;
-		m_tgroutAttr2.nEdgeMode = tgroutAttr.nEdgeMode;
-		m_tgroutAttr2.nDelayTm = tgroutAttr.nDelayTm;
-		m_tgroutAttr2.nWidth = tgroutAttr.nWidth;
-		break;
-
-	case 2:
-
-		m_tgroutAttr3.nTgrOutMode = signal;
-		m_tgroutAttr3.nTgrOutMode = signal;
-		m_tgroutAttr3.nEdgeMode = edge;
-		m_tgroutAttr3.nDelayTm = delay * 1000;
-		m_tgroutAttr3.nWidth = width * 1000;
-
-		if (TUCAMRET_SUCCESS != TUCAM_Cap_SetTriggerOut(m_opCam.hIdxTUCam, m_tgroutAttr3))
-		{
-			THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
-		}
-
-		tgroutAttr.nTgrOutPort = port;
-
-		if (TUCAMRET_SUCCESS != TUCAM_Cap_GetTriggerOut(m_opCam.hIdxTUCam, &tgroutAttr))
-		{
-			THROW_HW_ERROR(Error) << "Unable to get Output signal port " << port;
-		}
-		m_tgroutAttr3.nTgrOutMode = tgroutAttr.nTgrOutMode;
-		m_tgroutAttr3.nEdgeMode = tgroutAttr.nEdgeMode;
-		m_tgroutAttr3.nDelayTm = tgroutAttr.nDelayTm;
-		m_tgroutAttr3.nWidth = tgroutAttr.nWidth;
-		break;
-
-	default:
-		THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
-		break;
+		int nVal;
+		//the models without auto exposure keep the exposure time
+		if(TUCAMRET_SUCCESS != TUCAM_Capa_GetValue(m_opCam.hIdxTUCam, TUIDC_ATEXPOSURE, &nVal))
+			return true;
+		value = nVal;
+		m_parameter_cache.set("TUIDC_ATEXPOSURE", value);
 	}
+	return value == 0.;
 }
 
 //-----------------------------------------------------
-// Get trigger outpout on selected port
-//----------------------------------------------------- 
-void Camera::getOutputSignal(int port, TucamSignal& signal, TucamSignalEdge& edge, int& delay, int& width)
+// @brief writing these parameters changes other parameters of the camera
+//-----------------------------------------------------
+static bool isCoupledParameter(const std::string& name)
 {
-  DEB_MEMBER_FUNCT();
-
-  switch (port)
-  {
-  case 0:
-	  signal = (TucamSignal)m_tgroutAttr1.nTgrOutMode;
-	  edge = (TucamSignalEdge)m_tgroutAttr1.nEdgeMode;
-	  delay = m_tgroutAttr1.nDelayTm;
-	  width = m_tgroutAttr1.nWidth;
-	  break;
-
-  case 1:
-	  signal = (TucamSignal)m_tgroutAttr2.nTgrOutMode;
-	  edge = (TucamSignalEdge)m_tgroutAttr2.nEdgeMode;
-	  delay = m_tgroutAttr2.nDelayTm;
-	  width = m_tgroutAttr2.nWidth;
-	  break;
-
-  case 2:
-	  signal = (TucamSignal)m_tgroutAttr3.nTgrOutMode;
-	  edge = (TucamSignalEdge)m_tgroutAttr3.nEdgeMode;
-	  delay = m_tgroutAttr3.nDelayTm;
-	  width = m_tgroutAttr3.nWidth;
-	  break;
-
-  default:
-	  THROW_HW_ERROR(Error) << "Unable to set Output signal port " << port;
-	  break;
-  }
+	static const char* const COUPLED[] =
+	{
+		"TUIDC_RESOLUTION", "TUIDC_BITOFDEPTH", "TUIDC_ATEXPOSURE", "TUIDC_ATEXPOSURE_MODE", "TUIDC_HDR",
+		"TUIDC_IMGMODESELECT", "TUIDC_SENSORRESET", "TUIDC_CAMPARALOAD"
+	};
+	for(size_t i = 0; i < sizeof(COUPLED) / sizeof(COUPLED[0]); i++)
+	{
+		if(name == COUPLED[i])
+			return true;
+	}
+	return false;
 }
 
 //-----------------------------------------------------
-// is trigger out attribute is available
-//----------------------------------------------------- 
-bool Camera::is_trigOutput_available()
+// @brief the cached parameters are written or read again after the invalidation
+//-----------------------------------------------------
+void Camera::setParameterCache(bool enable)
 {
-	DEB_MEMBER_FUNCT();	
-	bool is_trigOutput_available = true;
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	m_parameter_cache.setEnable(enable);
+}
 
-	TUCAM_TRGOUT_ATTR tgroutAttr;
-	if (TUCAMRET_SUCCESS != TUCAM_Cap_GetTriggerOut(m_opCam.hIdxTUCam, &tgroutAttr))
-	{
-		is_trigOutput_available = false;
-		DEB_TRACE() << "Unable to get trigger out attribute from the camera!";
-	}
-	
-	return is_trigOutput_available;
+void Camera::getParameterCache(bool& enable)
+{
+	DEB_MEMBER_FUNCT();
+	enable = m_parameter_cache.isEnabled();
 }
 
+void Camera::invalidateParameterCache()
+{
+	DEB_MEMBER_FUNCT();
+	m_parameter_cache.invalidate();
+}
+
+void Camera::getParameterCacheStats(ParameterCacheStats& stats)
+{
+	DEB_MEMBER_FUNCT();
+	m_parameter_cache.getStats(stats);
+}
 
 //-----------------------------------------------------
 // Get selected parameter value
@@ -1508,6 +4978,7 @@ std::string Camera::getAllParameters()
 void Camera::setParameter(std::string parameter_name, std::string value_str)
 {
 	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
 
 	std::map<std::string, int>::const_iterator it = m_parameters_map.find(parameter_name);
 	//Check if the parameter name exists
@@ -1522,6 +4993,17 @@ void Camera::setParameter(std::string parameter_name, std::string value_str)
 		str_stream << value_str;
 		double value = 0.0;
 		str_stream >> value;
+
+		//the value already in the camera is not written again
+		bool cached = isCachedParameter(parameter_name) && (parameter_name != "TUIDP_EXPOSURETM" || isExposureCached());
+		double cache_value = (parameter_name.find("TUIDC_") != std::string::npos) ? (int) value : value;
+		if(cached && m_parameter_cache.isUnchanged(parameter_name, cache_value))
+		{
+			DEB_TRACE() << parameter_name << " is already " << cache_value;
+			return;
+		}
+		//the cached value is unknown until the write succeeds
+		m_parameter_cache.invalidate(parameter_name);
 		
 		//Set a control parameter
 		if(parameter_name.find("TUIDP_") != std::string::npos)
@@ -1555,6 +5037,11 @@ void Camera::setParameter(std::string parameter_name, std::string value_str)
 				THROW_HW_ERROR(Error) << "Unable to Write " << parameter_name << " to the camera !";
 			}
 		}
+
+		if(isCoupledParameter(parameter_name))
+			m_parameter_cache.invalidate();
+		else if(cached)
+			m_parameter_cache.set(parameter_name, cache_value);
 	}
 
 }
@@ -1565,13 +5052,22 @@ void Camera::setParameter(std::string parameter_name, std::string value_str)
 std::stringstream Camera::getParameterValue(std::string parameter_name, int parameter_id)
 {
 	DEB_MEMBER_FUNCT();
+	HandleUse handle(*this);
 	
 	std::stringstream result;
 	result.str("");
 	double double_value = 0.0f;
 	int int_value = 0;
 
-	if(parameter_name.find("TUIDP_") != std::string::npos)
+	bool cached = isCachedParameter(parameter_name) && (parameter_name != "TUIDP_EXPOSURETM" || isExposureCached());
+	if(cached && m_parameter_cache.get(parameter_name, double_value))
+	{
+		if(parameter_name.find("TUIDC_") != std::string::npos)
+			result << (int) double_value << std::endl;
+		else
+			result << double_value << std::endl;
+	}
+	else if(parameter_name.find("TUIDP_") != std::string::npos)
 	{
 		if(TUCAMRET_SUCCESS != TUCAM_Prop_GetValue(m_opCam.hIdxTUCam, parameter_id, &double_value))
 		{
@@ -1580,6 +5076,8 @@ std::stringstream Camera::getParameterValue(std::string parameter_name, int para
 		else
 		{
 			result << double_value << std::endl;
+			if(cached)
+				m_parameter_cache.set(parameter_name, double_value);
 		}
 	}
 	else if(parameter_name.find("TUIDC_") != std::string::npos)
@@ -1591,6 +5089,8 @@ std::stringstream Camera::getParameterValue(std::string parameter_name, int para
 		else
 		{
 			result << int_value << std::endl;
+			if(cached)
+				m_parameter_cache.set(parameter_name, int_value);
 		}
 	}
 	else if(parameter_name.find("TUIDPP_") != std::string::npos)
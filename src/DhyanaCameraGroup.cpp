@@ -0,0 +1,811 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "DhyanaCameraGroup.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//a camera which did not deliver its frame is triggered again after the frame period + this time (s)
+static const double GROUP_FRAME_TIMEOUT = 1.;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+CameraGroup::CameraGroup() :
+m_sync_mode(kSoftwareTrigger),
+m_master_output_port(0),
+m_trigger_period(0.),
+m_max_skew(0.),
+m_match_window(16),
+m_history_size(100),
+m_running(false),
+m_quit(false),
+m_trigger_thread(NULL),
+m_nb_frames(0),
+m_period(0.),
+m_callback(NULL)
+{
+	DEB_CONSTRUCTOR();
+	m_stats.arm_time = 0.;
+	m_stats.nb_triggers = 0;
+	m_stats.nb_matched = 0;
+	m_stats.nb_incomplete = 0;
+	m_stats.nb_out_of_sync = 0;
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+CameraGroup::~CameraGroup()
+{
+	DEB_DESTRUCTOR();
+	stopAcq();
+	removeCameras();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::addCamera(Camera& camera)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	if(m_running)
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the camera group during the acquisition !";
+	}
+	for(size_t i = 0; i < m_members.size(); i++)
+	{
+		if(&m_members[i]->camera == &camera)
+		{
+			THROW_HW_ERROR(Error) << "The camera is already in the group !";
+		}
+	}
+	if(camera.isAcqRunning())
+	{
+		THROW_HW_ERROR(Error) << "Unable to add a camera during its acquisition !";
+	}
+	Member* member = new Member(*this, camera, (int) m_members.size());
+	camera.getSerialNumber(member->stats.serial_number);
+	lock.unlock();
+
+	//the acquisition thread of the camera calls frameReady with its callback mutex locked
+	try
+	{
+		camera.registerFrameCallback(*member);
+	}
+	catch(Exception&)
+	{
+		delete member;
+		throw;
+	}
+	lock.lock();
+	m_members.push_back(member);
+	DEB_TRACE() << "Camera " << member->stats.serial_number << " added to the group";
+}
+
+void CameraGroup::removeCameras()
+{
+	DEB_MEMBER_FUNCT();
+	std::vector<Member*> members;
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(m_running)
+		{
+			THROW_HW_ERROR(Error) << "Unable to change the camera group during the acquisition !";
+		}
+		members.swap(m_members);
+		m_pending.clear();
+	}
+	for(size_t i = 0; i < members.size(); i++)
+	{
+		//the camera is back to its own trigger mode
+		try
+		{
+			members[i]->camera.setGroupTrigger(false);
+		}
+		catch(Exception& e)
+		{
+			DEB_WARNING() << "Camera " << members[i]->stats.serial_number << " : " << e.getErrMsg();
+		}
+		members[i]->camera.unregisterFrameCallback(*members[i]);
+		delete members[i];
+	}
+}
+
+int CameraGroup::getNbCameras() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return (int) m_members.size();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::setSyncMode(SyncMode mode)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(mode);
+	AutoMutex lock(m_cond.mutex());
+	if(m_running)
+	{
+		THROW_HW_ERROR(Error) << "Unable to change the sync mode during the acquisition !";
+	}
+	m_sync_mode = mode;
+}
+
+CameraGroup::SyncMode CameraGroup::getSyncMode() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_sync_mode;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::setMasterOutputPort(int port)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(port);
+	if(port < 0 || port > 2)
+	{
+		THROW_HW_ERROR(Error) << "Master output port must be in [0, 2] !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_master_output_port = port;
+}
+
+int CameraGroup::getMasterOutputPort() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_master_output_port;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::setTriggerPeriod(double period)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(period);
+	if(period < 0.)
+	{
+		THROW_HW_ERROR(Error) << "Trigger period can not be negative !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_trigger_period = period;
+}
+
+double CameraGroup::getTriggerPeriod() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_trigger_period;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::setMaxSkew(double max_skew)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(max_skew);
+	if(max_skew < 0.)
+	{
+		THROW_HW_ERROR(Error) << "Max skew can not be negative !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_max_skew = max_skew;
+}
+
+double CameraGroup::getMaxSkew() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_max_skew;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::setMatchWindow(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+	if(nb_frames < 1)
+	{
+		THROW_HW_ERROR(Error) << "Match window must be at least 1 frame !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_match_window = nb_frames;
+}
+
+int CameraGroup::getMatchWindow() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_match_window;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::setHistorySize(int size)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(size);
+	if(size < 1)
+	{
+		THROW_HW_ERROR(Error) << "History size must be at least 1 !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_history_size = size;
+	while((int) m_history.size() > m_history_size)
+		m_history.pop_front();
+}
+
+int CameraGroup::getHistorySize() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_history_size;
+}
+
+//-----------------------------------------------------
+// @brief the trigger modes are applied, then the cameras are armed in parallel
+//-----------------------------------------------------
+void CameraGroup::prepareAcq()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	if(m_running)
+	{
+		THROW_HW_ERROR(Error) << "The camera group is already running !";
+	}
+	if(m_members.empty())
+	{
+		THROW_HW_ERROR(Error) << "The camera group is empty !";
+	}
+
+	int nb_frames;
+	m_members[0]->camera.getNbFrames(nb_frames);
+	for(size_t i = 0; i < m_members.size(); i++)
+	{
+		Camera& camera = m_members[i]->camera;
+		int camera_nb_frames;
+		camera.getNbFrames(camera_nb_frames);
+		if(camera_nb_frames != nb_frames)
+		{
+			THROW_HW_ERROR(Error) << "Camera " << m_members[i]->stats.serial_number << " : nb of frames ("
+								  << camera_nb_frames << ") differs from the first camera (" << nb_frames << ") !";
+		}
+		//the group sends the software triggers, to the master only in kHardwareTrigger
+		if(i == 0 || m_sync_mode == kSoftwareTrigger)
+		{
+			camera.setGroupTrigger(true);
+			camera.setTrigMode(IntTrig);
+		}
+		else
+		{
+			camera.setGroupTrigger(false);
+			camera.setTrigMode(ExtTrigMult);
+		}
+	}
+	if(m_sync_mode == kHardwareTrigger)
+	{
+		m_members[0]->camera.setOutputSignal(m_master_output_port, Camera::kSignalStart);
+	}
+
+	double exp_time, lat_time;
+	m_members[0]->camera.getExpTime(exp_time);
+	m_members[0]->camera.getLatTime(lat_time);
+	m_period = (m_trigger_period > 0.) ? m_trigger_period : exp_time + lat_time;
+	m_nb_frames = nb_frames;
+
+	//reset the matching
+	m_pending.clear();
+	m_history.clear();
+	m_stats.arm_time = 0.;
+	m_stats.nb_triggers = 0;
+	m_stats.nb_matched = 0;
+	m_stats.nb_incomplete = 0;
+	m_stats.nb_out_of_sync = 0;
+	for(size_t i = 0; i < m_members.size(); i++)
+	{
+		GroupMemberStats& stats = m_members[i]->stats;
+		stats.arm_time = 0.;
+		stats.trigger_offset = 0.;
+		stats.last_skew = 0.;
+		stats.mean_skew = 0.;
+		stats.max_skew = 0.;
+		stats.nb_frames = 0;
+		stats.nb_missing = 0;
+		stats.nb_retriggers = 0;
+		m_members[i]->skew_sum = 0.;
+	}
+
+	lock.unlock();
+	Timestamp t0 = Timestamp::now();
+	runOnMembers(GroupThread::kPrepare);
+	double arm_time = Timestamp::now() - t0;
+	lock.lock();
+	m_stats.arm_time = arm_time;
+	DEB_TRACE() << m_members.size() << " cameras armed in " << (int) (arm_time * 1000) << " (ms)";
+
+	for(size_t i = 0; i < m_members.size(); i++)
+	{
+		if(!m_members[i]->error.empty())
+		{
+			std::string serial_number = m_members[i]->stats.serial_number;
+			std::string error = m_members[i]->error;
+			lock.unlock();
+			//the cameras already armed are stopped
+			runOnMembers(GroupThread::kStop);
+			THROW_HW_ERROR(Error) << "Unable to prepare the camera " << serial_number << " : " << error << " !";
+		}
+	}
+}
+
+//-----------------------------------------------------
+// @brief the acquisition threads are started before the first trigger
+//-----------------------------------------------------
+void CameraGroup::startAcq()
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(m_running)
+		{
+			THROW_HW_ERROR(Error) << "The camera group is already running !";
+		}
+		if(m_members.empty())
+		{
+			THROW_HW_ERROR(Error) << "The camera group is empty !";
+		}
+	}
+	runOnMembers(GroupThread::kStart);
+	for(size_t i = 0; i < m_members.size(); i++)
+	{
+		if(!m_members[i]->error.empty())
+		{
+			std::string serial_number = m_members[i]->stats.serial_number;
+			std::string error = m_members[i]->error;
+			runOnMembers(GroupThread::kStop);
+			THROW_HW_ERROR(Error) << "Unable to start the camera " << serial_number << " : " << error << " !";
+		}
+	}
+
+	AutoMutex lock(m_cond.mutex());
+	m_running = true;
+	m_quit = false;
+	m_trigger_thread = new GroupThread(*this, GroupThread::kTrigger);
+	m_trigger_thread->start();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::stopAcq()
+{
+	DEB_MEMBER_FUNCT();
+	GroupThread* trigger_thread;
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(!m_running)
+			return;
+		m_quit = true;
+		m_cond.broadcast();
+		trigger_thread = m_trigger_thread;
+		m_trigger_thread = NULL;
+	}
+	//the thread joins in its dtor
+	delete trigger_thread;
+	runOnMembers(GroupThread::kStop);
+
+	AutoMutex lock(m_cond.mutex());
+	m_running = false;
+}
+
+//-----------------------------------------------------
+// @brief true while one of the cameras acquires
+//-----------------------------------------------------
+bool CameraGroup::isAcqRunning() const
+{
+	AutoMutex lock(m_cond.mutex());
+	for(size_t i = 0; i < m_members.size(); i++)
+	{
+		if(m_members[i]->camera.isAcqRunning())
+			return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void CameraGroup::registerCallback(GroupFrameCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback)
+	{
+		THROW_HW_ERROR(Error) << "A group frame callback is already registered !";
+	}
+	m_callback = &cb;
+}
+
+void CameraGroup::unregisterCallback(GroupFrameCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback != &cb)
+	{
+		THROW_HW_ERROR(Error) << "This group frame callback is not registered !";
+	}
+	m_callback = NULL;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool CameraGroup::getLastGroupFrame(GroupFrame& frame) const
+{
+	AutoMutex lock(m_cond.mutex());
+	if(m_history.empty())
+		return false;
+	frame = m_history.back();
+	return true;
+}
+
+void CameraGroup::getHistory(std::vector<GroupFrame>& history) const
+{
+	AutoMutex lock(m_cond.mutex());
+	history.assign(m_history.begin(), m_history.end());
+}
+
+void CameraGroup::getStats(CameraGroupStats& stats) const
+{
+	AutoMutex lock(m_cond.mutex());
+	stats = m_stats;
+	stats.members.clear();
+	for(size_t i = 0; i < m_members.size(); i++)
+		stats.members.push_back(m_members[i]->stats);
+}
+
+//-----------------------------------------------------
+// @brief one thread per camera, returns when all the calls are done
+//-----------------------------------------------------
+void CameraGroup::runOnMembers(int role)
+{
+	DEB_MEMBER_FUNCT();
+	std::vector<GroupThread*> threads;
+	for(size_t i = 0; i < m_members.size(); i++)
+	{
+		GroupThread* thread = new GroupThread(*this, (GroupThread::Role) role, m_members[i]);
+		threads.push_back(thread);
+		thread->start();
+	}
+	//the threads join in their dtor
+	for(size_t i = 0; i < threads.size(); i++)
+		delete threads[i];
+}
+
+//-----------------------------------------------------
+// @brief lockstep : the next trigger is sent when all the cameras delivered the frame
+//-----------------------------------------------------
+void CameraGroup::triggerLoop()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	size_t nb_targets = (m_sync_mode == kSoftwareTrigger) ? m_members.size() : 1;
+	std::vector<double> offsets(nb_targets);
+	while(!m_quit && (m_nb_frames == 0 || m_stats.nb_triggers < m_nb_frames))
+	{
+		//the members can not change while running, they are used unlocked
+		lock.unlock();
+		Timestamp t0 = Timestamp::now();
+		for(size_t i = 0; i < nb_targets; i++)
+		{
+			m_members[i]->camera.softwareTrigger();
+			offsets[i] = Timestamp::now() - t0;
+		}
+		lock.lock();
+		for(size_t i = 0; i < nb_targets; i++)
+			m_members[i]->stats.trigger_offset = offsets[i];
+		int nb_triggers = ++m_stats.nb_triggers;
+
+		for(size_t i = 0; i < m_members.size(); i++)
+		{
+			m_members[i]->retriggered = false;
+			m_members[i]->given_up = false;
+		}
+		double deadline = (double) t0 + m_period + GROUP_FRAME_TIMEOUT;
+		int nb_timeouts = 0;
+		while(!m_quit && !allReceived(nb_triggers))
+		{
+			double remaining = deadline - (double) Timestamp::now();
+			if(remaining > 0.)
+			{
+				m_cond.wait(remaining);
+				continue;
+			}
+			if(m_sync_mode == kHardwareTrigger)
+			{
+				DEB_WARNING() << "Frame " << nb_triggers - 1 << " not received from all the cameras !";
+				break;
+			}
+			nb_timeouts++;
+			for(size_t i = 0; i < m_members.size(); i++)
+			{
+				Member* member = m_members[i];
+				if(member->stats.nb_frames >= nb_triggers || member->given_up)
+					continue;
+				//first timeout : one more period, a late camera still delivers the frame
+				if(nb_timeouts == 1)
+				{
+					member->nb_frames_at_timeout = member->stats.nb_frames;
+					continue;
+				}
+				//the trigger was lost only if nothing came since and nothing waits in the USB buffer,
+				//a retrigger of a late camera would shift its frame numbers
+				bool lost = !member->retriggered
+					&& member->stats.nb_frames == member->nb_frames_at_timeout
+					&& member->camera.getNbBufferedFrames() == 0;
+				if(lost)
+				{
+					DEB_WARNING() << "Camera " << member->stats.serial_number << " : trigger " << nb_triggers - 1 << " lost, sent again";
+					member->camera.softwareTrigger();
+					member->stats.nb_retriggers++;
+					member->retriggered = true;
+				}
+				else
+				{
+					DEB_WARNING() << "Camera " << member->stats.serial_number << " : frame " << nb_triggers - 1 << " missing";
+					member->stats.nb_missing++;
+					member->given_up = true;
+					pendingFrame(nb_triggers - 1)->second.missing[i] = true;
+				}
+			}
+			deadline = (double) Timestamp::now() + m_period + GROUP_FRAME_TIMEOUT;
+		}
+
+		//min period between the triggers
+		double next = (double) t0 + m_period;
+		while(!m_quit)
+		{
+			double remaining = next - (double) Timestamp::now();
+			if(remaining <= 0.)
+				break;
+			m_cond.wait(remaining);
+		}
+	}
+	DEB_TRACE() << "Trigger thread done : " << DEB_VAR1(m_stats.nb_triggers);
+}
+
+//-----------------------------------------------------
+// @brief called with m_cond locked
+//-----------------------------------------------------
+bool CameraGroup::allReceived(int nb_frames) const
+{
+	for(size_t i = 0; i < m_members.size(); i++)
+	{
+		if(m_members[i]->stats.nb_frames < nb_frames && !m_members[i]->given_up)
+			return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief called with m_cond locked, created if not yet received from any camera
+//-----------------------------------------------------
+std::map<int, CameraGroup::PendingFrame>::iterator CameraGroup::pendingFrame(int frame_nb)
+{
+	std::map<int, PendingFrame>::iterator it = m_pending.find(frame_nb);
+	if(it == m_pending.end())
+	{
+		PendingFrame pending;
+		pending.frame.frame_nb = frame_nb;
+		pending.frame.timestamps.assign(m_members.size(), 0.);
+		pending.frame.max_skew = 0.;
+		pending.frame.in_sync = true;
+		pending.nb_received = 0;
+		pending.missing.assign(m_members.size(), false);
+		it = m_pending.insert(std::make_pair(frame_nb, pending)).first;
+	}
+	return it;
+}
+
+//-----------------------------------------------------
+// @brief called by the acquisition thread of a camera
+//-----------------------------------------------------
+void CameraGroup::frameReady(Member& member, int frame_nb, double timestamp)
+{
+	DEB_MEMBER_FUNCT();
+	GroupFrame matched;
+	bool complete = false;
+	{
+		AutoMutex lock(m_cond.mutex());
+		member.stats.nb_frames++;
+
+		std::map<int, PendingFrame>::iterator it = pendingFrame(frame_nb);
+		it->second.frame.timestamps[member.index] = timestamp;
+		//late after all
+		if(it->second.missing[member.index])
+		{
+			it->second.missing[member.index] = false;
+			member.stats.nb_missing--;
+		}
+		if(++it->second.nb_received == (int) m_members.size())
+		{
+			matched = it->second.frame;
+			m_pending.erase(it);
+			matchFrame(matched);
+			complete = true;
+		}
+
+		//the frames not received from all the cameras within the window are given up
+		while(!m_pending.empty() && m_pending.begin()->first < frame_nb - m_match_window)
+		{
+			const GroupFrame& frame = m_pending.begin()->second.frame;
+			for(size_t i = 0; i < m_members.size(); i++)
+			{
+				if(frame.timestamps[i] == 0. && !m_pending.begin()->second.missing[i])
+					m_members[i]->stats.nb_missing++;
+			}
+			m_stats.nb_incomplete++;
+			m_pending.erase(m_pending.begin());
+		}
+		m_cond.broadcast();
+	}
+
+	if(complete)
+	{
+		AutoMutex lock(m_callback_mutex);
+		if(m_callback)
+			m_callback->groupFrameReady(matched);
+	}
+}
+
+//-----------------------------------------------------
+// @brief called with m_cond locked, the skews are relative to the first camera
+//-----------------------------------------------------
+void CameraGroup::matchFrame(GroupFrame& frame)
+{
+	double earliest = frame.timestamps[0];
+	double latest = frame.timestamps[0];
+	frame.skews.resize(frame.timestamps.size());
+	for(size_t i = 0; i < frame.timestamps.size(); i++)
+	{
+		double skew = frame.timestamps[i] - frame.timestamps[0];
+		double abs_skew = (skew < 0.) ? -skew : skew;
+		frame.skews[i] = skew;
+		if(frame.timestamps[i] < earliest)
+			earliest = frame.timestamps[i];
+		if(frame.timestamps[i] > latest)
+			latest = frame.timestamps[i];
+
+		Member* member = m_members[i];
+		member->skew_sum += skew;
+		member->stats.last_skew = skew;
+		member->stats.mean_skew = member->skew_sum / (m_stats.nb_matched + 1);
+		if(abs_skew > member->stats.max_skew)
+			member->stats.max_skew = abs_skew;
+	}
+	frame.max_skew = latest - earliest;
+	frame.in_sync = (m_max_skew <= 0. || frame.max_skew <= m_max_skew);
+	if(!frame.in_sync)
+		m_stats.nb_out_of_sync++;
+	m_stats.nb_matched++;
+
+	m_history.push_back(frame);
+	while((int) m_history.size() > m_history_size)
+		m_history.pop_front();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+CameraGroup::Member::Member(CameraGroup& group, Camera& camera, int index) :
+group(group),
+camera(camera),
+index(index),
+skew_sum(0.),
+nb_frames_at_timeout(0),
+retriggered(false),
+given_up(false)
+{
+	stats.arm_time = 0.;
+	stats.trigger_offset = 0.;
+	stats.last_skew = 0.;
+	stats.mean_skew = 0.;
+	stats.max_skew = 0.;
+	stats.nb_frames = 0;
+	stats.nb_missing = 0;
+	stats.nb_retriggers = 0;
+}
+
+void CameraGroup::Member::frameReady(int frame_nb, double timestamp)
+{
+	group.frameReady(*this, frame_nb, timestamp);
+}
+
+//-----------------------------------------------------
+// @brief the errors are kept, the thread must not throw
+//-----------------------------------------------------
+void CameraGroup::GroupThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	if(m_role == kTrigger)
+	{
+		m_group.triggerLoop();
+		return;
+	}
+	Timestamp t0 = Timestamp::now();
+	std::string error;
+	try
+	{
+		switch(m_role)
+		{
+			case kPrepare:
+				m_member->camera.prepareAcq();
+				break;
+			case kStart:
+				m_member->camera.startAcq();
+				break;
+			case kStop:
+				m_member->camera.stopAcq();
+				break;
+			default:
+				break;
+		}
+	}
+	catch(Exception& e)
+	{
+		error = e.getErrMsg();
+	}
+	double elapsed = Timestamp::now() - t0;
+
+	AutoMutex lock(m_group.m_cond.mutex());
+	m_member->error = error;
+	if(m_role == kPrepare)
+		m_member->stats.arm_time = elapsed;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+CameraGroup::GroupThread::GroupThread(CameraGroup& group, Role role, Member* member) :
+m_group(group),
+m_role(role),
+m_member(member)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+CameraGroup::GroupThread::~GroupThread()
+{
+	join();
+}
+
+//-----------------------------------------------------
@@ -0,0 +1,391 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include "lima/Exceptions.h"
+#include "DhyanaDefectMap.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// MAD to standard deviation for a normal distribution
+//-----------------------------------------------------
+static const double MAD_TO_SIGMA = 1.4826;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+DefectMap::DefectMap() :
+m_enable(false),
+m_replacement(kReplaceMedian),
+m_width(0),
+m_height(0),
+m_geometry_warned(false)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+DefectMap::~DefectMap()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void DefectMap::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+	m_geometry_warned = false;
+}
+
+bool DefectMap::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void DefectMap::setReplacement(Replacement replacement)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_replacement = replacement;
+}
+
+DefectMap::Replacement DefectMap::getReplacement() const
+{
+	AutoMutex lock(m_mutex);
+	return m_replacement;
+}
+
+//-----------------------------------------------------
+// @brief median of the values, the vector is reordered
+//-----------------------------------------------------
+static double median(std::vector<float>& values)
+{
+	size_t mid = values.size() / 2;
+	std::nth_element(values.begin(), values.begin() + mid, values.end());
+	return values[mid];
+}
+
+//-----------------------------------------------------
+// @brief build the defect list from the dark (offset) and gain maps
+//-----------------------------------------------------
+void DefectMap::build(const std::vector<float>& dark, const std::vector<float>& gain, const Size& size,
+					  double hot_sigma, double gain_tolerance)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR3(size, hot_sigma, gain_tolerance);
+	size_t nb_pixels = (size_t) size.getWidth() * size.getHeight();
+	if(nb_pixels == 0 || dark.size() != nb_pixels || (!gain.empty() && gain.size() != nb_pixels))
+	{
+		THROW_HW_ERROR(Error) << "Defect map needs a dark map (and optionally a gain map) of the detector size !";
+	}
+	if(hot_sigma <= 0. || gain_tolerance <= 0.)
+	{
+		THROW_HW_ERROR(Error) << "Defect thresholds must be strictly positive !";
+	}
+
+	std::vector<unsigned int> indices;
+
+	//hot pixels : robust statistics of the dark, insensitive to the defects themselves
+	std::vector<float> work(dark);
+	double dark_median = median(work);
+	for(size_t i = 0; i < nb_pixels; i++)
+	{
+		work[i] = (float) std::fabs(dark[i] - dark_median);
+	}
+	double dark_sigma = MAD_TO_SIGMA * median(work);
+	// a noiseless dark (MAD = 0) would flag every pixel above the median
+	if(dark_sigma < 1.)
+		dark_sigma = 1.;
+	double hot_level = dark_median + hot_sigma * dark_sigma;
+	for(size_t i = 0; i < nb_pixels; i++)
+	{
+		if(dark[i] > hot_level)
+			indices.push_back((unsigned int) i);
+	}
+	size_t nb_hot = indices.size();
+
+	//bad response : gain far from the median gain (or not finite)
+	if(!gain.empty())
+	{
+		work = gain;
+		double gain_median = median(work);
+		if(gain_median <= 0.)
+		{
+			THROW_HW_ERROR(Error) << "Gain map median is not positive !";
+		}
+		for(size_t i = 0; i < nb_pixels; i++)
+		{
+			double ratio = gain[i] / gain_median;
+			// written to also catch NaN
+			if(!(std::fabs(ratio - 1.) <= gain_tolerance))
+				indices.push_back((unsigned int) i);
+		}
+	}
+
+	DEB_TRACE() << "Defect map : " << nb_hot << " hot pixels, " << indices.size() - nb_hot << " bad response pixels";
+	setIndices(indices, size);
+}
+
+//-----------------------------------------------------
+// @brief read "x y" pairs, one per line
+//-----------------------------------------------------
+void DefectMap::load(const std::string& file_name, const Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(file_name, size);
+	std::ifstream file(file_name.c_str());
+	if(!file)
+	{
+		THROW_HW_ERROR(Error) << "Unable to open the defect map file : " << file_name;
+	}
+
+	std::vector<unsigned int> indices;
+	std::string line;
+	int line_nb = 0;
+	while(std::getline(file, line))
+	{
+		line_nb++;
+		std::string::size_type comment = line.find('#');
+		if(comment != std::string::npos)
+			line.erase(comment);
+		std::istringstream is(line);
+		int x, y;
+		if(!(is >> x))
+			continue;
+		if(!(is >> y) || x < 0 || y < 0 || x >= size.getWidth() || y >= size.getHeight())
+		{
+			THROW_HW_ERROR(Error) << "Invalid defect at line " << line_nb << " of " << file_name;
+		}
+		indices.push_back((unsigned int) y * size.getWidth() + x);
+	}
+	setIndices(indices, size);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void DefectMap::save(const std::string& file_name) const
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	std::ofstream file(file_name.c_str(), std::ios::out | std::ios::trunc);
+	if(!file)
+	{
+		THROW_HW_ERROR(Error) << "Unable to write the defect map file : " << file_name;
+	}
+	file << "# " << m_width << "x" << m_height << " detector, " << m_indices.size() << " defects : x y\n";
+	for(size_t i = 0; i < m_indices.size(); i++)
+	{
+		file << m_indices[i] % m_width << " " << m_indices[i] / m_width << "\n";
+	}
+	if(!file)
+	{
+		THROW_HW_ERROR(Error) << "Unable to write the defect map file : " << file_name;
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void DefectMap::clear()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_indices.clear();
+	m_row_start.clear();
+	m_width = 0;
+	m_height = 0;
+}
+
+int DefectMap::getNbDefects() const
+{
+	AutoMutex lock(m_mutex);
+	return (int) m_indices.size();
+}
+
+//-----------------------------------------------------
+// @brief sort the indices and build the row table
+//-----------------------------------------------------
+void DefectMap::setIndices(std::vector<unsigned int>& indices, const Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	std::sort(indices.begin(), indices.end());
+	indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+	int width = size.getWidth();
+	int height = size.getHeight();
+	std::vector<unsigned int> row_start(height + 1, 0);
+	size_t k = 0;
+	for(int y = 0; y <= height; y++)
+	{
+		unsigned int row_first = (unsigned int) y * width;
+		while(k < indices.size() && indices[k] < row_first)
+			k++;
+		row_start[y] = (unsigned int) k;
+	}
+
+	AutoMutex lock(m_mutex);
+	m_indices.swap(indices);
+	m_row_start.swap(row_start);
+	m_width = width;
+	m_height = height;
+	m_geometry_warned = false;
+	DEB_TRACE() << "Defect map : " << m_indices.size() << " defects";
+}
+
+//-----------------------------------------------------
+// @brief detector coordinates, lock must be held
+//-----------------------------------------------------
+bool DefectMap::isDefect(int x, int y) const
+{
+	const unsigned int* first = m_indices.empty() ? NULL : &m_indices[0];
+	return std::binary_search(first + m_row_start[y], first + m_row_start[y + 1],
+							  (unsigned int) y * m_width + x);
+}
+
+//-----------------------------------------------------
+// @brief rounding for the integer pixel types
+//-----------------------------------------------------
+template<class T> static inline T to_pixel(double v)
+{
+	return (T) (v + 0.5);
+}
+
+template<> inline float to_pixel<float>(double v)
+{
+	return (float) v;
+}
+
+//-----------------------------------------------------
+// @brief only the defects of the frame rows are visited
+//-----------------------------------------------------
+template<class T>
+void DefectMap::replacePixels(T* frame, int width, int height, int x0, int y0)
+{
+	const unsigned int* first = &m_indices[0];
+	double values[8];
+	for(int y = 0; y < height; y++)
+	{
+		int row = y0 + y;
+		unsigned int row_first = (unsigned int) row * m_width;
+		const unsigned int* begin = std::lower_bound(first + m_row_start[row], first + m_row_start[row + 1],
+													 row_first + x0);
+		const unsigned int* end = std::lower_bound(begin, first + m_row_start[row + 1],
+												   row_first + x0 + width);
+		for(const unsigned int* it = begin; it != end; ++it)
+		{
+			int x = (int) (*it - row_first) - x0;
+			int nb_values = 0;
+			for(int dy = -1; dy <= 1; dy++)
+			{
+				int ny = y + dy;
+				if(ny < 0 || ny >= height)
+					continue;
+				for(int dx = -1; dx <= 1; dx++)
+				{
+					int nx = x + dx;
+					if((dx == 0 && dy == 0) || nx < 0 || nx >= width)
+						continue;
+					if(isDefect(x0 + nx, y0 + ny))
+						continue;
+					values[nb_values++] = (double) frame[(size_t) ny * width + nx];
+				}
+			}
+			// a pixel surrounded by defects is left as is
+			if(nb_values == 0)
+				continue;
+
+			double v;
+			if(m_replacement == kReplaceMedian)
+			{
+				std::sort(values, values + nb_values);
+				int mid = nb_values / 2;
+				v = (nb_values & 1) ? values[mid] : 0.5 * (values[mid - 1] + values[mid]);
+			}
+			else
+			{
+				v = 0.;
+				for(int i = 0; i < nb_values; i++)
+					v += values[i];
+				v /= nb_values;
+			}
+			frame[(size_t) y * width + x] = to_pixel<T>(v);
+		}
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void DefectMap::replace(void* frame, ImageType type, int width, int height, int x0, int y0)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	if(m_indices.empty())
+		return;
+	if(x0 < 0 || y0 < 0 || x0 + width > m_width || y0 + height > m_height)
+	{
+		if(!m_geometry_warned)
+		{
+			DEB_ERROR() << "Frame " << width << "x" << height << " at (" << x0 << "," << y0 << ") "
+						<< "is outside of the defect map " << m_width << "x" << m_height;
+			m_geometry_warned = true;
+		}
+		return;
+	}
+
+	switch(type)
+	{
+		case Bpp8:
+			replacePixels((unsigned char*) frame, width, height, x0, y0);
+			break;
+		case Bpp16:
+			replacePixels((unsigned short*) frame, width, height, x0, y0);
+			break;
+		case Bpp32:
+			replacePixels((unsigned int*) frame, width, height, x0, y0);
+			break;
+		case Bpp32F:
+			replacePixels((float*) frame, width, height, x0, y0);
+			break;
+		default:
+			DEB_ERROR() << "Defect replacement : unsupported image type " << type;
+			break;
+	}
+}
+
+//-----------------------------------------------------
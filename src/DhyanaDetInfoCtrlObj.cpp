@@ -22,6 +22,7 @@
 
 #include <cstdlib>
 #include "DhyanaInterface.h"
+#include "DhyanaCamera.h"
 
 using namespace lima;
 using namespace lima::Dhyana;
@@ -120,7 +121,7 @@ void DetInfoCtrlObj::getDetectorModel(std::string& model)
 void DetInfoCtrlObj::registerMaxImageSizeCallback(HwMaxImageSizeCallback& cb)
 {
 	DEB_MEMBER_FUNCT();
-	//m_cam.registerMaxImageSizeCallback(cb);
+	m_cam.registerMaxImageSizeCallback(cb);
 }
 
 //-----------------------------------------------------
@@ -129,6 +130,6 @@ void DetInfoCtrlObj::registerMaxImageSizeCallback(HwMaxImageSizeCallback& cb)
 void DetInfoCtrlObj::unregisterMaxImageSizeCallback(HwMaxImageSizeCallback& cb)
 {
 	DEB_MEMBER_FUNCT();
-	//m_cam.unregisterMaxImageSizeCallback(cb);
+	m_cam.unregisterMaxImageSizeCallback(cb);
 }
 
@@ -0,0 +1,217 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <emmintrin.h>
+#include "lima/Exceptions.h"
+#include "DhyanaFrameAccumulator.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief dst = (first ? 0 : dst) + max(src - dark, 0), widened to 32 bits
+//-----------------------------------------------------
+static void accumulate_row(const unsigned short* src, const unsigned short* dark, unsigned int* dst, int width, bool first)
+{
+	const __m128i zero = _mm_setzero_si128();
+	int x = 0;
+	for(; x + 8 <= width; x += 8)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*) (src + x));
+		if(dark)
+			v = _mm_subs_epu16(v, _mm_loadu_si128((const __m128i*) (dark + x)));
+		__m128i lo = _mm_unpacklo_epi16(v, zero);
+		__m128i hi = _mm_unpackhi_epi16(v, zero);
+		if(!first)
+		{
+			lo = _mm_add_epi32(lo, _mm_loadu_si128((const __m128i*) (dst + x)));
+			hi = _mm_add_epi32(hi, _mm_loadu_si128((const __m128i*) (dst + x + 4)));
+		}
+		_mm_storeu_si128((__m128i*) (dst + x), lo);
+		_mm_storeu_si128((__m128i*) (dst + x + 4), hi);
+	}
+	for(; x < width; x++)
+	{
+		unsigned int v = src[x];
+		if(dark)
+			v = (v > dark[x]) ? v - dark[x] : 0;
+		dst[x] = first ? v : dst[x] + v;
+	}
+}
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+FrameAccumulator::FrameAccumulator() :
+m_enable(false),
+m_nb_frames(1),
+m_count(0),
+m_dark_subtraction(false),
+m_dark_width(0),
+m_dark_height(0),
+m_geometry_warned(false)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+FrameAccumulator::~FrameAccumulator()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameAccumulator::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+	m_count = 0;
+}
+
+bool FrameAccumulator::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameAccumulator::setNbFrames(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+	if(nb_frames < 1 || nb_frames > 65536)
+	{
+		THROW_HW_ERROR(Error) << "Number of accumulated frames must be in [1, 65536] !";
+	}
+	AutoMutex lock(m_mutex);
+	m_nb_frames = nb_frames;
+	m_count = 0;
+}
+
+int FrameAccumulator::getNbFrames() const
+{
+	AutoMutex lock(m_mutex);
+	return m_nb_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameAccumulator::setDarkSubtraction(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	if(enable && m_dark.empty())
+	{
+		THROW_HW_ERROR(Error) << "There is no dark to subtract !";
+	}
+	m_dark_subtraction = enable;
+}
+
+bool FrameAccumulator::getDarkSubtraction() const
+{
+	AutoMutex lock(m_mutex);
+	return m_dark_subtraction;
+}
+
+//-----------------------------------------------------
+// @brief round the dark to 16 bits
+//-----------------------------------------------------
+void FrameAccumulator::setDark(const std::vector<float>& dark, const Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	size_t nb_pixels = (size_t) size.getWidth() * size.getHeight();
+	if(nb_pixels == 0 || dark.size() != nb_pixels)
+	{
+		THROW_HW_ERROR(Error) << "Dark size does not match the detector size !";
+	}
+	std::vector<unsigned short> rounded(nb_pixels);
+	for(size_t i = 0; i < nb_pixels; i++)
+	{
+		float v = dark[i] + 0.5f;
+		rounded[i] = (v <= 0.f) ? 0 : ((v >= 65535.f) ? 65535 : (unsigned short) v);
+	}
+
+	AutoMutex lock(m_mutex);
+	m_dark.swap(rounded);
+	m_dark_width = size.getWidth();
+	m_dark_height = size.getHeight();
+	m_geometry_warned = false;
+}
+
+bool FrameAccumulator::hasDark() const
+{
+	AutoMutex lock(m_mutex);
+	return !m_dark.empty();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameAccumulator::reset()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_count = 0;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool FrameAccumulator::add(const unsigned short* src, unsigned int* dst, int width, int height, int x0, int y0)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	bool subtract = m_dark_subtraction;
+	if(subtract && (x0 < 0 || y0 < 0 || x0 + width > m_dark_width || y0 + height > m_dark_height))
+	{
+		if(!m_geometry_warned)
+		{
+			DEB_ERROR() << "Frame " << width << "x" << height << " at (" << x0 << "," << y0 << ") "
+						<< "is outside of the dark " << m_dark_width << "x" << m_dark_height << ", it is not subtracted";
+			m_geometry_warned = true;
+		}
+		subtract = false;
+	}
+
+	bool first = (m_count == 0);
+	for(int y = 0; y < height; y++)
+	{
+		const unsigned short* dark = subtract ? &m_dark[(size_t) (y0 + y) * m_dark_width + x0] : NULL;
+		accumulate_row(src + (size_t) y * width, dark, dst + (size_t) y * width, width, first);
+	}
+
+	m_count++;
+	if(m_count < m_nb_frames)
+		return false;
+	m_count = 0;
+	return true;
+}
+
+//-----------------------------------------------------
@@ -0,0 +1,421 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cstring>
+#include "lima/Exceptions.h"
+#include "lima/SizeUtils.h"
+#include "lima/Timestamp.h"
+#include "DhyanaFrameCompressor.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+FrameCompressor::FrameCompressor() :
+m_enable(false),
+m_nb_threads(2),
+m_block_size(0),
+m_quit(false),
+m_slots(8),
+m_next_push(0),
+m_next_compress(0),
+m_next_deliver(0),
+m_nb_queued(0),
+m_delivering(false),
+m_callback(NULL)
+{
+	DEB_CONSTRUCTOR();
+	for(size_t i = 0; i < m_slots.size(); i++)
+		m_slots[i].state = kFree;
+	resetStats();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+FrameCompressor::~FrameCompressor()
+{
+	DEB_DESTRUCTOR();
+	stopThreads();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(enable == m_enable)
+			return;
+		m_enable = enable;
+	}
+	if(enable)
+		startThreads();
+	else
+		stopThreads();
+}
+
+bool FrameCompressor::isEnabled() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::setNbThreads(int nb_threads)
+{
+	DEB_MEMBER_FUNCT();
+	if(nb_threads < 1 || nb_threads > 16)
+	{
+		THROW_HW_ERROR(Error) << "Compression nb of threads must be in [1, 16] !";
+	}
+	bool enable = isEnabled();
+	if(enable)
+		stopThreads();
+	{
+		AutoMutex lock(m_cond.mutex());
+		m_nb_threads = nb_threads;
+	}
+	if(enable)
+		startThreads();
+}
+
+int FrameCompressor::getNbThreads() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_nb_threads;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::setQueueDepth(int depth)
+{
+	DEB_MEMBER_FUNCT();
+	if(depth < 1 || depth > 256)
+	{
+		THROW_HW_ERROR(Error) << "Compression queue depth must be in [1, 256] !";
+	}
+	//push and the threads use the slots outside of the lock : nothing is queued anymore,
+	//the frame being copied is waited for, and the threads deliver the queue before they quit
+	bool enable;
+	{
+		AutoMutex lock(m_cond.mutex());
+		enable = m_enable;
+		m_enable = false;
+		bool filling = true;
+		while(filling)
+		{
+			filling = false;
+			for(size_t i = 0; i < m_slots.size(); i++)
+				filling = filling || (m_slots[i].state == kFilling);
+			if(filling)
+				m_cond.wait();
+		}
+	}
+	stopThreads();
+	{
+		AutoMutex lock(m_cond.mutex());
+		m_slots.resize(depth);
+		for(size_t i = 0; i < m_slots.size(); i++)
+			m_slots[i].state = kFree;
+		m_next_push = m_next_compress = m_next_deliver = 0;
+		m_nb_queued = 0;
+		m_enable = enable;
+	}
+	if(enable)
+		startThreads();
+}
+
+int FrameCompressor::getQueueDepth() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return (int) m_slots.size();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::setBlockSize(int block_size)
+{
+	DEB_MEMBER_FUNCT();
+	if(block_size < 0 || block_size % 8)
+	{
+		THROW_HW_ERROR(Error) << "Compression block size must be 0 or a positive multiple of 8 !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_block_size = block_size;
+}
+
+int FrameCompressor::getBlockSize() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_block_size;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::registerCallback(CompressedFrameCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback)
+	{
+		THROW_HW_ERROR(Error) << "A compressed frame callback is already registered !";
+	}
+	m_callback = &cb;
+}
+
+void FrameCompressor::unregisterCallback(CompressedFrameCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback != &cb)
+	{
+		THROW_HW_ERROR(Error) << "This compressed frame callback is not registered !";
+	}
+	m_callback = NULL;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::getStats(CompressionStats& stats) const
+{
+	AutoMutex lock(m_cond.mutex());
+	stats.nb_frames = m_nb_frames;
+	stats.nb_dropped = m_nb_dropped;
+	stats.ratio = (m_compressed_bytes > 0.) ? m_uncompressed_bytes / m_compressed_bytes : 0.;
+	stats.throughput = (m_elapsed > 0.) ? m_uncompressed_bytes / m_elapsed / 1e6 : 0.;
+	stats.queue_peak = m_queue_peak;
+}
+
+void FrameCompressor::resetStats()
+{
+	AutoMutex lock(m_cond.mutex());
+	m_nb_frames = 0;
+	m_nb_dropped = 0;
+	m_uncompressed_bytes = 0.;
+	m_compressed_bytes = 0.;
+	m_elapsed = 0.;
+	m_queue_peak = 0;
+}
+
+//-----------------------------------------------------
+// @brief nothing is left in the queue once the threads are stopped
+//-----------------------------------------------------
+void FrameCompressor::flush()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	while(m_nb_queued > 0 && !m_threads.empty())
+		m_cond.wait();
+}
+
+//-----------------------------------------------------
+// @brief the copy is done outside of the lock, the slot is reserved first
+//-----------------------------------------------------
+bool FrameCompressor::push(const void* frame, ImageType type, int width, int height, int frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	int index;
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(!m_enable)
+			return false;
+		if(m_slots[m_next_push].state != kFree)
+		{
+			if(m_nb_dropped++ == 0)
+			{
+				DEB_WARNING() << "Compression queue is full, frame " << frame_nb << " is not compressed";
+			}
+			return false;
+		}
+		index = m_next_push;
+		m_next_push = (m_next_push + 1) % (int) m_slots.size();
+		m_slots[index].state = kFilling;
+		m_nb_queued++;
+		if(m_nb_queued > m_queue_peak)
+			m_queue_peak = m_nb_queued;
+	}
+
+	Slot& slot = m_slots[index];
+	size_t frame_size = (size_t) width * height * FrameDim::getImageTypeDepth(type);
+	slot.frame_nb = frame_nb;
+	slot.timestamp = Timestamp::now();
+	slot.width = width;
+	slot.height = height;
+	slot.type = type;
+	slot.raw.resize(frame_size);
+	memcpy(&slot.raw[0], frame, frame_size);
+
+	AutoMutex lock(m_cond.mutex());
+	slot.state = kPending;
+	m_cond.broadcast();
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief the queued frames are compressed before the threads quit
+//-----------------------------------------------------
+void FrameCompressor::compressLoop()
+{
+	DEB_MEMBER_FUNCT();
+	BitshuffleLz4 codec;
+	AutoMutex lock(m_cond.mutex());
+	while(true)
+	{
+		while(m_slots[m_next_compress].state != kPending && !m_quit)
+			m_cond.wait();
+		if(m_slots[m_next_compress].state != kPending)
+			return;
+
+		Slot& slot = m_slots[m_next_compress];
+		m_next_compress = (m_next_compress + 1) % (int) m_slots.size();
+		slot.state = kBusy;
+		size_t block_size = (size_t) m_block_size;
+		lock.unlock();
+
+		Timestamp t0 = Timestamp::now();
+		size_t elem_size = FrameDim::getImageTypeDepth(slot.type);
+		size_t nb_elements = (size_t) slot.width * slot.height;
+		slot.compressed.resize(BitshuffleLz4::maxCompressedSize(nb_elements, elem_size, block_size));
+		slot.size = codec.compress(&slot.raw[0], nb_elements, elem_size, block_size, &slot.compressed[0]);
+		slot.elapsed = Timestamp::now() - t0;
+
+		lock.lock();
+		slot.state = kDone;
+		deliver(lock);
+	}
+}
+
+//-----------------------------------------------------
+// @brief one thread at a time delivers the consecutive done slots
+//-----------------------------------------------------
+void FrameCompressor::deliver(AutoMutex& lock)
+{
+	if(m_delivering)
+		return;
+	m_delivering = true;
+	while(m_slots[m_next_deliver].state == kDone)
+	{
+		Slot& slot = m_slots[m_next_deliver];
+		lock.unlock();
+		{
+			AutoMutex cb_lock(m_callback_mutex);
+			if(m_callback)
+			{
+				CompressedFrame frame;
+				frame.frame_nb = slot.frame_nb;
+				frame.timestamp = slot.timestamp;
+				frame.width = slot.width;
+				frame.height = slot.height;
+				frame.type = slot.type;
+				frame.uncompressed_size = slot.raw.size();
+				frame.data = &slot.compressed[0];
+				frame.size = slot.size;
+				m_callback->compressedFrameReady(frame);
+			}
+		}
+		lock.lock();
+
+		m_nb_frames++;
+		m_uncompressed_bytes += (double) slot.raw.size();
+		m_compressed_bytes += (double) slot.size;
+		m_elapsed += slot.elapsed;
+		slot.state = kFree;
+		m_next_deliver = (m_next_deliver + 1) % (int) m_slots.size();
+		m_nb_queued--;
+		m_cond.broadcast();
+	}
+	m_delivering = false;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::startThreads()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_quit = false;
+	for(int i = 0; i < m_nb_threads; i++)
+	{
+		WorkerThread* thread = new WorkerThread(*this);
+		m_threads.push_back(thread);
+		thread->start();
+	}
+	DEB_TRACE() << "Compression threads started : " << DEB_VAR1(m_nb_threads);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::stopThreads()
+{
+	DEB_MEMBER_FUNCT();
+	std::vector<WorkerThread*> threads;
+	{
+		AutoMutex lock(m_cond.mutex());
+		m_quit = true;
+		m_cond.broadcast();
+		threads.swap(m_threads);
+	}
+	//the threads join in their dtor
+	for(size_t i = 0; i < threads.size(); i++)
+		delete threads[i];
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCompressor::WorkerThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	m_compressor.compressLoop();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+FrameCompressor::WorkerThread::WorkerThread(FrameCompressor& compressor) :
+m_compressor(compressor)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+FrameCompressor::WorkerThread::~WorkerThread()
+{
+	join();
+}
+
+//-----------------------------------------------------
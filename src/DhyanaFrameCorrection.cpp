@@ -0,0 +1,447 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <fstream>
+#include <emmintrin.h>
+#include "lima/Exceptions.h"
+#include "DhyanaFrameCorrection.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+FrameCorrection::FrameCorrection() :
+m_enable(false),
+m_output_type(Bpp16),
+m_clamp(true),
+m_map_width(0),
+m_map_height(0),
+m_geometry_warned(false),
+m_dark_nb_frames(0),
+m_dark_remaining(0)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+FrameCorrection::~FrameCorrection()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCorrection::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+	m_geometry_warned = false;
+}
+
+bool FrameCorrection::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCorrection::setOutputType(ImageType type)
+{
+	DEB_MEMBER_FUNCT();
+	if(type != Bpp16 && type != Bpp32F)
+	{
+		THROW_HW_ERROR(Error) << "Correction output type must be Bpp16 or Bpp32F !";
+	}
+	AutoMutex lock(m_mutex);
+	m_output_type = type;
+}
+
+ImageType FrameCorrection::getOutputType() const
+{
+	AutoMutex lock(m_mutex);
+	return m_output_type;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCorrection::setClamp(bool clamp)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_clamp = clamp;
+}
+
+bool FrameCorrection::getClamp() const
+{
+	AutoMutex lock(m_mutex);
+	return m_clamp;
+}
+
+//-----------------------------------------------------
+// @brief copy a map, offset and gain maps must have the same size
+//-----------------------------------------------------
+void FrameCorrection::setMap(const float* map, const Size& size, std::vector<float>& dst)
+{
+	DEB_MEMBER_FUNCT();
+	int width = size.getWidth();
+	int height = size.getHeight();
+	if(width <= 0 || height <= 0)
+	{
+		THROW_HW_ERROR(Error) << "Correction map size is empty !";
+	}
+
+	AutoMutex lock(m_mutex);
+	std::vector<float>& other = (&dst == &m_offset) ? m_gain : m_offset;
+	if(!other.empty() && (width != m_map_width || height != m_map_height))
+	{
+		THROW_HW_ERROR(Error) << "Offset and gain maps must have the same size !";
+	}
+	dst.assign(map, map + (size_t) width * height);
+	m_map_width = width;
+	m_map_height = height;
+	m_geometry_warned = false;
+}
+
+void FrameCorrection::setOffsetMap(const float* map, const Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	setMap(map, size, m_offset);
+}
+
+void FrameCorrection::setGainMap(const float* map, const Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	setMap(map, size, m_gain);
+}
+
+//-----------------------------------------------------
+// @brief read a raw float32 map of the given size
+//-----------------------------------------------------
+void FrameCorrection::loadMap(const std::string& file_name, const Size& size, std::vector<float>& map)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(file_name, size);
+	size_t nb_pixels = (size_t) size.getWidth() * size.getHeight();
+	std::vector<float> data(nb_pixels);
+
+	std::ifstream file(file_name.c_str(), std::ios::in | std::ios::binary);
+	if(!file)
+	{
+		THROW_HW_ERROR(Error) << "Unable to open the correction map file : " << file_name;
+	}
+	file.seekg(0, std::ios::end);
+	std::streamoff file_size = file.tellg();
+	if(file_size != (std::streamoff) (nb_pixels * sizeof(float)))
+	{
+		THROW_HW_ERROR(Error) << "Correction map file " << file_name << " has " << file_size
+							  << " bytes, expected " << nb_pixels * sizeof(float)
+							  << " (float32 " << size.getWidth() << "x" << size.getHeight() << ")";
+	}
+	file.seekg(0, std::ios::beg);
+	if(nb_pixels && !file.read((char*) &data[0], nb_pixels * sizeof(float)))
+	{
+		THROW_HW_ERROR(Error) << "Unable to read the correction map file : " << file_name;
+	}
+	setMap(nb_pixels ? &data[0] : NULL, size, map);
+}
+
+void FrameCorrection::loadOffsetMap(const std::string& file_name, const Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	loadMap(file_name, size, m_offset);
+}
+
+void FrameCorrection::loadGainMap(const std::string& file_name, const Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	loadMap(file_name, size, m_gain);
+}
+
+//-----------------------------------------------------
+// @brief write the offset map as raw float32
+//-----------------------------------------------------
+void FrameCorrection::saveOffsetMap(const std::string& file_name)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	if(m_offset.empty())
+	{
+		THROW_HW_ERROR(Error) << "There is no offset map to save !";
+	}
+	std::ofstream file(file_name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!file || !file.write((const char*) &m_offset[0], m_offset.size() * sizeof(float)))
+	{
+		THROW_HW_ERROR(Error) << "Unable to write the offset map file : " << file_name;
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCorrection::clearMaps()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_offset.clear();
+	m_gain.clear();
+	m_map_width = 0;
+	m_map_height = 0;
+}
+
+bool FrameCorrection::hasOffsetMap() const
+{
+	AutoMutex lock(m_mutex);
+	return !m_offset.empty();
+}
+
+bool FrameCorrection::hasGainMap() const
+{
+	AutoMutex lock(m_mutex);
+	return !m_gain.empty();
+}
+
+void FrameCorrection::getMaps(std::vector<float>& offset, std::vector<float>& gain, Size& size) const
+{
+	AutoMutex lock(m_mutex);
+	offset = m_offset;
+	gain = m_gain;
+	size = Size(m_map_width, m_map_height);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameCorrection::startDarkAccumulation(int nb_frames, const Size& size)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_frames);
+	// the sums are 32 bits : 65535 * 65536 fits
+	if(nb_frames < 1 || nb_frames > 65536)
+	{
+		THROW_HW_ERROR(Error) << "Number of dark frames must be in [1, 65536] !";
+	}
+	AutoMutex lock(m_mutex);
+	if(!m_gain.empty() && (size.getWidth() != m_map_width || size.getHeight() != m_map_height))
+	{
+		THROW_HW_ERROR(Error) << "Dark size does not match the gain map size !";
+	}
+	m_map_width = size.getWidth();
+	m_map_height = size.getHeight();
+	m_dark_sum.assign((size_t) m_map_width * m_map_height, 0);
+	m_dark_nb_frames = nb_frames;
+	m_dark_remaining = nb_frames;
+}
+
+void FrameCorrection::abortDarkAccumulation()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_dark_remaining = 0;
+	m_dark_sum.clear();
+}
+
+int FrameCorrection::getDarkAccumulationRemaining() const
+{
+	AutoMutex lock(m_mutex);
+	return m_dark_remaining;
+}
+
+//-----------------------------------------------------
+// @brief add the frame to the dark sums, build the offset map after the last one
+//-----------------------------------------------------
+void FrameCorrection::accumulateDark(const unsigned short* src, int width, int height, int x0, int y0)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	if(m_dark_remaining <= 0)
+		return;
+	if(x0 < 0 || y0 < 0 || x0 + width > m_map_width || y0 + height > m_map_height)
+	{
+		DEB_ERROR() << "Dark frame is outside of the map, accumulation is aborted";
+		m_dark_remaining = 0;
+		m_dark_sum.clear();
+		return;
+	}
+
+	const __m128i zero = _mm_setzero_si128();
+	for(int y = 0; y < height; y++)
+	{
+		const unsigned short* in = src + (size_t) y * width;
+		unsigned int* sum = &m_dark_sum[(size_t) (y0 + y) * m_map_width + x0];
+		int x = 0;
+		for(; x + 8 <= width; x += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*) (in + x));
+			__m128i s0 = _mm_loadu_si128((const __m128i*) (sum + x));
+			__m128i s1 = _mm_loadu_si128((const __m128i*) (sum + x + 4));
+			s0 = _mm_add_epi32(s0, _mm_unpacklo_epi16(v, zero));
+			s1 = _mm_add_epi32(s1, _mm_unpackhi_epi16(v, zero));
+			_mm_storeu_si128((__m128i*) (sum + x), s0);
+			_mm_storeu_si128((__m128i*) (sum + x + 4), s1);
+		}
+		for(; x < width; x++)
+		{
+			sum[x] += in[x];
+		}
+	}
+
+	m_dark_remaining--;
+	if(m_dark_remaining == 0)
+	{
+		if(!m_gain.empty() && m_gain.size() != m_dark_sum.size())
+		{
+			DEB_ERROR() << "Dark size does not match the gain map size !";
+			m_dark_sum.clear();
+			return;
+		}
+		float inv_nb = 1.f / (float) m_dark_nb_frames;
+		m_offset.resize(m_dark_sum.size());
+		for(size_t i = 0; i < m_dark_sum.size(); i++)
+		{
+			m_offset[i] = (float) m_dark_sum[i] * inv_nb;
+		}
+		m_dark_sum.clear();
+		m_geometry_warned = false;
+		DEB_TRACE() << "Offset map computed from " << m_dark_nb_frames << " dark frames";
+	}
+}
+
+//-----------------------------------------------------
+// @brief the frame must be inside the maps
+//-----------------------------------------------------
+bool FrameCorrection::checkGeometry(int width, int height, int x0, int y0)
+{
+	DEB_MEMBER_FUNCT();
+	if(m_offset.empty() && m_gain.empty())
+		return true;
+	if(x0 >= 0 && y0 >= 0 && x0 + width <= m_map_width && y0 + height <= m_map_height)
+		return true;
+	if(!m_geometry_warned)
+	{
+		DEB_ERROR() << "Frame " << width << "x" << height << " at (" << x0 << "," << y0 << ") "
+					<< "is outside of the correction maps " << m_map_width << "x" << m_map_height;
+		m_geometry_warned = true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------
+// @brief correct 4 pixels
+//-----------------------------------------------------
+static inline __m128 correct_ps(__m128i v32, const float* offset, const float* gain)
+{
+	__m128 v = _mm_cvtepi32_ps(v32);
+	return _mm_mul_ps(_mm_sub_ps(v, _mm_loadu_ps(offset)), _mm_loadu_ps(gain));
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool FrameCorrection::apply(const unsigned short* src, void* dst, int width, int height, int x0, int y0)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	//outside of the maps, the frame is only converted to the output type
+	bool in_maps = checkGeometry(width, height, x0, y0);
+
+	if((int) m_zero_row.size() < width)
+	{
+		m_zero_row.assign(width, 0.f);
+		m_unit_row.assign(width, 1.f);
+	}
+
+	const bool is_float = (m_output_type == Bpp32F);
+	const bool clamp = m_clamp;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 fzero = _mm_setzero_ps();
+	const __m128 fmax = _mm_set1_ps(65535.f);
+	const __m128i bias32 = _mm_set1_epi32(32768);
+	const __m128i bias16 = _mm_set1_epi16((short) 0x8000);
+
+	for(int y = 0; y < height; y++)
+	{
+		size_t map_row = (size_t) (y0 + y) * m_map_width + x0;
+		const float* offset = (!in_maps || m_offset.empty()) ? &m_zero_row[0] : &m_offset[map_row];
+		const float* gain = (!in_maps || m_gain.empty()) ? &m_unit_row[0] : &m_gain[map_row];
+		const unsigned short* in = src + (size_t) y * width;
+		int x = 0;
+
+		if(is_float)
+		{
+			float* out = ((float*) dst) + (size_t) y * width;
+			for(; x + 8 <= width; x += 8)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*) (in + x));
+				__m128 lo = correct_ps(_mm_unpacklo_epi16(v, zero), offset + x, gain + x);
+				__m128 hi = correct_ps(_mm_unpackhi_epi16(v, zero), offset + x + 4, gain + x + 4);
+				if(clamp)
+				{
+					lo = _mm_max_ps(lo, fzero);
+					hi = _mm_max_ps(hi, fzero);
+				}
+				_mm_storeu_ps(out + x, lo);
+				_mm_storeu_ps(out + x + 4, hi);
+			}
+			for(; x < width; x++)
+			{
+				float c = ((float) in[x] - offset[x]) * gain[x];
+				out[x] = (clamp && c < 0.f) ? 0.f : c;
+			}
+		}
+		else
+		{
+			unsigned short* out = ((unsigned short*) dst) + (size_t) y * width;
+			for(; x + 8 <= width; x += 8)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i*) (in + x));
+				__m128 lo = correct_ps(_mm_unpacklo_epi16(v, zero), offset + x, gain + x);
+				__m128 hi = correct_ps(_mm_unpackhi_epi16(v, zero), offset + x + 4, gain + x + 4);
+				lo = _mm_min_ps(_mm_max_ps(lo, fzero), fmax);
+				hi = _mm_min_ps(_mm_max_ps(hi, fzero), fmax);
+				// no unsigned 32->16 pack in SSE2 : pack signed around 32768
+				__m128i lo32 = _mm_sub_epi32(_mm_cvtps_epi32(lo), bias32);
+				__m128i hi32 = _mm_sub_epi32(_mm_cvtps_epi32(hi), bias32);
+				__m128i packed = _mm_xor_si128(_mm_packs_epi32(lo32, hi32), bias16);
+				_mm_storeu_si128((__m128i*) (out + x), packed);
+			}
+			for(; x < width; x++)
+			{
+				float c = ((float) in[x] - offset[x]) * gain[x];
+				c = (c < 0.f) ? 0.f : ((c > 65535.f) ? 65535.f : c);
+				//rounded to nearest even like _mm_cvtps_epi32, whatever the column
+				out[x] = (unsigned short) _mm_cvtss_si32(_mm_set_ss(c));
+			}
+		}
+	}
+	return in_maps;
+}
+
+//-----------------------------------------------------
@@ -0,0 +1,372 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "DhyanaFrameHistogram.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief 4 pixels per iteration in 4 sub histograms
+//-----------------------------------------------------
+template<class T>
+static void histogram_integer(const T* src, size_t n, unsigned int shift, unsigned int last_bin,
+							  unsigned int* h0, unsigned int* h1, unsigned int* h2, unsigned int* h3)
+{
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		unsigned int b0 = (unsigned int) src[i] >> shift;
+		unsigned int b1 = (unsigned int) src[i + 1] >> shift;
+		unsigned int b2 = (unsigned int) src[i + 2] >> shift;
+		unsigned int b3 = (unsigned int) src[i + 3] >> shift;
+		h0[(b0 < last_bin) ? b0 : last_bin]++;
+		h1[(b1 < last_bin) ? b1 : last_bin]++;
+		h2[(b2 < last_bin) ? b2 : last_bin]++;
+		h3[(b3 < last_bin) ? b3 : last_bin]++;
+	}
+	for(; i < n; i++)
+	{
+		unsigned int b = (unsigned int) src[i] >> shift;
+		h0[(b < last_bin) ? b : last_bin]++;
+	}
+}
+
+//-----------------------------------------------------
+// @brief float pixels, negative values go to the first bin
+//-----------------------------------------------------
+static inline unsigned int float_bin(float v, float inv_width, unsigned int last_bin)
+{
+	if(!(v > 0.f))
+		return 0;
+	float b = v * inv_width;
+	return (b < (float) last_bin) ? (unsigned int) b : last_bin;
+}
+
+static void histogram_float(const float* src, size_t n, float inv_width, unsigned int last_bin,
+							unsigned int* h0, unsigned int* h1, unsigned int* h2, unsigned int* h3)
+{
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4)
+	{
+		h0[float_bin(src[i], inv_width, last_bin)]++;
+		h1[float_bin(src[i + 1], inv_width, last_bin)]++;
+		h2[float_bin(src[i + 2], inv_width, last_bin)]++;
+		h3[float_bin(src[i + 3], inv_width, last_bin)]++;
+	}
+	for(; i < n; i++)
+	{
+		h0[float_bin(src[i], inv_width, last_bin)]++;
+	}
+}
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+FrameHistogram::FrameHistogram() :
+m_enable(false),
+m_source(kSourceHost),
+m_nb_bins(1024),
+m_history(16),
+m_history_next(0),
+m_history_count(0),
+m_callback(NULL)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+FrameHistogram::~FrameHistogram()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameHistogram::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+}
+
+bool FrameHistogram::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameHistogram::setSource(Source source)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_source = source;
+}
+
+FrameHistogram::Source FrameHistogram::getSource() const
+{
+	AutoMutex lock(m_mutex);
+	return m_source;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameHistogram::setNbBins(int nb_bins)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(nb_bins);
+	if(nb_bins < 16 || nb_bins > 65536 || (nb_bins & (nb_bins - 1)))
+	{
+		THROW_HW_ERROR(Error) << "Histogram nb of bins must be a power of 2 in [16, 65536] !";
+	}
+	AutoMutex lock(m_mutex);
+	m_nb_bins = nb_bins;
+}
+
+int FrameHistogram::getNbBins() const
+{
+	AutoMutex lock(m_mutex);
+	return m_nb_bins;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameHistogram::setHistorySize(int size)
+{
+	DEB_MEMBER_FUNCT();
+	if(size < 1)
+	{
+		THROW_HW_ERROR(Error) << "Histogram history size must be at least 1 !";
+	}
+	AutoMutex lock(m_mutex);
+	m_history.assign(size, FrameHistogramData());
+	m_history_next = 0;
+	m_history_count = 0;
+}
+
+int FrameHistogram::getHistorySize() const
+{
+	AutoMutex lock(m_mutex);
+	return (int) m_history.size();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameHistogram::registerCallback(FrameHistogramCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback)
+	{
+		THROW_HW_ERROR(Error) << "A histogram callback is already registered !";
+	}
+	m_callback = &cb;
+}
+
+void FrameHistogram::unregisterCallback(FrameHistogramCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback != &cb)
+	{
+		THROW_HW_ERROR(Error) << "This histogram callback is not registered !";
+	}
+	m_callback = NULL;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool FrameHistogram::getLast(FrameHistogramData& histogram) const
+{
+	AutoMutex lock(m_mutex);
+	if(m_history_count == 0)
+		return false;
+	int last = (m_history_next + (int) m_history.size() - 1) % (int) m_history.size();
+	histogram = m_history[last];
+	return true;
+}
+
+void FrameHistogram::getHistory(std::vector<FrameHistogramData>& history) const
+{
+	AutoMutex lock(m_mutex);
+	history.clear();
+	history.reserve(m_history_count);
+	int size = (int) m_history.size();
+	int first = (m_history_next + size - m_history_count) % size;
+	for(int k = 0; k < m_history_count; k++)
+	{
+		history.push_back(m_history[(first + k) % size]);
+	}
+}
+
+void FrameHistogram::reset()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_history_next = 0;
+	m_history_count = 0;
+}
+
+//-----------------------------------------------------
+// @brief width of a bin, at least 1
+//-----------------------------------------------------
+unsigned int FrameHistogram::binWidth(int range_bits, int nb_bins)
+{
+	unsigned int width = (unsigned int) ((1ULL << range_bits) / (unsigned int) nb_bins);
+	return (width == 0) ? 1 : width;
+}
+
+//-----------------------------------------------------
+// @brief store in the ring buffer and call the callback
+//-----------------------------------------------------
+void FrameHistogram::publish(const FrameHistogramData& histogram)
+{
+	{
+		AutoMutex lock(m_mutex);
+		m_history[m_history_next] = histogram;
+		m_history_next = (m_history_next + 1) % (int) m_history.size();
+		if(m_history_count < (int) m_history.size())
+			m_history_count++;
+	}
+
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback)
+	{
+		m_callback->frameHistogramReady(histogram);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool FrameHistogram::compute(const void* frame, ImageType type, size_t nb_pixels, int range_bits, int frame_nb,
+							 FrameHistogramData& histogram)
+{
+	DEB_MEMBER_FUNCT();
+	int nb_bins = getNbBins();
+	if(type == Bpp8)
+		range_bits = 8;
+	else if(range_bits < 8 || range_bits > 32)
+		range_bits = 16;
+
+	unsigned int bin_width = binWidth(range_bits, nb_bins);
+	unsigned int shift = 0;
+	while((1U << shift) < bin_width)
+		shift++;
+	unsigned int last_bin = nb_bins - 1;
+
+	m_private_bins.assign(4 * (size_t) nb_bins, 0);
+	unsigned int* h0 = &m_private_bins[0];
+	unsigned int* h1 = h0 + nb_bins;
+	unsigned int* h2 = h1 + nb_bins;
+	unsigned int* h3 = h2 + nb_bins;
+	switch(type)
+	{
+		case Bpp8:
+			histogram_integer((const unsigned char*) frame, nb_pixels, shift, last_bin, h0, h1, h2, h3);
+			break;
+		case Bpp16:
+			histogram_integer((const unsigned short*) frame, nb_pixels, shift, last_bin, h0, h1, h2, h3);
+			break;
+		case Bpp32:
+			histogram_integer((const unsigned int*) frame, nb_pixels, shift, last_bin, h0, h1, h2, h3);
+			break;
+		case Bpp32F:
+			histogram_float((const float*) frame, nb_pixels, 1.f / (float) bin_width, last_bin, h0, h1, h2, h3);
+			break;
+		default:
+			DEB_ERROR() << "Histogram : unsupported image type " << type;
+			return false;
+	}
+
+	histogram.frame_nb = frame_nb;
+	histogram.timestamp = Timestamp::now();
+	histogram.bin_width = bin_width;
+	histogram.from_camera = false;
+	histogram.bins.resize(nb_bins);
+	for(int b = 0; b < nb_bins; b++)
+	{
+		histogram.bins[b] = h0[b] + h1[b] + h2[b] + h3[b];
+	}
+	return true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameHistogram::fromCamera(const unsigned int* camera_bins, size_t nb_camera_bins, int bit_depth, int frame_nb,
+								FrameHistogramData& histogram)
+{
+	DEB_MEMBER_FUNCT();
+	int nb_bins = getNbBins();
+	unsigned int bin_width = binWidth(bit_depth, nb_bins);
+	unsigned long long camera_width = (1ULL << bit_depth) / nb_camera_bins;
+	if(camera_width == 0)
+		camera_width = 1;
+
+	histogram.frame_nb = frame_nb;
+	histogram.timestamp = Timestamp::now();
+	histogram.bin_width = bin_width;
+	histogram.from_camera = true;
+	histogram.bins.assign(nb_bins, 0);
+	for(size_t i = 0; i < nb_camera_bins; i++)
+	{
+		unsigned long long b = (i * camera_width) / bin_width;
+		histogram.bins[(b < (unsigned long long) nb_bins) ? (size_t) b : nb_bins - 1] += camera_bins[i];
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+double FrameHistogram::percentile(const FrameHistogramData& histogram, double fraction)
+{
+	unsigned long long total = 0;
+	for(size_t b = 0; b < histogram.bins.size(); b++)
+		total += histogram.bins[b];
+	if(total == 0)
+		return 0.;
+
+	double target = fraction * (double) total;
+	unsigned long long count = 0;
+	for(size_t b = 0; b < histogram.bins.size(); b++)
+	{
+		count += histogram.bins[b];
+		if((double) count >= target)
+			return (double) (b + 1) * histogram.bin_width - 1.;
+	}
+	return (double) histogram.bins.size() * histogram.bin_width - 1.;
+}
+
+//-----------------------------------------------------
@@ -0,0 +1,346 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cstring>
+#include <sstream>
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "DhyanaFramePublisher.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+static const size_t RING_PAGE_SIZE = 4096;
+
+//-----------------------------------------------------
+// generations tried when the next ones are still mapped by old readers
+//-----------------------------------------------------
+static const int RING_CREATE_ATTEMPTS = 16;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+FramePublisher::FramePublisher() :
+m_enable(false),
+m_name("Local\\DhyanaFrames"),
+m_nb_slots(4),
+m_directory_mapping(NULL),
+m_directory(NULL),
+m_mapping(NULL),
+m_data(NULL),
+m_header(NULL),
+m_width(0),
+m_height(0),
+m_image_type(Bpp16),
+m_frame_size(0),
+m_start_time(0.),
+m_nb_frames(0)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+FramePublisher::~FramePublisher()
+{
+	DEB_DESTRUCTOR();
+	removeRing();
+	removeDirectory();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FramePublisher::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+	if(!enable)
+	{
+		removeRing();
+		removeDirectory();
+	}
+}
+
+bool FramePublisher::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+// @brief the ring is created with the new name at the next acquisition
+//-----------------------------------------------------
+void FramePublisher::setName(const std::string& name)
+{
+	DEB_MEMBER_FUNCT();
+	if(name.empty())
+	{
+		THROW_HW_ERROR(Error) << "Shared memory name can not be empty !";
+	}
+	AutoMutex lock(m_mutex);
+	if(name != m_name)
+	{
+		removeRing();
+		removeDirectory();
+	}
+	m_name = name;
+}
+
+std::string FramePublisher::getName() const
+{
+	AutoMutex lock(m_mutex);
+	return m_name;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FramePublisher::setNbSlots(int nb_slots)
+{
+	DEB_MEMBER_FUNCT();
+	if(nb_slots < 2 || nb_slots > 256)
+	{
+		THROW_HW_ERROR(Error) << "Shared memory nb of slots must be in [2, 256] !";
+	}
+	AutoMutex lock(m_mutex);
+	if(nb_slots != m_nb_slots)
+		removeRing();
+	m_nb_slots = nb_slots;
+}
+
+int FramePublisher::getNbSlots() const
+{
+	AutoMutex lock(m_mutex);
+	return m_nb_slots;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FramePublisher::getStats(SharedMemoryStats& stats) const
+{
+	AutoMutex lock(m_mutex);
+	stats.name = (m_header) ? m_ring_name : std::string();
+	stats.generation = (m_directory) ? (int) m_directory->generation : 0;
+	stats.nb_slots = (m_header) ? (int) m_header->nb_slots : 0;
+	stats.slot_size = (m_header) ? (int) m_header->slot_size : 0;
+	stats.nb_published = (m_header) ? m_header->nb_published : 0;
+	stats.nb_frames = m_nb_frames;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FramePublisher::start(const FrameDim& frame_dim)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	if(!m_enable)
+		return;
+	m_width = frame_dim.getSize().getWidth();
+	m_height = frame_dim.getSize().getHeight();
+	m_image_type = frame_dim.getImageType();
+	m_frame_size = frame_dim.getMemSize();
+	if(m_header == NULL || m_frame_size > m_header->max_frame_size)
+	{
+		removeRing();
+		createRing(m_frame_size);
+	}
+	m_start_time = Timestamp::now();
+	m_nb_frames = 0;
+}
+
+//-----------------------------------------------------
+// @brief single writer : the slot sequence is odd during the copy
+//-----------------------------------------------------
+void FramePublisher::push(const void* frame, int frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	if(m_header == NULL)
+		return;
+	LONGLONG index = m_header->nb_published;
+	size_t offset = m_header->header_size + (size_t) (index % m_header->nb_slots) * m_header->slot_size;
+	SharedSlotHeader* slot = (SharedSlotHeader *) (m_data + offset);
+
+	InterlockedIncrement(&slot->sequence);
+	slot->frame_nb = frame_nb;
+	slot->width = m_width;
+	slot->height = m_height;
+	slot->image_type = m_image_type;
+	slot->size = (unsigned int) m_frame_size;
+	slot->timestamp = (double) Timestamp::now() - m_start_time;
+	slot->index = index;
+	memcpy((unsigned char *) slot + SHARED_SLOT_DATA_OFFSET, frame, m_frame_size);
+	InterlockedIncrement(&slot->sequence);
+
+	InterlockedExchange64(&m_header->nb_published, index + 1);
+	m_nb_frames++;
+}
+
+//-----------------------------------------------------
+// @brief the directory has a fixed size : the one still mapped by a reader is reused
+//-----------------------------------------------------
+void FramePublisher::openDirectory()
+{
+	DEB_MEMBER_FUNCT();
+	if(m_directory)
+		return;
+	HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, SHARED_DIRECTORY_SIZE, m_name.c_str());
+	if(mapping == NULL)
+	{
+		THROW_HW_ERROR(Error) << "Unable to create the shared memory " << m_name << " (error " << GetLastError() << ") !";
+	}
+	SharedRingDirectory* directory = (SharedRingDirectory *) MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, SHARED_DIRECTORY_SIZE);
+	if(directory == NULL)
+	{
+		DWORD error = GetLastError();
+		CloseHandle(mapping);
+		THROW_HW_ERROR(Error) << "Unable to map the shared memory " << m_name << " (error " << error << ") !";
+	}
+	if(directory->magic[0] == 0)
+	{
+		//new mapping, zeroed
+		directory->generation = 0;
+		MemoryBarrier();
+		memcpy(directory->magic, SHARED_DIRECTORY_MAGIC, sizeof(directory->magic));
+	}
+	else if(memcmp(directory->magic, SHARED_DIRECTORY_MAGIC, sizeof(directory->magic)) != 0)
+	{
+		UnmapViewOfFile(directory);
+		CloseHandle(mapping);
+		THROW_HW_ERROR(Error) << "The shared memory " << m_name << " is used by another application !";
+	}
+	m_directory_mapping = mapping;
+	m_directory = directory;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FramePublisher::removeDirectory()
+{
+	DEB_MEMBER_FUNCT();
+	if(m_directory)
+	{
+		UnmapViewOfFile(m_directory);
+		m_directory = NULL;
+	}
+	if(m_directory_mapping)
+	{
+		CloseHandle(m_directory_mapping);
+		m_directory_mapping = NULL;
+	}
+}
+
+//-----------------------------------------------------
+// @brief a ring of the next generation, the old rings may still be mapped by the readers
+//-----------------------------------------------------
+void FramePublisher::createRing(size_t max_frame_size)
+{
+	DEB_MEMBER_FUNCT();
+	openDirectory();
+	size_t slot_size = (SHARED_SLOT_DATA_OFFSET + max_frame_size + RING_PAGE_SIZE - 1) / RING_PAGE_SIZE * RING_PAGE_SIZE;
+	unsigned long long total_size = SHARED_RING_HEADER_SIZE + (unsigned long long) slot_size * m_nb_slots;
+
+	//an existing ring of the same name can not be reused, its size is unknown
+	HANDLE mapping = NULL;
+	LONG generation = m_directory->generation;
+	std::string ring_name;
+	for(int attempt = 0; attempt < RING_CREATE_ATTEMPTS && mapping == NULL; attempt++)
+	{
+		generation++;
+		std::ostringstream name;
+		name << m_name << "_" << generation;
+		ring_name = name.str();
+		mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+									 (DWORD) (total_size >> 32), (DWORD) total_size, ring_name.c_str());
+		if(mapping == NULL)
+		{
+			THROW_HW_ERROR(Error) << "Unable to create the shared memory " << ring_name << " (error " << GetLastError() << ") !";
+		}
+		if(GetLastError() == ERROR_ALREADY_EXISTS)
+		{
+			CloseHandle(mapping);
+			mapping = NULL;
+		}
+	}
+	if(mapping == NULL)
+	{
+		THROW_HW_ERROR(Error) << "The shared memories " << m_name << "_<n> up to " << ring_name << " are still mapped by other processes !";
+	}
+	unsigned char* data = (unsigned char *) MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+	if(data == NULL)
+	{
+		DWORD error = GetLastError();
+		CloseHandle(mapping);
+		THROW_HW_ERROR(Error) << "Unable to map the shared memory " << ring_name << " (error " << error << ") !";
+	}
+
+	//the pages of a new mapping are zeroed, the slot sequences start at 0
+	SharedRingHeader* header = (SharedRingHeader *) data;
+	header->header_size = SHARED_RING_HEADER_SIZE;
+	header->nb_slots = m_nb_slots;
+	header->slot_size = (unsigned int) slot_size;
+	header->max_frame_size = (unsigned int) (slot_size - SHARED_SLOT_DATA_OFFSET);
+	header->closed = 0;
+	header->nb_published = 0;
+	MemoryBarrier();
+	//the readers check the magic last
+	memcpy(header->magic, SHARED_RING_MAGIC, sizeof(header->magic));
+	//the readers follow the directory once the ring is ready
+	InterlockedExchange(&m_directory->generation, generation);
+
+	m_ring_name = ring_name;
+	m_mapping = mapping;
+	m_data = data;
+	m_header = header;
+	DEB_TRACE() << "Shared memory " << m_ring_name << " : " << m_nb_slots << " slots of " << slot_size << " bytes";
+}
+
+//-----------------------------------------------------
+// @brief the readers see the ring closed and open the next one
+//-----------------------------------------------------
+void FramePublisher::removeRing()
+{
+	DEB_MEMBER_FUNCT();
+	if(m_header)
+	{
+		InterlockedExchange(&m_header->closed, 1);
+		m_header = NULL;
+	}
+	if(m_data)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = NULL;
+	}
+	if(m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = NULL;
+	}
+}
+
+//-----------------------------------------------------
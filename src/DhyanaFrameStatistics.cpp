@@ -0,0 +1,497 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cmath>
+#include <emmintrin.h>
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "DhyanaFrameStatistics.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// pixels per SSE2 block : the 16 and 32 bits lane counters can not overflow
+//-----------------------------------------------------
+static const size_t STATS_BLOCK_PIXELS = 4096 * 8;
+
+//-----------------------------------------------------
+// @brief running sums of a frame or a roi
+//-----------------------------------------------------
+struct StatsAccum
+{
+	double				min;
+	double				max;
+	unsigned long long	sum;		// integer pixels
+	unsigned long long	sum_sq;
+	double				fsum;		// float pixels
+	double				fsum_sq;
+	long long			nb_pixels;
+	long long			nb_saturated;
+
+	StatsAccum() :
+	min(0.), max(0.), sum(0), sum_sq(0), fsum(0.), fsum_sq(0.), nb_pixels(0), nb_saturated(0)
+	{
+	}
+
+	void add(double v_min, double v_max)
+	{
+		if(nb_pixels == 0 || v_min < min)
+			min = v_min;
+		if(nb_pixels == 0 || v_max > max)
+			max = v_max;
+	}
+
+	void toStats(FrameStats& stats) const
+	{
+		stats.nb_pixels = nb_pixels;
+		stats.min = min;
+		stats.max = max;
+		stats.sum = (double) sum + fsum;
+		stats.nb_saturated = nb_saturated;
+		stats.mean = 0.;
+		stats.std = 0.;
+		if(nb_pixels > 0)
+		{
+			stats.mean = stats.sum / nb_pixels;
+			double variance = ((double) sum_sq + fsum_sq) / nb_pixels - stats.mean * stats.mean;
+			stats.std = (variance > 0.) ? std::sqrt(variance) : 0.;
+		}
+	}
+};
+
+//-----------------------------------------------------
+// @brief SSE2 statistics (and copy if dst) of n 16 bits pixels
+//-----------------------------------------------------
+static void stats_u16(const unsigned short* src, unsigned short* dst, size_t n, double saturation, StatsAccum& acc)
+{
+	// no unsigned 16 bits compare in SSE2 : compare signed around 32768
+	const __m128i bias = _mm_set1_epi16((short) 0x8000);
+	const __m128i zero = _mm_setzero_si128();
+	// pixel is saturated if not below the ceiled level
+	double ceil_level = std::ceil(saturation);
+	bool count_saturated = (ceil_level <= 65535.);
+	unsigned int level = (ceil_level < 0.) ? 0 : (unsigned int) (count_saturated ? ceil_level : 65535.);
+	const __m128i level_b = _mm_set1_epi16((short) (level ^ 0x8000));
+
+	unsigned short p_min = 0xFFFF;
+	unsigned short p_max = 0;
+	unsigned long long nb_below = 0;
+	__m128i vmin = _mm_set1_epi16(0x7FFF);
+	__m128i vmax = _mm_set1_epi16((short) 0x8000);
+
+	size_t i = 0;
+	while(i + 8 <= n)
+	{
+		size_t block_end = i + STATS_BLOCK_PIXELS;
+		if(block_end > n)
+			block_end = n;
+
+		__m128i below16 = zero;
+		__m128i sum32 = zero;
+		__m128i sq64 = zero;
+		for(; i + 8 <= block_end; i += 8)
+		{
+			__m128i v = _mm_loadu_si128((const __m128i*) (src + i));
+			if(dst)
+				_mm_storeu_si128((__m128i*) (dst + i), v);
+
+			__m128i vb = _mm_xor_si128(v, bias);
+			vmin = _mm_min_epi16(vmin, vb);
+			vmax = _mm_max_epi16(vmax, vb);
+			below16 = _mm_sub_epi16(below16, _mm_cmplt_epi16(vb, level_b));
+
+			sum32 = _mm_add_epi32(sum32, _mm_add_epi32(_mm_unpacklo_epi16(v, zero), _mm_unpackhi_epi16(v, zero)));
+
+			// 32 bits squares from the low and high 16 bits of the products
+			__m128i lo = _mm_mullo_epi16(v, v);
+			__m128i hi = _mm_mulhi_epu16(v, v);
+			__m128i sq0 = _mm_unpacklo_epi16(lo, hi);
+			__m128i sq1 = _mm_unpackhi_epi16(lo, hi);
+			sq64 = _mm_add_epi64(sq64, _mm_unpacklo_epi32(sq0, zero));
+			sq64 = _mm_add_epi64(sq64, _mm_unpackhi_epi32(sq0, zero));
+			sq64 = _mm_add_epi64(sq64, _mm_unpacklo_epi32(sq1, zero));
+			sq64 = _mm_add_epi64(sq64, _mm_unpackhi_epi32(sq1, zero));
+		}
+
+		unsigned short below[8];
+		unsigned int sums[4];
+		unsigned long long squares[2];
+		_mm_storeu_si128((__m128i*) below, below16);
+		_mm_storeu_si128((__m128i*) sums, sum32);
+		_mm_storeu_si128((__m128i*) squares, sq64);
+		for(int k = 0; k < 8; k++)
+			nb_below += below[k];
+		for(int k = 0; k < 4; k++)
+			acc.sum += sums[k];
+		acc.sum_sq += squares[0] + squares[1];
+	}
+
+	if(i > 0)
+	{
+		unsigned short mins[8];
+		unsigned short maxs[8];
+		_mm_storeu_si128((__m128i*) mins, _mm_xor_si128(vmin, bias));
+		_mm_storeu_si128((__m128i*) maxs, _mm_xor_si128(vmax, bias));
+		for(int k = 0; k < 8; k++)
+		{
+			if(mins[k] < p_min)
+				p_min = mins[k];
+			if(maxs[k] > p_max)
+				p_max = maxs[k];
+		}
+	}
+
+	for(; i < n; i++)
+	{
+		unsigned short v = src[i];
+		if(dst)
+			dst[i] = v;
+		if(v < p_min)
+			p_min = v;
+		if(v > p_max)
+			p_max = v;
+		if(v < level)
+			nb_below++;
+		acc.sum += v;
+		acc.sum_sq += (unsigned long long) v * v;
+	}
+
+	if(n == 0)
+		return;
+	acc.add(p_min, p_max);
+	acc.nb_pixels += n;
+	if(count_saturated)
+		acc.nb_saturated += n - nb_below;
+}
+
+//-----------------------------------------------------
+// @brief scalar statistics of the other pixel types
+//-----------------------------------------------------
+template<class T>
+static void stats_generic(const T* src, size_t n, double saturation, StatsAccum& acc)
+{
+	if(n == 0)
+		return;
+	double p_min = src[0];
+	double p_max = src[0];
+	double sum = 0.;
+	double sum_sq = 0.;
+	long long nb_saturated = 0;
+	for(size_t i = 0; i < n; i++)
+	{
+		double v = src[i];
+		if(v < p_min)
+			p_min = v;
+		if(v > p_max)
+			p_max = v;
+		if(v >= saturation)
+			nb_saturated++;
+		sum += v;
+		sum_sq += v * v;
+	}
+	acc.add(p_min, p_max);
+	acc.fsum += sum;
+	acc.fsum_sq += sum_sq;
+	acc.nb_pixels += n;
+	acc.nb_saturated += nb_saturated;
+}
+
+//-----------------------------------------------------
+// @brief n contiguous pixels of the given type
+//-----------------------------------------------------
+static void stats_pixels(const void* src, ImageType type, size_t n, double saturation, StatsAccum& acc)
+{
+	switch(type)
+	{
+		case Bpp8:
+			stats_generic((const unsigned char*) src, n, saturation, acc);
+			break;
+		case Bpp16:
+			stats_u16((const unsigned short*) src, NULL, n, saturation, acc);
+			break;
+		case Bpp32:
+			stats_generic((const unsigned int*) src, n, saturation, acc);
+			break;
+		case Bpp32F:
+			stats_generic((const float*) src, n, saturation, acc);
+			break;
+		default:
+			break;
+	}
+}
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+FrameStatistics::FrameStatistics() :
+m_enable(false),
+m_saturation_level(0.),
+m_history(256),
+m_history_next(0),
+m_history_count(0),
+m_callback(NULL)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+FrameStatistics::~FrameStatistics()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStatistics::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+}
+
+bool FrameStatistics::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStatistics::setSaturationLevel(double level)
+{
+	DEB_MEMBER_FUNCT();
+	if(level < 0.)
+	{
+		THROW_HW_ERROR(Error) << "Saturation level must be positive (0 : full scale) !";
+	}
+	AutoMutex lock(m_mutex);
+	m_saturation_level = level;
+}
+
+double FrameStatistics::getSaturationLevel() const
+{
+	AutoMutex lock(m_mutex);
+	return m_saturation_level;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStatistics::setRois(const std::vector<Roi>& rois)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_rois = rois;
+}
+
+void FrameStatistics::getRois(std::vector<Roi>& rois) const
+{
+	AutoMutex lock(m_mutex);
+	rois = m_rois;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStatistics::setHistorySize(int size)
+{
+	DEB_MEMBER_FUNCT();
+	if(size < 1)
+	{
+		THROW_HW_ERROR(Error) << "Statistics history size must be at least 1 !";
+	}
+	AutoMutex lock(m_mutex);
+	m_history.assign(size, Entry());
+	m_history_next = 0;
+	m_history_count = 0;
+}
+
+int FrameStatistics::getHistorySize() const
+{
+	AutoMutex lock(m_mutex);
+	return (int) m_history.size();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStatistics::registerCallback(FrameStatsCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback)
+	{
+		THROW_HW_ERROR(Error) << "A statistics callback is already registered !";
+	}
+	m_callback = &cb;
+}
+
+void FrameStatistics::unregisterCallback(FrameStatsCallback& cb)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback != &cb)
+	{
+		THROW_HW_ERROR(Error) << "This statistics callback is not registered !";
+	}
+	m_callback = NULL;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool FrameStatistics::getLast(FrameStats& stats, std::vector<FrameStats>& roi_stats) const
+{
+	AutoMutex lock(m_mutex);
+	if(m_history_count == 0)
+		return false;
+	int last = (m_history_next + (int) m_history.size() - 1) % (int) m_history.size();
+	stats = m_history[last].stats;
+	roi_stats = m_history[last].roi_stats;
+	return true;
+}
+
+void FrameStatistics::getHistory(std::vector<FrameStats>& history) const
+{
+	AutoMutex lock(m_mutex);
+	history.clear();
+	history.reserve(m_history_count);
+	int size = (int) m_history.size();
+	int first = (m_history_next + size - m_history_count) % size;
+	for(int k = 0; k < m_history_count; k++)
+	{
+		history.push_back(m_history[(first + k) % size].stats);
+	}
+}
+
+void FrameStatistics::reset()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_history_next = 0;
+	m_history_count = 0;
+}
+
+//-----------------------------------------------------
+// @brief level of the saturated pixels
+//-----------------------------------------------------
+double FrameStatistics::saturationLevel(int bit_depth) const
+{
+	AutoMutex lock(m_mutex);
+	if(m_saturation_level > 0.)
+		return m_saturation_level;
+	if(bit_depth <= 0 || bit_depth >= 32)
+		return 4294967295.;
+	return (double) ((1 << bit_depth) - 1);
+}
+
+//-----------------------------------------------------
+// @brief statistics of the rois clipped to the frame
+//-----------------------------------------------------
+void FrameStatistics::computeRois(const void* frame, ImageType type, int width, int height, double saturation,
+								  FrameStats& model, std::vector<FrameStats>& roi_stats) const
+{
+	std::vector<Roi> rois;
+	getRois(rois);
+	roi_stats.resize(rois.size());
+	size_t pixel_bytes = FrameDim::getImageTypeDepth(type);
+	for(size_t r = 0; r < rois.size(); r++)
+	{
+		int x0 = rois[r].getTopLeft().x;
+		int y0 = rois[r].getTopLeft().y;
+		int x1 = x0 + rois[r].getSize().getWidth();
+		int y1 = y0 + rois[r].getSize().getHeight();
+		x0 = (x0 < 0) ? 0 : x0;
+		y0 = (y0 < 0) ? 0 : y0;
+		x1 = (x1 > width) ? width : x1;
+		y1 = (y1 > height) ? height : y1;
+
+		StatsAccum acc;
+		for(int y = y0; y < y1 && x0 < x1; y++)
+		{
+			const char* row = (const char*) frame + ((size_t) y * width + x0) * pixel_bytes;
+			stats_pixels(row, type, x1 - x0, saturation, acc);
+		}
+		roi_stats[r] = model;
+		acc.toStats(roi_stats[r]);
+	}
+}
+
+//-----------------------------------------------------
+// @brief store in the ring buffer and call the callback
+//-----------------------------------------------------
+void FrameStatistics::publish(const FrameStats& stats)
+{
+	{
+		AutoMutex lock(m_mutex);
+		Entry& entry = m_history[m_history_next];
+		entry.stats = stats;
+		entry.roi_stats = m_roi_stats;
+		m_history_next = (m_history_next + 1) % (int) m_history.size();
+		if(m_history_count < (int) m_history.size())
+			m_history_count++;
+	}
+
+	AutoMutex lock(m_callback_mutex);
+	if(m_callback)
+	{
+		m_callback->frameStatsReady(stats, m_roi_stats);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStatistics::process(const unsigned short* src, unsigned short* dst, int width, int height, int frame_nb, int bit_depth)
+{
+	FrameStats stats;
+	stats.frame_nb = frame_nb;
+	stats.timestamp = Timestamp::now();
+	double saturation = saturationLevel(bit_depth);
+
+	StatsAccum acc;
+	stats_u16(src, dst, (size_t) width * height, saturation, acc);
+	acc.toStats(stats);
+	computeRois(dst ? dst : src, Bpp16, width, height, saturation, stats, m_roi_stats);
+	publish(stats);
+}
+
+void FrameStatistics::process(const void* frame, ImageType type, int width, int height, int frame_nb, int bit_depth)
+{
+	FrameStats stats;
+	stats.frame_nb = frame_nb;
+	stats.timestamp = Timestamp::now();
+	double saturation = saturationLevel(bit_depth);
+
+	StatsAccum acc;
+	stats_pixels(frame, type, (size_t) width * height, saturation, acc);
+	acc.toStats(stats);
+	computeRois(frame, type, width, height, saturation, stats, m_roi_stats);
+	publish(stats);
+}
+
+//-----------------------------------------------------
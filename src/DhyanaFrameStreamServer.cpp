@@ -0,0 +1,663 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+//winsock2 before any windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <cstring>
+#include <sstream>
+#include "lima/Exceptions.h"
+#include "lima/SizeUtils.h"
+#include "lima/Timestamp.h"
+#include "DhyanaFrameStreamServer.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+static const int STREAM_MAX_QUEUE_DEPTH = 64;
+static const size_t STREAM_ENCODE_QUEUE_DEPTH = 4;
+static const DWORD STREAM_SUBSCRIPTION_TIMEOUT_MS = 500;
+
+//-----------------------------------------------------
+// @brief blocking send of the whole buffer
+//-----------------------------------------------------
+static bool sendAll(SOCKET s, const unsigned char* data, size_t size)
+{
+	while(size > 0)
+	{
+		int chunk = (size > 0x40000000) ? 0x40000000 : (int) size;
+		int sent = send(s, (const char *) data, chunk, 0);
+		if(sent <= 0)
+			return false;
+		data += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+FrameStreamServer::FrameStreamServer() :
+m_enable(false),
+m_port(9999),
+m_address("0.0.0.0"),
+m_encoding(kRaw),
+m_drop_policy(kDropOldest),
+m_queue_depth(4),
+m_quit(true),
+m_listen_socket(INVALID_SOCKET),
+m_accept_thread(NULL),
+m_encode_thread(NULL),
+m_nb_open(0),
+m_start_time(0.),
+m_nb_frames(0),
+m_nb_dropped(0)
+{
+	DEB_CONSTRUCTOR();
+	m_start_time = Timestamp::now();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+FrameStreamServer::~FrameStreamServer()
+{
+	DEB_DESTRUCTOR();
+	stopServer();
+	for(size_t i = 0; i < m_encode_queue.size(); i++)
+		delete m_encode_queue[i];
+	for(size_t i = 0; i < m_free_messages.size(); i++)
+		delete m_free_messages[i];
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStreamServer::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(enable == m_enable)
+			return;
+		m_enable = enable;
+	}
+	if(enable)
+		startServer();
+	else
+		stopServer();
+}
+
+bool FrameStreamServer::isEnabled() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStreamServer::setPort(int port)
+{
+	DEB_MEMBER_FUNCT();
+	if(port < 1 || port > 65535)
+	{
+		THROW_HW_ERROR(Error) << "Streaming port must be in [1, 65535] !";
+	}
+	bool enable = isEnabled();
+	if(enable)
+		stopServer();
+	{
+		AutoMutex lock(m_cond.mutex());
+		m_port = port;
+	}
+	if(enable)
+		startServer();
+}
+
+int FrameStreamServer::getPort() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_port;
+}
+
+void FrameStreamServer::setAddress(const std::string& address)
+{
+	DEB_MEMBER_FUNCT();
+	IN_ADDR in_addr;
+	if(inet_pton(AF_INET, address.c_str(), &in_addr) != 1)
+	{
+		THROW_HW_ERROR(Error) << address << " is not an IPv4 address !";
+	}
+	bool enable = isEnabled();
+	if(enable)
+		stopServer();
+	{
+		AutoMutex lock(m_cond.mutex());
+		m_address = address;
+	}
+	if(enable)
+		startServer();
+}
+
+std::string FrameStreamServer::getAddress() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_address;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStreamServer::setEncoding(Encoding encoding)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_encoding = encoding;
+}
+
+FrameStreamServer::Encoding FrameStreamServer::getEncoding() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_encoding;
+}
+
+void FrameStreamServer::setDropPolicy(DropPolicy policy)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_drop_policy = policy;
+}
+
+FrameStreamServer::DropPolicy FrameStreamServer::getDropPolicy() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_drop_policy;
+}
+
+void FrameStreamServer::setQueueDepth(int depth)
+{
+	DEB_MEMBER_FUNCT();
+	if(depth < 1 || depth > STREAM_MAX_QUEUE_DEPTH)
+	{
+		THROW_HW_ERROR(Error) << "Streaming queue depth must be in [1, " << STREAM_MAX_QUEUE_DEPTH << "] !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_queue_depth = depth;
+}
+
+int FrameStreamServer::getQueueDepth() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_queue_depth;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStreamServer::getStats(StreamingStats& stats) const
+{
+	AutoMutex lock(m_cond.mutex());
+	stats.nb_frames = m_nb_frames;
+	stats.nb_dropped = m_nb_dropped;
+	stats.subscribers.clear();
+	for(size_t i = 0; i < m_subscribers.size(); i++)
+	{
+		const Subscriber* subscriber = m_subscribers[i];
+		if(subscriber->closed)
+			continue;
+		StreamSubscriberStats subscriber_stats;
+		subscriber_stats.address = subscriber->address;
+		subscriber_stats.drop_policy = subscriber->drop_policy;
+		subscriber_stats.queue_depth = subscriber->queue_depth;
+		subscriber_stats.nb_sent = subscriber->nb_sent;
+		subscriber_stats.nb_dropped = subscriber->nb_dropped;
+		stats.subscribers.push_back(subscriber_stats);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStreamServer::start()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_start_time = Timestamp::now();
+}
+
+//-----------------------------------------------------
+// @brief the copy is done outside of the lock, nothing is copied without subscriber
+//-----------------------------------------------------
+void FrameStreamServer::push(const void* frame, ImageType type, int width, int height, int frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	Message* message;
+	double timestamp;
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(m_quit || m_nb_open == 0)
+			return;
+		if(m_encoding == kBitshuffleLz4 && m_encode_queue.size() >= STREAM_ENCODE_QUEUE_DEPTH)
+		{
+			if(m_nb_dropped++ == 0)
+			{
+				DEB_WARNING() << "Streaming encoder is late, frame " << frame_nb << " is not sent";
+			}
+			return;
+		}
+		message = getMessage();
+		timestamp = (double) Timestamp::now() - m_start_time;
+	}
+
+	size_t frame_size = (size_t) width * height * FrameDim::getImageTypeDepth(type);
+	message->data.resize(sizeof(StreamFrameHeader) + frame_size);
+	StreamFrameHeader* header = (StreamFrameHeader *) &message->data[0];
+	memcpy(header->magic, STREAM_FRAME_MAGIC, sizeof(header->magic));
+	header->header_size = sizeof(StreamFrameHeader);
+	header->frame_nb = frame_nb;
+	header->width = width;
+	header->height = height;
+	header->image_type = type;
+	header->encoding = kRaw;
+	header->data_size = (unsigned int) frame_size;
+	header->uncompressed_size = (unsigned int) frame_size;
+	header->reserved = 0;
+	header->timestamp = timestamp;
+	memcpy(&message->data[sizeof(StreamFrameHeader)], frame, frame_size);
+
+	AutoMutex lock(m_cond.mutex());
+	if(m_quit)
+	{
+		m_free_messages.push_back(message);
+	}
+	else if(m_encoding == kBitshuffleLz4)
+	{
+		m_encode_queue.push_back(message);
+		m_cond.broadcast();
+	}
+	else
+	{
+		dispatch(message);
+	}
+}
+
+//-----------------------------------------------------
+// @brief queue the message for each subscriber, according to its drop policy
+//-----------------------------------------------------
+void FrameStreamServer::dispatch(Message* message)
+{
+	for(size_t i = 0; i < m_subscribers.size(); i++)
+	{
+		Subscriber* subscriber = m_subscribers[i];
+		if(subscriber->closed)
+			continue;
+		if((int) subscriber->queue.size() >= subscriber->queue_depth)
+		{
+			subscriber->nb_dropped++;
+			if(subscriber->drop_policy == kDropNewest)
+				continue;
+			releaseMessage(subscriber->queue.front());
+			subscriber->queue.pop_front();
+		}
+		subscriber->queue.push_back(message);
+		message->refs++;
+	}
+	m_nb_frames++;
+	if(message->refs == 0)
+		m_free_messages.push_back(message);
+	m_cond.broadcast();
+}
+
+FrameStreamServer::Message* FrameStreamServer::getMessage()
+{
+	Message* message;
+	if(m_free_messages.empty())
+	{
+		message = new Message;
+	}
+	else
+	{
+		message = m_free_messages.back();
+		m_free_messages.pop_back();
+	}
+	message->refs = 0;
+	return message;
+}
+
+void FrameStreamServer::releaseMessage(Message* message)
+{
+	if(--message->refs == 0)
+		m_free_messages.push_back(message);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStreamServer::startServer()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	WSADATA wsa_data;
+	SOCKET listen_socket = INVALID_SOCKET;
+	if(WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0)
+	{
+		m_enable = false;
+		THROW_HW_ERROR(Error) << "Unable to initialize Winsock !";
+	}
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((u_short) m_port);
+	inet_pton(AF_INET, m_address.c_str(), &address.sin_addr);
+	listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if(listen_socket == INVALID_SOCKET ||
+	   bind(listen_socket, (const sockaddr *) &address, sizeof(address)) == SOCKET_ERROR ||
+	   listen(listen_socket, SOMAXCONN) == SOCKET_ERROR)
+	{
+		int error = WSAGetLastError();
+		if(listen_socket != INVALID_SOCKET)
+			closesocket(listen_socket);
+		WSACleanup();
+		m_enable = false;
+		THROW_HW_ERROR(Error) << "Unable to listen on " << m_address << ":" << m_port << " (error " << error << ") !";
+	}
+
+	m_quit = false;
+	m_listen_socket = listen_socket;
+	m_accept_thread = new ServerThread(*this, ServerThread::kAccept);
+	m_accept_thread->start();
+	m_encode_thread = new ServerThread(*this, ServerThread::kEncode);
+	m_encode_thread->start();
+	DEB_TRACE() << "Streaming server listening on " << m_address << ":" << m_port;
+}
+
+//-----------------------------------------------------
+// @brief closing the sockets aborts the blocking accept, recv and send
+//-----------------------------------------------------
+void FrameStreamServer::stopServer()
+{
+	DEB_MEMBER_FUNCT();
+	std::vector<Subscriber*> subscribers;
+	ServerThread* accept_thread;
+	ServerThread* encode_thread;
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(m_quit)
+			return;
+		m_quit = true;
+		closesocket((SOCKET) m_listen_socket);
+		m_listen_socket = INVALID_SOCKET;
+		for(size_t i = 0; i < m_subscribers.size(); i++)
+			closesocket((SOCKET) m_subscribers[i]->socket);
+		subscribers.swap(m_subscribers);
+		m_nb_open = 0;
+		accept_thread = m_accept_thread;
+		encode_thread = m_encode_thread;
+		m_accept_thread = m_encode_thread = NULL;
+		m_cond.broadcast();
+	}
+
+	//the threads join in their dtor
+	delete accept_thread;
+	delete encode_thread;
+	for(size_t i = 0; i < subscribers.size(); i++)
+		delete subscribers[i]->thread;
+
+	AutoMutex lock(m_cond.mutex());
+	for(size_t i = 0; i < subscribers.size(); i++)
+	{
+		for(size_t j = 0; j < subscribers[i]->queue.size(); j++)
+			releaseMessage(subscribers[i]->queue[j]);
+		delete subscribers[i];
+	}
+	for(size_t i = 0; i < m_encode_queue.size(); i++)
+		m_free_messages.push_back(m_encode_queue[i]);
+	m_encode_queue.clear();
+	WSACleanup();
+	DEB_TRACE() << "Streaming server stopped";
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStreamServer::acceptLoop()
+{
+	DEB_MEMBER_FUNCT();
+	SOCKET listen_socket;
+	{
+		AutoMutex lock(m_cond.mutex());
+		listen_socket = (SOCKET) m_listen_socket;
+	}
+	while(true)
+	{
+		sockaddr_in address;
+		int address_size = sizeof(address);
+		SOCKET s = accept(listen_socket, (sockaddr *) &address, &address_size);
+
+		AutoMutex lock(m_cond.mutex());
+		if(m_quit)
+		{
+			if(s != INVALID_SOCKET)
+				closesocket(s);
+			return;
+		}
+		reapSubscribers(lock);
+		if(s == INVALID_SOCKET)
+		{
+			DEB_TRACE() << "Unable to accept a subscriber (error " << WSAGetLastError() << ")";
+			lock.unlock();
+			Sleep(100);
+			continue;
+		}
+
+		BOOL no_delay = TRUE;
+		setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char *) &no_delay, sizeof(no_delay));
+		char ip[INET_ADDRSTRLEN] = "";
+		inet_ntop(AF_INET, &address.sin_addr, ip, sizeof(ip));
+		std::ostringstream name;
+		name << ip << ":" << ntohs(address.sin_port);
+
+		Subscriber* subscriber = new Subscriber;
+		subscriber->socket = s;
+		subscriber->address = name.str();
+		subscriber->drop_policy = m_drop_policy;
+		subscriber->queue_depth = m_queue_depth;
+		subscriber->closed = false;
+		subscriber->nb_sent = 0;
+		subscriber->nb_dropped = 0;
+		subscriber->thread = new ServerThread(*this, ServerThread::kSend, subscriber);
+		m_subscribers.push_back(subscriber);
+		m_nb_open++;
+		subscriber->thread->start();
+		DEB_TRACE() << "New subscriber " << subscriber->address;
+	}
+}
+
+//-----------------------------------------------------
+// @brief the disconnected subscribers are removed at the next connection
+//-----------------------------------------------------
+void FrameStreamServer::reapSubscribers(AutoMutex& lock)
+{
+	std::vector<Subscriber*> closed;
+	for(size_t i = 0; i < m_subscribers.size();)
+	{
+		Subscriber* subscriber = m_subscribers[i];
+		if(!subscriber->closed)
+		{
+			i++;
+			continue;
+		}
+		for(size_t j = 0; j < subscriber->queue.size(); j++)
+			releaseMessage(subscriber->queue[j]);
+		subscriber->queue.clear();
+		closed.push_back(subscriber);
+		m_subscribers.erase(m_subscribers.begin() + i);
+	}
+	if(closed.empty())
+		return;
+
+	lock.unlock();
+	for(size_t i = 0; i < closed.size(); i++)
+	{
+		delete closed[i]->thread;
+		closesocket((SOCKET) closed[i]->socket);
+		delete closed[i];
+	}
+	lock.lock();
+}
+
+//-----------------------------------------------------
+// @brief compression of the queued frames, in their order
+//-----------------------------------------------------
+void FrameStreamServer::encodeLoop()
+{
+	DEB_MEMBER_FUNCT();
+	BitshuffleLz4 codec;
+	std::vector<unsigned char> chunk;
+	AutoMutex lock(m_cond.mutex());
+	while(true)
+	{
+		while(m_encode_queue.empty() && !m_quit)
+			m_cond.wait();
+		if(m_quit)
+			return;
+		Message* message = m_encode_queue.front();
+		m_encode_queue.pop_front();
+		lock.unlock();
+
+		const StreamFrameHeader* header = (const StreamFrameHeader *) &message->data[0];
+		size_t elem_size = FrameDim::getImageTypeDepth((ImageType) header->image_type);
+		size_t nb_elements = (size_t) header->width * header->height;
+		chunk.resize(sizeof(StreamFrameHeader) + BitshuffleLz4::maxCompressedSize(nb_elements, elem_size, 0));
+		size_t size = codec.compress(&message->data[sizeof(StreamFrameHeader)], nb_elements, elem_size, 0,
+									 &chunk[sizeof(StreamFrameHeader)]);
+		memcpy(&chunk[0], header, sizeof(StreamFrameHeader));
+		StreamFrameHeader* chunk_header = (StreamFrameHeader *) &chunk[0];
+		chunk_header->encoding = kBitshuffleLz4;
+		chunk_header->data_size = (unsigned int) size;
+		chunk.resize(sizeof(StreamFrameHeader) + size);
+		//the raw buffer is kept for the next frame
+		message->data.swap(chunk);
+
+		lock.lock();
+		if(m_quit)
+		{
+			m_free_messages.push_back(message);
+			return;
+		}
+		dispatch(message);
+	}
+}
+
+//-----------------------------------------------------
+// @brief a failed send (disconnection or server stop) ends the subscriber
+//-----------------------------------------------------
+void FrameStreamServer::sendLoop(Subscriber* subscriber)
+{
+	DEB_MEMBER_FUNCT();
+	SOCKET s = (SOCKET) subscriber->socket;
+
+	//the subscriber may choose its drop policy and queue depth
+	StreamSubscription subscription;
+	DWORD timeout = STREAM_SUBSCRIPTION_TIMEOUT_MS;
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char *) &timeout, sizeof(timeout));
+	int received = recv(s, (char *) &subscription, sizeof(subscription), MSG_WAITALL);
+
+	AutoMutex lock(m_cond.mutex());
+	if(received == sizeof(subscription) && memcmp(subscription.magic, STREAM_SUBSCRIPTION_MAGIC, sizeof(subscription.magic)) == 0)
+	{
+		subscriber->drop_policy = (subscription.drop_policy == kDropNewest) ? kDropNewest : kDropOldest;
+		int depth = (int) subscription.queue_depth;
+		subscriber->queue_depth = (depth < 1) ? 1 : (depth > STREAM_MAX_QUEUE_DEPTH) ? STREAM_MAX_QUEUE_DEPTH : depth;
+		DEB_TRACE() << "Subscriber " << subscriber->address << " : "
+					<< DEB_VAR2(subscriber->drop_policy, subscriber->queue_depth);
+	}
+
+	while(true)
+	{
+		while(subscriber->queue.empty() && !m_quit)
+			m_cond.wait();
+		if(m_quit)
+			return;
+		Message* message = subscriber->queue.front();
+		subscriber->queue.pop_front();
+		lock.unlock();
+
+		bool sent = sendAll(s, &message->data[0], message->data.size());
+
+		lock.lock();
+		releaseMessage(message);
+		if(!sent)
+		{
+			DEB_TRACE() << "Subscriber " << subscriber->address << " disconnected";
+			subscriber->closed = true;
+			//the frames are not copied anymore without subscriber, it is removed at the next connection
+			m_nb_open--;
+			return;
+		}
+		subscriber->nb_sent++;
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void FrameStreamServer::ServerThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	switch(m_role)
+	{
+		case kAccept:
+			m_server.acceptLoop();
+			break;
+		case kEncode:
+			m_server.encodeLoop();
+			break;
+		case kSend:
+			m_server.sendLoop(m_subscriber);
+			break;
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+FrameStreamServer::ServerThread::ServerThread(FrameStreamServer& server, Role role, Subscriber* subscriber) :
+m_server(server),
+m_role(role),
+m_subscriber(subscriber)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+FrameStreamServer::ServerThread::~ServerThread()
+{
+	join();
+}
+
+//-----------------------------------------------------
@@ -0,0 +1,325 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <emmintrin.h>
+#include "lima/Exceptions.h"
+#include "DhyanaHdrMerger.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// minimum signal (ADU) of the high gain readout used by the calibration
+//-----------------------------------------------------
+static const double HDR_CALIBRATION_MIN_SIGNAL = 64.;
+
+//-----------------------------------------------------
+// largest float below 2^31, the Bpp32 output is clamped to it
+//-----------------------------------------------------
+static const float HDR_MAX_INT32 = 2147483520.f;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+HdrMerger::HdrMerger() :
+m_calibration_requested(false)
+{
+	DEB_CONSTRUCTOR();
+	m_params.enable = false;
+	m_params.k_factor = 1.;
+	m_params.threshold = 4000;
+	m_params.blend_width = 1;
+	m_params.high_offset = 0;
+	m_params.low_offset = 0;
+	m_params.output_type = Bpp32F;
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+HdrMerger::~HdrMerger()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void HdrMerger::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_params.enable = enable;
+}
+
+bool HdrMerger::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_params.enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void HdrMerger::setKFactor(double k)
+{
+	DEB_MEMBER_FUNCT();
+	if(k <= 0.)
+	{
+		THROW_HW_ERROR(Error) << "HDR K factor must be strictly positive !";
+	}
+	AutoMutex lock(m_mutex);
+	m_params.k_factor = k;
+}
+
+double HdrMerger::getKFactor() const
+{
+	AutoMutex lock(m_mutex);
+	return m_params.k_factor;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void HdrMerger::setThreshold(unsigned threshold)
+{
+	DEB_MEMBER_FUNCT();
+	if(threshold > 65535)
+	{
+		THROW_HW_ERROR(Error) << "HDR threshold must be in [0, 65535] !";
+	}
+	AutoMutex lock(m_mutex);
+	m_params.threshold = threshold;
+}
+
+unsigned HdrMerger::getThreshold() const
+{
+	AutoMutex lock(m_mutex);
+	return m_params.threshold;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void HdrMerger::setBlendWidth(unsigned width)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	// a width of 1 is a hard switch at the threshold
+	m_params.blend_width = (width == 0) ? 1 : width;
+}
+
+unsigned HdrMerger::getBlendWidth() const
+{
+	AutoMutex lock(m_mutex);
+	return m_params.blend_width;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void HdrMerger::setOffsets(unsigned high_offset, unsigned low_offset)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_params.high_offset = high_offset;
+	m_params.low_offset = low_offset;
+}
+
+void HdrMerger::getOffsets(unsigned& high_offset, unsigned& low_offset) const
+{
+	AutoMutex lock(m_mutex);
+	high_offset = m_params.high_offset;
+	low_offset = m_params.low_offset;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void HdrMerger::setOutputType(ImageType type)
+{
+	DEB_MEMBER_FUNCT();
+	if(type != Bpp32 && type != Bpp32F)
+	{
+		THROW_HW_ERROR(Error) << "HDR output type must be Bpp32 or Bpp32F !";
+	}
+	AutoMutex lock(m_mutex);
+	m_params.output_type = type;
+}
+
+ImageType HdrMerger::getOutputType() const
+{
+	AutoMutex lock(m_mutex);
+	return m_params.output_type;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void HdrMerger::requestCalibration()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_calibration_requested = true;
+}
+
+bool HdrMerger::isCalibrationPending() const
+{
+	AutoMutex lock(m_mutex);
+	return m_calibration_requested;
+}
+
+//-----------------------------------------------------
+// @brief K = sum(h.l) / sum(l.l) on the pixels where the high gain is linear
+//-----------------------------------------------------
+void HdrMerger::calibrate(const Params& params, const unsigned short* high, const unsigned short* low, size_t nb_pixels)
+{
+	DEB_MEMBER_FUNCT();
+	double sum_hl = 0.;
+	double sum_ll = 0.;
+	size_t nb_used = 0;
+	double upper = (double) params.threshold - (double) params.blend_width;
+	for(size_t i = 0; i < nb_pixels; i++)
+	{
+		double h = (double) high[i] - params.high_offset;
+		double l = (double) low[i] - params.low_offset;
+		if(h >= HDR_CALIBRATION_MIN_SIGNAL && high[i] < upper && l > 0.)
+		{
+			sum_hl += h * l;
+			sum_ll += l * l;
+			nb_used++;
+		}
+	}
+
+	AutoMutex lock(m_mutex);
+	m_calibration_requested = false;
+	if(nb_used == 0 || sum_ll <= 0.)
+	{
+		DEB_ERROR() << "HDR calibration failed : no pixel in the linear range of the high gain";
+		return;
+	}
+	m_params.k_factor = sum_hl / sum_ll;
+	DEB_TRACE() << "HDR calibration : " << DEB_VAR2(m_params.k_factor, nb_used);
+}
+
+//-----------------------------------------------------
+// @brief merge 4 pixels
+//-----------------------------------------------------
+static inline __m128 hdr_merge_ps(__m128 h, __m128 l,
+								  __m128 high_offset, __m128 low_offset, __m128 k,
+								  __m128 threshold, __m128 inv_blend)
+{
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.f);
+	__m128 hv = _mm_sub_ps(h, high_offset);
+	__m128 lv = _mm_mul_ps(_mm_sub_ps(l, low_offset), k);
+	__m128 w = _mm_mul_ps(_mm_sub_ps(threshold, h), inv_blend);
+	w = _mm_min_ps(_mm_max_ps(w, zero), one);
+	return _mm_add_ps(lv, _mm_mul_ps(w, _mm_sub_ps(hv, lv)));
+}
+
+//-----------------------------------------------------
+// @brief store 4 merged pixels as float or as rounded int32 in [0, 2^31[
+// the rounding is the one of the MXCSR (to nearest even), the scalar tail uses it too
+//-----------------------------------------------------
+static inline void hdr_store(void* dst, size_t i, __m128 v, bool is_float)
+{
+	if(is_float)
+	{
+		_mm_storeu_ps(((float*) dst) + i, v);
+	}
+	else
+	{
+		v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(HDR_MAX_INT32));
+		__m128i iv = _mm_cvtps_epi32(v);
+		_mm_storeu_si128((__m128i*) (((unsigned int*) dst) + i), iv);
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void HdrMerger::merge(const unsigned short* high, const unsigned short* low, void* dst, size_t nb_pixels)
+{
+	Params params;
+	bool calibration_requested;
+	{
+		AutoMutex lock(m_mutex);
+		params = m_params;
+		calibration_requested = m_calibration_requested;
+	}
+
+	if(calibration_requested)
+	{
+		calibrate(params, high, low, nb_pixels);
+		AutoMutex lock(m_mutex);
+		params.k_factor = m_params.k_factor;
+	}
+
+	const bool is_float = (params.output_type == Bpp32F);
+	const float f_high_offset = (float) params.high_offset;
+	const float f_low_offset = (float) params.low_offset;
+	const float f_k = (float) params.k_factor;
+	const float f_threshold = (float) params.threshold;
+	const float f_inv_blend = 1.f / (float) params.blend_width;
+
+	const __m128 high_offset = _mm_set1_ps(f_high_offset);
+	const __m128 low_offset = _mm_set1_ps(f_low_offset);
+	const __m128 k = _mm_set1_ps(f_k);
+	const __m128 threshold = _mm_set1_ps(f_threshold);
+	const __m128 inv_blend = _mm_set1_ps(f_inv_blend);
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for(; i + 8 <= nb_pixels; i += 8)
+	{
+		__m128i h16 = _mm_loadu_si128((const __m128i*) (high + i));
+		__m128i l16 = _mm_loadu_si128((const __m128i*) (low + i));
+		__m128 h_lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(h16, zero));
+		__m128 h_hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(h16, zero));
+		__m128 l_lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(l16, zero));
+		__m128 l_hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(l16, zero));
+		hdr_store(dst, i, hdr_merge_ps(h_lo, l_lo, high_offset, low_offset, k, threshold, inv_blend), is_float);
+		hdr_store(dst, i + 4, hdr_merge_ps(h_hi, l_hi, high_offset, low_offset, k, threshold, inv_blend), is_float);
+	}
+
+	for(; i < nb_pixels; i++)
+	{
+		float h = (float) high[i];
+		float hv = h - f_high_offset;
+		float lv = ((float) low[i] - f_low_offset) * f_k;
+		float w = (f_threshold - h) * f_inv_blend;
+		w = (w < 0.f) ? 0.f : ((w > 1.f) ? 1.f : w);
+		float v = lv + w * (hv - lv);
+		if(is_float)
+		{
+			((float*) dst)[i] = v;
+		}
+		else
+		{
+			v = (v < 0.f) ? 0.f : ((v > HDR_MAX_INT32) ? HDR_MAX_INT32 : v);
+			((unsigned int*) dst)[i] = (unsigned int) _mm_cvtss_si32(_mm_set_ss(v));
+		}
+	}
+}
+
+//-----------------------------------------------------
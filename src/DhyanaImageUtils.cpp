@@ -0,0 +1,106 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include "DhyanaImageUtils.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief cpuid leaf 1, ecx bit 9
+//-----------------------------------------------------
+bool ImageUtils::hasSSSE3()
+{
+	static int has_ssse3 = -1;
+	if(has_ssse3 < 0)
+	{
+#if defined(_MSC_VER)
+		int regs[4];
+		__cpuid(regs, 1);
+		has_ssse3 = (regs[2] & (1 << 9)) ? 1 : 0;
+#else
+		unsigned int eax, ebx, ecx, edx;
+		has_ssse3 = (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & (1 << 9))) ? 1 : 0;
+#endif
+	}
+	return has_ssse3 == 1;
+}
+
+//-----------------------------------------------------
+// @brief unpack 8 pixels (12 bytes) per iteration, return the nb of pixels done
+//-----------------------------------------------------
+DHYANA_TARGET_SSSE3
+size_t ImageUtils::unpack12_ssse3(const unsigned char* src, unsigned short* dst, size_t nb_pixels)
+{
+	// lane 2j   <- bytes (3j, 3j+1) , keep the 12 low bits
+	// lane 2j+1 <- bytes (3j+1, 3j+2), keep the 12 high bits
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+	const __m128i even_mask = _mm_setr_epi16(0x0FFF, 0, 0x0FFF, 0, 0x0FFF, 0, 0x0FFF, 0);
+	const __m128i odd_mask = _mm_setr_epi16(0, -1, 0, -1, 0, -1, 0, -1);
+
+	size_t done = 0;
+	// each load reads 16 bytes but only 12 are consumed : stop before the end of the source
+	while(done + 8 <= nb_pixels && packed12Size(done) + 16 <= packed12Size(nb_pixels))
+	{
+		__m128i packed = _mm_loadu_si128((const __m128i*) (src + packed12Size(done)));
+		__m128i v = _mm_shuffle_epi8(packed, shuffle);
+		__m128i even = _mm_and_si128(v, even_mask);
+		__m128i odd = _mm_and_si128(_mm_srli_epi16(v, 4), odd_mask);
+		_mm_storeu_si128((__m128i*) (dst + done), _mm_or_si128(even, odd));
+		done += 8;
+	}
+	return done;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ImageUtils::unpack12(const unsigned char* src, unsigned short* dst, size_t nb_pixels)
+{
+	size_t i = 0;
+	if(hasSSSE3())
+	{
+		i = unpack12_ssse3(src, dst, nb_pixels);
+	}
+
+	// remaining pixels, i is always even here
+	for(; i + 1 < nb_pixels; i += 2)
+	{
+		const unsigned char* p = src + (i / 2) * 3;
+		dst[i]     = (unsigned short) (p[0] | ((p[1] & 0x0F) << 8));
+		dst[i + 1] = (unsigned short) ((p[1] >> 4) | (p[2] << 4));
+	}
+	if(i < nb_pixels)
+	{
+		const unsigned char* p = src + (i / 2) * 3;
+		dst[i] = (unsigned short) (p[0] | ((p[1] & 0x0F) << 8));
+	}
+}
+
+//-----------------------------------------------------
@@ -148,6 +148,9 @@ void Interface::getStatus(StatusType& status)
       break;
     case Camera::Fault:
       status.set(HwInterface::StatusType::Fault);
+      break;
+    case Camera::Initializing:
+      status.set(HwInterface::StatusType::Config);
     }
 }
 
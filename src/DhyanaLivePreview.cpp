@@ -0,0 +1,282 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "DhyanaLivePreview.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+LivePreview::LivePreview() :
+m_enable(false),
+m_mode(kExponential),
+m_alpha(0.1),
+m_bin(4),
+m_refresh_period(0.1),
+m_reset_requested(true),
+m_average_width(0),
+m_average_height(0),
+m_nb_averaged(0),
+m_last_publish(0.),
+m_image_frame_nb(-1),
+m_image_nb_averaged(0)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+LivePreview::~LivePreview()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LivePreview::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+	m_reset_requested = true;
+}
+
+bool LivePreview::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LivePreview::setMode(Mode mode)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_mode = mode;
+	m_reset_requested = true;
+}
+
+LivePreview::Mode LivePreview::getMode() const
+{
+	AutoMutex lock(m_mutex);
+	return m_mode;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LivePreview::setAlpha(double alpha)
+{
+	DEB_MEMBER_FUNCT();
+	if(alpha <= 0. || alpha > 1.)
+	{
+		THROW_HW_ERROR(Error) << "Preview alpha must be in ]0, 1] !";
+	}
+	AutoMutex lock(m_mutex);
+	m_alpha = alpha;
+}
+
+double LivePreview::getAlpha() const
+{
+	AutoMutex lock(m_mutex);
+	return m_alpha;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LivePreview::setBinning(int bin)
+{
+	DEB_MEMBER_FUNCT();
+	if(bin != 1 && bin != 2 && bin != 4 && bin != 8 && bin != 16)
+	{
+		THROW_HW_ERROR(Error) << "Preview binning must be 1, 2, 4, 8 or 16 !";
+	}
+	AutoMutex lock(m_mutex);
+	m_bin = bin;
+	m_reset_requested = true;
+}
+
+int LivePreview::getBinning() const
+{
+	AutoMutex lock(m_mutex);
+	return m_bin;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LivePreview::setRefreshPeriod(double period)
+{
+	DEB_MEMBER_FUNCT();
+	if(period < 0.)
+	{
+		THROW_HW_ERROR(Error) << "Preview refresh period must be positive !";
+	}
+	AutoMutex lock(m_mutex);
+	m_refresh_period = period;
+}
+
+double LivePreview::getRefreshPeriod() const
+{
+	AutoMutex lock(m_mutex);
+	return m_refresh_period;
+}
+
+void LivePreview::reset()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	m_reset_requested = true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool LivePreview::getImage(std::vector<float>& image, Size& size, int& frame_nb, int& nb_averaged) const
+{
+	AutoMutex lock(m_image_mutex);
+	if(m_image.empty())
+		return false;
+	image = m_image;
+	size = m_image_size;
+	frame_nb = m_image_frame_nb;
+	nb_averaged = m_image_nb_averaged;
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief mean of bin x bin pixels, the incomplete blocks of the borders are dropped
+//-----------------------------------------------------
+template<class T>
+void LivePreview::binFrame(const T* frame, int width, int height, int bin)
+{
+	int binned_width = width / bin;
+	int binned_height = height / bin;
+	float scale = 1.f / (float) (bin * bin);
+	m_binned.assign((size_t) binned_width * binned_height, 0.f);
+	for(int by = 0; by < binned_height; by++)
+	{
+		float* out = binned_width ? &m_binned[(size_t) by * binned_width] : NULL;
+		for(int dy = 0; dy < bin; dy++)
+		{
+			const T* row = frame + (size_t) (by * bin + dy) * width;
+			for(int bx = 0; bx < binned_width; bx++)
+			{
+				const T* p = row + bx * bin;
+				float sum = 0.f;
+				for(int dx = 0; dx < bin; dx++)
+					sum += (float) p[dx];
+				out[bx] += sum;
+			}
+		}
+		for(int bx = 0; bx < binned_width; bx++)
+			out[bx] *= scale;
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void LivePreview::process(const void* frame, ImageType type, int width, int height, int frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	Mode mode;
+	float alpha;
+	int bin;
+	double refresh_period;
+	bool reset_requested;
+	{
+		AutoMutex lock(m_mutex);
+		mode = m_mode;
+		alpha = (float) m_alpha;
+		bin = m_bin;
+		refresh_period = m_refresh_period;
+		reset_requested = m_reset_requested;
+		m_reset_requested = false;
+	}
+
+	switch(type)
+	{
+		case Bpp8:
+			binFrame((const unsigned char*) frame, width, height, bin);
+			break;
+		case Bpp16:
+			binFrame((const unsigned short*) frame, width, height, bin);
+			break;
+		case Bpp32:
+			binFrame((const unsigned int*) frame, width, height, bin);
+			break;
+		case Bpp32F:
+			binFrame((const float*) frame, width, height, bin);
+			break;
+		default:
+			DEB_ERROR() << "Preview : unsupported image type " << type;
+			return;
+	}
+
+	//a new geometry restarts the average
+	int binned_width = width / bin;
+	int binned_height = height / bin;
+	if(reset_requested || binned_width != m_average_width || binned_height != m_average_height)
+	{
+		m_average_width = binned_width;
+		m_average_height = binned_height;
+		m_nb_averaged = 0;
+	}
+
+	if(m_nb_averaged == 0)
+	{
+		m_average = m_binned;
+	}
+	else
+	{
+		//running average : the weight of the new frame is 1 / n
+		float weight = (mode == kRunningAverage) ? 1.f / (float) (m_nb_averaged + 1) : alpha;
+		for(size_t i = 0; i < m_average.size(); i++)
+		{
+			m_average[i] += weight * (m_binned[i] - m_average[i]);
+		}
+	}
+	m_nb_averaged++;
+
+	double now = Timestamp::now();
+	if(m_image_frame_nb >= 0 && now - m_last_publish < refresh_period)
+		return;
+	m_last_publish = now;
+
+	AutoMutex lock(m_image_mutex);
+	m_image = m_average;
+	m_image_size = Size(m_average_width, m_average_height);
+	m_image_frame_nb = frame_nb;
+	m_image_nb_averaged = m_nb_averaged;
+}
+
+//-----------------------------------------------------
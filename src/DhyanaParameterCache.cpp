@@ -0,0 +1,174 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <iomanip>
+#include <sstream>
+#include "lima/Exceptions.h"
+#include "DhyanaParameterCache.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+ParameterCache::ParameterCache() :
+m_enable(true)
+{
+	DEB_CONSTRUCTOR();
+	resetStats();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+ParameterCache::~ParameterCache()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ParameterCache::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(enable);
+	AutoMutex lock(m_mutex);
+	m_enable = enable;
+	m_values.clear();
+}
+
+bool ParameterCache::isEnabled() const
+{
+	AutoMutex lock(m_mutex);
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool ParameterCache::isUnchanged(const std::string& name, const std::string& value)
+{
+	AutoMutex lock(m_mutex);
+	m_stats.nb_writes++;
+	if(!m_enable)
+		return false;
+	std::map<std::string, std::string>::const_iterator found = m_values.find(name);
+	if(found == m_values.end() || found->second != value)
+		return false;
+	m_stats.nb_skipped_writes++;
+	return true;
+}
+
+bool ParameterCache::isUnchanged(const std::string& name, double value)
+{
+	return isUnchanged(name, toString(value));
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ParameterCache::set(const std::string& name, const std::string& value)
+{
+	AutoMutex lock(m_mutex);
+	if(m_enable)
+		m_values[name] = value;
+}
+
+void ParameterCache::set(const std::string& name, double value)
+{
+	set(name, toString(value));
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool ParameterCache::get(const std::string& name, std::string& value)
+{
+	AutoMutex lock(m_mutex);
+	m_stats.nb_reads++;
+	std::map<std::string, std::string>::const_iterator found = m_values.find(name);
+	if(found == m_values.end())
+		return false;
+	value = found->second;
+	m_stats.nb_read_hits++;
+	return true;
+}
+
+bool ParameterCache::get(const std::string& name, double& value)
+{
+	std::string str;
+	if(!get(name, str))
+		return false;
+	std::istringstream is(str);
+	return !!(is >> value);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ParameterCache::invalidate(const std::string& name)
+{
+	AutoMutex lock(m_mutex);
+	m_values.erase(name);
+}
+
+void ParameterCache::invalidate()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	DEB_TRACE() << "Drop " << m_values.size() << " cached parameters";
+	m_values.clear();
+	m_stats.nb_invalidations++;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ParameterCache::getStats(ParameterCacheStats& stats) const
+{
+	AutoMutex lock(m_mutex);
+	stats = m_stats;
+	stats.nb_entries = (int) m_values.size();
+}
+
+void ParameterCache::resetStats()
+{
+	AutoMutex lock(m_mutex);
+	m_stats.nb_entries = 0;
+	m_stats.nb_writes = 0;
+	m_stats.nb_skipped_writes = 0;
+	m_stats.nb_reads = 0;
+	m_stats.nb_read_hits = 0;
+	m_stats.nb_invalidations = 0;
+}
+
+//-----------------------------------------------------
+// @brief 17 digits : the double is written back exactly
+//-----------------------------------------------------
+std::string ParameterCache::toString(double value)
+{
+	std::ostringstream os;
+	os << std::setprecision(17) << value;
+	return os.str();
+}
@@ -0,0 +1,228 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <windows.h>
+#include "lima/Exceptions.h"
+#include "DhyanaProfileStore.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+static const char PROFILE_EXTENSION[] = ".profile";
+
+//-----------------------------------------------------
+// @brief remove the leading and trailing blanks
+//-----------------------------------------------------
+static std::string trim(const std::string& str)
+{
+	std::string::size_type first = str.find_first_not_of(" \t\r\n");
+	if(first == std::string::npos)
+		return std::string();
+	std::string::size_type last = str.find_last_not_of(" \t\r\n");
+	return str.substr(first, last - first + 1);
+}
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+ProfileStore::ProfileStore() :
+m_directory(".")
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+ProfileStore::~ProfileStore()
+{
+	DEB_DESTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief the profiles read from the previous directory are forgotten
+//-----------------------------------------------------
+void ProfileStore::setDirectory(const std::string& directory)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(directory);
+	if(directory.empty())
+	{
+		THROW_HW_ERROR(Error) << "Profile directory can not be empty !";
+	}
+	AutoMutex lock(m_mutex);
+	m_directory = directory;
+	m_profiles.clear();
+}
+
+std::string ProfileStore::getDirectory() const
+{
+	AutoMutex lock(m_mutex);
+	return m_directory;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ProfileStore::save(const std::string& name, const ProfileValues& values)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR2(name, values.size());
+	checkName(name);
+	AutoMutex lock(m_mutex);
+	std::string file_name = fileName(name);
+	std::ofstream file(file_name.c_str(), std::ios::out | std::ios::trunc);
+	if(!file)
+	{
+		THROW_HW_ERROR(Error) << "Unable to write the profile file : " << file_name;
+	}
+	file << "# Dhyana profile " << name << " : key = value\n";
+	for(ProfileValues::const_iterator it = values.begin(); it != values.end(); ++it)
+	{
+		file << it->first << " = " << it->second << "\n";
+	}
+	if(!file)
+	{
+		THROW_HW_ERROR(Error) << "Unable to write the profile file : " << file_name;
+	}
+	m_profiles[name] = values;
+}
+
+//-----------------------------------------------------
+// @brief the profile is read from its file the first time only
+//-----------------------------------------------------
+bool ProfileStore::load(const std::string& name, ProfileValues& values)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(name);
+	checkName(name);
+	AutoMutex lock(m_mutex);
+	std::map<std::string, ProfileValues>::const_iterator found = m_profiles.find(name);
+	if(found != m_profiles.end())
+	{
+		values = found->second;
+		return true;
+	}
+
+	std::string file_name = fileName(name);
+	std::ifstream file(file_name.c_str());
+	if(!file)
+		return false;
+	ProfileValues file_values;
+	std::string line;
+	int line_nb = 0;
+	while(std::getline(file, line))
+	{
+		line_nb++;
+		std::string::size_type comment = line.find('#');
+		if(comment != std::string::npos)
+			line.erase(comment);
+		if(trim(line).empty())
+			continue;
+		std::string::size_type equal = line.find('=');
+		std::string key = (equal != std::string::npos) ? trim(line.substr(0, equal)) : std::string();
+		if(key.empty())
+		{
+			THROW_HW_ERROR(Error) << "Invalid profile entry at line " << line_nb << " of " << file_name;
+		}
+		file_values[key] = trim(line.substr(equal + 1));
+	}
+	m_profiles[name] = file_values;
+	values = file_values;
+	return true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ProfileStore::remove(const std::string& name)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(name);
+	checkName(name);
+	AutoMutex lock(m_mutex);
+	bool in_memory = m_profiles.erase(name) > 0;
+	std::string file_name = fileName(name);
+	if(!DeleteFileA(file_name.c_str()) && !in_memory)
+	{
+		THROW_HW_ERROR(Error) << "Unknown profile " << name << " !";
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ProfileStore::list(std::vector<std::string>& names)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_mutex);
+	names.clear();
+	for(std::map<std::string, ProfileValues>::const_iterator it = m_profiles.begin(); it != m_profiles.end(); ++it)
+		names.push_back(it->first);
+
+	std::string pattern = m_directory + "\\*" + PROFILE_EXTENSION;
+	WIN32_FIND_DATAA find_data;
+	HANDLE find = FindFirstFileA(pattern.c_str(), &find_data);
+	if(find != INVALID_HANDLE_VALUE)
+	{
+		std::string::size_type ext_size = sizeof(PROFILE_EXTENSION) - 1;
+		do
+		{
+			std::string file_name = find_data.cFileName;
+			if(file_name.size() > ext_size)
+				names.push_back(file_name.substr(0, file_name.size() - ext_size));
+		}
+		while(FindNextFileA(find, &find_data));
+		FindClose(find);
+	}
+	std::sort(names.begin(), names.end());
+	names.erase(std::unique(names.begin(), names.end()), names.end());
+}
+
+//-----------------------------------------------------
+// @brief the name is a file name and a camera profile name
+//-----------------------------------------------------
+void ProfileStore::checkName(const std::string& name)
+{
+	DEB_STATIC_FUNCT();
+	bool valid = !name.empty() && name.size() <= 64;
+	for(std::string::size_type i = 0; valid && i < name.size(); i++)
+	{
+		char c = name[i];
+		valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+	}
+	if(!valid)
+	{
+		THROW_HW_ERROR(Error) << "Invalid profile name \"" << name << "\", only letters, digits, '_' and '-' are allowed !";
+	}
+}
+
+//-----------------------------------------------------
+// @brief called with m_mutex locked
+//-----------------------------------------------------
+std::string ProfileStore::fileName(const std::string& name) const
+{
+	return m_directory + "\\" + name + PROFILE_EXTENSION;
+}
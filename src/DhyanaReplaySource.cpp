@@ -0,0 +1,293 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cstdio>
+#include <cstring>
+#include "lima/Exceptions.h"
+#include "lima/SizeUtils.h"
+#include "lima/Timestamp.h"
+#include "DhyanaImageUtils.h"
+#include "DhyanaReplaySource.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+static const char RECORD_MAGIC[8] = "DHYREC1";
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+ReplaySource::ReplaySource() :
+m_file(INVALID_HANDLE_VALUE),
+m_mapping(NULL),
+m_data(NULL),
+m_timing(kRecordedTiming),
+m_loop(false),
+m_interrupted(false),
+m_next(0),
+m_start_time(0.),
+m_loop_offset(0.)
+{
+	DEB_CONSTRUCTOR();
+	memset(&m_header, 0, sizeof(m_header));
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+ReplaySource::~ReplaySource()
+{
+	DEB_DESTRUCTOR();
+	close();
+}
+
+//-----------------------------------------------------
+// @brief the index is checked against the size of the data file before the mapping
+//-----------------------------------------------------
+void ReplaySource::open(const std::string& name)
+{
+	DEB_MEMBER_FUNCT();
+	DEB_PARAM() << DEB_VAR1(name);
+	close();
+	AutoMutex lock(m_cond.mutex());
+
+	std::string index_name = name + ".idx";
+	FILE* index = fopen(index_name.c_str(), "rb");
+	if(index == NULL)
+	{
+		THROW_HW_ERROR(Error) << "Unable to open the replay index " << index_name << " !";
+	}
+	RecordIndexHeader header;
+	std::vector<RecordIndexEntry> entries;
+	bool valid = (fread(&header, sizeof(header), 1, index) == 1 && memcmp(header.magic, RECORD_MAGIC, sizeof(header.magic)) == 0);
+	RecordIndexEntry entry;
+	while(valid && fread(&entry, sizeof(entry), 1, index) == 1)
+		entries.push_back(entry);
+	fclose(index);
+	if(!valid)
+	{
+		THROW_HW_ERROR(Error) << index_name << " is not a recording index !";
+	}
+	if(entries.empty())
+	{
+		THROW_HW_ERROR(Error) << "The recording " << name << " has no frame !";
+	}
+
+	std::string data_name = name + ".raw";
+	HANDLE file = CreateFileA(data_name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(file == INVALID_HANDLE_VALUE)
+	{
+		THROW_HW_ERROR(Error) << "Unable to open the replay file " << data_name << " (error " << GetLastError() << ") !";
+	}
+	LARGE_INTEGER file_size;
+	file_size.QuadPart = 0;
+	GetFileSizeEx(file, &file_size);
+	//the camera frames as transferred : a 12 bits frame may be packed, an HDR frame holds 2 readouts
+	size_t nb_pixels = (size_t) header.width * header.height;
+	unsigned long long frame_size = (unsigned long long) nb_pixels * FrameDim::getImageTypeDepth((ImageType) header.image_type);
+	unsigned long long packed_size = (header.image_type == Bpp12) ? ImageUtils::packed12Size(nb_pixels) : frame_size;
+	unsigned long long hdr_size = (header.image_type == Bpp16) ? 2 * frame_size : frame_size;
+	for(size_t i = 0; i < entries.size(); i++)
+	{
+		bool valid_size = (entries[i].size == frame_size || entries[i].size == packed_size || entries[i].size == hdr_size);
+		if(!valid_size || entries[i].offset + entries[i].size > (unsigned long long) file_size.QuadPart)
+		{
+			CloseHandle(file);
+			THROW_HW_ERROR(Error) << "The frame " << entries[i].frame_nb << " is outside of " << data_name << " !";
+		}
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const unsigned char* data = (mapping != NULL) ? (const unsigned char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if(data == NULL)
+	{
+		DWORD error = GetLastError();
+		if(mapping != NULL)
+			CloseHandle(mapping);
+		CloseHandle(file);
+		THROW_HW_ERROR(Error) << "Unable to map the replay file " << data_name << " (error " << error << ") !";
+	}
+
+	m_name = name;
+	m_file = file;
+	m_mapping = mapping;
+	m_data = data;
+	m_header = header;
+	m_entries.swap(entries);
+	m_next = 0;
+	DEB_TRACE() << "Replay of " << data_name << " : " << m_entries.size() << " frames "
+				<< header.width << "x" << header.height;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ReplaySource::close()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	if(m_data)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = NULL;
+	}
+	if(m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = NULL;
+	}
+	if(m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_entries.clear();
+	m_name.clear();
+}
+
+bool ReplaySource::isOpen() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_data != NULL;
+}
+
+std::string ReplaySource::getName() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_name;
+}
+
+int ReplaySource::getNbFrames() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return (int) m_entries.size();
+}
+
+void ReplaySource::getFrameFormat(int& width, int& height, ImageType& type) const
+{
+	AutoMutex lock(m_cond.mutex());
+	width = m_header.width;
+	height = m_header.height;
+	type = (ImageType) m_header.image_type;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ReplaySource::setTiming(Timing timing)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_timing = timing;
+}
+
+ReplaySource::Timing ReplaySource::getTiming() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_timing;
+}
+
+void ReplaySource::setLoop(bool loop)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_loop = loop;
+}
+
+bool ReplaySource::getLoop() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_loop;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void ReplaySource::start()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_interrupted = false;
+	m_next = 0;
+	m_loop_offset = 0.;
+	m_start_time = Timestamp::now();
+}
+
+void ReplaySource::interrupt()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_interrupted = true;
+	m_cond.broadcast();
+}
+
+//-----------------------------------------------------
+// @brief the frame points into the mapping, it is only read by readFrame
+//-----------------------------------------------------
+bool ReplaySource::nextFrame(TUCAM_FRAME& frame)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	if(m_data == NULL || m_interrupted)
+		return false;
+	if(m_next >= m_entries.size())
+	{
+		if(!m_loop)
+			return false;
+		//the next loop starts one mean frame period after the last frame
+		double duration = m_entries.back().timestamp - m_entries.front().timestamp;
+		if(m_entries.size() > 1)
+			duration += duration / (m_entries.size() - 1);
+		m_loop_offset += duration;
+		m_next = 0;
+	}
+
+	const RecordIndexEntry& entry = m_entries[m_next];
+	if(m_timing == kRecordedTiming)
+	{
+		double due = m_start_time + m_loop_offset + entry.timestamp - m_entries.front().timestamp;
+		double now = Timestamp::now();
+		while(!m_interrupted && now < due)
+		{
+			m_cond.wait(due - now);
+			now = Timestamp::now();
+		}
+		if(m_interrupted)
+			return false;
+	}
+	m_next++;
+
+	size_t depth = FrameDim::getImageTypeDepth((ImageType) m_header.image_type);
+	frame.usHeader = 0;
+	frame.usOffset = 0;
+	frame.usWidth = (USHORT) m_header.width;
+	frame.usHeight = (USHORT) m_header.height;
+	frame.uiWidthStep = (UINT32) (m_header.width * depth);
+	frame.ucElemBytes = (UCHAR) depth;
+	frame.uiIndex = entry.frame_nb;
+	frame.uiImgSize = entry.size;
+	frame.uiHstSize = 0;
+	frame.pBuffer = (PUCHAR) (m_data + entry.offset);
+	return true;
+}
+
+//-----------------------------------------------------
@@ -0,0 +1,246 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cstring>
+#include <sstream>
+#include "DhyanaSharedFrameReader.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+SharedFrameReader::SharedFrameReader() :
+m_directory_mapping(NULL),
+m_directory(NULL),
+m_generation(0),
+m_mapping(NULL),
+m_data(NULL),
+m_header(NULL),
+m_next_index(0),
+m_nb_lost(0)
+{
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+SharedFrameReader::~SharedFrameReader()
+{
+	close();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool SharedFrameReader::open(const std::string& name)
+{
+	close();
+	m_name = name;
+	return checkRing();
+}
+
+void SharedFrameReader::close()
+{
+	unmap();
+	if(m_directory)
+	{
+		UnmapViewOfFile(m_directory);
+		m_directory = NULL;
+	}
+	if(m_directory_mapping)
+	{
+		CloseHandle(m_directory_mapping);
+		m_directory_mapping = NULL;
+	}
+	m_name.clear();
+}
+
+bool SharedFrameReader::isOpen() const
+{
+	return m_header != NULL;
+}
+
+//-----------------------------------------------------
+// @brief a ring closed by the publisher is replaced by the generation given by the directory
+//-----------------------------------------------------
+bool SharedFrameReader::checkRing()
+{
+	if(m_header != NULL && !m_header->closed && m_directory->generation == m_generation)
+		return true;
+	unmap();
+	if(m_name.empty() || !mapDirectory())
+		return false;
+	LONG generation = m_directory->generation;
+	if(generation == 0)
+		return false;
+
+	std::ostringstream ring_name;
+	ring_name << m_name << "_" << generation;
+	m_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, ring_name.str().c_str());
+	if(m_mapping == NULL)
+		return false;
+	m_data = (const unsigned char *) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+	const SharedRingHeader* header = (const SharedRingHeader *) m_data;
+	if(header == NULL || memcmp(header->magic, SHARED_RING_MAGIC, sizeof(header->magic)) != 0 || header->closed)
+	{
+		unmap();
+		return false;
+	}
+	m_header = header;
+	m_generation = generation;
+	//only the frames published from now on are read
+	m_next_index = m_header->nb_published;
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief the directory is kept until close, it does not change with the rings
+//-----------------------------------------------------
+bool SharedFrameReader::mapDirectory()
+{
+	if(m_directory != NULL)
+		return true;
+	m_directory_mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, m_name.c_str());
+	if(m_directory_mapping == NULL)
+		return false;
+	m_directory = (const SharedRingDirectory *) MapViewOfFile(m_directory_mapping, FILE_MAP_READ, 0, 0, SHARED_DIRECTORY_SIZE);
+	if(m_directory == NULL || memcmp(m_directory->magic, SHARED_DIRECTORY_MAGIC, sizeof(m_directory->magic)) != 0)
+	{
+		if(m_directory)
+			UnmapViewOfFile(m_directory);
+		m_directory = NULL;
+		CloseHandle(m_directory_mapping);
+		m_directory_mapping = NULL;
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief the ring only
+//-----------------------------------------------------
+void SharedFrameReader::unmap()
+{
+	if(m_data)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = NULL;
+	}
+	if(m_mapping)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = NULL;
+	}
+	m_header = NULL;
+}
+
+//-----------------------------------------------------
+// @brief the publisher may be writing the slot of the oldest frame, it is skipped
+//-----------------------------------------------------
+bool SharedFrameReader::next(SharedFrame& frame)
+{
+	if(!checkRing())
+		return false;
+	//64 bits read, atomic on x64
+	long long nb_published = m_header->nb_published;
+	long long oldest = nb_published - m_header->nb_slots + 1;
+	if(m_next_index < oldest)
+	{
+		m_nb_lost += oldest - m_next_index;
+		m_next_index = oldest;
+	}
+	while(m_next_index < nb_published)
+	{
+		if(read(m_next_index++, frame))
+			return true;
+		m_nb_lost++;
+	}
+	return false;
+}
+
+bool SharedFrameReader::latest(SharedFrame& frame)
+{
+	if(!checkRing())
+		return false;
+	long long nb_published = m_header->nb_published;
+	if(nb_published == 0 || !read(nb_published - 1, frame))
+		return false;
+	m_next_index = nb_published;
+	return true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool SharedFrameReader::isValid(const SharedFrame& frame) const
+{
+	if(m_header == NULL)
+		return false;
+	MemoryBarrier();
+	return slot(frame.index)->sequence == frame.sequence;
+}
+
+bool SharedFrameReader::copy(const SharedFrame& frame, void* dst) const
+{
+	if(m_header == NULL)
+		return false;
+	memcpy(dst, frame.data, frame.size);
+	return isValid(frame);
+}
+
+long long SharedFrameReader::getNbLost() const
+{
+	return m_nb_lost;
+}
+
+//-----------------------------------------------------
+// @brief seqlock read of the slot header
+//-----------------------------------------------------
+bool SharedFrameReader::read(long long index, SharedFrame& frame) const
+{
+	const SharedSlotHeader* header = slot(index);
+	LONG sequence = header->sequence;
+	MemoryBarrier();
+	if(sequence & 1)
+		return false;
+	frame.frame_nb = header->frame_nb;
+	frame.width = header->width;
+	frame.height = header->height;
+	frame.image_type = header->image_type;
+	frame.size = header->size;
+	frame.timestamp = header->timestamp;
+	frame.index = header->index;
+	frame.data = (const unsigned char *) header + SHARED_SLOT_DATA_OFFSET;
+	frame.sequence = sequence;
+	MemoryBarrier();
+	return frame.index == index && header->sequence == sequence;
+}
+
+const SharedSlotHeader* SharedFrameReader::slot(long long index) const
+{
+	size_t offset = m_header->header_size + (size_t) (index % m_header->nb_slots) * m_header->slot_size;
+	return (const SharedSlotHeader *) (m_data + offset);
+}
+
+//-----------------------------------------------------
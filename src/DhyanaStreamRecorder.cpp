@@ -0,0 +1,511 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include "lima/Exceptions.h"
+#include "lima/Timestamp.h"
+#include "DhyanaStreamRecorder.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// unbuffered I/O : offsets and sizes multiple of the sector size,
+// 4096 covers the 512 bytes and the 4K sectors disks
+//-----------------------------------------------------
+static const size_t RECORD_ALIGNMENT = 4096;
+static const char RECORD_MAGIC[8] = "DHYREC1";
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+StreamRecorder::StreamRecorder() :
+m_enable(false),
+m_file_number(0),
+m_nb_buffers(8),
+m_preallocation_step(1000),
+m_recording(false),
+m_stop(false),
+m_thread(NULL),
+m_file(INVALID_HANDLE_VALUE),
+m_index(NULL),
+m_frame_size(0),
+m_slot_size(0),
+m_buffers(NULL),
+m_next_fill(0),
+m_next_write(0),
+m_next_complete(0),
+m_in_flight(0),
+m_next_offset(0),
+m_allocated(0),
+m_start_time(0.),
+m_nb_frames(0),
+m_nb_dropped(0),
+m_nb_bytes(0.),
+m_in_flight_peak(0),
+m_last_time(0.),
+m_error(false)
+{
+	DEB_CONSTRUCTOR();
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+StreamRecorder::~StreamRecorder()
+{
+	DEB_DESTRUCTOR();
+	stop();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void StreamRecorder::setEnable(bool enable)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_enable = enable;
+}
+
+bool StreamRecorder::isEnabled() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_enable;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void StreamRecorder::setFilePrefix(const std::string& prefix)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	m_prefix = prefix;
+	m_file_number = 0;
+}
+
+std::string StreamRecorder::getFilePrefix() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_prefix;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void StreamRecorder::setNbBuffers(int nb_buffers)
+{
+	DEB_MEMBER_FUNCT();
+	if(nb_buffers < 2 || nb_buffers > 64)
+	{
+		THROW_HW_ERROR(Error) << "Recording nb of buffers must be in [2, 64] !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_nb_buffers = nb_buffers;
+}
+
+int StreamRecorder::getNbBuffers() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_nb_buffers;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void StreamRecorder::setPreallocationStep(int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	if(nb_frames < 1)
+	{
+		THROW_HW_ERROR(Error) << "Recording preallocation step must be at least 1 frame !";
+	}
+	AutoMutex lock(m_cond.mutex());
+	m_preallocation_step = nb_frames;
+}
+
+int StreamRecorder::getPreallocationStep() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_preallocation_step;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void StreamRecorder::getStats(RecordingStats& stats) const
+{
+	AutoMutex lock(m_cond.mutex());
+	stats.file_name = m_file_name;
+	stats.nb_frames = m_nb_frames;
+	stats.nb_dropped = m_nb_dropped;
+	double elapsed = m_last_time - m_start_time;
+	stats.throughput = (elapsed > 0.) ? m_nb_bytes / elapsed / 1e6 : 0.;
+	stats.in_flight_peak = m_in_flight_peak;
+	stats.error = m_error;
+	stats.error_reason = m_error_reason;
+}
+
+bool StreamRecorder::isRecording() const
+{
+	AutoMutex lock(m_cond.mutex());
+	return m_recording;
+}
+
+//-----------------------------------------------------
+// @brief the files are created here so that an error is reported by prepareAcq
+//-----------------------------------------------------
+void StreamRecorder::start(const Size& size, ImageType type, size_t max_frame_size, int nb_frames)
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	if(!m_enable)
+		return;
+	if(m_recording)
+	{
+		THROW_HW_ERROR(Error) << "A recording is already running !";
+	}
+	if(m_prefix.empty())
+	{
+		THROW_HW_ERROR(Error) << "Recording file prefix is not set !";
+	}
+
+	std::ostringstream name;
+	name << m_prefix << "_" << std::setw(4) << std::setfill('0') << m_file_number;
+	m_file_name = name.str() + ".raw";
+	m_file = CreateFileA(m_file_name.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+						 FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING | FILE_FLAG_OVERLAPPED, NULL);
+	if(m_file == INVALID_HANDLE_VALUE)
+	{
+		THROW_HW_ERROR(Error) << "Unable to create the recording file " << m_file_name
+							  << " (error " << GetLastError() << ") !";
+	}
+	m_index = fopen((name.str() + ".idx").c_str(), "wb");
+	if(m_index == NULL)
+	{
+		closeFiles();
+		THROW_HW_ERROR(Error) << "Unable to create the recording index " << name.str() << ".idx !";
+	}
+
+	m_frame_size = max_frame_size;
+	m_slot_size = (m_frame_size + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+	RecordIndexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+	header.width = size.getWidth();
+	header.height = size.getHeight();
+	header.image_type = type;
+	header.slot_size = (unsigned int) m_slot_size;
+	fwrite(&header, sizeof(header), 1, m_index);
+
+	//page aligned and zeroed : the padding of the slots stays 0
+	m_buffers = (unsigned char *) VirtualAlloc(NULL, m_slot_size * m_nb_buffers, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	if(m_buffers == NULL)
+	{
+		closeFiles();
+		THROW_HW_ERROR(Error) << "Unable to allocate " << m_nb_buffers << " recording buffers !";
+	}
+	m_slots.resize(m_nb_buffers);
+	for(size_t i = 0; i < m_slots.size(); i++)
+	{
+		Slot& slot = m_slots[i];
+		slot.state = kFree;
+		slot.buffer = m_buffers + i * m_slot_size;
+		memset(&slot.overlapped, 0, sizeof(slot.overlapped));
+		slot.overlapped.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+		slot.failed = false;
+	}
+
+	m_allocated = 0;
+	int nb_preallocated = (nb_frames > 0) ? nb_frames : m_preallocation_step;
+	if(!extendFile((unsigned long long) nb_preallocated * m_slot_size))
+	{
+		closeFiles();
+		THROW_HW_ERROR(Error) << "Unable to preallocate the recording file " << m_file_name << " !";
+	}
+
+	m_next_fill = m_next_write = m_next_complete = 0;
+	m_in_flight = 0;
+	m_next_offset = 0;
+	m_nb_frames = 0;
+	m_nb_dropped = 0;
+	m_nb_bytes = 0.;
+	m_in_flight_peak = 0;
+	m_error = false;
+	m_error_reason.clear();
+	m_start_time = m_last_time = Timestamp::now();
+	m_file_number++;
+	m_stop = false;
+	m_recording = true;
+	m_thread = new WriterThread(*this);
+	m_thread->start();
+	DEB_TRACE() << "Recording to " << m_file_name << " : " << DEB_VAR2(m_slot_size, nb_preallocated);
+}
+
+//-----------------------------------------------------
+// @brief the writer thread completes the writes already queued
+//-----------------------------------------------------
+void StreamRecorder::stop()
+{
+	DEB_MEMBER_FUNCT();
+	WriterThread* thread;
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(!m_recording)
+			return;
+		m_stop = true;
+		m_cond.broadcast();
+		thread = m_thread;
+		m_thread = NULL;
+	}
+	//joins in its dtor
+	delete thread;
+
+	AutoMutex lock(m_cond.mutex());
+	//remove the preallocated space not used
+	LARGE_INTEGER end;
+	end.QuadPart = m_next_offset;
+	if(!SetFilePointerEx(m_file, end, NULL, FILE_BEGIN) || !SetEndOfFile(m_file))
+	{
+		DEB_ERROR() << "Unable to truncate the recording file " << m_file_name;
+	}
+	closeFiles();
+	m_recording = false;
+	DEB_TRACE() << "Recording done : " << DEB_VAR2(m_nb_frames, m_nb_dropped);
+}
+
+//-----------------------------------------------------
+// @brief the copy is done outside of the lock, the slot and its file offset are reserved first
+//-----------------------------------------------------
+bool StreamRecorder::push(const void* frame, size_t size, int frame_nb)
+{
+	DEB_MEMBER_FUNCT();
+	int index;
+	{
+		AutoMutex lock(m_cond.mutex());
+		if(!m_recording || m_stop)
+			return false;
+		if(size > m_frame_size)
+		{
+			if(m_nb_dropped++ == 0)
+			{
+				DEB_WARNING() << "Frame " << frame_nb << " (" << size << " bytes) does not fit in the recording slots";
+			}
+			return false;
+		}
+		if(m_error || m_slots[m_next_fill].state != kFree)
+		{
+			if(m_nb_dropped++ == 0 && !m_error)
+			{
+				DEB_WARNING() << "No free recording buffer, frame " << frame_nb << " is not recorded";
+			}
+			return false;
+		}
+		index = m_next_fill;
+		m_next_fill = (m_next_fill + 1) % (int) m_slots.size();
+		m_slots[index].state = kFilling;
+		m_slots[index].entry.offset = m_next_offset;
+		m_next_offset += m_slot_size;
+	}
+
+	Slot& slot = m_slots[index];
+	memcpy(slot.buffer, frame, size);
+	slot.entry.timestamp = (double) Timestamp::now() - m_start_time;
+	slot.entry.frame_nb = (unsigned int) frame_nb;
+	slot.entry.size = (unsigned int) size;
+
+	AutoMutex lock(m_cond.mutex());
+	slot.state = kFilled;
+	m_cond.broadcast();
+	return true;
+}
+
+//-----------------------------------------------------
+// @brief issue all the filled slots, then wait for the oldest write
+//-----------------------------------------------------
+void StreamRecorder::writeLoop()
+{
+	DEB_MEMBER_FUNCT();
+	AutoMutex lock(m_cond.mutex());
+	while(true)
+	{
+		while(m_slots[m_next_write].state != kFilled && m_in_flight == 0 && !m_stop)
+			m_cond.wait();
+
+		while(m_slots[m_next_write].state == kFilled)
+		{
+			Slot& slot = m_slots[m_next_write];
+			m_next_write = (m_next_write + 1) % (int) m_slots.size();
+			//continuous acquisition
+			if(!m_error && slot.entry.offset + m_slot_size > m_allocated
+			   && !extendFile(m_allocated + (unsigned long long) m_preallocation_step * m_slot_size))
+			{
+				std::ostringstream reason;
+				reason << "Unable to extend " << m_file_name << " beyond " << m_allocated << " bytes (disk full ?)";
+				m_error = true;
+				m_error_reason = reason.str();
+				DEB_ERROR() << m_error_reason << ", the recording stops";
+			}
+			//after an error the frames are dropped, the file is not written anymore
+			if(m_error)
+			{
+				slot.state = kFree;
+				m_nb_dropped++;
+				m_cond.broadcast();
+				continue;
+			}
+			slot.state = kWriting;
+			slot.overlapped.Offset = (DWORD) slot.entry.offset;
+			slot.overlapped.OffsetHigh = (DWORD) (slot.entry.offset >> 32);
+			ResetEvent(slot.overlapped.hEvent);
+			m_in_flight++;
+			if(m_in_flight > m_in_flight_peak)
+				m_in_flight_peak = m_in_flight;
+			lock.unlock();
+
+			BOOL done = WriteFile(m_file, slot.buffer, (DWORD) m_slot_size, NULL, &slot.overlapped);
+			slot.failed = !done && GetLastError() != ERROR_IO_PENDING;
+			lock.lock();
+		}
+
+		if(m_in_flight == 0)
+		{
+			if(m_stop)
+				return;
+			continue;
+		}
+
+		Slot& slot = m_slots[m_next_complete];
+		lock.unlock();
+		DWORD written = 0;
+		BOOL done = !slot.failed && GetOverlappedResult(m_file, &slot.overlapped, &written, TRUE);
+		lock.lock();
+
+		if(done && written == m_slot_size)
+		{
+			fwrite(&slot.entry, sizeof(slot.entry), 1, m_index);
+			m_nb_frames++;
+			m_nb_bytes += slot.entry.size;
+			m_last_time = Timestamp::now();
+		}
+		else
+		{
+			//disk full or removed : the next frames are dropped
+			if(!m_error)
+			{
+				std::ostringstream reason;
+				reason << "Unable to write the frame " << slot.entry.frame_nb << " in " << m_file_name
+					   << " (error " << GetLastError() << ")";
+				m_error_reason = reason.str();
+				DEB_ERROR() << m_error_reason;
+			}
+			m_error = true;
+			m_nb_dropped++;
+		}
+		slot.state = kFree;
+		m_next_complete = (m_next_complete + 1) % (int) m_slots.size();
+		m_in_flight--;
+		m_cond.broadcast();
+	}
+}
+
+//-----------------------------------------------------
+// @brief reserve the file space before the writes
+//-----------------------------------------------------
+bool StreamRecorder::extendFile(unsigned long long size)
+{
+	DEB_MEMBER_FUNCT();
+	LARGE_INTEGER end;
+	end.QuadPart = size;
+	if(!SetFilePointerEx(m_file, end, NULL, FILE_BEGIN) || !SetEndOfFile(m_file))
+	{
+		DEB_ERROR() << "Unable to extend the recording file to " << size << " bytes (error " << GetLastError() << ")";
+		return false;
+	}
+	//without it the writes beyond the valid data are zero filled first and serialized,
+	//it needs the SE_MANAGE_VOLUME_NAME privilege (administrator)
+	if(!SetFileValidData(m_file, end.QuadPart))
+	{
+		DEB_TRACE() << "SetFileValidData failed (error " << GetLastError() << "), the writes may be serialized";
+	}
+	m_allocated = size;
+	return true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void StreamRecorder::closeFiles()
+{
+	for(size_t i = 0; i < m_slots.size(); i++)
+	{
+		if(m_slots[i].overlapped.hEvent)
+			CloseHandle(m_slots[i].overlapped.hEvent);
+	}
+	m_slots.clear();
+	if(m_buffers)
+	{
+		VirtualFree(m_buffers, 0, MEM_RELEASE);
+		m_buffers = NULL;
+	}
+	if(m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	if(m_index)
+	{
+		fclose(m_index);
+		m_index = NULL;
+	}
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void StreamRecorder::WriterThread::threadFunction()
+{
+	DEB_MEMBER_FUNCT();
+	m_recorder.writeLoop();
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+StreamRecorder::WriterThread::WriterThread(StreamRecorder& recorder) :
+m_recorder(recorder)
+{
+	pthread_attr_setscope(&m_thread_attr, PTHREAD_SCOPE_PROCESS);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+StreamRecorder::WriterThread::~WriterThread()
+{
+	join();
+}
+
+//-----------------------------------------------------
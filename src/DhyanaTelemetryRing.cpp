@@ -0,0 +1,139 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include "lima/Exceptions.h"
+#include "DhyanaTelemetryRing.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+//-----------------------------------------------------
+// a sample being written is read again a few times
+//-----------------------------------------------------
+static const int TELEMETRY_READ_RETRIES = 4;
+
+//-----------------------------------------------------
+// @brief  ctor
+//-----------------------------------------------------
+TelemetryRing::TelemetryRing(int nb_samples) :
+m_slots(nb_samples > 0 ? nb_samples : 1),
+m_nb_samples(0)
+{
+	DEB_CONSTRUCTOR();
+	DEB_PARAM() << DEB_VAR1(nb_samples);
+	for(size_t i = 0; i < m_slots.size(); i++)
+	{
+		m_slots[i].sequence = 0;
+		m_slots[i].index = -1;
+	}
+}
+
+//-----------------------------------------------------
+// @brief  dtor
+//-----------------------------------------------------
+TelemetryRing::~TelemetryRing()
+{
+	DEB_DESTRUCTOR();
+}
+
+int TelemetryRing::getNbSlots() const
+{
+	return (int) m_slots.size();
+}
+
+long long TelemetryRing::getNbSamples() const
+{
+	//64 bits read, atomic on x64
+	return m_nb_samples;
+}
+
+//-----------------------------------------------------
+// @brief single writer : the slot sequence is odd during the copy
+//-----------------------------------------------------
+void TelemetryRing::push(const TelemetrySample& sample)
+{
+	LONGLONG index = m_nb_samples;
+	Slot& slot = m_slots[(size_t) (index % m_slots.size())];
+	InterlockedIncrement(&slot.sequence);
+	MemoryBarrier();
+	slot.index = index;
+	slot.sample = sample;
+	MemoryBarrier();
+	InterlockedIncrement(&slot.sequence);
+	InterlockedExchange64(&m_nb_samples, index + 1);
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+bool TelemetryRing::getLast(TelemetrySample& sample) const
+{
+	long long nb_samples = m_nb_samples;
+	//the last slot can only be overwritten after a full turn of the ring
+	for(long long index = nb_samples - 1; index >= 0 && index >= nb_samples - 2; index--)
+	{
+		if(read(index, sample))
+			return true;
+	}
+	return false;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void TelemetryRing::getHistory(std::vector<TelemetrySample>& history, double since) const
+{
+	history.clear();
+	long long nb_samples = m_nb_samples;
+	long long first = nb_samples - (long long) m_slots.size();
+	if(first < 0)
+		first = 0;
+	history.reserve((size_t) (nb_samples - first));
+	TelemetrySample sample;
+	for(long long index = first; index < nb_samples; index++)
+	{
+		if(read(index, sample) && sample.timestamp > since)
+			history.push_back(sample);
+	}
+}
+
+//-----------------------------------------------------
+// @brief seqlock read of the slot, false if it holds another sample
+//-----------------------------------------------------
+bool TelemetryRing::read(long long index, TelemetrySample& sample) const
+{
+	const Slot& slot = m_slots[(size_t) (index % m_slots.size())];
+	for(int retry = 0; retry < TELEMETRY_READ_RETRIES; retry++)
+	{
+		LONG sequence = slot.sequence;
+		MemoryBarrier();
+		if(sequence & 1)
+			continue;
+		long long slot_index = slot.index;
+		sample = slot.sample;
+		MemoryBarrier();
+		if(slot.sequence != sequence)
+			continue;
+		return slot_index == index;
+	}
+	return false;
+}
@@ -143,7 +143,8 @@ void CSoftTriggerTimer::on_timer()
 
 	////Timestamp t0 = Timestamp::now();						
 	////DEB_TRACE() << "CSoftTriggerTimer::on_timer : TUCAM_Cap_DoSoftwareTrigger";
-	TUCAM_Cap_DoSoftwareTrigger(m_cam.m_opCam.hIdxTUCam);	
+	//the handle is not closed by a reconnection meanwhile
+	m_cam.softwareTrigger();
 	if(m_is_oneshot)//for internal_multi
 	{
 		stop();
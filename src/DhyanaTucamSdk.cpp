@@ -0,0 +1,232 @@
+//###########################################################################
+// This file is part of LImA, a Library for Image Acquisition
+//
+// Copyright (C) : 2009-2014
+// European Synchrotron Radiation Facility
+// BP 220, Grenoble 38043
+// FRANCE
+//
+// This is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3 of the License, or
+// (at your option) any later version.
+//
+// This software is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, see <http://www.gnu.org/licenses/>.
+//###########################################################################
+
+#include <algorithm>
+#include "lima/Exceptions.h"
+#include "DhyanaTucamSdk.h"
+
+using namespace lima;
+using namespace lima::Dhyana;
+
+Cond TucamSdk::s_cond;
+int TucamSdk::s_nb_users = 0;
+TUCAM_INIT TucamSdk::s_init;
+std::vector<int> TucamSdk::s_open_indexes;
+std::vector<int> TucamSdk::s_probed_indexes;
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void TucamSdk::init()
+{
+	DEB_STATIC_FUNCT();
+	AutoMutex lock(s_cond.mutex());
+	if(s_nb_users++ > 0)
+		return;
+	DEB_TRACE() << "Initialize TUCAM API ...";
+	s_init.pstrConfigPath = "./";//Camera parameters input saving path is not defined
+	s_init.uiCamCount = 0;
+	if(TUCAMRET_SUCCESS != TUCAM_Api_Init(&s_init))
+	{
+		s_nb_users = 0;
+		// Initializing SDK API environment failed
+		THROW_HW_ERROR(Error) << "Unable to initialize TUCAM_Api !";
+	}
+	DEB_TRACE() << "TUCAM API initialized (nb. camera : " << s_init.uiCamCount << ")";
+	if(0 == s_init.uiCamCount)
+	{
+		s_nb_users = 0;
+		TUCAM_Api_Uninit();
+		// No camera
+		THROW_HW_ERROR(Error) << "Unable to locate the camera !";
+	}
+}
+
+void TucamSdk::uninit()
+{
+	DEB_STATIC_FUNCT();
+	AutoMutex lock(s_cond.mutex());
+	if(s_nb_users <= 0 || --s_nb_users > 0)
+		return;
+	DEB_TRACE() << "Uninitialize TUCAM API ...";
+	TUCAM_Api_Uninit();
+	s_init.uiCamCount = 0;
+}
+
+//-----------------------------------------------------
+// @brief the cameras are searched in the index order for a serial number
+//-----------------------------------------------------
+void TucamSdk::open(int index, const std::string& serial_number, TUCAM_OPEN& cam)
+{
+	DEB_STATIC_FUNCT();
+	DEB_PARAM() << DEB_VAR2(index, serial_number);
+	AutoMutex lock(s_cond.mutex());
+	if(s_nb_users <= 0)
+	{
+		THROW_HW_ERROR(Error) << "TUCAM_Api is not initialized !";
+	}
+
+	cam.hIdxTUCam = NULL;
+	if(serial_number.empty())
+	{
+		if(index < 0 || index >= (int) s_init.uiCamCount)
+		{
+			THROW_HW_ERROR(Error) << "No camera at index " << index << " (nb. camera : " << s_init.uiCamCount << ") !";
+		}
+		//probed by an open by serial number, it is released if it is not the camera
+		while(isProbed(index))
+			s_cond.wait();
+		if(isOpen(index))
+		{
+			THROW_HW_ERROR(Error) << "The camera at index " << index << " is already opened !";
+		}
+		//the index is reserved, the other cameras are opened at the same time
+		s_open_indexes.push_back(index);
+		lock.unlock();
+		cam.uiIdxOpen = index;
+		if(TUCAMRET_SUCCESS != TUCAM_Dev_Open(&cam) || NULL == cam.hIdxTUCam)
+		{
+			cam.hIdxTUCam = NULL;
+			lock.lock();
+			s_open_indexes.erase(std::find(s_open_indexes.begin(), s_open_indexes.end(), index));
+			THROW_HW_ERROR(Error) << "Unable to open the camera at index " << index << " !";
+		}
+	}
+	else
+	{
+		for(int i = 0; i < (int) s_init.uiCamCount && NULL == cam.hIdxTUCam; i++)
+		{
+			//the camera probed by an other thread may be this one
+			while(isProbed(i))
+				s_cond.wait();
+			if(isOpen(i))
+				continue;
+			//each probed index is reserved, the other cameras are opened at the same time
+			s_open_indexes.push_back(i);
+			s_probed_indexes.push_back(i);
+			lock.unlock();
+			cam.uiIdxOpen = i;
+			bool found = false;
+			if(TUCAMRET_SUCCESS == TUCAM_Dev_Open(&cam) && NULL != cam.hIdxTUCam)
+			{
+				std::string serial = getSerialNumber(cam.hIdxTUCam);
+				DEB_TRACE() << "Camera at index " << i << " : " << DEB_VAR1(serial);
+				found = (serial == serial_number);
+				if(!found)
+					TUCAM_Dev_Close(cam.hIdxTUCam);
+			}
+			lock.lock();
+			s_probed_indexes.erase(std::find(s_probed_indexes.begin(), s_probed_indexes.end(), i));
+			if(!found)
+			{
+				cam.hIdxTUCam = NULL;
+				s_open_indexes.erase(std::find(s_open_indexes.begin(), s_open_indexes.end(), i));
+			}
+			s_cond.broadcast();
+		}
+		if(NULL == cam.hIdxTUCam)
+		{
+			THROW_HW_ERROR(Error) << "Unable to find the camera " << serial_number << " !";
+		}
+	}
+	DEB_TRACE() << "Camera opened at index " << cam.uiIdxOpen;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+void TucamSdk::close(TUCAM_OPEN& cam)
+{
+	DEB_STATIC_FUNCT();
+	AutoMutex lock(s_cond.mutex());
+	if(NULL == cam.hIdxTUCam)
+		return;
+	DEB_TRACE() << "Close the camera at index " << cam.uiIdxOpen;
+	TUCAM_Dev_Close(cam.hIdxTUCam);
+	cam.hIdxTUCam = NULL;
+	std::vector<int>::iterator it = std::find(s_open_indexes.begin(), s_open_indexes.end(), (int) cam.uiIdxOpen);
+	if(it != s_open_indexes.end())
+		s_open_indexes.erase(it);
+}
+
+//-----------------------------------------------------
+// @brief a camera plugged again is only seen after a new TUCAM_Api_Init
+//-----------------------------------------------------
+bool TucamSdk::refresh()
+{
+	DEB_STATIC_FUNCT();
+	AutoMutex lock(s_cond.mutex());
+	if(s_nb_users <= 0 || !s_open_indexes.empty())
+		return false;
+	DEB_TRACE() << "Enumerate the cameras again ...";
+	TUCAM_Api_Uninit();
+	s_init.uiCamCount = 0;
+	if(TUCAMRET_SUCCESS != TUCAM_Api_Init(&s_init))
+	{
+		s_init.uiCamCount = 0;
+		return false;
+	}
+	DEB_TRACE() << "TUCAM API initialized (nb. camera : " << s_init.uiCamCount << ")";
+	return true;
+}
+
+//-----------------------------------------------------
+//
+//-----------------------------------------------------
+int TucamSdk::getNbCameras()
+{
+	AutoMutex lock(s_cond.mutex());
+	return (s_nb_users > 0) ? (int) s_init.uiCamCount : 0;
+}
+
+int TucamSdk::getNbOpen()
+{
+	AutoMutex lock(s_cond.mutex());
+	return (int) s_open_indexes.size();
+}
+
+std::string TucamSdk::getSerialNumber(HDTUCAM handle)
+{
+	char serial[64] = "";
+	TUCAM_REG_RW reg_rw;
+	reg_rw.nRegType = TUREG_SN;
+	reg_rw.pBuf = serial;
+	reg_rw.nBufSize = sizeof(serial) - 1;
+	if(TUCAMRET_SUCCESS != TUCAM_Reg_Read(handle, reg_rw))
+		return std::string();
+	return std::string(serial);
+}
+
+//-----------------------------------------------------
+// @brief called with s_cond locked
+//-----------------------------------------------------
+bool TucamSdk::isOpen(int index)
+{
+	return std::find(s_open_indexes.begin(), s_open_indexes.end(), index) != s_open_indexes.end();
+}
+
+bool TucamSdk::isProbed(int index)
+{
+	return std::find(s_probed_indexes.begin(), s_probed_indexes.end(), index) != s_probed_indexes.end();
+}
+
+//-----------------------------------------------------
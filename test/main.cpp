@@ -2,6 +2,8 @@
 // This main file was used to troubleshoot significant delays when using Tucsen SDK with Dhyana cameras.
 // It can trigger an acquisition with direct calls to the SDK, or run the acquisition through Lima.
 //#################
+#include <winsock2.h>
+#include <ws2tcpip.h>
 #include <iostream>
 #include <yat/utils/XString.h>
 #include <yat/time/Timer.h>
@@ -20,8 +22,14 @@
 #include <lima/CtAcquisition.h>
 #include <DhyanaBinCtrlObj.h>
 #include <DhyanaInterface.h>
+#include <DhyanaFrameCompressor.h>
+#include <DhyanaSharedFrameReader.h>
+#include <DhyanaFrameStreamServer.h>
 
 #include <ctime>
+#include <random>
+#include <algorithm>
+#include <cmath>
 
 #include "TUCamApi.h"
 #include "TUDefine.h"
@@ -356,13 +364,263 @@ void vanilla_snap()
 	uninit();   
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+//compression benchmark on simulated Dhyana 95 frames (2048x2048, 16 bits) :
+//offset + gaussian read noise + shot noise of a gaussian spot over a flat background
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class BenchmarkCallback : public lima::Dhyana::CompressedFrameCallback
+{
+public:
+	BenchmarkCallback() : nb_errors(0) {}
+	void compressedFrameReady(const lima::Dhyana::CompressedFrame& frame)
+	{
+		//check the first frame only, the decompression is not optimized
+		if(frame.frame_nb != 0)
+			return;
+		std::vector<unsigned short> back(frame.width * frame.height);
+		if(!codec.decompress(frame.data, frame.size, sizeof(unsigned short), &back[0], back.size() * sizeof(unsigned short))
+		   || back != *reference)
+			nb_errors++;
+	}
+	lima::Dhyana::BitshuffleLz4 codec;
+	const std::vector<unsigned short>* reference;
+	int nb_errors;
+};
+
+void simulate_frame(std::vector<unsigned short>& frame, int width, int height, double background, double peak, unsigned seed)
+{
+	std::mt19937 generator(seed);
+	std::normal_distribution<double> read_noise(0., 1.6);
+	frame.resize(width * height);
+	for(int y = 0; y < height; y++)
+	{
+		for(int x = 0; x < width; x++)
+		{
+			double dx = x - width / 2.;
+			double dy = y - height / 2.;
+			double signal = background + peak * std::exp(-(dx * dx + dy * dy) / (2. * 200. * 200.));
+			//shot noise, gaussian approximation
+			double value = 100. + signal + std::sqrt(signal) * read_noise(generator) / 1.6 + read_noise(generator);
+			frame[y * width + x] = (unsigned short) std::min(std::max(value + 0.5, 0.), 65535.);
+		}
+	}
+}
+
+void compression_benchmark()
+{
+	const int width = 2048;
+	const int height = 2048;
+	const int nb_frames = 16;
+	const size_t nb_pixels = (size_t) width * height;
+	const double frame_mb = nb_pixels * sizeof(unsigned short) / 1e6;
+	const double levels[][2] = {{0., 0.}, {20., 200.}, {200., 4000.}};	//dark, low light, bright spot
+	const char* names[] = {"dark", "low light", "bright spot"};
+
+	for(int l = 0; l < 3; l++)
+	{
+		std::vector<unsigned short> frame;
+		simulate_frame(frame, width, height, levels[l][0], levels[l][1], l + 1);
+
+		//single thread
+		lima::Dhyana::BitshuffleLz4 codec;
+		std::vector<unsigned char> chunk(lima::Dhyana::BitshuffleLz4::maxCompressedSize(nb_pixels, sizeof(unsigned short), 0));
+		size_t size = 0;
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		for(int i = 0; i < nb_frames; i++)
+			size = codec.compress(&frame[0], nb_pixels, sizeof(unsigned short), 0, &chunk[0]);
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		std::cout << names[l] << " : ratio " << frame_mb * 1e6 / size
+				  << ", 1 thread " << nb_frames * frame_mb / elapsed << " MB/s" << std::endl;
+
+		//thread pool, all the frames are queued
+		for(int nb_threads = 2; nb_threads <= 8; nb_threads *= 2)
+		{
+			lima::Dhyana::FrameCompressor compressor;
+			BenchmarkCallback cb;
+			cb.reference = &frame;
+			compressor.registerCallback(cb);
+			compressor.setNbThreads(nb_threads);
+			compressor.setQueueDepth(nb_frames);
+			compressor.setEnable(true);
+			t0 = std::chrono::steady_clock::now();
+			for(int i = 0; i < nb_frames; i++)
+				compressor.push(&frame[0], lima::Bpp16, width, height, i);
+			compressor.flush();
+			elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			compressor.setEnable(false);
+			compressor.unregisterCallback(cb);
+			std::cout << "\t" << nb_threads << " threads " << nb_frames * frame_mb / elapsed << " MB/s"
+					  << ((cb.nb_errors) ? " (DECOMPRESSION ERROR)" : "") << std::endl;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+//consumer of the shared memory ring (setSharedMemory), run beside the device server
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void shared_memory_reader(const std::string& name)
+{
+	lima::Dhyana::SharedFrameReader reader;
+	std::cout << "Wait for the shared memory " << name << " ..." << std::endl;
+	while(!reader.open(name))
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	lima::Dhyana::SharedFrame frame;
+	long long nb_frames = 0;
+	long long nb_overwritten = 0;
+	double mean = 0.;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	while(true)
+	{
+		if(!reader.next(frame))
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			continue;
+		}
+
+		//the frame is read in place, the result is kept only if the slot was not rewritten meanwhile
+		double sum = 0.;
+		if(frame.image_type == lima::Bpp16)
+		{
+			const unsigned short* pixels = (const unsigned short *) frame.data;
+			for(unsigned int i = 0; i < frame.size / sizeof(unsigned short); i++)
+				sum += pixels[i];
+		}
+		if(!reader.isValid(frame))
+		{
+			nb_overwritten++;
+			continue;
+		}
+		nb_frames++;
+		mean = sum * sizeof(unsigned short) / frame.size;
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if(elapsed >= 1.)
+		{
+			std::cout << "frame " << frame.frame_nb << " (" << frame.width << "x" << frame.height << ")"
+					  << " : " << nb_frames / elapsed << " fps, mean " << mean
+					  << ", lost " << reader.getNbLost() << ", overwritten " << nb_overwritten << std::endl;
+			nb_frames = 0;
+			t0 = std::chrono::steady_clock::now();
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+//subscriber of the TCP streaming (setStreaming), e.g. over loopback beside the device server
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool receive_all(SOCKET s, void* data, size_t size)
+{
+	char* p = (char *) data;
+	while(size > 0)
+	{
+		int received = recv(s, p, (int) size, 0);
+		if(received <= 0)
+			return false;
+		p += received;
+		size -= received;
+	}
+	return true;
+}
+
+void stream_client(const std::string& host, int port)
+{
+	WSADATA wsa_data;
+	WSAStartup(MAKEWORD(2, 2), &wsa_data);
+	SOCKET s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = htons((u_short) port);
+	inet_pton(AF_INET, host.c_str(), &address.sin_addr);
+	if(connect(s, (const sockaddr *) &address, sizeof(address)) == SOCKET_ERROR)
+	{
+		std::cerr << "Unable to connect to " << host << ":" << port << std::endl;
+		closesocket(s);
+		WSACleanup();
+		return;
+	}
+
+	//latest frames only, 4 frames queued at most on the server side
+	lima::Dhyana::StreamSubscription subscription;
+	memcpy(subscription.magic, STREAM_SUBSCRIPTION_MAGIC, sizeof(subscription.magic));
+	subscription.drop_policy = lima::Dhyana::FrameStreamServer::kDropOldest;
+	subscription.queue_depth = 4;
+	send(s, (const char *) &subscription, sizeof(subscription), 0);
+
+	lima::Dhyana::BitshuffleLz4 codec;
+	lima::Dhyana::StreamFrameHeader header;
+	std::vector<unsigned char> data;
+	std::vector<unsigned char> frame;
+	long long nb_frames = 0;
+	long long nb_missing = 0;
+	double nb_bytes = 0.;
+	long long last_frame_nb = -1;
+	std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+	while(receive_all(s, &header, sizeof(header)))
+	{
+		data.resize(header.data_size);
+		if(header.data_size > 0 && !receive_all(s, &data[0], data.size()))
+			break;
+		if(header.encoding == lima::Dhyana::FrameStreamServer::kBitshuffleLz4)
+		{
+			frame.resize(header.uncompressed_size);
+			size_t elem_size = lima::FrameDim::getImageTypeDepth((lima::ImageType) header.image_type);
+			if(!codec.decompress(&data[0], data.size(), elem_size, &frame[0], frame.size()))
+				std::cerr << "Unable to decompress the frame " << header.frame_nb << std::endl;
+		}
+		if(last_frame_nb >= 0 && header.frame_nb > last_frame_nb + 1)
+			nb_missing += header.frame_nb - last_frame_nb - 1;
+		last_frame_nb = header.frame_nb;
+		nb_frames++;
+		nb_bytes += sizeof(header) + header.data_size;
+
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if(elapsed >= 1.)
+		{
+			std::cout << "frame " << header.frame_nb << " (" << header.width << "x" << header.height << ")"
+					  << " : " << nb_frames / elapsed << " fps, " << nb_bytes / elapsed / 1e6 << " MB/s"
+					  << ", missing " << nb_missing << std::endl;
+			nb_frames = 0;
+			nb_bytes = 0.;
+			t0 = std::chrono::steady_clock::now();
+		}
+	}
+	std::cout << "Disconnected" << std::endl;
+	closesocket(s);
+	WSACleanup();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 int main(int argc, char* argv[])
 {
-	std::cout<<"usage : MainDhyana.exe exptime_ms nbframes nbloops [path+filename to save image, if this arg is empty, then saving is disabled]\n"<<std::endl;
+	std::cout<<"usage : MainDhyana.exe exptime_ms nbframes nbloops [path+filename to save image, if this arg is empty, then saving is disabled]"<<std::endl;
+	std::cout<<"        MainDhyana.exe compression_benchmark"<<std::endl;
+	std::cout<<"        MainDhyana.exe shared_memory_reader [name of the shared memory]"<<std::endl;
+	std::cout<<"        MainDhyana.exe stream_client [host [port]]\n"<<std::endl;
     try
 	{
+		if(argc > 1 && std::string(argv[1]) == "compression_benchmark")
+		{
+			compression_benchmark();
+			return 0;
+		}
+		if(argc > 1 && std::string(argv[1]) == "shared_memory_reader")
+		{
+			shared_memory_reader((argc > 2) ? std::string(argv[2]) : std::string("Local\\DhyanaFrames"));
+			return 0;
+		}
+		if(argc > 1 && std::string(argv[1]) == "stream_client")
+		{
+			stream_client((argc > 2) ? std::string(argv[2]) : std::string("127.0.0.1"),
+						  (argc > 3) ? yat::StringUtil::to_num<int>(std::string(argv[3])) : 9999);
+			return 0;
+		}
+
 		//decode program user inputs 
 		if(argc > 1)
 			m_exp_time_ms 		= yat::StringUtil::to_num<unsigned>(std::string(argv[1]));				